@@ -12,6 +12,9 @@ SOURCES += \
     PeerConnection.cpp \
     QFlowLayout.cpp \
     TcpAgentServer.cpp \
+    analysiscache.cpp \
+    analysisjob.cpp \
+    asynclogger.cpp \
     clientpeerswindow.cpp \
     commandadapter.cpp \
     commhelper.cpp \
@@ -22,6 +25,7 @@ SOURCES += \
     energycalibration.cpp \
     globalsettings.cpp \
     localsettingwindow.cpp \
+    logview.cpp \
     main.cpp \
     mainwindow.cpp \
     neutronyieldcalibration.cpp \
@@ -31,13 +35,23 @@ SOURCES += \
     particalwindow.cpp \
     qcomboboxdelegate.cpp \
     qhuaweiswitcherhelper.cpp \
+    roi909estimator.cpp \
+    rollingseries.cpp \
+    spectrumkernels.cpp \
+    spectrumlod.cpp \
+    spectrumquery.cpp \
     switchbutton.cpp \
-    sysutils.cpp
+    sysutils.cpp \
+    tracezone.cpp
 
 HEADERS += \
     PeerConnection.h \
     QFlowLayout.h \
     TcpAgentServer.h \
+    analysiscache.h \
+    analysisjob.h \
+    asynclogger.h \
+    chunkedvector.h \
     clientpeerswindow.h \
     commandadapter.h \
     countratestatisticswindow.h \
@@ -45,7 +59,9 @@ HEADERS += \
     dataprocessor.h \
     detsettingwindow.h \
     energycalibration.h \
+    lmsolver.h \
     localsettingwindow.h \
+    logview.h \
     neutronyieldcalibration.h \
     neutronyieldstatisticswindow.h \
     offlinewindow.h \
@@ -54,11 +70,17 @@ HEADERS += \
     qcomboboxdelegate.h \
     qhuaweiswitcherhelper.h \
     qlitethread.h \
+    roi909estimator.h \
+    rollingseries.h \
+    spectrumkernels.h \
+    spectrumlod.h \
+    spectrumquery.h \
     commhelper.h \
     globalsettings.h \
     mainwindow.h \
     switchbutton.h \
-    sysutils.h
+    sysutils.h \
+    tracezone.h
 
 FORMS += \
     clientpeerswindow.ui \
@@ -130,6 +152,8 @@ DEFINES += GIT_DATE=\"\\\"$$GIT_DATE\\\"\"
 DEFINES += GIT_HASH=\"\\\"$$GIT_HASH\\\"\"
 DEFINES += GIT_VERSION=\"\\\"$$GIT_VERSION\\\"\"
 DEFINES += APP_VERSION="\\\"V1.0.1\\\""
+# release版本也保留日志调用点（文件:行号），异步日志按调用点限流
+DEFINES += QT_MESSAGELOGCONTEXT
 
 windows {
     # MinGW
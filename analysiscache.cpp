@@ -0,0 +1,138 @@
+#include "analysiscache.h"
+#include "globalsettings.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDebug>
+
+// 缓存目录
+#define ANALYSIS_CACHE_DIR "./cache/AnalysisResult"
+
+// 文件头标识及版本号，解析算法或缓存格式变化时增加版本号，旧缓存自动失效
+// 2：剥谱改用CurveFit::fit_strip（线性初值+LM，不合理时改用alglib），结果与版本1不同
+const quint32 cacheMagic = 0x5A524143; // "ZRAC"
+const quint32 cacheVersion = 2;
+
+QString AnalysisCache::key(const QString& filePath, int detectorId, const Parameters& parameters)
+{
+    QFileInfo fileInfo(filePath);
+    if (!fileInfo.exists())
+        return QString();
+
+    quint64 rows = 0, columns = 0;
+    if (fileInfo.suffix() == "H5")
+        HDF5Settings::readH5SpectrumDims(filePath.toStdString(), detectorId, rows, columns);
+
+    QByteArray identity;
+    QDataStream stream(&identity, QIODevice::WriteOnly);
+    stream << cacheVersion
+           << fileInfo.absoluteFilePath()
+           << fileInfo.size()
+           << fileInfo.lastModified().toMSecsSinceEpoch()
+           << rows << columns
+           << detectorId
+           << parameters.measureTime << parameters.timeStep << parameters.startTime << parameters.endTime;
+
+    return QCryptographicHash::hash(identity, QCryptographicHash::Sha1).toHex();
+}
+
+QString AnalysisCache::cacheFilePath(const QString& key)
+{
+    return QString(ANALYSIS_CACHE_DIR) + "/" + key + ".dat";
+}
+
+ParseResultSnapshotPtr AnalysisCache::load(const QString& key)
+{
+    if (key.isEmpty())
+        return ParseResultSnapshotPtr();
+
+    QFile file(cacheFilePath(key));
+    if (!file.open(QIODevice::ReadOnly))
+        return ParseResultSnapshotPtr();
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_15);
+
+    quint32 magic = 0, version = 0;
+    stream >> magic >> version;
+    if (magic != cacheMagic || version != cacheVersion)
+        return ParseResultSnapshotPtr();
+
+    QSharedPointer<ParseResultSnapshot> snapshot(new ParseResultSnapshot());
+
+    // 分时能谱按结构体原样存放
+    qint32 specCount = 0;
+    stream >> specCount;
+    if (specCount < 0)
+        return ParseResultSnapshotPtr();
+
+    // 按文件剩余长度检查个数，避免文件损坏时按错误的个数分配内存
+    qint64 specBytes = qint64(specCount) * qint64(sizeof(ParseData::mergeSpecData));
+    if (specBytes > file.size() - file.pos())
+    {
+        qWarning() << "解析结果缓存已损坏：" << file.fileName();
+        return ParseResultSnapshotPtr();
+    }
+    snapshot->mergeSpec.resize(specCount);
+    for (int chunk = 0; chunk < snapshot->mergeSpec.chunkCount(); ++chunk)
+    {
+        int bytes = snapshot->mergeSpec.chunkLength(chunk) * int(sizeof(ParseData::mergeSpecData));
+        if (stream.readRawData(reinterpret_cast<char*>(snapshot->mergeSpec.chunkData(chunk)), bytes) != bytes)
+            return ParseResultSnapshotPtr();
+    }
+
+    stream >> snapshot->count909_time >> snapshot->count909_count >> snapshot->count909_fitcount >> snapshot->count909_residual
+           >> snapshot->decayFitC0
+           >> snapshot->strip_x >> snapshot->strip_y >> snapshot->strip_fity >> snapshot->strip_residualRate
+           >> snapshot->strip_rightCH;
+
+    if (stream.status() != QDataStream::Ok)
+    {
+        qWarning() << "解析结果缓存已损坏：" << file.fileName();
+        return ParseResultSnapshotPtr();
+    }
+
+    return snapshot;
+}
+
+bool AnalysisCache::save(const QString& key, ParseResultSnapshotPtr snapshot)
+{
+    if (key.isEmpty() || !snapshot)
+        return false;
+
+    QDir().mkpath(ANALYSIS_CACHE_DIR);
+
+    // 先写临时文件再替换，避免并行解析或异常退出时留下不完整的缓存
+    QSaveFile file(cacheFilePath(key));
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_15);
+    stream << cacheMagic << cacheVersion;
+
+    qint32 specCount = snapshot->mergeSpec.size();
+    stream << specCount;
+    for (int chunk = 0; chunk < snapshot->mergeSpec.chunkCount(); ++chunk)
+    {
+        stream.writeRawData(reinterpret_cast<const char*>(snapshot->mergeSpec.chunkData(chunk)),
+                            snapshot->mergeSpec.chunkLength(chunk) * int(sizeof(ParseData::mergeSpecData)));
+    }
+
+    stream << snapshot->count909_time << snapshot->count909_count << snapshot->count909_fitcount << snapshot->count909_residual
+           << snapshot->decayFitC0
+           << snapshot->strip_x << snapshot->strip_y << snapshot->strip_fity << snapshot->strip_residualRate
+           << snapshot->strip_rightCH;
+
+    if (stream.status() != QDataStream::Ok)
+    {
+        file.cancelWriting();
+        return false;
+    }
+
+    return file.commit();
+}
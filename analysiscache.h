@@ -0,0 +1,45 @@
+/*
+ * @Author: MrPan
+ * @Date: 2026-02-06 10:05:18
+ * @LastEditors: Maoxiaoqing
+ * @LastEditTime: 2026-02-06 10:05:18
+ * @Description: 解析结果磁盘缓存。以测量文件标识（大小、修改时间、数据集维度）、谱仪编号和解析参数为键，
+ *               保存分时能谱、剥谱曲线和909keV计数曲线，参数不变时再次解析直接读取缓存
+ */
+#ifndef ANALYSISCACHE_H
+#define ANALYSISCACHE_H
+
+#include <QString>
+#include "parsedata.h"
+
+class AnalysisCache
+{
+public:
+    // 解析参数，与ParseData::setStartTime/getResult_offline的参数一致
+    struct Parameters{
+        qint64 measureTime = 0; //测量开始时刻相对打靶时刻，单位s
+        int timeStep = 0;       //单位s
+        int startTime = 0;      //单位s
+        int endTime = 0;        //单位s
+    };
+
+    /**
+     * @brief key 计算缓存键
+     * @param filePath 测量文件路径
+     * @param detectorId 谱仪编号
+     * @param parameters 解析参数
+     * @return 文件不存在时返回空字符串
+     */
+    static QString key(const QString& filePath, int detectorId, const Parameters& parameters);
+
+    // 读取缓存，不存在或格式不符时返回空指针
+    static ParseResultSnapshotPtr load(const QString& key);
+
+    // 保存解析结果
+    static bool save(const QString& key, ParseResultSnapshotPtr snapshot);
+
+private:
+    static QString cacheFilePath(const QString& key);
+};
+
+#endif // ANALYSISCACHE_H
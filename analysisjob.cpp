@@ -0,0 +1,92 @@
+#include "analysisjob.h"
+#include "qlitethread.h"
+#include <QDebug>
+
+// 进度上报的最小时间间隔，单位ms
+const int progressInterval = 100;
+
+bool AnalysisJob::Context::isCanceled() const
+{
+    return mJob->mInterrupted->load();
+}
+
+void AnalysisJob::Context::setProgress(qint64 done, qint64 total, const QString &stage)
+{
+    {
+        QMutexLocker locker(&mMutex);
+        // 最后一次进度总是上报，其余按时间间隔限流
+        if (done < total && mProgressTimer.isValid() && mProgressTimer.elapsed() < progressInterval)
+            return;
+        mProgressTimer.restart();
+    }
+
+    emit mJob->progress(done, total, stage);
+}
+
+void AnalysisJob::Context::postPartial(const QVariant &data)
+{
+    emit mJob->partialResult(data);
+}
+
+void AnalysisJob::Context::setResult(const QVariant &result)
+{
+    QMutexLocker locker(&mMutex);
+    mResult = result;
+}
+
+AnalysisJob::AnalysisJob(std::atomic<bool>* interrupted, QObject *parent)
+    : QObject{parent}
+    , mInterrupted(interrupted)
+{
+    qRegisterMetaType<QVariant>("QVariant");
+}
+
+AnalysisJob::~AnalysisJob()
+{
+    // 窗口关闭时中断并等待工作线程退出，避免线程访问已释放的对象
+    if (mRunning && mThread)
+    {
+        cancel();
+        mThread->wait();
+    }
+}
+
+bool AnalysisJob::start(JobProc proc)
+{
+    if (mRunning)
+        return false;
+
+    mInterrupted->store(false);
+    mRunning = true;
+
+    mThread = new QLiteThread(this, [=](){
+        Context context(this);
+        bool success = false;
+        try {
+            success = proc(context);
+        } catch (const std::exception& e) {
+            qCritical() << "分析任务异常：" << e.what();
+            success = false;
+        }
+
+        bool canceled = mInterrupted->load();
+        QVariant result;
+        {
+            QMutexLocker locker(&context.mMutex);
+            result = context.mResult;
+        }
+
+        QMetaObject::invokeMethod(this, [=](){
+            mRunning = false;
+            mThread = nullptr;
+            emit finished(success && !canceled, canceled, result);
+        }, Qt::QueuedConnection);
+    });
+    mThread->start();
+    return true;
+}
+
+void AnalysisJob::cancel()
+{
+    mInterrupted->store(true);
+}
@@ -0,0 +1,86 @@
+/*
+ * @Author: MrPan
+ * @Date: 2026-02-04 09:30:12
+ * @LastEditors: Maoxiaoqing
+ * @LastEditTime: 2026-02-04 09:30:12
+ * @Description: 后台分析任务，在工作线程中执行文件解析/拟合，支持进度上报、协作式中断以及中间结果推送
+ */
+#ifndef ANALYSISJOB_H
+#define ANALYSISJOB_H
+
+#include <QObject>
+#include <QVariant>
+#include <QMutex>
+#include <QElapsedTimer>
+#include <atomic>
+#include <functional>
+
+class AnalysisJob : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief 任务上下文，仅在工作线程中使用，各方法均可在线程池的多个线程中同时调用
+     */
+    class Context
+    {
+    public:
+        // 是否已请求中断，行循环/拟合循环中应定期检查
+        bool isCanceled() const;
+
+        /**
+         * @brief setProgress 上报进度，内部限制上报频率，不会频繁刷新界面
+         * @param done 已完成数量（读取行数、已拟合能谱段数等）
+         * @param total 总数
+         * @param stage 当前阶段描述
+         */
+        void setProgress(qint64 done, qint64 total, const QString& stage = QString());
+
+        // 推送中间结果，界面收到后可先行刷新曲线
+        void postPartial(const QVariant& data);
+
+        // 设置最终结果，随finished信号一起发出
+        void setResult(const QVariant& result);
+
+    private:
+        friend class AnalysisJob;
+        explicit Context(AnalysisJob* job) : mJob(job) {}
+
+        AnalysisJob* mJob = nullptr;
+        QVariant mResult;
+        QMutex mMutex;
+        QElapsedTimer mProgressTimer;
+    };
+
+    typedef std::function<bool(Context&)> JobProc;
+
+    /**
+     * @param interrupted 中断标志，一般传入窗口的mInterrupted，置为true即中断任务
+     */
+    explicit AnalysisJob(std::atomic<bool>* interrupted, QObject *parent = nullptr);
+    ~AnalysisJob();
+
+    /**
+     * @brief start 启动任务，上一个任务未结束时返回false
+     * @param proc 任务函数，在工作线程中执行，返回是否成功
+     */
+    bool start(JobProc proc);
+
+    // 请求中断
+    void cancel();
+
+    bool isRunning() const { return mRunning; }
+
+signals:
+    void progress(qint64 done, qint64 total, const QString& stage);
+    void partialResult(const QVariant& data);
+    void finished(bool success, bool canceled, const QVariant& result);
+
+private:
+    std::atomic<bool>* mInterrupted = nullptr;
+    std::atomic<bool> mRunning = false;
+    class QLiteThread* mThread = nullptr;
+};
+
+#endif // ANALYSISJOB_H
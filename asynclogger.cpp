@@ -0,0 +1,329 @@
+#include "asynclogger.h"
+#include "globalsettings.h"
+#include "qlitethread.h"
+#include <QDateTime>
+
+Q_LOGGING_CATEGORY(lcSpectrum, "zr.spectrum")
+Q_LOGGING_CATEGORY(lcPacket, "zr.packet")
+
+// 队列容量，必须为2的幂
+const int queueCapacity = 8192;
+
+int logSeverity(QtMsgType type)
+{
+    switch (type) {
+    case QtDebugMsg: return 0;
+    case QtInfoMsg: return 1;
+    case QtWarningMsg: return 2;
+    case QtCriticalMsg: return 3;
+    default: return 4;
+    }
+}
+
+AsyncLogger* AsyncLogger::instance()
+{
+    static AsyncLogger logger;
+    return &logger;
+}
+
+AsyncLogger::AsyncLogger(QObject *parent)
+    : QObject{parent}
+    , mCells(new Cell[queueCapacity])
+    , mMask(queueCapacity - 1)
+    , mEnqueuePos(0)
+    , mDropped(0)
+    , mRunning(false)
+    , mStopRequested(false)
+{
+    for (int i = 0; i < queueCapacity; ++i)
+        mCells[i].sequence.store(i, std::memory_order_relaxed);
+
+    qRegisterMetaType<LogMessage>("LogMessage");
+    qRegisterMetaType<QVector<LogMessage>>("QVector<LogMessage>");
+}
+
+AsyncLogger::~AsyncLogger()
+{
+    stop();
+}
+
+void AsyncLogger::start(QtMessageHandler downstream)
+{
+    if (mRunning)
+        return;
+
+    mDownstream = downstream;
+
+    GlobalSettings settings(CONFIG_FILENAME);
+    settings.beginGroup("Log");
+    mFlushInterval = qBound(10, settings.value("FlushInterval", 50).toInt(), 1000);
+    setRateLimit(settings.value("RateLimitBurst", 5).toInt(), settings.value("RateLimitInterval", 1000).toInt());
+    settings.beginGroup("Levels");
+    for (const QString& category : settings.childKeys())
+    {
+        QString level = settings.value(category).toString().toLower();
+        QtMsgType minType = QtDebugMsg;
+        if (level == "info")
+            minType = QtInfoMsg;
+        else if (level == "warning")
+            minType = QtWarningMsg;
+        else if (level == "critical")
+            minType = QtCriticalMsg;
+        setCategoryLevel(category, minType);
+    }
+    settings.endGroup();
+    settings.endGroup();
+
+    mStopRequested = false;
+    mRunning = true;
+    mThread = new QLiteThread();
+    mThread->setObjectName("asyncLoggerThread");
+    mThread->setWorkThreadProc([=](){
+        run();
+    });
+    mThread->start(QThread::LowPriority);
+}
+
+void AsyncLogger::stop()
+{
+    if (!mRunning)
+        return;
+
+    mStopRequested = true;
+    mThread->wait();
+    mThread = nullptr;
+    mRunning = false;
+}
+
+void AsyncLogger::setCategoryLevel(const QString &category, QtMsgType minType)
+{
+    mCategoryLevels[category] = minType;
+    applyFilterRules();
+}
+
+void AsyncLogger::applyFilterRules()
+{
+    // 由QLoggingCategory在格式化消息之前过滤，被过滤的qCDebug等几乎没有开销
+    const QtMsgType levels[] = {QtDebugMsg, QtInfoMsg, QtWarningMsg, QtCriticalMsg};
+    const char* names[] = {"debug", "info", "warning", "critical"};
+    QStringList rules;
+    for (auto it = mCategoryLevels.constBegin(); it != mCategoryLevels.constEnd(); ++it)
+    {
+        for (int i = 0; i < 4; ++i)
+            rules << QString("%1.%2=%3").arg(it.key(), names[i], logSeverity(levels[i]) >= logSeverity(it.value()) ? "true" : "false");
+    }
+    QLoggingCategory::setFilterRules(rules.join('\n'));
+}
+
+void AsyncLogger::setRateLimit(int burst, int interval)
+{
+    mBurst = qMax(1, burst);
+    mInterval = qMax(1, interval);
+}
+
+void AsyncLogger::post(QtMsgType type, const QMessageLogContext &context, const QString &msg)
+{
+    LogMessage message;
+    message.type = type;
+    message.text = msg;
+    message.time = QDateTime::currentMSecsSinceEpoch();
+    message.file = context.file;
+    message.line = context.line;
+    message.function = context.function;
+    message.category = context.category;
+
+    // 后台线程未运行（启动前、退出后）时同步写出
+    if (!mRunning)
+    {
+        if (mDownstream)
+            mDownstream(type, context, msg);
+        return;
+    }
+
+    if (!push(message))
+        mDropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool AsyncLogger::push(LogMessage &message)
+{
+    quint64 pos = mEnqueuePos.load(std::memory_order_relaxed);
+    Cell* cell = nullptr;
+    for (;;)
+    {
+        cell = &mCells[pos & mMask];
+        quint64 sequence = cell->sequence.load(std::memory_order_acquire);
+        qint64 diff = qint64(sequence) - qint64(pos);
+        if (diff == 0)
+        {
+            // 抢占该单元，失败时pos被更新为最新的写位置
+            if (mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+        {
+            // 队列已满
+            return false;
+        }
+        else
+        {
+            pos = mEnqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    cell->message = std::move(message);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+bool AsyncLogger::pop(LogMessage &message)
+{
+    Cell* cell = &mCells[mDequeuePos & mMask];
+    if (cell->sequence.load(std::memory_order_acquire) != mDequeuePos + 1)
+        return false;
+
+    message = std::move(cell->message);
+    cell->sequence.store(mDequeuePos + mMask + 1, std::memory_order_release);
+    mDequeuePos++;
+    return true;
+}
+
+void AsyncLogger::run()
+{
+    while (!mStopRequested)
+    {
+        drain();
+        QThread::msleep(mFlushInterval);
+    }
+
+    // 退出前写出剩余消息和被合并的计数
+    drain();
+    flushSuppressed(true);
+    if (!mBatch.isEmpty())
+    {
+        emit messagesReady(mBatch);
+        mBatch.clear();
+    }
+}
+
+void AsyncLogger::drain()
+{
+    LogMessage message;
+    while (pop(message))
+        process(message);
+
+    quint64 dropped = mDropped.exchange(0, std::memory_order_relaxed);
+    if (dropped > 0)
+    {
+        LogMessage notice;
+        notice.type = QtWarningMsg;
+        notice.time = QDateTime::currentMSecsSinceEpoch();
+        notice.text = QString("日志队列已满，丢弃%1条消息").arg(dropped);
+        deliver(notice);
+    }
+
+    flushSuppressed(false);
+
+    // 一次取队列的界面消息合并发送，界面一次插入
+    if (!mBatch.isEmpty())
+    {
+        emit messagesReady(mBatch);
+        mBatch.clear();
+    }
+}
+
+bool AsyncLogger::isRateLimited(const LogMessage &message)
+{
+    // 警告及以上的消息一律原样输出；只对调试消息和每个能谱、每个数据包一条的分类限流
+    if (logSeverity(message.type) >= logSeverity(QtWarningMsg))
+        return false;
+    if (message.type == QtDebugMsg)
+        return true;
+    return message.category && (qstrcmp(message.category, lcSpectrum().categoryName()) == 0
+                                || qstrcmp(message.category, lcPacket().categoryName()) == 0);
+}
+
+void AsyncLogger::process(LogMessage &message)
+{
+    if (!isRateLimited(message))
+    {
+        deliver(message);
+        return;
+    }
+
+    // 以分类+调用点（文件:行号）作为限流的键；没有调用点信息时，
+    // 同一调用点的消息只有其中的数字不同，如"sequenceID=123"，去掉数字后作为键
+    QString key = QString("%1|%2|").arg(message.type).arg(QLatin1String(message.category));
+    if (message.file)
+    {
+        key += QString("%1:%2").arg(QLatin1String(message.file)).arg(message.line);
+    }
+    else
+    {
+        key.reserve(key.size() + message.text.size());
+        for (const QChar& ch : qAsConst(message.text))
+        {
+            if (!ch.isDigit())
+                key.append(ch);
+        }
+    }
+
+    RateState& state = mRates[key];
+    if (message.time - state.windowStart >= mInterval)
+    {
+        if (state.suppressed > 0)
+            deliverSuppressed(state);
+        state.windowStart = message.time;
+        state.count = 0;
+    }
+
+    if (++state.count <= mBurst)
+    {
+        deliver(message);
+    }
+    else
+    {
+        state.suppressed++;
+        state.last = std::move(message);
+    }
+}
+
+void AsyncLogger::flushSuppressed(bool all)
+{
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    for (auto it = mRates.begin(); it != mRates.end(); )
+    {
+        RateState& state = it.value();
+        bool expired = now - state.windowStart >= mInterval;
+        if (state.suppressed > 0 && (expired || all))
+            deliverSuppressed(state);
+
+        // 长时间没有再出现的调用点不再保留，键的数量有上限
+        if (now - state.windowStart >= 10 * mInterval && state.suppressed == 0)
+            it = mRates.erase(it);
+        else
+            ++it;
+    }
+}
+
+void AsyncLogger::deliverSuppressed(RateState &state)
+{
+    // 被合并的消息以最后一条为代表写出
+    LogMessage summary = std::move(state.last);
+    summary.text += QString(" （%1ms内重复%2次，已省略）").arg(mInterval).arg(state.suppressed);
+    deliver(summary);
+    state.suppressed = 0;
+    state.last = LogMessage();
+}
+
+void AsyncLogger::deliver(const LogMessage &message)
+{
+    if (mDownstream)
+    {
+        QMessageLogContext context(message.file, message.line, message.function, message.category);
+        mDownstream(message.type, context, message.text);
+    }
+
+    // 与原有处理一致，调试消息不显示在界面上
+    if (message.type != QtDebugMsg)
+        mBatch.append(message);
+}
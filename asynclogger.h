@@ -0,0 +1,124 @@
+/*
+ * @Author: MrPan
+ * @Date: 2026-02-08 14:05:41
+ * @LastEditors: Maoxiaoqing
+ * @LastEditTime: 2026-02-08 14:05:41
+ * @Description: 异步日志。Qt消息处理函数只把消息写入无锁的多生产者队列，由后台线程取出后按调用点限流、
+ *               写入log4qt并批量转发到界面，采集/解析线程打印日志时不加锁、不做文件IO、不等待界面。
+ */
+#ifndef ASYNCLOGGER_H
+#define ASYNCLOGGER_H
+
+#include <QObject>
+#include <QVector>
+#include <QHash>
+#include <QMap>
+#include <QLoggingCategory>
+#include <atomic>
+#include <memory>
+
+// 高频日志的分类，可按分类设置输出级别（配置文件 Log/Levels/<分类>=debug|info|warning|critical）
+Q_DECLARE_LOGGING_CATEGORY(lcSpectrum) // 每个能谱一条的日志
+Q_DECLARE_LOGGING_CATEGORY(lcPacket)   // 每个网络数据包一条的日志
+
+// 一条日志消息，文件名、函数名、分类名均指向静态字符串
+struct LogMessage {
+    QtMsgType type = QtDebugMsg;
+    QString text;
+    qint64 time = 0; // 产生时刻，ms since epoch
+    const char* file = nullptr;
+    int line = 0;
+    const char* function = nullptr;
+    const char* category = nullptr;
+};
+Q_DECLARE_METATYPE(LogMessage)
+
+// 消息级别的严重程度：调试0、信息1、警告2、错误3、致命4，QtMsgType的枚举值不是按严重程度排列的
+int logSeverity(QtMsgType type);
+
+class QLiteThread;
+class AsyncLogger : public QObject
+{
+    Q_OBJECT
+public:
+    static AsyncLogger* instance();
+
+    /**
+     * @brief start 启动后台线程，读取Log配置
+     * @param downstream 原有的消息处理函数（log4qt），在后台线程中调用
+     */
+    void start(QtMessageHandler downstream);
+
+    // 停止后台线程，队列中剩余的消息全部写出；之后的消息直接同步写出
+    void stop();
+
+    /**
+     * @brief post 在Qt消息处理函数中调用，不加锁；队列满时丢弃并计数，由后台线程报告丢弃条数
+     */
+    void post(QtMsgType type, const QMessageLogContext& context, const QString& msg);
+
+    /**
+     * @brief setCategoryLevel 设置分类的最低输出级别，低于该级别的qCDebug/qCInfo等不再格式化消息
+     * @param category 分类名，"default"对应qDebug/qInfo等
+     * @param minType 最低级别，QtDebugMsg为全部输出
+     */
+    void setCategoryLevel(const QString& category, QtMsgType minType);
+
+    /**
+     * @brief setRateLimit 设置限流：调试消息及zr.spectrum、zr.packet分类的消息，同一分类、同一调用点
+     * 每interval毫秒最多输出burst条，其余合并为一条“重复N次”的消息；警告及以上的消息不限流
+     */
+    void setRateLimit(int burst, int interval);
+
+signals:
+    // 一批需要显示在界面上的消息（不含调试消息），在后台线程中发出
+    void messagesReady(const QVector<LogMessage>& messages);
+
+private:
+    explicit AsyncLogger(QObject* parent = nullptr);
+    ~AsyncLogger();
+
+    bool push(LogMessage& message);
+    bool pop(LogMessage& message);
+    void run();
+    void drain();
+    void process(LogMessage& message);
+    static bool isRateLimited(const LogMessage& message);
+    void applyFilterRules();
+
+    // 有界无锁队列（多生产者单消费者），每个单元的序号表示单元当前可写还是可读
+    struct Cell {
+        std::atomic<quint64> sequence;
+        LogMessage message;
+    };
+    std::unique_ptr<Cell[]> mCells;
+    quint64 mMask = 0;
+    std::atomic<quint64> mEnqueuePos;
+    quint64 mDequeuePos = 0; // 只在后台线程中访问
+    std::atomic<quint64> mDropped;
+
+    QtMessageHandler mDownstream = nullptr;
+    std::atomic<bool> mRunning;
+    std::atomic<bool> mStopRequested;
+    QLiteThread* mThread = nullptr;
+    int mFlushInterval = 50; // 后台线程取队列的时间间隔，ms
+
+    // 限流状态，只在后台线程中访问
+    struct RateState {
+        qint64 windowStart = 0;
+        int count = 0;
+        int suppressed = 0;
+        LogMessage last;
+    };
+    QHash<QString, RateState> mRates;
+    void flushSuppressed(bool all);
+    void deliverSuppressed(RateState& state);
+    void deliver(const LogMessage& message);
+    int mBurst = 5;
+    int mInterval = 1000;
+    QVector<LogMessage> mBatch;
+
+    QMap<QString, QtMsgType> mCategoryLevels;
+};
+
+#endif // ASYNCLOGGER_H
@@ -0,0 +1,117 @@
+/*
+ * @Author: MrPan
+ * @Date: 2026-02-09 16:32:08
+ * @LastEditors: Maoxiaoqing
+ * @LastEditTime: 2026-02-09 16:32:08
+ * @Description: 按块存放的只追加数组。每块ChunkSize个元素，由QSharedPointer持有，复制数组只复制块指针；
+ *               复制出的数组与原数组共享已有的块，原数组之后在末尾追加、修改尚未被复制出的元素都不会引起整体复制。
+ *               用于解析线程不断追加、界面线程只读已发布部分的解析结果（ParseResultSnapshot）：
+ *               发布时用prefix(count)给出前count个元素，解析线程只写入下标不小于count的元素，二者不会访问同一元素。
+ */
+#ifndef CHUNKEDVECTOR_H
+#define CHUNKEDVECTOR_H
+
+#include <QDataStream>
+#include <QSharedPointer>
+#include <QVector>
+#include <array>
+
+template<typename T, int ChunkSize>
+class ChunkedVector
+{
+public:
+    int size() const { return mSize; }
+    bool isEmpty() const { return mSize == 0; }
+
+    const T& at(int i) const { return (*mChunks.at(i / ChunkSize))[i % ChunkSize]; }
+    const T& operator[](int i) const { return at(i); }
+
+    // 写入元素，只能写入尚未发布到快照中的元素
+    T& operator[](int i) { return (*mChunks[i / ChunkSize])[i % ChunkSize]; }
+    T& last() { return (*this)[mSize - 1]; }
+
+    void append(const T& value)
+    {
+        if (mSize == mChunks.size() * ChunkSize)
+            mChunks.append(QSharedPointer<Chunk>(new Chunk()));
+        (*this)[mSize++] = value;
+    }
+
+    void append(const QVector<T>& values)
+    {
+        for (const T& value : values)
+            append(value);
+    }
+
+    // 只增长，新增元素为默认值
+    void resize(int size)
+    {
+        while (mChunks.size() * ChunkSize < size)
+            mChunks.append(QSharedPointer<Chunk>(new Chunk()));
+        mSize = qMax(mSize, size);
+    }
+
+    // 释放本数组持有的块，已复制出的数组仍持有各自的块
+    void clear()
+    {
+        mChunks.clear();
+        mSize = 0;
+    }
+
+    // 前count个元素，与本数组共享块
+    ChunkedVector prefix(int count) const
+    {
+        ChunkedVector result;
+        result.mSize = qBound(0, count, mSize);
+        result.mChunks = mChunks.mid(0, (result.mSize + ChunkSize - 1) / ChunkSize);
+        return result;
+    }
+
+    // 复制[first, first+length)为连续数组
+    QVector<T> mid(int first, int length) const
+    {
+        QVector<T> result;
+        result.reserve(length);
+        for (int i = first; i < first + length; ++i)
+            result.append(at(i));
+        return result;
+    }
+
+    // 按块遍历连续存放的元素，块内元素连续，用于整块读写文件
+    int chunkCount() const { return (mSize + ChunkSize - 1) / ChunkSize; }
+    int chunkLength(int chunk) const { return qMin(ChunkSize, mSize - chunk * ChunkSize); }
+    const T* chunkData(int chunk) const { return mChunks.at(chunk)->data(); }
+    T* chunkData(int chunk) { return mChunks[chunk]->data(); }
+
+private:
+    typedef std::array<T, ChunkSize> Chunk;
+    QVector<QSharedPointer<Chunk>> mChunks;
+    int mSize = 0;
+};
+
+// 与QVector<T>的流格式相同
+template<typename T, int ChunkSize>
+QDataStream& operator<<(QDataStream& stream, const ChunkedVector<T, ChunkSize>& vector)
+{
+    stream << quint32(vector.size());
+    for (int i = 0; i < vector.size(); ++i)
+        stream << vector.at(i);
+    return stream;
+}
+
+template<typename T, int ChunkSize>
+QDataStream& operator>>(QDataStream& stream, ChunkedVector<T, ChunkSize>& vector)
+{
+    vector.clear();
+    quint32 size = 0;
+    stream >> size;
+    for (quint32 i = 0; i < size && stream.status() == QDataStream::Ok; ++i)
+    {
+        T value;
+        stream >> value;
+        vector.append(value);
+    }
+    return stream;
+}
+
+#endif // CHUNKEDVECTOR_H
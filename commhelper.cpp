@@ -518,16 +518,21 @@ void CommHelper::connectSwitcher(bool query)
         QString ip = settings.value(QString("Switcher/%1/ip").arg(i+1), "").toString();
         QString ass = settings.value(QString("Switcher/%1/detector").arg(i+1), "").toString();
         QHuaWeiSwitcherHelper* huaWeiSwitcherHelper = new QHuaWeiSwitcherHelper(ip);
+        huaWeiSwitcherHelper->setPort(settings.value(QString("Switcher/%1/port").arg(i+1), 23).toUInt());
         huaWeiSwitcherHelper->setAssociatedDetector(ass);
 
         connect(huaWeiSwitcherHelper, &QHuaWeiSwitcherHelper::switcherLogged, this, &CommHelper::switcherLogged);
         connect(huaWeiSwitcherHelper, &QHuaWeiSwitcherHelper::switcherConnected, this, &CommHelper::switcherConnected);
         connect(huaWeiSwitcherHelper, &QHuaWeiSwitcherHelper::switcherDisconnected, this, &CommHelper::switcherDisconnected);
         connect(huaWeiSwitcherHelper, &QHuaWeiSwitcherHelper::reportPoePowerStatus, this, &CommHelper::reportPoePowerStatus);
+        connect(huaWeiSwitcherHelper, &QHuaWeiSwitcherHelper::poeBatchFinished, this, &CommHelper::onPoeBatchFinished);
 
         mHuaWeiSwitcherHelper.push_back(huaWeiSwitcherHelper);
     }
 
+    // 各交换机各自的telnet连接并行登录、上电
+    if (!query)
+        startPoeBatchTiming(mHuaWeiSwitcherHelper.size());
     for (auto switcherHelper : mHuaWeiSwitcherHelper)
     {
         if (query)
@@ -551,6 +556,7 @@ void CommHelper::openPower()
 {
     GlobalSettings settings(CONFIG_FILENAME);
     mHuaWeiSwitcherCount =  settings.value("Switcher/Count", 0).toUInt();
+    int started = 0;
     for (int i=0; i<mHuaWeiSwitcherCount; ++i){
         QString ip = settings.value(QString("Switcher/%1/ip").arg(i+1), "").toString();
         QString ass = settings.value(QString("Switcher/%1/detector").arg(i+1), "").toString();
@@ -558,10 +564,12 @@ void CommHelper::openPower()
         {
             if (switcherHelper->ip() == ip){
                 switcherHelper->setAssociatedDetector(ass);
-                switcherHelper->openSwitcherPOEPower(0x00);
+                if (switcherHelper->openSwitcherPOEPower(0x00))
+                    started++;
             }
         }
     }
+    startPoeBatchTiming(started);
 }
 /*
  断开电源
@@ -570,6 +578,7 @@ void CommHelper::closePower(bool disconnect)
 {
     GlobalSettings settings(CONFIG_FILENAME);
     mHuaWeiSwitcherCount =  settings.value("Switcher/Count", 0).toUInt();
+    int started = 0;
     for (int i=0; i<mHuaWeiSwitcherCount; ++i){
         QString ip = settings.value(QString("Switcher/%1/ip").arg(i+1), "").toString();
         QString ass = settings.value(QString("Switcher/%1/detector").arg(i+1), "").toString();
@@ -577,10 +586,39 @@ void CommHelper::closePower(bool disconnect)
         {
             if (switcherHelper->ip() == ip){
                 switcherHelper->setAssociatedDetector(ass);
-                switcherHelper->closeSwitcherPOEPower(0x00, disconnect);
+                if (switcherHelper->closeSwitcherPOEPower(0x00, disconnect))
+                    started++;
             }
         }
     }
+    startPoeBatchTiming(started);
+}
+
+void CommHelper::startPoeBatchTiming(int switcherCount)
+{
+    mPoeBatchPending = switcherCount;
+    mPoeBatchFailed = false;
+    mPoeBatchElapsed.start();
+}
+
+/*
+ 单台交换机批量上电/断电结束，全部交换机结束后输出总耗时
+*/
+void CommHelper::onPoeBatchFinished(QString ip, bool on, int okCount, int failCount, qint64 elapsedMs)
+{
+    Q_UNUSED(ip);
+    Q_UNUSED(okCount);
+    Q_UNUSED(elapsedMs);
+    if (mPoeBatchPending <= 0)
+        return;
+
+    if (failCount > 0)
+        mPoeBatchFailed = true;
+    if (--mPoeBatchPending == 0)
+    {
+        qInfo().noquote() << QString("全部交换机POE%1完成%2，总耗时%3ms")
+                             .arg(on ? "上电" : "断电").arg(mPoeBatchFailed ? "（有端口失败）" : "").arg(mPoeBatchElapsed.elapsed());
+    }
 }
 
 /*
@@ -182,6 +182,12 @@ private:
 
     quint8 mHuaWeiSwitcherCount = 0;
     QList<QHuaWeiSwitcherHelper *> mHuaWeiSwitcherHelper;
+    // 全部交换机POE批量上电/断电的总耗时统计
+    QElapsedTimer mPoeBatchElapsed;
+    int mPoeBatchPending = 0;
+    bool mPoeBatchFailed = false;
+    void startPoeBatchTiming(int switcherCount);
+    void onPoeBatchFinished(QString ip, bool on, int okCount, int failCount, qint64 elapsedMs);
     QString mShotDir;// 保存路径
     QString mShotNum;// 测量发次
 
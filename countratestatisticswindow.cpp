@@ -8,11 +8,16 @@
 #include "countratestatisticswindow.h"
 #include "ui_countratestatisticswindow.h"
 #include "globalsettings.h"
+#include "spectrumkernels.h"
+#include "analysisjob.h"
+#include "spectrumquery.h"
 
 #include <QButtonGroup>
 #include <QFileDialog>
 #include <QAction>
 #include <QToolButton>
+#include <QProgressBar>
+#include <QElapsedTimer>
 
 #include <QJsonArray>
 #include <QJsonObject>
@@ -33,6 +38,18 @@ CountRateStatisticsWindow::CountRateStatisticsWindow(bool isDarkTheme, QWidget *
     applyColorTheme();
     connect(this, SIGNAL(reporWriteLog(const QString&,QtMsgType)), this, SLOT(replyWriteLog(const QString&,QtMsgType)));
 
+    // 后台分析任务
+    mAnalysisJob = new AnalysisJob(&mInterrupted, this);
+    connect(mAnalysisJob, &AnalysisJob::progress, this, [=](qint64 done, qint64 total, const QString& stage){
+        QProgressBar* progressBar = this->findChild<QProgressBar*>("progressBar_job");
+        progressBar->setMaximum(1000);
+        progressBar->setValue(total > 0 ? done * 1000 / total : 0);
+        progressBar->setFormat(QString("%1 %2/%3").arg(stage).arg(done).arg(total));
+        progressBar->show();
+    });
+    connect(mAnalysisJob, &AnalysisJob::partialResult, this, &CountRateStatisticsWindow::slotPartialResult);
+    connect(mAnalysisJob, &AnalysisJob::finished, this, &CountRateStatisticsWindow::slotAnalysisFinished);
+
     QTimer::singleShot(0, this, [&](){
         qGoodStateHolder->setCurrentThemeDark(mIsDarkTheme);
         QGoodWindow::setAppCustomTheme(mIsDarkTheme,this->mThemeColor); // Must be >96
@@ -48,6 +65,9 @@ CountRateStatisticsWindow::CountRateStatisticsWindow(bool isDarkTheme, QWidget *
 
 CountRateStatisticsWindow::~CountRateStatisticsWindow()
 {
+    // 先结束后台任务再释放界面
+    delete mAnalysisJob;
+    mAnalysisJob = nullptr;
     delete ui;
 }
 
@@ -63,6 +83,14 @@ void CountRateStatisticsWindow::initUi()
         ui->statusbar->setContentsMargins(5, 0, 5, 0);
         ui->statusbar->addWidget(new QLabel(ui->statusbar), 1);
         ui->statusbar->addWidget(nullptr, 1);
+
+        // 解析进度
+        QProgressBar *progressBar_job = new QProgressBar(ui->statusbar);
+        progressBar_job->setObjectName("progressBar_job");
+        progressBar_job->setFixedWidth(300);
+        progressBar_job->setTextVisible(true);
+        progressBar_job->hide();
+        ui->statusbar->addPermanentWidget(progressBar_job);
         ui->statusbar->addPermanentWidget(label_systemtime);
 
         QTimer* systemClockTimer = new QTimer(this);
@@ -553,7 +581,6 @@ void CountRateStatisticsWindow::initCustomPlot(QCustomPlot* customPlot, QString
 }
 
 
-#include "H5Cpp.h"
 void CountRateStatisticsWindow::on_action_open_triggered()
 {
     // 打开历史测量数据文件...
@@ -570,60 +597,16 @@ void CountRateStatisticsWindow::on_action_open_triggered()
     settings.setValue("mainWindow/LastFilePath", filePath);
     ui->textBrowser_filepath->setText(filePath);
 
-    // 解析文件，获取能谱范围时长
-    {
-        // 1. 打开文件
-        H5::H5File file(filePath.toStdString(), H5F_ACC_RDONLY);
-
-        // 2. 打开分组核数据集
-        H5::Group group = file.openGroup("Detector#1");
-        H5::DataSet dataset = group.openDataSet("Spectrum");
-
-        // 3. 确认数据类型匹配（可选，用于错误检查）
-        H5::CompType fileType = dataset.getCompType();
-        if (fileType != H5::PredType::NATIVE_UINT) {
-            file.close();
-            return;
-        }
-
-        // 4. 初始文件空间
-        H5::DataSpace file_space = dataset.getSpace();
-        hsize_t current_dims[2];
-        file_space.getSimpleExtentDims(current_dims, NULL);
-        hsize_t rows = current_dims[0];
-        hsize_t cols = current_dims[1];
-        if (rows<=0){
-            group.close();
-            dataset.close();
-            file_space.close();
-            file.close();
-            return;
-        }
-
-        // 5. 内存空间：只读取一行
-        hsize_t mem_dims[2] = {1, cols};
-        H5::DataSpace mem_space(2, mem_dims);
-        uint32_t* row_data = new uint32_t[cols];
-
-        // 6. 指定数据读取位置
-        hsize_t start[2] = {0, 0};
-        hsize_t count[2] = {1, cols};
-        file_space.selectHyperslab(H5S_SELECT_SET, count, start);
-
-        // 7. 读取数据
-        dataset.read(row_data, H5::PredType::NATIVE_UINT, mem_space, file_space);
-        FullSpectrum* data = reinterpret_cast<FullSpectrum*>(row_data);
-
-        ui->line_measure_endT->setText(QString::number(rows * data->measureTime / 1000));
-        emit reporWriteLog(tr("测量时长/s：%1").arg(ui->line_measure_endT->text()));
-
-        delete[] row_data;
-        row_data = nullptr;
+    // 解析文件，获取能谱范围时长。经HDF5Settings串行读取（HDF5库不是线程安全的），只读各行表头
+    QVector<quint32> headers;
+    if (!HDF5Settings::readH5SpectrumHeaders(filePath.toStdString(), 1, headers) || headers.isEmpty())
+        return;
 
-        group.close();
-        dataset.close();
-        file_space.close();
-    }
+    // 表头每行3个数：序号、测量时间、死时间
+    quint64 rows = headers.size() / 3;
+    quint32 measureTime = headers.at(1);
+    ui->line_measure_endT->setText(QString::number(rows * measureTime / 1000));
+    emit reporWriteLog(tr("测量时长/s：%1").arg(ui->line_measure_endT->text()));
 }
 
 
@@ -633,196 +616,324 @@ void CountRateStatisticsWindow::on_action_exit_triggered()
 }
 
 
-void CountRateStatisticsWindow::on_action_startMeasure_triggered()
+/**
+ * @brief 一个谱仪的计数率、死时间率统计，逐秒加入
+ */
+struct CountRateStatistics
 {
-    emit reporWriteLog(tr("开始解析..."));
-
-    ui->spectorMeter->graph(0)->data()->clear();
-    ui->spectorMeter->graph(1)->data()->clear();
-    ui->spectorMeter->replot(QCustomPlot::rpQueuedReplot);
-    int index = 1;
-    if (ui->tableWidget->selectedItems().count() > 0)
-        index = ui->tableWidget->selectedItems()[0]->row() - 1;
+    quint64 minV = quint32(-1);
+    quint64 maxV = 0;
+    double minVAdjust = quint32(-1);
+    double maxVAdjust = 0;
+    double minVDeathTime = quint32(-1);
+    double maxVDeathTime = 0;
+    quint32 ref = 0;
+    quint64 total = 0;
+    double totalDeathTime = 0;
+    double totalAdjust = 0;// 修正后
+
+    /**
+     * @brief add 加入一秒的数据
+     * @param totalTemp 这一秒的总计数
+     * @param measureTime 这一秒的测量时间合计，ms
+     * @param deathTime 这一秒的死时间合计，*10ns
+     */
+    void add(quint64 totalTemp, quint64 measureTime, quint64 deathTime)
+    {
+        // 死时间修正系数按这一秒的总测量时间、总死时间计算
+        double realTime = (double)measureTime * 10e6;
+        double factor = realTime / (realTime - (double)deathTime * 10);
+
+        // 死时间率统计
+        double totalTempDeathT = (double)deathTime * 10 / realTime;
+        minVDeathTime = qMin(minVDeathTime, totalTempDeathT);
+        maxVDeathTime = qMax(maxVDeathTime, totalTempDeathT);
+        totalDeathTime += totalTempDeathT;
+
+        // 修正后10e6
+        double totalSAdjust = (double)totalTemp * factor;
+
+        ++ref;
+        minV = qMin(minV, totalTemp);
+        maxV = qMax(maxV, totalTemp);
+        total += totalTemp;
+
+        minVAdjust = qMin(minVAdjust, totalSAdjust);
+        maxVAdjust = qMax(maxVAdjust, totalSAdjust);
+        totalAdjust += totalSAdjust;
+    }
 
-    if (mMapSpectrum.contains(index))
+    QVariantMap toResult(quint8 detId) const
     {
-        QVector<double> spectrumTotal(8192, 0); // 8192道完整数据
-        QVector<double> spectrumTotalAdjust(8192, 0); // 8192道完整数据
-        QVector<double> keys;
-        for (int i=0; i<8192; ++i)
+        QVariantMap result;
+        result["index"] = detId;
+        result["minV"] = minV;
+        result["minVAdjust"] = minVAdjust;
+        result["maxV"] = maxV;
+        result["maxVAdjust"] = maxVAdjust;
+        result["meanV"] = (quint64)(total / ref);
+        result["meanVAdjust"] = totalAdjust / ref;
+        result["minVDeathTime"] = minVDeathTime;
+        result["maxVDeathTime"] = maxVDeathTime;
+        result["meanVDeathTime"] = totalDeathTime * 100 / ref;
+        return result;
+    }
+};
+
+
+/**
+ * @brief 按秒汇总一个谱仪的累计能谱（修正前、修正后），每秒按这一秒的死时间修正，不足一秒的尾部数据舍弃
+ * @return 是否有完整1秒的数据
+ */
+static bool queryDetectorSpectrum(const QString& filePath, quint8 detId, quint32 tmStart, quint32 tmEnd, int blockRows,
+                                  AnalysisJob::Context& context, const std::atomic<bool>* interrupted, QVariantMap& result)
+{
+    SpectrumQueryRequest request;
+    request.filePath = filePath;
+    request.detectors << detId;
+    request.sequenceBegin = tmStart;
+    request.sequenceEnd = tmEnd;
+    request.timeBin = 1000;
+    request.blockRows = blockRows;
+
+    QVector<double> spectrumTotal(8192, 0); // 8192道完整数据
+    QVector<double> spectrumTotalAdjust(8192, 0); // 8192道完整数据
+    int seconds = 0;
+    int count = SpectrumQuery::run(request, [&](quint8, const SpectrumQueryBin& bin) {
+        if (!bin.complete)
+            return;
+
+        double realTime = (double)bin.measureTime * 10e6;
+        double factor = realTime / (realTime - (double)bin.deathTime * 10);
+        for (int j=0; j<8192; ++j)
         {
-            keys << i;
-            spectrumTotal[i] = mMapSpectrum[index][i];
-            spectrumTotalAdjust[i] = mMapSpectrumAdjust[index][i];
+            spectrumTotal[j] += bin.spectrum[j];
+            spectrumTotalAdjust[j] += (double)bin.spectrum[j] * factor;
         }
+        ++seconds;
+    }, [&](qint64 done, qint64 total) {
+        context.setProgress(done, total, QObject::tr("谱仪#%1能谱").arg(detId));
+    }, interrupted);
+
+    if (count <= 0 || seconds == 0)
+        return false;
+
+    result["index"] = detId;
+    result["spectrum"] = QVariant::fromValue(spectrumTotal);
+    result["spectrumAdjust"] = QVariant::fromValue(spectrumTotalAdjust);
+    return true;
+}
+
 
-        ui->spectorMeter->graph(0)->setData(keys, spectrumTotal);
-        ui->spectorMeter->graph(1)->setData(keys, spectrumTotalAdjust);
-        ui->spectorMeter->replot(QCustomPlot::rpQueuedReplot);
+void CountRateStatisticsWindow::on_action_startMeasure_triggered()
+{
+    if (mAnalysisJob->isRunning())
+    {
+        emit reporWriteLog(tr("上一次解析尚未结束，请等待或先停止解析。"), QtWarningMsg);
         return;
     }
 
-    qApp->setOverrideCursor(QCursor(Qt::WaitCursor));
-    quint32 tmStart = ui->spinBox_timeStart->value();
-    quint32 tmEnd = ui->spinBox_timeEnd->value();
     QString filePath = ui->textBrowser_filepath->toPlainText();
+    if (filePath.isEmpty() || !QFileInfo::exists(filePath))
+    {
+        emit reporWriteLog(tr("请先打开测量文件。"), QtWarningMsg);
+        return;
+    }
 
-    // 1. 打开文件
-    H5::H5File file(filePath.toStdString(), H5F_ACC_RDONLY);
-
+    emit reporWriteLog(tr("开始解析，统计全部%1个谱仪...").arg(DET_NUM));
 
-    //for (int index = 1; index <= DET_NUM; ++index)
+    // 一次统计全部谱仪，清空上一次结果
+    mMapSpectrum.clear();
+    mMapSpectrumAdjust.clear();
+    for (int row=2; row<ui->tableWidget->rowCount(); ++row)
     {
-        // 2. 打开分组核数据集
-        H5::Group group = file.openGroup(QString("Detector#%1").arg(index).toStdString().c_str());
-        H5::DataSet dataset = group.openDataSet("Spectrum");
+        for (int column=1; column<ui->tableWidget->columnCount(); ++column)
+            ui->tableWidget->item(row, column)->setText("");
+    }
+    ui->spectorMeter->graph(0)->data()->clear();
+    ui->spectorMeter->graph(1)->data()->clear();
+    ui->spectorMeter->replot(QCustomPlot::rpQueuedReplot);
 
-        // 3. 确认数据类型匹配（可选，用于错误检查）
-        H5::CompType fileType = dataset.getCompType();
-        if (fileType != H5::PredType::NATIVE_UINT)
+    // 之后点击其它谱仪查看能谱时沿用本次的文件和时间范围
+    mQueryFilePath = filePath;
+    mQueryStart = ui->spinBox_timeStart->value();
+    mQueryEnd = ui->spinBox_timeEnd->value();
+    quint32 tmStart = mQueryStart;
+    quint32 tmEnd = mQueryEnd;
+    int blockRows = spectrumBlockRows();
+    int index = selectedDetector();
+
+    ui->action_startMeasure->setEnabled(false);
+    mAnalysisJob->start([=](AnalysisJob::Context& context) -> bool {
+        // 1. 计数率、死时间率只读能谱摘要，按秒（测量时间累计满1000ms）统计，不足一秒的尾部数据舍弃
+        std::atomic<int> successCount(0);
+        QVector<quint8> noSummary; //早期文件没有摘要的谱仪
+        for (quint8 detId = 1; detId <= DET_NUM; ++detId)
         {
-            file.close();
-            qApp->restoreOverrideCursor();
-            return;
-        }
+            if (context.isCanceled())
+                return false;
 
-        // 4. 初始文件空间
-        H5::DataSpace file_space = dataset.getSpace();
-        hsize_t current_dims[2];
-        file_space.getSimpleExtentDims(current_dims, NULL);
-        hsize_t rows = current_dims[0];
-        hsize_t cols = current_dims[1];
-        if (rows<=0)
-        {
-            file.close();
-            qApp->restoreOverrideCursor();
-            return;
-        }
-
-        // 5. 内存空间：每次读取一行
-        hsize_t mem_dims[2] = {1, cols};
-        H5::DataSpace mem_space(2, mem_dims);
-        uint32_t* row_data = new uint32_t[cols];
-        quint64 minV = quint32(-1);
-        quint64 maxV = 0;
-        double minVAdjust = quint32(-1);
-        double maxVAdjust = 0;
-        double minVDeathTime = quint32(-1);
-        double maxVDeathTime = 0;
-        quint32 ref = 0;
-        quint64 total = 0;
-        double totalDeathTime = 0;
-        quint32 measureTime = 0;
-        double totalAdjust = 0;// 修正后
-        QVector<double> spectrumTotal(8192, 0); // 8192道完整数据
-        QVector<double> spectrumTotalAdjust(8192, 0); // 8192道完整数据
-
-        for (hsize_t i = 0; i < rows;/* ++i*/) {
-            if (mInterrupted)
+            context.setProgress(detId - 1, DET_NUM, tr("统计计数率"));
+            QVector<H5SpectrumSummary> summary;
+            if (!HDF5Settings::readH5SpectrumSummary(filePath.toStdString(), detId, summary))
             {
-                emit reporWriteLog(tr("解析被中断！"));
-                break;
+                noSummary << detId;
+                continue;
             }
 
-            // 6. 指定数据读取位置
-            hsize_t start[2] = {i, 0};
-            hsize_t count[2] = {1, cols};
-            file_space.selectHyperslab(H5S_SELECT_SET, count, start);
-
-            // 7. 读取数据
-            dataset.read(row_data, H5::PredType::NATIVE_UINT, mem_space, file_space);
-            FullSpectrum* data = reinterpret_cast<FullSpectrum*>(row_data);
-            if (data->sequence >= tmStart && data->sequence <= tmEnd)
+            CountRateStatistics statistics;
+            quint64 totalTemp = 0, measureTime = 0, deathTime = 0;
+            for (const H5SpectrumSummary& row : qAsConst(summary))
             {
-                // 8. 对数据按秒进行重新分类
-                quint64 totalTemp = 0;//计数
-                double totalTempDeathT = 0;//死时间
-                quint8 step = 1000 / data->measureTime;
-                QVector<quint32> spectrum(8192, 0);// 能谱/s
-                quint32 deathTime = 0;// 死时间/s
-                for (int t = 0; t < step; ++t)
-                {
-                    for (int j=0; j<8192; ++j)
-                    {
-                        spectrum[j] += data->spectrum[j];
+                if (row.sequence < tmStart || row.sequence > tmEnd || row.measureTime == 0)
+                    continue;
 
-                    }
-
-                    deathTime += data->deathTime;
+                totalTemp += row.totalCount;
+                measureTime += row.measureTime;
+                deathTime += row.deathTime;
+                if (measureTime >= 1000)
+                {
+                    statistics.add(totalTemp, measureTime, deathTime);
+                    totalTemp = measureTime = deathTime = 0;
                 }
-                i += step;
+            }
 
-                // 9. 能谱统计
-                for (int j=0; j<8192; ++j)
+            if (statistics.ref > 0)
+            {
+                ++successCount;
+                context.postPartial(statistics.toResult(detId));
+            }
+        }
+
+        // 没有摘要的谱仪一起查询全谱，各谱仪在线程池中并行按秒汇总
+        if (!noSummary.isEmpty())
+        {
+            SpectrumQueryRequest request;
+            request.filePath = filePath;
+            request.detectors = noSummary;
+            request.sequenceBegin = tmStart;
+            request.sequenceEnd = tmEnd;
+            request.channelRebin = 8; // 只需要总计数，合并道址减少汇总的数据量
+            request.timeBin = 1000;
+            request.blockRows = blockRows;
+
+            // 每个谱仪只在一个线程中回调，各自的统计互不干扰
+            QVector<CountRateStatistics> statisticsList(DET_NUM + 1);
+            CountRateStatistics* statistics = statisticsList.data();
+            int count = SpectrumQuery::run(request, [&](quint8 detId, const SpectrumQueryBin& bin) {
+                if (!bin.complete)
+                    return;
+                quint64 totalTemp = 0;
+                for (quint64 value : bin.spectrum)
+                    totalTemp += value;
+                statistics[detId].add(totalTemp, bin.measureTime, bin.deathTime);
+            }, [&](qint64 done, qint64 total) {
+                context.setProgress(done, total, tr("读取能谱"));
+            }, &mInterrupted, [&](quint8 detId, bool success) {
+                if (success && statistics[detId].ref > 0)
                 {
-                    // 9. 对数据进行累加，计数计数率
-                    totalTemp += spectrum[j];
-                    spectrumTotal[j] += spectrum[j];
-                    spectrumTotalAdjust[j] += (double)spectrum[j] * data->measureTime * 10e6 / (data->measureTime*10e6 - data->deathTime*10);
+                    ++successCount;
+                    context.postPartial(statistics[detId].toResult(detId));
                 }
+            });
+            if (count < 0)
+                return false;
+        }
 
-                // 死时间率统计
-                totalTempDeathT = (double)deathTime*10 / (data->measureTime*10e6);
-                minVDeathTime = qMin(minVDeathTime, (double)totalTempDeathT);
-                maxVDeathTime = qMax(maxVDeathTime, (double)totalTempDeathT);
-                totalDeathTime += totalTempDeathT;
+        // 2. 选中谱仪的累计能谱
+        QVariantMap spectrum;
+        if (successCount > 0 && queryDetectorSpectrum(filePath, index, tmStart, tmEnd, blockRows, context, &mInterrupted, spectrum))
+            context.postPartial(spectrum);
 
-                // 9. 修正后10e6
-                double totalSAdjust = 0;
-                totalSAdjust = (double)totalTemp * data->measureTime * 10e6 / (data->measureTime*10e6 - data->deathTime*10);
+        context.setResult(successCount.load());
+        return successCount > 0;
+    });
+}
 
-                ++ref;
-                minV = qMin(minV, (quint64)totalTemp);
-                maxV = qMax(maxV, (quint64)totalTemp);
-                total += (quint64)totalTemp;
 
-                minVAdjust = qMin((double)minVAdjust, (double)totalSAdjust);
-                maxVAdjust = qMax((double)maxVAdjust, (double)totalSAdjust);
-                totalAdjust += totalSAdjust;
-            }
-            else{
-                ++i;
-            }
+void CountRateStatisticsWindow::startSpectrumQuery(int index)
+{
+    if (mAnalysisJob->isRunning() || mQueryFilePath.isEmpty())
+        return;
 
-            measureTime = data->measureTime;
+    QString filePath = mQueryFilePath;
+    quint32 tmStart = mQueryStart;
+    quint32 tmEnd = mQueryEnd;
+    int blockRows = spectrumBlockRows();
 
-            // 释放文件空间
-            file_space.selectNone();
-        }
+    ui->action_startMeasure->setEnabled(false);
+    mAnalysisJob->start([=](AnalysisJob::Context& context) -> bool {
+        QVariantMap spectrum;
+        if (!queryDetectorSpectrum(filePath, index, tmStart, tmEnd, blockRows, context, &mInterrupted, spectrum))
+            return false;
 
-        QVector<double> keys;
-        for (int j=0; j<8192; ++j)
-            keys << j;
-
-        ui->spectorMeter->graph(0)->setData(keys, spectrumTotal);
-        ui->spectorMeter->graph(1)->setData(keys, spectrumTotalAdjust);
-        ui->tableWidget->item(index + 1, 1)->setText(QString::number(minV));
-        ui->tableWidget->item(index + 1, 2)->setText(QString::number(minVAdjust));
-        ui->tableWidget->item(index + 1, 3)->setText(QString::number(maxV));
-        ui->tableWidget->item(index + 1, 4)->setText(QString::number(maxVAdjust));
-        ui->tableWidget->item(index + 1, 5)->setText(QString::number(total / ref));
-        ui->tableWidget->item(index + 1, 6)->setText(QString::number(totalAdjust / ref));
-
-        ui->tableWidget->item(index + 1, 7)->setText(QString::number(minVDeathTime, 'e', 2));
-        ui->tableWidget->item(index + 1, 8)->setText(QString::number(maxVDeathTime, 'e', 2));
-        ui->tableWidget->item(index + 1, 9)->setText(QString::number(totalDeathTime * 100 / ref, 'e', 2));
-
-        mMapSpectrum[index] = spectrumTotal;
-        mMapSpectrumAdjust[index] = spectrumTotalAdjust;
-        delete[] row_data;
-        dataset.close();
-        group.close();
-    }
+        context.postPartial(spectrum);
+        return true;
+    });
+}
 
-    file.close();
-    ui->spectorMeter->rescaleAxes(true);
-    ui->spectorMeter->replot(QCustomPlot::rpQueuedReplot);
-    qApp->restoreOverrideCursor();
 
-    emit reporWriteLog(tr("解析结束"));
+int CountRateStatisticsWindow::spectrumBlockRows() const
+{
+    // 每次读取的能谱行数，1024行约32MB
+    GlobalSettings settings;
+    return qBound(1, settings.value("CountRate/BlockRows", 1024).toInt(), 65536);
+}
+
+
+void CountRateStatisticsWindow::slotPartialResult(const QVariant& data)
+{
+    QVariantMap result = data.toMap();
+    int index = result["index"].toInt();
+    if (index + 1 >= ui->tableWidget->rowCount())
+        return;
+
+    // 累计能谱
+    if (result.contains("spectrum"))
+    {
+        mMapSpectrum[index] = result["spectrum"].value<QVector<double>>();
+        mMapSpectrumAdjust[index] = result["spectrumAdjust"].value<QVector<double>>();
+        if (index == selectedDetector())
+            showSpectrum(index);
+        return;
+    }
+
+    // 计数率、死时间率统计
+    ui->tableWidget->item(index + 1, 1)->setText(QString::number(result["minV"].toULongLong()));
+    ui->tableWidget->item(index + 1, 2)->setText(QString::number(result["minVAdjust"].toDouble()));
+    ui->tableWidget->item(index + 1, 3)->setText(QString::number(result["maxV"].toULongLong()));
+    ui->tableWidget->item(index + 1, 4)->setText(QString::number(result["maxVAdjust"].toDouble()));
+    ui->tableWidget->item(index + 1, 5)->setText(QString::number(result["meanV"].toULongLong()));
+    ui->tableWidget->item(index + 1, 6)->setText(QString::number(result["meanVAdjust"].toDouble()));
+
+    ui->tableWidget->item(index + 1, 7)->setText(QString::number(result["minVDeathTime"].toDouble(), 'e', 2));
+    ui->tableWidget->item(index + 1, 8)->setText(QString::number(result["maxVDeathTime"].toDouble(), 'e', 2));
+    ui->tableWidget->item(index + 1, 9)->setText(QString::number(result["meanVDeathTime"].toDouble(), 'e', 2));
 }
 
 
+void CountRateStatisticsWindow::slotAnalysisFinished(bool success, bool canceled, const QVariant& data)
+{
+    ui->action_startMeasure->setEnabled(true);
+    this->findChild<QProgressBar*>("progressBar_job")->hide();
+
+    if (canceled)
+    {
+        emit reporWriteLog(tr("解析被中断！"));
+        return;
+    }
+
+    if (!success)
+    {
+        emit reporWriteLog(tr("解析失败！"), QtCriticalMsg);
+        return;
+    }
+
+    // 查看单个谱仪能谱的任务没有结果
+    if (data.isValid())
+        emit reporWriteLog(tr("解析结束，%1个谱仪有有效数据").arg(data.toInt()));
+}
+
 void CountRateStatisticsWindow::on_action_stopMeasure_triggered()
 {
     emit reporWriteLog(tr("中断解析"));
@@ -835,22 +946,35 @@ void CountRateStatisticsWindow::on_tableWidget_cellClicked(int row, int column)
     if (row <= 1 || column != 0)
         return;
 
+    // 还没有能谱的谱仪按本次统计的文件、时间范围读取
     int index = row - 1;
     if (mMapSpectrum.contains(index))
-    {
-        QVector<double> spectrumTotal(8192, 0); // 8192道完整数据
-        QVector<double> spectrumTotalAdjust(8192, 0); // 8192道完整数据
-        QVector<double> keys;
-        for (int i=0; i<8192; ++i)
-        {
-            keys << i;
-            spectrumTotal[i] = mMapSpectrum[index][i];
-            spectrumTotalAdjust[i] = mMapSpectrumAdjust[index][i];
-        }
+        showSpectrum(index);
+    else
+        startSpectrumQuery(index);
+}
 
-        ui->spectorMeter->graph(0)->setData(keys, spectrumTotal);
-        ui->spectorMeter->graph(1)->setData(keys, spectrumTotalAdjust);
-        ui->spectorMeter->replot(QCustomPlot::rpQueuedReplot);
-    }
+
+int CountRateStatisticsWindow::selectedDetector() const
+{
+    int index = 1;
+    if (ui->tableWidget->selectedItems().count() > 0)
+        index = ui->tableWidget->selectedItems()[0]->row() - 1;
+    return (index >= 1 && index <= DET_NUM) ? index : 1;
 }
 
+
+void CountRateStatisticsWindow::showSpectrum(int index)
+{
+    if (!mMapSpectrum.contains(index))
+        return;
+
+    QVector<double> keys;
+    for (int i=0; i<8192; ++i)
+        keys << i;
+
+    ui->spectorMeter->graph(0)->setData(keys, mMapSpectrum[index]);
+    ui->spectorMeter->graph(1)->setData(keys, mMapSpectrumAdjust[index]);
+    ui->spectorMeter->rescaleAxes(true);
+    ui->spectorMeter->replot(QCustomPlot::rpQueuedReplot);
+}
@@ -41,6 +41,12 @@ private slots:
 
     void on_tableWidget_cellClicked(int row, int column);
 
+    // 一个谱仪的统计或累计能谱完成
+    void slotPartialResult(const QVariant& data);
+
+    // 后台解析完成
+    void slotAnalysisFinished(bool success, bool canceled, const QVariant& data);
+
 private:
     Ui::CountRateStatisticsWindow *ui;
     bool mIsDarkTheme = true;
@@ -48,11 +54,24 @@ private:
     QColor mThemeColor = QColor(255,255,255);
     class QGoodWindowHelper *mainWindow = nullptr;
 
+    // 当前选中的谱仪，未选中时为1
+    int selectedDetector() const;
+    void showSpectrum(int index);
+    // 在后台读取一个谱仪的累计能谱
+    void startSpectrumQuery(int index);
+    int spectrumBlockRows() const;
+
     // 中断解析
     std::atomic<bool> mInterrupted = false;
+    class AnalysisJob* mAnalysisJob = nullptr;
 
     QMap<quint8, QVector<double>> mMapSpectrum;
     QMap<quint8, QVector<double>> mMapSpectrumAdjust;
+
+    // 本次统计的文件和时间范围
+    QString mQueryFilePath;
+    quint32 mQueryStart = 0;
+    quint32 mQueryEnd = 0;
 };
 
 #endif // COUNTRATESTATISTICSWINDOW_H
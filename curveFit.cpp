@@ -7,6 +7,8 @@
  */
 
 #include "curveFit.h"
+#include "spectrumkernels.h"
+#include "lmsolver.h"
 #include <algorithm>
 #include <QDebug>
 #include <math.h>
@@ -54,7 +56,169 @@ namespace CurveFit {
 
     void function_log(const real_1d_array &c, const real_1d_array &t, double &func, void *ptr)
     {
-        func = c[0] - log(2)/(78.4*60)*t[0];
+        func = c[0] - lambda89Zr*t[0];
+    }
+
+    void function_gauss_linear_grad(const real_1d_array &c, const real_1d_array &x, double &func, real_1d_array &grad, void *_peak)
+    {
+        double peak = *static_cast<double*>(_peak);
+        double d = x[0] - peak;
+        double g = exp(-0.5*d*d/(c[1]*c[1]));
+        func = c[0]*g + c[2]*x[0] + c[3];
+
+        grad[0] = g;
+        grad[1] = c[0]*g*d*d/(c[1]*c[1]*c[1]);
+        grad[2] = x[0];
+        grad[3] = 1.0;
+    }
+
+    void function_gauss_linear2_grad(const real_1d_array &c, const real_1d_array &x, double &func, real_1d_array &grad, void *ptr)
+    {
+        double d = x[0] - c[1];
+        double s2 = c[2]*c[2];
+        double g = exp(-0.5*d*d/s2);
+        func = c[0]*g + c[3]*x[0] + c[4];
+
+        grad[0] = g;
+        grad[1] = c[0]*g*d/s2;
+        grad[2] = c[0]*g*d*d/(s2*c[2]);
+        grad[3] = x[0];
+        grad[4] = 1.0;
+    }
+
+    void function_gauss_poly4_grad(const real_1d_array &c, const real_1d_array &x, double &func, real_1d_array &grad, void *ptr)
+    {
+        double x1 = x[0];
+        double x2 = x1*x1;
+        double x3 = x2*x1;
+        double x4 = x2*x2;
+        double d = x1 - c[1];
+        double s2 = c[2]*c[2];
+        double g = exp(-0.5*d*d/s2);
+        func = c[0]*g + c[3]*x4 + c[4]*x3 + c[5]*x2 + c[6]*x1 + c[7];
+
+        grad[0] = g;
+        grad[1] = c[0]*g*d/s2;
+        grad[2] = c[0]*g*d*d/(s2*c[2]);
+        grad[3] = x4;
+        grad[4] = x3;
+        grad[5] = x2;
+        grad[6] = x1;
+        grad[7] = 1.0;
+    }
+
+    void function_2gauss_poly4_grad(const real_1d_array &c, const real_1d_array &x, double &func, real_1d_array &grad, void *ptr)
+    {
+        double x1 = x[0];
+        double x2 = x1*x1;
+        double x3 = x2*x1;
+        double x4 = x2*x2;
+
+        //第一个高斯峰
+        double d1 = x1 - c[1];
+        double s1 = c[2]*c[2];
+        double g1 = exp(-0.5*d1*d1/s1);
+
+        //第二个高斯峰
+        double d2 = x1 - c[4];
+        double s2 = c[5]*c[5];
+        double g2 = exp(-0.5*d2*d2/s2);
+
+        func = c[0]*g1 + c[3]*g2 + c[6]*x4 + c[7]*x3 + c[8]*x2 + c[9]*x1 + c[10];
+
+        grad[0] = g1;
+        grad[1] = c[0]*g1*d1/s1;
+        grad[2] = c[0]*g1*d1*d1/(s1*c[2]);
+        grad[3] = g2;
+        grad[4] = c[3]*g2*d2/s2;
+        grad[5] = c[3]*g2*d2*d2/(s2*c[5]);
+        grad[6] = x4;
+        grad[7] = x3;
+        grad[8] = x2;
+        grad[9] = x1;
+        grad[10] = 1.0;
+    }
+
+    void function_log_grad(const real_1d_array &c, const real_1d_array &t, double &func, real_1d_array &grad, void *ptr)
+    {
+        func = c[0] - lambda89Zr*t[0];
+        grad[0] = 1.0;
+    }
+
+    // 批量计算时的分块长度，高斯指数部分先写入栈上缓冲区，再整块做指数运算
+    const int evaluateBlock = 256;
+
+    // 计算 dst[i] = -0.5*((x[i]-center)/sigma)^2
+    static inline void gauss_exponent(const double* x, int n, double center, double sigma, double* dst)
+    {
+        double k = -0.5/(sigma*sigma);
+        for (int i=0; i<n; ++i)
+        {
+            double d = x[i] - center;
+            dst[i] = k*d*d;
+        }
+    }
+
+    void evaluate_gauss_linear2(const double* c, const double* x, int n, double* func)
+    {
+        double g[evaluateBlock];
+        for (int start=0; start<n; start+=evaluateBlock)
+        {
+            int count = std::min(evaluateBlock, n-start);
+            const double* xb = x + start;
+            gauss_exponent(xb, count, c[1], c[2], g);
+            SpectrumKernels::exp(g, count, g);
+            for (int i=0; i<count; ++i)
+                func[start+i] = c[0]*g[i] + c[3]*xb[i] + c[4];
+        }
+    }
+
+    void evaluate_gauss_poly4(const double* c, const double* x, int n, double* func)
+    {
+        double g[evaluateBlock];
+        for (int start=0; start<n; start+=evaluateBlock)
+        {
+            int count = std::min(evaluateBlock, n-start);
+            const double* xb = x + start;
+            gauss_exponent(xb, count, c[1], c[2], g);
+            SpectrumKernels::exp(g, count, g);
+            for (int i=0; i<count; ++i)
+            {
+                double v = xb[i];
+                func[start+i] = c[0]*g[i] + (((c[3]*v + c[4])*v + c[5])*v + c[6])*v + c[7];
+            }
+        }
+    }
+
+    void evaluate_2gauss_poly4(const double* c, const double* x, int n, double* func)
+    {
+        double g1[evaluateBlock], g2[evaluateBlock];
+        for (int start=0; start<n; start+=evaluateBlock)
+        {
+            int count = std::min(evaluateBlock, n-start);
+            const double* xb = x + start;
+            gauss_exponent(xb, count, c[1], c[2], g1);
+            gauss_exponent(xb, count, c[4], c[5], g2);
+            SpectrumKernels::exp(g1, count, g1);
+            SpectrumKernels::exp(g2, count, g2);
+            for (int i=0; i<count; ++i)
+            {
+                double v = xb[i];
+                func[start+i] = c[0]*g1[i] + c[3]*g2[i] + (((c[6]*v + c[7])*v + c[8])*v + c[9])*v + c[10];
+            }
+        }
+    }
+
+    void evaluate_log(const double* c, const double* t, int n, double* func)
+    {
+        for (int i=0; i<n; ++i)
+            func[i] = c[0] - lambda89Zr*t[i];
+    }
+
+    void residual_rate(const double* y, const double* func, int n, double* rate)
+    {
+        for (int i=0; i<n; ++i)
+            rate[i] = (y[i] - func[i]) / func[i]*100.0;
     }
 
     bool fit_linear(QVector<QPointF> points, double* fit_c, double* R2, lsfitreport* rep)
@@ -302,7 +466,7 @@ namespace CurveFit {
         return 1;  
     }
 
-    bool fit_gauss_linear(QVector<QPointF> points, double* fit_c, double peak, double* chi_square)
+    bool fit_gauss_linear(QVector<QPointF> points, double* fit_c, double peak, double* chi_square, GradientMode mode)
     {
         int paraNum = 4; //待拟合参数个数
         int num = points.size();
@@ -336,10 +500,19 @@ namespace CurveFit {
             //
             // Fitting without weights
             //
-            double diffstep = 1.4901e-08;
-            lsfitcreatef(x, y, c, diffstep, state);
-            alglib::lsfitsetcond(state, epsx, maxits);
-            alglib::lsfitfit(state, function_gauss_linear, NULL, &peak);
+            if (mode == AnalyticGradient)
+            {
+                lsfitcreatefg(x, y, c, true, state);
+                alglib::lsfitsetcond(state, epsx, maxits);
+                alglib::lsfitfit(state, function_gauss_linear, function_gauss_linear_grad, NULL, &peak);
+            }
+            else
+            {
+                double diffstep = 1.4901e-08;
+                lsfitcreatef(x, y, c, diffstep, state);
+                alglib::lsfitsetcond(state, epsx, maxits);
+                alglib::lsfitfit(state, function_gauss_linear, NULL, &peak);
+            }
             lsfitresults(state, c, rep); //参数存储到state中
 
             //取出拟合参数c
@@ -369,7 +542,7 @@ namespace CurveFit {
         return 1;
     }
 
-    bool fit_gauss_linear2(QVector<QPointF> points, double* fit_c)
+    bool fit_gauss_linear2(QVector<QPointF> points, double* fit_c, GradientMode mode)
     {
         int paraNum = 5; //待拟合参数个数
         int num = points.size();
@@ -401,9 +574,18 @@ namespace CurveFit {
             lsfitstate state; //所有的参数数据都存储到state中的。
             lsfitreport rep;
 
-            lsfitcreatef(x, y, c, diffstep, state); //参数存储到state中
-            alglib::lsfitsetcond(state, epsx, maxits); //参数存储到state中
-            alglib::lsfitfit(state, function_gauss_linear2); //参数存储到state中
+            if (mode == AnalyticGradient)
+            {
+                lsfitcreatefg(x, y, c, true, state);
+                alglib::lsfitsetcond(state, epsx, maxits);
+                alglib::lsfitfit(state, function_gauss_linear2, function_gauss_linear2_grad);
+            }
+            else
+            {
+                lsfitcreatef(x, y, c, diffstep, state); //参数存储到state中
+                alglib::lsfitsetcond(state, epsx, maxits); //参数存储到state中
+                alglib::lsfitfit(state, function_gauss_linear2); //参数存储到state中
+            }
             lsfitresults(state, c, rep); //参数存储到state中
             // printf("fit_gauss_linear2 c:%s\n", c.tostring(1).c_str());
 
@@ -442,7 +624,7 @@ namespace CurveFit {
         return 1;
     }
 
-    bool fit_gauss_ploy4(QVector<QPointF> points, double* fit_c, QVector<double> &residual_rate)
+    bool fit_gauss_ploy4(QVector<QPointF> points, double* fit_c, QVector<double> &residual_rate, GradientMode mode)
     {
         int paraNum = 8; //待拟合参数个数
         int num = points.size();
@@ -478,9 +660,18 @@ namespace CurveFit {
             //
             // Fitting without weights
             //
-            lsfitcreatef(x, y, c, diffstep_tmp, state);
-            alglib::lsfitsetcond(state, epsx, maxits);
-            alglib::lsfitfit(state, function_gauss_poly4);
+            if (mode == AnalyticGradient)
+            {
+                lsfitcreatefg(x, y, c, true, state);
+                alglib::lsfitsetcond(state, epsx, maxits);
+                alglib::lsfitfit(state, function_gauss_poly4, function_gauss_poly4_grad);
+            }
+            else
+            {
+                lsfitcreatef(x, y, c, diffstep_tmp, state);
+                alglib::lsfitsetcond(state, epsx, maxits);
+                alglib::lsfitfit(state, function_gauss_poly4);
+            }
             lsfitresults(state, c, rep); //参数存储到state中
 
             //取出拟合参数c
@@ -490,23 +681,11 @@ namespace CurveFit {
 
             //计算残差率
             double chi_square_sum = 0.0;
-            for(int i=0; i<num; i++)
-            {
-                double x_temp = fit_x.at(i);
-                alglib::real_1d_array xData;
-                xData.setlength(1);
-                xData[0] = x_temp;
-
-                //计算拟合得到的y值
-                double y;
-                function_gauss_poly4(c, xData, y, NULL);
-
-                double residual = fit_y.at(i) - y; //残差
-                // double chi_square = residual * residual / y;
-                // chi_square_sum += chi_square;
-                double resRate = residual / y*100.0;
-                residual_rate.push_back(resRate);
-            }
+            QVector<double> fit_curve(num);
+            evaluate_gauss_poly4(fit_c, fit_x.constData(), num, fit_curve.data());
+            int offset = residual_rate.size();
+            residual_rate.resize(offset + num);
+            CurveFit::residual_rate(fit_y.constData(), fit_curve.constData(), num, residual_rate.data() + offset);
 
             qDebug().noquote()<<"fit_gauss_ploy4 c:["<<fit_c[0]<<","<<fit_c[1]<<","<<fit_c[2]<<","<<QString::number(fit_c[3], 'g', 9)
                     <<","<<QString::number(fit_c[4], 'g', 9)<<","<<QString::number(fit_c[5], 'g', 9)<<","<<QString::number(fit_c[6], 'g', 9)<<","<<fit_c[7]
@@ -523,7 +702,7 @@ namespace CurveFit {
         return 1;
     }
 
-    bool fit_2gauss_ploy4(QVector<QPointF> points, double* fit_c, QVector<double> &residual_rate)
+    bool fit_2gauss_ploy4(QVector<QPointF> points, double* fit_c, QVector<double> &residual_rate, GradientMode mode)
     {
         int paraNum = 11; //待拟合参数个数
         int num = points.size();
@@ -559,9 +738,18 @@ namespace CurveFit {
             //
             // Fitting without weights
             //
-            lsfitcreatef(x, y, c, diffstep_tmp, state);
-            alglib::lsfitsetcond(state, epsx, maxits);
-            alglib::lsfitfit(state, function_2gauss_poly4);
+            if (mode == AnalyticGradient)
+            {
+                lsfitcreatefg(x, y, c, true, state);
+                alglib::lsfitsetcond(state, epsx, maxits);
+                alglib::lsfitfit(state, function_2gauss_poly4, function_2gauss_poly4_grad);
+            }
+            else
+            {
+                lsfitcreatef(x, y, c, diffstep_tmp, state);
+                alglib::lsfitsetcond(state, epsx, maxits);
+                alglib::lsfitfit(state, function_2gauss_poly4);
+            }
             lsfitresults(state, c, rep); //参数存储到state中
 
             //取出拟合参数c
@@ -571,23 +759,11 @@ namespace CurveFit {
 
             //计算残差率
             double chi_square_sum = 0.0;
-            for(int i=0; i<num; i++)
-            {
-                double x_temp = fit_x.at(i);
-                alglib::real_1d_array xData;
-                xData.setlength(1);
-                xData[0] = x_temp;
-
-                //计算拟合得到的y值
-                double y;
-                function_2gauss_poly4(c, xData, y, NULL);
-
-                double residual = fit_y.at(i) - y; //残差
-                // double chi_square = residual * residual / y;
-                // chi_square_sum += chi_square;
-                double resRate = residual / y*100.0;
-                residual_rate.push_back(resRate);
-            }
+            QVector<double> fit_curve(num);
+            evaluate_2gauss_poly4(fit_c, fit_x.constData(), num, fit_curve.data());
+            int offset = residual_rate.size();
+            residual_rate.resize(offset + num);
+            CurveFit::residual_rate(fit_y.constData(), fit_curve.constData(), num, residual_rate.data() + offset);
 
             qDebug().noquote()<<"fit_2gauss_ploy4 c:["<<fit_c[0]<<","<<fit_c[1]<<","<<fit_c[2]<<","
                     <<QString::number(fit_c[3], 'g', 9)<<","<<QString::number(fit_c[4], 'g', 9)<<","
@@ -608,7 +784,7 @@ namespace CurveFit {
         return 1;
     }
 
-    bool fit_log(QVector<QPointF> points, double* fit_c, QVector<double> &residual_rate)
+    bool fit_log(QVector<QPointF> points, double* fit_c, QVector<double> &residual_rate, GradientMode mode)
     {
         int paraNum = 1; //待拟合参数个数
         int num = points.size();
@@ -645,9 +821,18 @@ namespace CurveFit {
             //
             // Fitting without weights
             //
-            lsfitcreatef(x, y, c, diffstep_tmp, state);
-            alglib::lsfitsetcond(state, epsx, maxits);
-            alglib::lsfitfit(state, function_log);
+            if (mode == AnalyticGradient)
+            {
+                lsfitcreatefg(x, y, c, true, state);
+                alglib::lsfitsetcond(state, epsx, maxits);
+                alglib::lsfitfit(state, function_log, function_log_grad);
+            }
+            else
+            {
+                lsfitcreatef(x, y, c, diffstep_tmp, state);
+                alglib::lsfitsetcond(state, epsx, maxits);
+                alglib::lsfitfit(state, function_log);
+            }
             lsfitresults(state, c, rep); //参数存储到state中
 
             //取出拟合参数c
@@ -656,21 +841,11 @@ namespace CurveFit {
             }
 
             //计算残差率
-            for(int i=0; i<num; i++)
-            {
-                double x_temp = fit_x.at(i);
-                alglib::real_1d_array xData;
-                xData.setlength(1);
-                xData[0] = x_temp;
-
-                //计算拟合得到的y值
-                double y;
-                function_log(c, xData, y, NULL);
-
-                double residual = fit_y.at(i) - y; //残差
-                double resRate = residual / y*100.0;
-                residual_rate.push_back(resRate);
-            }
+            QVector<double> fit_curve(num);
+            evaluate_log(fit_c, fit_x.constData(), num, fit_curve.data());
+            int offset = residual_rate.size();
+            residual_rate.resize(offset + num);
+            CurveFit::residual_rate(fit_y.constData(), fit_curve.constData(), num, residual_rate.data() + offset);
 
             qDebug().noquote()<<"CurveFit::fit_log c:["<<fit_c[0]<<","
                     <<"], iterationscount="<<rep.iterationscount
@@ -684,5 +859,130 @@ namespace CurveFit {
         }
         return 1;
     }
-}
 
+    namespace {
+    // 剥谱模型对应的alglib参考实现及批量计算，LM拟合结果不合理时用alglib重新拟合
+    bool referenceStripFit(const LM::TwoGaussPoly4&, QVector<QPointF>& points, double* c)
+    {
+        QVector<double> residual_rate;
+        return fit_2gauss_ploy4(points, c, residual_rate);
+    }
+    bool referenceStripFit(const LM::GaussPoly4&, QVector<QPointF>& points, double* c)
+    {
+        QVector<double> residual_rate;
+        return fit_gauss_ploy4(points, c, residual_rate);
+    }
+    void evaluateStripCurve(const LM::TwoGaussPoly4&, const double* c, const double* x, int n, double* func)
+    {
+        evaluate_2gauss_poly4(c, x, n, func);
+    }
+    void evaluateStripCurve(const LM::GaussPoly4&, const double* c, const double* x, int n, double* func)
+    {
+        evaluate_gauss_poly4(c, x, n, func);
+    }
+
+    /**
+     * @brief 剥谱拟合结果是否合理：收敛，各高斯峰的幅度、峰宽为正，峰位在剥谱范围内，拟合优度不低于minR2
+     * @param c 拟合参数，前面为各高斯峰的{幅度, 峰位, 峰宽}，最后5个为本底多项式系数
+     */
+    template<typename Model, int N = Model::ParamCount>
+    bool isStripFitValid(const double* c, const double* x, const double* y, const double* curve, int n, double minR2)
+    {
+        const int gaussCount = (N - 5) / 3;
+        for (int k=0; k<gaussCount; ++k)
+        {
+            double amplitude = c[3*k], peak = c[3*k+1], sigma = c[3*k+2];
+            if (!(amplitude > 0.0) || !(sigma > 0.0) || sigma > (x[n-1] - x[0]) || peak < x[0] || peak > x[n-1])
+                return false;
+        }
+
+        double mean = 0.0;
+        for (int i=0; i<n; ++i)
+            mean += y[i];
+        mean /= n;
+        double rss = 0.0, tss = 0.0;
+        for (int i=0; i<n; ++i)
+        {
+            rss += (y[i] - curve[i]) * (y[i] - curve[i]);
+            tss += (y[i] - mean) * (y[i] - mean);
+        }
+        double r2 = tss > 0.0 ? 1.0 - rss / tss : 1.0;
+        return std::isfinite(r2) && r2 >= minR2;
+    }
+
+    /**
+     * @brief 剥谱拟合。峰位、峰宽沿用上一段能谱的结果，幅度和本底系数由线性最小二乘给出初值；
+     * 本底多项式以剥谱窗口中点、半宽归一化后的能量为自变量拟合，结果换回以能量为自变量的系数。
+     * LM拟合不收敛或结果不合理时用alglib重新拟合，仍不合理时返回false，c保持不变
+     * @param c 输入初值、输出拟合结果，以能量为自变量，与CurveFit::function_(2)gauss_poly4的参数一致
+     * @param curve 输出拟合曲线，长度不小于n
+     * @param usedReference 输出是否改用了alglib，可为nullptr
+     */
+    template<typename Model, int N = Model::ParamCount>
+    bool stripFit(const double* x, const double* y, int n, double* c, double minR2, double* curve, bool* usedReference)
+    {
+        if (usedReference)
+            *usedReference = false;
+        if (n < N)
+            return false;
+
+        Model model;
+        model.center = (x[0] + x[n-1]) * 0.5;
+        model.scale = (x[n-1] - x[0]) * 0.5;
+
+        LM::Params<N> p;
+        for (int i=0; i<N-5; ++i)
+            p[i] = c[i];
+        LM::poly4Rebase(c + N - 5, model.center, model.scale, p.data() + N - 5);
+        if (!LM::solveLinear(model, x, y, n, p))
+            return false;
+
+        // 线性最小二乘给出的初值，换回以能量为自变量，供alglib重新拟合时使用
+        double seed[N];
+        for (int i=0; i<N-5; ++i)
+            seed[i] = p[i];
+        LM::poly4Rebase(p.data() + N - 5, -model.center / model.scale, 1.0 / model.scale, seed + N - 5);
+
+        double result[N];
+        bool converged = LM::fit(model, x, y, n, p);
+        if (converged)
+        {
+            // 峰宽只以平方出现，符号无意义
+            for (int k=0; k<(N-5)/3; ++k)
+                p[3*k+2] = fabs(p[3*k+2]);
+            for (int i=0; i<N-5; ++i)
+                result[i] = p[i];
+            LM::poly4Rebase(p.data() + N - 5, -model.center / model.scale, 1.0 / model.scale, result + N - 5);
+            evaluateStripCurve(model, result, x, n, curve);
+        }
+        if (!converged || !isStripFitValid<Model>(result, x, y, curve, n, minR2))
+        {
+            qDebug()<<"LM::fit 剥谱拟合"<<(converged ? "结果不合理" : "不收敛")<<"，使用alglib重新拟合";
+            QVector<QPointF> points(n);
+            for (int i=0; i<n; ++i)
+                points[i] = QPointF(x[i], y[i]);
+            std::copy(seed, seed + N, result);
+            if (usedReference)
+                *usedReference = true;
+            if (!referenceStripFit(model, points, result))
+                return false;
+            for (int k=0; k<(N-5)/3; ++k)
+                result[3*k+2] = fabs(result[3*k+2]);
+            evaluateStripCurve(model, result, x, n, curve);
+            if (!isStripFitValid<Model>(result, x, y, curve, n, minR2))
+                return false;
+        }
+
+        std::copy(result, result + N, c);
+        return true;
+    }
+    }
+
+    bool fit_strip(const double* x, const double* y, int n, double* fit_c, bool twoPeaks, double minR2, double* fit_curve, bool* usedReference)
+    {
+        if (twoPeaks)
+            return stripFit<LM::TwoGaussPoly4>(x, y, n, fit_c, minR2, fit_curve, usedReference);
+        else
+            return stripFit<LM::GaussPoly4>(x, y, n, fit_c, minR2, fit_curve, usedReference);
+    }
+}
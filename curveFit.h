@@ -14,6 +14,17 @@
 #pragma once
 
 namespace CurveFit {
+    // 89Zr衰变常数 ln2/(78.4h)，单位1/min，909keV计数衰减拟合统一使用
+    constexpr double lambda89Zr = 0.69314718055994531 / (78.4 * 60);
+
+    /**
+     * @brief 拟合时雅可比矩阵的计算方式
+     */
+    enum GradientMode{
+        NumericGradient = 0,  //有限差分（lsfitcreatef），每次迭代每个数据点需要p+1次函数求值
+        AnalyticGradient = 1  //解析梯度（lsfitcreatefg），每次迭代每个数据点只需1次函数及梯度求值
+    };
+
     /**
      * @brief 定义线性函数 f=kx+b
      * @param c 拟合参数c
@@ -86,6 +97,37 @@ namespace CurveFit {
      */
     void function_log(const alglib::real_1d_array &c, const alglib::real_1d_array &t, double &func, void *ptr);
 
+    /**
+     * @brief 以下为对应拟合函数的解析梯度，同时给出函数值func以及对各拟合参数的偏导数grad
+     * @param c 拟合参数c
+     * @param x 自变量x
+     * @param func 函数值
+     * @param grad 函数对拟合参数c的偏导数，长度与c相同
+     * @param ptr 用于自定义传参，与对应的函数一致
+     */
+    void function_gauss_linear_grad(const alglib::real_1d_array &c, const alglib::real_1d_array &x, double &func, alglib::real_1d_array &grad, void *_peak);
+    void function_gauss_linear2_grad(const alglib::real_1d_array &c, const alglib::real_1d_array &x, double &func, alglib::real_1d_array &grad, void *ptr);
+    void function_gauss_poly4_grad(const alglib::real_1d_array &c, const alglib::real_1d_array &x, double &func, alglib::real_1d_array &grad, void *ptr);
+    void function_2gauss_poly4_grad(const alglib::real_1d_array &c, const alglib::real_1d_array &x, double &func, alglib::real_1d_array &grad, void *ptr);
+    void function_log_grad(const alglib::real_1d_array &c, const alglib::real_1d_array &t, double &func, alglib::real_1d_array &grad, void *ptr);
+
+    /**
+     * @brief 以下为对应拟合函数的批量计算，一次给出整段自变量上的函数值，指数部分调用SpectrumKernels::exp批量计算
+     * @param c 拟合参数c，与对应函数的参数顺序一致
+     * @param x 自变量数组
+     * @param n 数据点个数
+     * @param func 函数值数组，长度不小于n
+     */
+    void evaluate_gauss_linear2(const double* c, const double* x, int n, double* func);
+    void evaluate_gauss_poly4(const double* c, const double* x, int n, double* func);
+    void evaluate_2gauss_poly4(const double* c, const double* x, int n, double* func);
+    void evaluate_log(const double* c, const double* t, int n, double* func);
+
+    /**
+     * @brief 计算拟合相对残差 rate[i] = (y[i]-func[i])/func[i]*100
+     */
+    void residual_rate(const double* y, const double* func, int n, double* rate);
+
     /**
      * @brief 线性拟合
      * func = c[0]*x + c[1];
@@ -126,17 +168,19 @@ namespace CurveFit {
      * @param fit_c 待拟合参数一维数组c的初值 拟合成功后，会将拟合结果存放在fit_c中
      * @param peak 高斯峰位
      * @param chi_square 拟合方差
+     * @param mode 梯度计算方式
      * @return 拟合是否成功
      */
-    bool fit_gauss_linear(QVector<QPointF> points, double* fit_c, double peak, double* chi_square);
+    bool fit_gauss_linear(QVector<QPointF> points, double* fit_c, double peak, double* chi_square, GradientMode mode = AnalyticGradient);
 
     /**
      * @brief 高斯+线性拟合 func = c[0]*exp(-0.5*pow((x[0]-c[1])/c[2],2)) + c[3]*x[0] + c[4];
      * @param points 待拟合数据对
      * @param fit_c 待拟合参数一维数组c的初值 拟合成功后，会将拟合结果存放在fit_c中
+     * @param mode 梯度计算方式
      * @return 拟合是否成功
      */
-    bool fit_gauss_linear2(QVector<QPointF> points, double* fit_c);
+    bool fit_gauss_linear2(QVector<QPointF> points, double* fit_c, GradientMode mode = AnalyticGradient);
 
     /**
      * @brief 高斯+4阶多项式拟合
@@ -144,9 +188,10 @@ namespace CurveFit {
      * @param points 待拟合数据对
      * @param fit_c 待拟合参数一维数组c的初值 拟合成功后，会将拟合结果存放在fit_c中
      * @param residual_rate 每个数据点的拟合相对残差
+     * @param mode 梯度计算方式
      * @return 拟合是否成功
      */
-    bool fit_gauss_ploy4(QVector<QPointF> points, double* fit_c, QVector<double> &residual_rate);
+    bool fit_gauss_ploy4(QVector<QPointF> points, double* fit_c, QVector<double> &residual_rate, GradientMode mode = AnalyticGradient);
 
     /**
      * @brief 双高斯+4阶多项式拟合
@@ -155,19 +200,38 @@ namespace CurveFit {
      * @param points 待拟合数据对
      * @param fit_c 待拟合参数一维数组c的初值 拟合成功后，会将拟合结果存放在fit_c中
      * @param residual_rate 每个数据点的拟合相对残差
+     * @param mode 梯度计算方式
      * @return 拟合是否成功
      */
-    bool fit_2gauss_ploy4(QVector<QPointF> points, double* fit_c, QVector<double> &residual_rate);
+    bool fit_2gauss_ploy4(QVector<QPointF> points, double* fit_c, QVector<double> &residual_rate, GradientMode mode = AnalyticGradient);
 
     /**
      * @brief 对909全能峰计数随时间变化曲线进行拟合
-     * func = c0 - log(2)/(78.4*60)*t;
+     * func = c0 - lambda89Zr*t，t单位min;
      * @param points 待拟合数据对
      * @param fit_c 待拟合参数一维数组c的初值 拟合成功后，会将拟合结果存放在fit_c中
      * @param residual_rate 每个数据点的拟合相对残差
+     * @param mode 梯度计算方式
      * @return 拟合是否成功
      */
-    bool fit_log(QVector<QPointF> points, double* fit_c, QVector<double> &residual_rate);
+    bool fit_log(QVector<QPointF> points, double* fit_c, QVector<double> &residual_rate, GradientMode mode = AnalyticGradient);
+
+    /**
+     * @brief 剥谱拟合，双高斯（846/909keV）或单高斯（909keV）+4阶多项式本底。
+     * 峰位、峰宽以fit_c为初值，幅度和本底系数先由线性最小二乘求出，再用LM::fit整体拟合，
+     * 本底多项式在拟合时以窗口中点、半宽归一化的自变量表示；不收敛或结果不合理（幅度、峰宽不为正，
+     * 峰位超出窗口，拟合优度低于minR2）时改用alglib拟合，仍不合理则返回false且fit_c不变
+     * @param x 能量数组
+     * @param y 计数数组
+     * @param n 数据点个数
+     * @param fit_c 初值及拟合结果，twoPeaks时11个参数，否则8个，与function_2gauss_poly4/function_gauss_poly4一致
+     * @param twoPeaks 是否双高斯
+     * @param minR2 拟合优度下限，为0时只剔除比常数拟合还差的结果
+     * @param fit_curve 输出拟合曲线，长度不小于n
+     * @param usedReference 输出是否改用了alglib，可为nullptr
+     * @return 拟合结果是否有效
+     */
+    bool fit_strip(const double* x, const double* y, int n, double* fit_c, bool twoPeaks, double minR2, double* fit_curve, bool* usedReference = nullptr);
 
     const int gauss_arr_count_min = 10; //高斯拟合数据点数最小值
 }
@@ -1,4 +1,5 @@
 ﻿#include "dataprocessor.h"
+#include "tracezone.h"
 #include <QDebug>
 #include <QTimer>
 
@@ -30,7 +31,10 @@ DataProcessor::DataProcessor(quint8 index, QTcpSocket* socket, QObject *parent)
             }
 
             if (!mTerminatedDataThread)
+            {
+                TRACE_ZONE_DET("analyzeCommands", mIndex);
                 analyzeCommands(mCachePool);
+            }
         }
     });
     mDataProcessThread->start();
@@ -203,6 +207,7 @@ void DataProcessor::sendCmdToSocket(CommandItem cmdItem) const
 
 void DataProcessor::readyRead()
 {
+    TRACE_ZONE_DET("socket read", mIndex);
     QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
     if (socket->bytesAvailable() <= 0)
         return;
@@ -244,6 +249,7 @@ void DataProcessor::restartTempTimeout() {
  * @param data 完整的能谱数据包，传入进来时已经验证了包的完整性
  */
 void DataProcessor::inputSpectrumData(quint8 no, QByteArray& data){
+    TRACE_ZONE_DET("inputSpectrumData", no);
     // 能谱数据：一个能谱数据包长度为256*32bit，但完整的能谱数据为8192*32bit。
     // 1. 提取数据包数据（256道 quint32 数据）
     quint32 spectrumSeq = 0;
@@ -313,8 +319,11 @@ void DataProcessor::inputSpectrumData(quint8 no, QByteArray& data){
             emit reportFullSpectrum(mIndex, fullSpectrumCopy);
 
             // H5能谱文件写入
-            H5Spectrum h5Spectrum = FullSpectoH5Spec(fullSpectrumCopy);
-            HDF5Settings::instance()->writeH5Spectrum(mIndex, h5Spectrum);
+            {
+                TRACE_ZONE_DET("HDF5 write", mIndex);
+                H5Spectrum h5Spectrum = FullSpectoH5Spec(fullSpectrumCopy);
+                HDF5Settings::instance()->writeH5Spectrum(mIndex, h5Spectrum);
+            }
 
             if(spectrumSeq%1000 == 0){
                 qDebug() << "Get a full spectrum, SpectrumID:" << spectrumSeq
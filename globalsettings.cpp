@@ -1,4 +1,5 @@
 ﻿#include "globalsettings.h"
+#include "spectrumkernels.h"
 #include <QFileInfo>
 #include <QApplication>
 #include <QTextCodec>
@@ -105,11 +106,18 @@ void GlobalSettings::setRealtimeSave(bool realtime)
 }
 
 //////////////////////////////
+// HDF5库默认编译不是线程安全的，进程内所有HDF5调用（打开/关闭文件、读、写、数据类型的创建和释放）都持有该锁
+static QMutex h5Mutex;
+
 HDF5Settings::HDF5Settings(QObject *parent) : QObject(parent)
 {
     //初始化数据类型
-    mCompDataType = createCfgDataType();
-    mSpectrumDataType = createFullSpectrumType();
+    {
+        QMutexLocker locker(&h5Mutex);
+        mCompDataType = createCfgDataType();
+        mSpectrumDataType = createFullSpectrumType();
+        mSummaryDataType = createSummaryType();
+    }
 
     // 创建配置文件
     createH5Config();
@@ -119,6 +127,7 @@ HDF5Settings::HDF5Settings(QObject *parent) : QObject(parent)
 
 HDF5Settings::~HDF5Settings()
 {
+    QMutexLocker locker(&h5Mutex);
     if (mfH5Setting)
     {
         mfH5Setting->close();
@@ -132,6 +141,16 @@ HDF5Settings::~HDF5Settings()
         delete mfH5Spectrum;
         mfH5Spectrum = nullptr;
     }
+
+    // 成员的析构在锁外进行，这里先释放其持有的HDF5对象
+    for (int i=0; i<DET_NUM; ++i)
+    {
+        mSpectrumDataset[i].close();
+        mSummaryDataset[i].close();
+    }
+    mSummaryDataType.close();
+    mCompDataType.close();
+    mSpectrumDataType.close();
 }
 
 QMap<quint8, DetParameter>& HDF5Settings::detParameters()
@@ -146,7 +165,7 @@ void HDF5Settings::setDetParameter(QMap<quint8, DetParameter>& detParameters)
 
 void HDF5Settings::sync()
 {
-    QMutexLocker locker(&mWrite_mutex);
+    QMutexLocker locker(&h5Mutex);
     try {
         // 1 打开文件（不清空）
         // H5::H5File fH5Setting(DEFAULT_HDF5_FILENAME, H5F_ACC_RDWR);
@@ -227,7 +246,7 @@ void HDF5Settings::writeStrAttr(H5::DataSet& ds, const std::string& key, const s
 
 void HDF5Settings::writeBytes(quint8 index, QByteArray& data)
 {
-    QMutexLocker locker(&mWrite_mutex);
+    QMutexLocker locker(&h5Mutex);
     H5::DataSet dataset = mSpectrumDataset[index-1];//cfgGroup.openDataSet("Spectrum");
 
     // 获取当前维度
@@ -261,6 +280,7 @@ void HDF5Settings::writeBytes(quint8 index, QByteArray& data)
 
 void HDF5Settings::createH5Config()
 {
+    QMutexLocker locker(&h5Mutex);
     if (QFileInfo::exists(DEFAULT_HDF5_FILENAME))
     {
         mfH5Setting = new H5::H5File(DEFAULT_HDF5_FILENAME, H5F_ACC_RDWR);
@@ -385,6 +405,7 @@ void HDF5Settings::createH5Config()
 
 void HDF5Settings::createH5Spectrum(QString filePath)
 {
+    QMutexLocker locker(&h5Mutex);
     // 创建表格数组
     if (!QFileInfo::exists(filePath))
     {
@@ -430,11 +451,45 @@ void HDF5Settings::createH5Spectrum(QString filePath)
             hsize_t chunk_dims[2] = {1, columns};  // 分块大小
             prop_list.setChunk(2, chunk_dims);
 
+            // 能谱摘要：一维可扩展，每块1024行
+            hsize_t summary_init_dims[1] = {0};
+            hsize_t summary_max_dims[1] = {H5S_UNLIMITED};
+            H5::DataSpace summary_dataspace(1, summary_init_dims, summary_max_dims);
+            H5::DSetCreatPropList summary_prop_list;
+            hsize_t summary_chunk_dims[1] = {1024};
+            summary_prop_list.setChunk(1, summary_chunk_dims);
+
+            // 摘要中统计的感兴趣区，8192道下标[first, last]
+            mSummaryRois.clear();
+            QStringList rangeTexts;
+            {
+                GlobalSettings settings;
+                QStringList ranges = settings.value("HDF5/SummaryRois", "").toString().split(';', Qt::SkipEmptyParts);
+                for (const QString& range : qAsConst(ranges))
+                {
+                    QStringList bounds = range.split('-');
+                    int first = bounds.value(0).trimmed().toInt();
+                    int last = bounds.value(1).trimmed().toInt();
+                    if (bounds.size() != 2 || first < 0 || last < first || last >= 8192 || mSummaryRois.size() >= SUMMARY_ROI_NUM)
+                        continue;
+                    mSummaryRois.append(qMakePair(first, last));
+                    rangeTexts << QString("%1-%2").arg(first).arg(last);
+                }
+            }
+
             for (int i=1; i<=DET_NUM; ++i){
                 // 创建数据集
                 H5::Group cfgGroup = mfH5Spectrum->createGroup(QString("Detector#%1").arg(i).toStdString());
                 H5::DataSet dataset = cfgGroup.createDataSet("Spectrum", H5::PredType::NATIVE_UINT, dataspace, prop_list);
                 mSpectrumDataset[i-1] = dataset;
+
+                H5::DataSet summary = cfgGroup.createDataSet("Summary", mSummaryDataType, summary_dataspace, summary_prop_list);
+                writeStrAttr(summary, "roiRanges", rangeTexts.join(';').toStdString());
+                writeStrAttr(summary, "lostCount", "与上一行之间丢失的能谱个数");
+                writeStrAttr(summary, "totalCount", "全谱总计数");
+                writeStrAttr(summary, "roiCount", "感兴趣区计数，道址区间见roiRanges");
+                mSummaryDataset[i-1] = summary;
+                mHasLastSequence[i-1] = false;
             }
 
             // for (int i=1; i<=DET_NUM; ++i){
@@ -484,10 +539,14 @@ void HDF5Settings::createH5Spectrum(QString filePath)
 
 void HDF5Settings::closeH5Spectrum()
 {
+    QMutexLocker locker(&h5Mutex);
     if (mfH5Spectrum)
     {
         for (int i=0;i<DET_NUM; ++i)
+        {
             mSpectrumDataset[i].close();
+            mSummaryDataset[i].close();
+        }
         H5Fflush(mfH5Spectrum->getId(), H5F_SCOPE_GLOBAL);  // 同步文件元数据
         mfH5Spectrum->close();
         delete mfH5Spectrum;
@@ -595,6 +654,53 @@ H5::CompType HDF5Settings::createFullSpectrumType()
     return type;
 }
 
+// 定义H5SpectrumSummary的HDF5复合类型
+H5::CompType HDF5Settings::createSummaryType()
+{
+    H5::CompType type(sizeof(H5SpectrumSummary));
+    type.insertMember("sequence", HOFFSET(H5SpectrumSummary, sequence), H5::PredType::NATIVE_UINT32);
+    type.insertMember("measureTime", HOFFSET(H5SpectrumSummary, measureTime), H5::PredType::NATIVE_UINT32);
+    type.insertMember("deathTime", HOFFSET(H5SpectrumSummary, deathTime), H5::PredType::NATIVE_UINT32);
+    type.insertMember("lostCount", HOFFSET(H5SpectrumSummary, lostCount), H5::PredType::NATIVE_UINT32);
+    type.insertMember("totalCount", HOFFSET(H5SpectrumSummary, totalCount), H5::PredType::NATIVE_UINT64);
+
+    hsize_t roi_dims[] = {SUMMARY_ROI_NUM};
+    H5::ArrayType roi_array(H5::PredType::NATIVE_UINT64, 1, roi_dims);
+    type.insertMember("roiCount", HOFFSET(H5SpectrumSummary, roiCount), roi_array);
+    return type;
+}
+
+void HDF5Settings::writeH5Summary(quint8 index, const H5Spectrum& data)
+{
+    H5SpectrumSummary summary{};
+    summary.sequence = data.sequence;
+    summary.measureTime = data.measureTime;
+    summary.deathTime = data.deathTime;
+    if (mHasLastSequence[index-1] && data.sequence > mLastSequence[index-1] + 1)
+        summary.lostCount = data.sequence - mLastSequence[index-1] - 1;
+    mLastSequence[index-1] = data.sequence;
+    mHasLastSequence[index-1] = true;
+
+    summary.totalCount = SpectrumKernels::totalCount(data.spectrum, 8192);
+    for (int i=0; i<mSummaryRois.size(); ++i)
+        summary.roiCount[i] = SpectrumKernels::totalCount(data.spectrum + mSummaryRois[i].first, mSummaryRois[i].second - mSummaryRois[i].first + 1);
+
+    H5::DataSet dataset = mSummaryDataset[index-1];
+    H5::DataSpace file_space = dataset.getSpace();
+    hsize_t current_dims[1];
+    file_space.getSimpleExtentDims(current_dims, NULL);
+
+    current_dims[0] += 1;
+    dataset.extend(current_dims);
+    file_space = dataset.getSpace();
+
+    hsize_t mem_dims[1] = {1};
+    H5::DataSpace mem_space(1, mem_dims);
+    hsize_t offset[1] = {current_dims[0] - 1};
+    file_space.selectHyperslab(H5S_SELECT_SET, mem_dims, offset);
+    dataset.write(&summary, mSummaryDataType, mem_space, file_space);
+}
+
 /**
  * @brief 写入单个FullSpectrum结构体到HDF5文件
  * @param index 探测器索引（1~24)
@@ -602,7 +708,7 @@ H5::CompType HDF5Settings::createFullSpectrumType()
  */
 void HDF5Settings::writeH5Spectrum(quint8 index, const H5Spectrum& data)
 {
-    QMutexLocker locker(&mWrite_mutex);
+    QMutexLocker locker(&h5Mutex);
     if (!mfH5Spectrum)
         return;
 
@@ -637,6 +743,9 @@ void HDF5Settings::writeH5Spectrum(quint8 index, const H5Spectrum& data)
         //QByteArray data(columns, static_cast<uchar>(i));
         dataset.write(&data, H5::PredType::NATIVE_UINT, mem_space, file_space);
 
+        // 6. 同步写入摘要
+        writeH5Summary(index, data);
+
         // 强制同步（避免异常丢失）
         //H5Fflush(dataset.getId(), H5F_SCOPE_GLOBAL);
         if (++mSpectrumRef >= 100)
@@ -652,6 +761,8 @@ void HDF5Settings::writeH5Spectrum(quint8 index, const H5Spectrum& data)
 bool HDF5Settings::readAllH5Spectrum(const std::string& filePath, const quint32 detectorId,
     QVector<H5Spectrum>& outData)
 {    
+    QMutexLocker locker(&h5Mutex);
+
     try {
         // 1. 打开文件
         H5::H5File file(filePath, H5F_ACC_RDONLY);
@@ -702,11 +813,167 @@ bool HDF5Settings::readAllH5Spectrum(const std::string& filePath, const quint32
     }
 }
 
+bool HDF5Settings::readH5SpectrumDims(const std::string& filePath, const quint32 detectorId,
+    quint64& rows, quint64& columns)
+{
+    QMutexLocker locker(&h5Mutex);
+
+    try {
+        H5::H5File file(filePath, H5F_ACC_RDONLY);
+        H5::Group group = file.openGroup(QString("Detector#%1").arg(detectorId).toStdString());
+        H5::DataSet dataset = group.openDataSet("Spectrum");
+
+        hsize_t dims[2] = {0, 0};
+        dataset.getSpace().getSimpleExtentDims(dims, nullptr);
+        rows = dims[0];
+        columns = dims[1];
+        return true;
+
+    } catch (H5::Exception& e) {
+        e.printErrorStack();
+        return false;
+    }
+}
+
+// 打开探测器的能谱数据集。数据集按行分块且不压缩，关闭块缓存后只读取部分列时HDF5直接读取所选字节，
+// 而不是先把整行读入缓存
+static H5::DataSet openSpectrumDataset(H5::H5File& file, const quint32 detectorId)
+{
+    H5::Group group = file.openGroup(QString("Detector#%1").arg(detectorId).toStdString());
+    H5::DSetAccPropList accessList;
+    accessList.setChunkCache(0, 0, 1.0);
+    return group.openDataSet("Spectrum", accessList);
+}
+
+bool HDF5Settings::readH5SpectrumSummary(const std::string& filePath, const quint32 detectorId,
+    QVector<H5SpectrumSummary>& outData, QVector<QPair<int, int>>* roiRanges)
+{
+    QMutexLocker locker(&h5Mutex);
+
+    try {
+        H5::H5File file(filePath, H5F_ACC_RDONLY);
+        H5::Group group = file.openGroup(QString("Detector#%1").arg(detectorId).toStdString());
+        if (H5Lexists(group.getId(), "Summary", H5P_DEFAULT) <= 0)
+            return false;
+
+        H5::DataSet dataset = group.openDataSet("Summary");
+        hsize_t dims[1] = {0};
+        dataset.getSpace().getSimpleExtentDims(dims, nullptr);
+        outData.resize(dims[0]);
+        if (dims[0] > 0)
+            dataset.read(outData.data(), createSummaryType());
+
+        if (roiRanges)
+        {
+            roiRanges->clear();
+            if (dataset.attrExists("roiRanges"))
+            {
+                H5::Attribute attribute = dataset.openAttribute("roiRanges");
+                H5std_string text;
+                attribute.read(attribute.getStrType(), text);
+                QStringList ranges = QString::fromStdString(text).split(';', Qt::SkipEmptyParts);
+                for (const QString& range : qAsConst(ranges))
+                {
+                    QStringList bounds = range.split('-');
+                    roiRanges->append(qMakePair(bounds.value(0).toInt(), bounds.value(1).toInt()));
+                }
+            }
+        }
+        return true;
+
+    } catch (H5::Exception& e) {
+        e.printErrorStack();
+        return false;
+    }
+}
+
+bool HDF5Settings::readH5SpectrumHeaders(const std::string& filePath, const quint32 detectorId,
+    QVector<quint32>& outData)
+{
+    QMutexLocker locker(&h5Mutex);
+
+    try {
+        H5::H5File file(filePath, H5F_ACC_RDONLY);
+        H5::DataSet dataset = openSpectrumDataset(file, detectorId);
+
+        H5::DataSpace file_space = dataset.getSpace();
+        hsize_t dims[2] = {0, 0};
+        file_space.getSimpleExtentDims(dims, nullptr);
+
+        const hsize_t headerColumns = 3;
+        if (dims[1] != sizeof(H5Spectrum) / sizeof(quint32)) {
+            qWarning() << "H5Spectrum column mismatch:"
+                       << dims[1] << "!=" << sizeof(H5Spectrum) / sizeof(quint32);
+            return false;
+        }
+
+        outData.resize(dims[0] * headerColumns);
+        if (dims[0] == 0)
+            return true;
+
+        hsize_t start[2] = {0, 0};
+        hsize_t count[2] = {dims[0], headerColumns};
+        file_space.selectHyperslab(H5S_SELECT_SET, count, start);
+
+        H5::DataSpace mem_space(2, count);
+        dataset.read(outData.data(), H5::PredType::NATIVE_UINT, mem_space, file_space);
+        return true;
+
+    } catch (H5::Exception& e) {
+        e.printErrorStack();
+        return false;
+    }
+}
+
+bool HDF5Settings::readH5SpectrumChannels(const std::string& filePath, const quint32 detectorId,
+    quint64 startRow, quint64 rowCount, int channelBegin, int channelCount, QVector<quint32>& outData)
+{
+    QMutexLocker locker(&h5Mutex);
+
+    try {
+        H5::H5File file(filePath, H5F_ACC_RDONLY);
+        H5::DataSet dataset = openSpectrumDataset(file, detectorId);
+
+        H5::DataSpace file_space = dataset.getSpace();
+        hsize_t dims[2] = {0, 0};
+        file_space.getSimpleExtentDims(dims, nullptr);
+
+        // 道址数据从第4列开始
+        const hsize_t headerColumns = 3;
+        if (channelBegin < 0 || channelCount <= 0 || headerColumns + channelBegin + channelCount > dims[1]) {
+            qWarning() << "H5Spectrum channel range out of bounds:"
+                       << channelBegin << channelCount << dims[1];
+            return false;
+        }
+
+        if (startRow >= dims[0]) {
+            outData.clear();
+            return true;
+        }
+
+        hsize_t rows = qMin<hsize_t>(rowCount, dims[0] - startRow);
+        outData.resize(rows * channelCount);
+
+        hsize_t start[2] = {startRow, headerColumns + channelBegin};
+        hsize_t count[2] = {rows, hsize_t(channelCount)};
+        file_space.selectHyperslab(H5S_SELECT_SET, count, start);
+
+        H5::DataSpace mem_space(2, count);
+        dataset.read(outData.data(), H5::PredType::NATIVE_UINT, mem_space, file_space);
+        return true;
+
+    } catch (H5::Exception& e) {
+        e.printErrorStack();
+        return false;
+    }
+}
+
 bool HDF5Settings::readFullSpectrum(const std::string& filePath,
                                              const std::string& groupName,
                                              const std::string& datasetName,
                                              std::function<void(const H5Spectrum&)> callback)
 {
+    QMutexLocker locker(&h5Mutex);
     H5Spectrum data{};  // 初始化默认值
 
     try {
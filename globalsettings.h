@@ -69,6 +69,20 @@ struct H5Spectrum{
     quint32 spectrum[8192]; // 8192道完整数据
 };
 
+// 每行能谱的摘要，与能谱同步写入HDF5文件（Detector#N/Summary），
+// 计数率、死时间统计只需读取摘要，不必读取8192道数据。
+// 打靶时刻判断（ParseData的总计数>1000搜索）目前只在在线解析中进行，离线分析的打靶时刻取自界面输入，
+// 暂未改为从摘要查找
+#define SUMMARY_ROI_NUM 4
+struct H5SpectrumSummary{
+    quint32 sequence;      // 能谱序号
+    quint32 measureTime;   // 能量测量时间间隔,单位ms
+    quint32 deathTime;     // 死时间,单位*10ns
+    quint32 lostCount;     // 与上一行之间丢失的能谱个数
+    quint64 totalCount;    // 全谱总计数
+    quint64 roiCount[SUMMARY_ROI_NUM]; // 感兴趣区计数，道址区间见数据集属性roiRanges，未设置的为0
+};
+
 // 用于解包时的完整能谱数据
 #pragma pack(push, 1)  // 确保字节对齐
 struct FullSpectrum {
@@ -823,6 +837,8 @@ public:
 
     // 定义FullSpectrum的HDF5复合类型
     H5::CompType createFullSpectrumType();
+    // 定义H5SpectrumSummary的HDF5复合类型
+    static H5::CompType createSummaryType();
     H5::CompType createCfgDataType();
 
     void createH5Config();
@@ -845,12 +861,59 @@ public:
     static bool readAllH5Spectrum(const std::string& filePath, const quint32 detectorId,
         QVector<H5Spectrum>& outData);
 
+    /**
+     * @brief 读取指定探测器能谱数据集的维度，不读取数据
+     * @param filePath H5文件路径
+     * @param detectorId 探测器编号
+     * @param rows 能谱行数
+     * @param columns 每行的列数
+     * @return 是否读取成功
+     */
+    static bool readH5SpectrumDims(const std::string& filePath, const quint32 detectorId,
+        quint64& rows, quint64& columns);
+
+    /**
+     * @brief 读取指定探测器的能谱摘要（Detector#N/Summary），数据量只有能谱的千分之一左右
+     * @param filePath H5文件路径
+     * @param detectorId 探测器编号
+     * @param outData 每行能谱一条摘要
+     * @param roiRanges 返回感兴趣区的道址区间[first, last]，可为空
+     * @return 是否读取成功，早期文件没有摘要时返回false
+     */
+    static bool readH5SpectrumSummary(const std::string& filePath, const quint32 detectorId,
+        QVector<H5SpectrumSummary>& outData, QVector<QPair<int, int>>* roiRanges = nullptr);
+
+    /**
+     * @brief 只读取指定探测器各行能谱的表头（序号、测量时间、死时间），不读取道址数据
+     * @param filePath H5文件路径
+     * @param detectorId 探测器编号
+     * @param outData 每行3个数，按行依次存放
+     * @return 是否读取成功
+     */
+    static bool readH5SpectrumHeaders(const std::string& filePath, const quint32 detectorId,
+        QVector<quint32>& outData);
+
+    /**
+     * @brief 读取指定探测器从startRow开始的连续若干行能谱中[channelBegin, channelBegin+channelCount)道的数据，
+     * 只读所选道址对应的字节
+     * @param filePath H5文件路径
+     * @param detectorId 探测器编号
+     * @param startRow 起始行
+     * @param rowCount 读取行数，超出数据集末尾时只读到末尾
+     * @param channelBegin 起始道址
+     * @param channelCount 道数
+     * @param outData 按行依次存放，每行channelCount个数，大小调整为实际读取的行数×channelCount
+     * @return 是否读取成功
+     */
+    static bool readH5SpectrumChannels(const std::string& filePath, const quint32 detectorId,
+        quint64 startRow, quint64 rowCount, int channelBegin, int channelCount, QVector<quint32>& outData);
+
     /**
      * @brief 从HDF5文件逐行读取H5Spectrum结构体
      * @param filePath H5文件路径
      * @param groupName 分组名称(Detector#1)
      * @param datasetName 数据集名称(Spectrum)
-     * @param callback 数据回调
+     * @param callback 数据回调，读取期间持有HDF5锁，回调中不能再调用HDF5Settings的读写接口
      * @return 是否读取成功
      */
     bool readFullSpectrum(const std::string& filePath,
@@ -861,14 +924,21 @@ public:
     Q_SIGNAL void sigSpectrum(const H5Spectrum&);
 
 private:
+    // 追加一行能谱摘要，调用前已持有HDF5锁
+    void writeH5Summary(quint8 index, const H5Spectrum& data);
+
     H5::H5File *mfH5Setting = nullptr; // H5配置文件
     H5::H5File *mfH5Spectrum = nullptr; // H5能谱文件
     quint32 mSpectrumRef = 0;// 能谱计数
     H5::DataSet mSpectrumDataset[DET_NUM];
+    H5::DataSet mSummaryDataset[DET_NUM];
+    H5::CompType mSummaryDataType;
+    QVector<QPair<int, int>> mSummaryRois; // 摘要中统计的感兴趣区，配置项HDF5/SummaryRois，如"3600-3700;1200-1260"
+    quint32 mLastSequence[DET_NUM];
+    bool mHasLastSequence[DET_NUM] = {};
     H5::CompType mCompDataType;//复合数据类型
     H5::CompType mSpectrumDataType;//复合数据类型
     QMap<quint8, DetParameter> mMapDetParameter;
-    QMutex mWrite_mutex;
 };
 
 #endif // GLOBALSETTINGS_H
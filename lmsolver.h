@@ -0,0 +1,357 @@
+/*
+ * @Author: MrPan
+ * @Date: 2026-02-05 14:20:36
+ * @LastEditors: Maoxiaoqing
+ * @LastEditTime: 2026-02-05 14:20:36
+ * @Description: 定长参数的Levenberg-Marquardt拟合，参数个数为模板参数，矩阵均为栈上的Eigen定长矩阵，
+ *               直接对连续存放的x/y数组拟合，拟合过程中不申请堆内存。用于寻峰、剥谱等频繁调用的拟合，
+ *               CurveFit中基于alglib的同名模型拟合保留作为参考实现。
+ */
+#ifndef LMSOLVER_H
+#define LMSOLVER_H
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+
+namespace CurveFit {
+namespace LM {
+    template<int N>
+    using Params = Eigen::Matrix<double, N, 1>;
+
+    struct Options{
+        double epsx = 1e-8;       // 参数相对变化量小于该值时认为收敛（阻尼较小、接近高斯-牛顿步时才判断）
+        double epsg = 1e-6;       // 残差与各参数梯度方向夹角余弦的最大值小于该值时认为收敛
+        int maxIterations = 1000; // 最大迭代次数
+        double lambda = 1e-3;     // 阻尼因子初值
+    };
+
+    struct Report{
+        int iterations = 0;       // 迭代次数
+        bool converged = false;   // 是否收敛
+        double rss = 0.0;         // 残差平方和
+        double r2 = 0.0;          // 拟合优度
+    };
+
+    /**
+     * @brief poly4Rebase 4阶多项式换元，p(x) = c[0]*x^4 + c[1]*x^3 + c[2]*x^2 + c[3]*x + c[4]，
+     * 令 x = center + scale*t，给出以t为自变量的系数，顺序相同。
+     * 反变换为 poly4Rebase(out, -center/scale, 1/scale, c)
+     */
+    inline void poly4Rebase(const double* c, double center, double scale, double* out)
+    {
+        static const double binomial[5][5] = {{1,0,0,0,0},{1,1,0,0,0},{1,2,1,0,0},{1,3,3,1,0},{1,4,6,4,1}};
+        double a[5] = {c[4], c[3], c[2], c[1], c[0]}; // a[k]为x^k的系数
+        double b[5] = {0, 0, 0, 0, 0};
+        double scalePow = 1.0;
+        for (int j=0; j<5; ++j)
+        {
+            double centerPow = 1.0;
+            for (int k=j; k<5; ++k)
+            {
+                b[j] += a[k] * binomial[k][j] * centerPow;
+                centerPow *= center;
+            }
+            b[j] *= scalePow;
+            scalePow *= scale;
+        }
+        for (int k=0; k<5; ++k)
+            out[k] = b[4-k];
+    }
+
+    /**
+     * @brief 高斯+线性，峰位固定 func = c[0]*exp(-0.5*pow((x-peak)/c[1],2)) + c[2]*x + c[3];
+     * 与CurveFit::function_gauss_linear一致
+     */
+    struct GaussLinear{
+        enum { ParamCount = 4 };
+        double peak = 0.0;
+
+        // 模型对该参数是线性的
+        static bool isLinear(int k) { return k != 1; }
+
+        double operator()(const Params<4>& c, double x, Params<4>& grad) const
+        {
+            double d = x - peak;
+            double g = exp(-0.5*d*d/(c[1]*c[1]));
+            grad << g, c[0]*g*d*d/(c[1]*c[1]*c[1]), x, 1.0;
+            return c[0]*g + c[2]*x + c[3];
+        }
+    };
+
+    /**
+     * @brief 高斯+线性 func = c[0]*exp(-0.5*pow((x-c[1])/c[2],2)) + c[3]*x + c[4];
+     * 与CurveFit::function_gauss_linear2一致
+     */
+    struct GaussLinear2{
+        enum { ParamCount = 5 };
+
+        static bool isLinear(int k) { return k == 0 || k >= 3; }
+
+        double operator()(const Params<5>& c, double x, Params<5>& grad) const
+        {
+            double d = x - c[1];
+            double s2 = c[2]*c[2];
+            double g = exp(-0.5*d*d/s2);
+            grad << g, c[0]*g*d/s2, c[0]*g*d*d/(s2*c[2]), x, 1.0;
+            return c[0]*g + c[3]*x + c[4];
+        }
+    };
+
+    /**
+     * @brief 单高斯+4阶多项式，center=0、scale=1时与CurveFit::function_gauss_poly4一致。
+     * 多项式部分以 t=(x-center)/scale 为自变量，剥谱时x在800~1100keV，x^4与常数项量级相差1e12，
+     * 取窗口中点、半宽归一化后各阶系数量级相当，拟合结果用poly4Rebase换回以x为自变量的系数
+     */
+    struct GaussPoly4{
+        enum { ParamCount = 8 };
+        double center = 0.0;
+        double scale = 1.0;
+
+        static bool isLinear(int k) { return k == 0 || k >= 3; }
+
+        double operator()(const Params<8>& c, double x, Params<8>& grad) const
+        {
+            double t = (x - center) / scale;
+            double x2 = t*t;
+            double x3 = x2*t;
+            double x4 = x2*x2;
+            double d = x - c[1];
+            double s2 = c[2]*c[2];
+            double g = exp(-0.5*d*d/s2);
+            grad << g, c[0]*g*d/s2, c[0]*g*d*d/(s2*c[2]), x4, x3, x2, t, 1.0;
+            return c[0]*g + c[3]*x4 + c[4]*x3 + c[5]*x2 + c[6]*t + c[7];
+        }
+    };
+
+    /**
+     * @brief 双高斯+4阶多项式，center=0、scale=1时与CurveFit::function_2gauss_poly4一致，
+     * 多项式部分的自变量同GaussPoly4
+     */
+    struct TwoGaussPoly4{
+        enum { ParamCount = 11 };
+        double center = 0.0;
+        double scale = 1.0;
+
+        static bool isLinear(int k) { return k == 0 || k == 3 || k >= 6; }
+
+        double operator()(const Params<11>& c, double x, Params<11>& grad) const
+        {
+            double t = (x - center) / scale;
+            double x2 = t*t;
+            double x3 = x2*t;
+            double x4 = x2*x2;
+            double d1 = x - c[1];
+            double s1 = c[2]*c[2];
+            double g1 = exp(-0.5*d1*d1/s1);
+            double d2 = x - c[4];
+            double s2 = c[5]*c[5];
+            double g2 = exp(-0.5*d2*d2/s2);
+            grad << g1, c[0]*g1*d1/s1, c[0]*g1*d1*d1/(s1*c[2]),
+                    g2, c[3]*g2*d2/s2, c[3]*g2*d2*d2/(s2*c[5]),
+                    x4, x3, x2, t, 1.0;
+            return c[0]*g1 + c[3]*g2 + c[6]*x4 + c[7]*x3 + c[8]*x2 + c[9]*t + c[10];
+        }
+    };
+
+    // 残差平方和
+    template<typename Model, int N = Model::ParamCount>
+    double residualSquareSum(const Model& model, const double* x, const double* y, int n, const Params<N>& c)
+    {
+        Params<N> grad;
+        double rss = 0.0;
+        for (int i=0; i<n; ++i)
+        {
+            double r = y[i] - model(c, x[i], grad);
+            rss += r*r;
+        }
+        return rss;
+    }
+
+    /**
+     * @brief solveLinear 固定非线性参数（峰位、峰宽），对线性参数（幅度、本底系数）求线性最小二乘解，
+     * 模型对这些参数是线性的，一步即得精确解。用作fit的初值，避免本底系数初值与数据量级不符时迭代发散
+     * @return 解是否有效
+     */
+    template<typename Model, int N = Model::ParamCount>
+    bool solveLinear(const Model& model, const double* x, const double* y, int n, Params<N>& c)
+    {
+        typedef Eigen::Matrix<double, N, N> Matrix;
+        Matrix JtJ = Matrix::Zero();
+        Params<N> Jtr = Params<N>::Zero();
+        Params<N> grad, scale;
+        int linearCount = 0;
+        for (int k=0; k<N; ++k)
+            linearCount += Model::isLinear(k) ? 1 : 0;
+        if (n < linearCount || !c.allFinite())
+            return false;
+
+        for (int i=0; i<n; ++i)
+        {
+            double r = y[i] - model(c, x[i], grad);
+            for (int k=0; k<N; ++k)
+            {
+                if (!Model::isLinear(k))
+                    grad[k] = 0.0;
+            }
+            JtJ.template selfadjointView<Eigen::Lower>().rankUpdate(grad);
+            Jtr.noalias() += grad * r;
+        }
+        JtJ.template triangularView<Eigen::StrictlyUpper>() = JtJ.transpose();
+
+        // 非线性参数对应的行列置为单位阵、右端为0，其增量为0
+        for (int k=0; k<N; ++k)
+        {
+            if (!Model::isLinear(k) || JtJ(k, k) <= 0.0)
+            {
+                JtJ.row(k).setZero();
+                JtJ.col(k).setZero();
+                JtJ(k, k) = 1.0;
+                Jtr[k] = 0.0;
+            }
+            scale[k] = 1.0 / sqrt(JtJ(k, k));
+        }
+
+        Matrix A = scale.asDiagonal() * JtJ * scale.asDiagonal();
+        Params<N> delta = scale.asDiagonal() * A.ldlt().solve(scale.asDiagonal() * Jtr);
+        if (!delta.allFinite())
+            return false;
+
+        c += delta;
+        return true;
+    }
+
+    /**
+     * @brief fit Levenberg-Marquardt拟合
+     * @param model 拟合模型，double operator()(const Params<N>& c, double x, Params<N>& grad)，返回函数值并给出梯度
+     * @param x 自变量数组
+     * @param y 待拟合数据数组
+     * @param n 数据点个数
+     * @param c 拟合参数初值，拟合结束后存放拟合结果
+     * @param options 拟合条件
+     * @param report 拟合报告，可以为nullptr
+     * @return 是否收敛且参数均为有限值。达到最大迭代次数、阻尼增大到无法下降而梯度判据仍不满足时返回false，
+     * 此时c为迭代过程中残差最小的参数。结果是否合理（幅度、峰宽的符号，拟合优度）由调用者按模型判断
+     */
+    template<typename Model, int N = Model::ParamCount>
+    bool fit(const Model& model, const double* x, const double* y, int n, Params<N>& c,
+             const Options& options = Options(), Report* report = nullptr)
+    {
+        if (n < N || !c.allFinite())
+            return false;
+
+        typedef Eigen::Matrix<double, N, N> Matrix;
+        Matrix JtJ, A;
+        Params<N> Jtr, grad, scale, delta, trial;
+
+        double rss = residualSquareSum(model, x, y, n, c);
+        double lambda = options.lambda;
+        bool converged = false;
+        int iteration = 0;
+        for (; iteration < options.maxIterations && !converged; ++iteration)
+        {
+            // 正规方程 JtJ*delta = Jt*r
+            JtJ.setZero();
+            Jtr.setZero();
+            for (int i=0; i<n; ++i)
+            {
+                double r = y[i] - model(c, x[i], grad);
+                JtJ.template selfadjointView<Eigen::Lower>().rankUpdate(grad);
+                Jtr.noalias() += grad * r;
+            }
+            JtJ.template triangularView<Eigen::StrictlyUpper>() = JtJ.transpose();
+
+            // 按对角元归一化，多项式各阶系数量级相差很大，不归一化时方程组病态
+            for (int k=0; k<N; ++k)
+                scale[k] = JtJ(k, k) > 0.0 ? 1.0 / sqrt(JtJ(k, k)) : 1.0;
+
+            // 梯度判据：残差向量与每个参数的梯度方向都近似正交
+            double gradientMax = 0.0;
+            for (int k=0; k<N; ++k)
+                gradientMax = std::max(gradientMax, fabs(Jtr[k] * scale[k]));
+            if (gradientMax <= options.epsg * sqrt(rss))
+            {
+                converged = true;
+                break;
+            }
+
+            // 增大阻尼直至残差下降
+            bool accepted = false;
+            while (!accepted)
+            {
+                A = scale.asDiagonal() * JtJ * scale.asDiagonal();
+                A.diagonal().array() += lambda;
+                delta = scale.asDiagonal() * A.ldlt().solve(scale.asDiagonal() * Jtr);
+
+                trial = c + delta;
+                double trialRss = delta.allFinite() ? residualSquareSum(model, x, y, n, trial) : INFINITY;
+                if (trialRss < rss)
+                {
+                    accepted = true;
+
+                    // 步长判据，阻尼很大时步长被压小，不能据此判断收敛
+                    if (lambda <= 1.0)
+                    {
+                        converged = true;
+                        for (int k=0; k<N; ++k)
+                        {
+                            if (fabs(delta[k]) > options.epsx * (fabs(trial[k]) + options.epsx))
+                            {
+                                converged = false;
+                                break;
+                            }
+                        }
+                    }
+                    lambda = std::max(lambda * 0.1, 1e-15);
+
+                    c = trial;
+                    rss = trialRss;
+                }
+                else
+                {
+                    lambda *= 10.0;
+                    // 阻尼已很大仍无法下降，停止迭代，是否收敛由梯度判据决定
+                    if (lambda > 1e15)
+                        break;
+                }
+            }
+            if (!accepted)
+            {
+                // 无法继续下降时参数未变，放宽梯度判据，只排除明显未到极小值的情况
+                converged = gradientMax <= sqrt(options.epsg) * sqrt(rss);
+                ++iteration;
+                break;
+            }
+        }
+
+        if (report)
+        {
+            double mean = 0.0;
+            for (int i=0; i<n; ++i)
+                mean += y[i];
+            mean /= n;
+
+            double tss = 0.0;
+            for (int i=0; i<n; ++i)
+                tss += (y[i] - mean) * (y[i] - mean);
+
+            report->iterations = iteration;
+            report->converged = converged;
+            report->rss = rss;
+            report->r2 = tss > 0.0 ? 1.0 - rss / tss : 1.0;
+        }
+
+        return converged && c.allFinite();
+    }
+
+    // 计算拟合曲线值
+    template<typename Model, int N = Model::ParamCount>
+    double evaluate(const Model& model, const Params<N>& c, double x)
+    {
+        Params<N> grad;
+        return model(c, x, grad);
+    }
+}
+}
+
+#endif // LMSOLVER_H
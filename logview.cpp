@@ -0,0 +1,431 @@
+#include "logview.h"
+#include "globalsettings.h"
+#include <QApplication>
+#include <QClipboard>
+#include <QDateTime>
+#include <QKeyEvent>
+#include <QPainter>
+#include <QRegularExpression>
+#include <QScrollBar>
+#include <QVarLengthArray>
+#include <cstring>
+#include <algorithm>
+
+// 三字组在布隆过滤器中的位，字符先做大小写折叠，与不区分大小写的查找一致
+static inline int trigramBit(ushort a, ushort b, ushort c)
+{
+    quint64 key = (quint64(a) << 32) | (quint64(b) << 16) | c;
+    return int((key * 0x9E3779B97F4A7C15ull) >> 53); // 11位，0~2047
+}
+
+static void foldText(const QString& text, QVarLengthArray<ushort, 256>& folded)
+{
+    folded.resize(text.size());
+    for (int i = 0; i < text.size(); ++i)
+        folded[i] = text.at(i).toCaseFolded().unicode();
+}
+
+// 从日志文本中识别谱仪编号，如"谱仪[#3]"、"Det index=3"、"Detector 3"
+static int detectorOf(const QString& text)
+{
+    static const QRegularExpression re("谱仪\\[#(\\d+)\\]|探测器\\s*#?(\\d+)|Det(?:ector)?\\s*(?:index\\s*=\\s*)?(\\d+)");
+    QRegularExpressionMatch match = re.match(text);
+    if (!match.hasMatch())
+        return 0;
+
+    for (int i = 1; i <= 3; ++i)
+    {
+        if (match.capturedLength(i) > 0)
+        {
+            int id = match.captured(i).toInt();
+            return id > 0 && id < 32 ? id : 0;
+        }
+    }
+    return 0;
+}
+
+LogModel::LogModel(int capacity, QObject *parent)
+    : QAbstractListModel{parent}
+{
+    // 容量取块长度的整数倍，块在环形缓冲区中与行同时被覆盖
+    mCapacity = qMax(int(BlockLines), (capacity + BlockLines - 1) / BlockLines * BlockLines);
+}
+
+int LogModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+    return mFiltering ? mFiltered.size() - mFilteredHead : int(mNextSeq - mFirstSeq);
+}
+
+qint64 LogModel::rowToSeq(int row) const
+{
+    return mFiltering ? mFiltered.at(mFilteredHead + row) : mFirstSeq + row;
+}
+
+bool LogModel::accepts(const Entry &entry) const
+{
+    return entry.severity >= mMinSeverity && (mDetectorId == 0 || entry.detector == mDetectorId);
+}
+
+bool LogModel::blockAccepts(const Block &block) const
+{
+    return (block.severityMask >> mMinSeverity) != 0 && (mDetectorId == 0 || (block.detectorMask & (1u << mDetectorId)));
+}
+
+void LogModel::append(const QVector<LogMessage> &messages)
+{
+    int first = qMax(0, messages.size() - mCapacity);
+    int count = messages.size() - first;
+    if (count <= 0)
+        return;
+
+    // 超出容量时先移除最早的行，其位置随后被新行覆盖
+    qint64 overflow = mNextSeq - mFirstSeq + count - mCapacity;
+    if (overflow > 0)
+    {
+        qint64 newFirstSeq = mFirstSeq + overflow;
+        if (mFiltering)
+        {
+            int removed = 0;
+            while (mFilteredHead + removed < mFiltered.size() && mFiltered.at(mFilteredHead + removed) < newFirstSeq)
+                removed++;
+            if (removed > 0)
+            {
+                beginRemoveRows(QModelIndex(), 0, removed - 1);
+                mFilteredHead += removed;
+                endRemoveRows();
+            }
+            mFirstSeq = newFirstSeq;
+
+            // 已移除的部分过多时整体前移
+            if (mFilteredHead > mFiltered.size() / 2)
+            {
+                mFiltered.remove(0, mFilteredHead);
+                mFilteredHead = 0;
+            }
+        }
+        else
+        {
+            beginRemoveRows(QModelIndex(), 0, int(overflow) - 1);
+            mFirstSeq = newFirstSeq;
+            endRemoveRows();
+        }
+    }
+
+    // 写入环形缓冲区并更新块索引，此时行数尚未改变
+    QVarLengthArray<ushort, 256> folded;
+    QVector<qint64> accepted;
+    qint64 seq = mNextSeq;
+    for (int i = first; i < messages.size(); ++i, ++seq)
+    {
+        const LogMessage& message = messages.at(i);
+        Entry entry;
+        entry.time = message.time;
+        entry.text = message.text;
+        entry.severity = quint8(logSeverity(message.type));
+        entry.detector = quint8(detectorOf(message.text));
+
+        // 缓冲区按需增长，写满后循环覆盖
+        int slot = int(seq % mCapacity);
+        if (slot == mEntries.size())
+            mEntries.append(entry);
+        else
+            mEntries[slot] = entry;
+
+        if (seq % BlockLines == 0)
+        {
+            int blockSlot = int((seq / BlockLines) % (mCapacity / BlockLines));
+            if (blockSlot == mBlocks.size())
+                mBlocks.append(Block());
+            Block& newBlock = mBlocks[blockSlot];
+            std::memset(newBlock.bloom, 0, sizeof(newBlock.bloom));
+            newBlock.severityMask = 0;
+            newBlock.detectorMask = 0;
+        }
+
+        Block& currentBlock = block(seq);
+        foldText(entry.text, folded);
+        for (int j = 0; j + 2 < folded.size(); ++j)
+        {
+            int bit = trigramBit(folded[j], folded[j+1], folded[j+2]);
+            currentBlock.bloom[bit >> 6] |= 1ull << (bit & 63);
+        }
+        currentBlock.severityMask |= 1u << entry.severity;
+        currentBlock.detectorMask |= 1u << entry.detector;
+
+        if (mFiltering && accepts(entry))
+            accepted.append(seq);
+    }
+
+    if (mFiltering)
+    {
+        if (!accepted.isEmpty())
+        {
+            int rows = rowCount();
+            beginInsertRows(QModelIndex(), rows, rows + accepted.size() - 1);
+            mFiltered.append(accepted);
+            endInsertRows();
+        }
+        mNextSeq = seq;
+    }
+    else
+    {
+        int rows = rowCount();
+        beginInsertRows(QModelIndex(), rows, rows + count - 1);
+        mNextSeq = seq;
+        endInsertRows();
+    }
+}
+
+void LogModel::clear()
+{
+    beginResetModel();
+    QVector<Entry>().swap(mEntries);
+    QVector<Block>().swap(mBlocks);
+    QVector<qint64>().swap(mFiltered);
+    mFilteredHead = 0;
+    mFirstSeq = 0;
+    mNextSeq = 0;
+    endResetModel();
+}
+
+void LogModel::setFilter(int minSeverity, int detectorId)
+{
+    beginResetModel();
+    mMinSeverity = qBound(0, minSeverity, 4);
+    mDetectorId = detectorId > 0 && detectorId < 32 ? detectorId : 0;
+    mFiltering = mMinSeverity > 0 || mDetectorId > 0;
+
+    mFiltered.clear();
+    mFilteredHead = 0;
+    if (mFiltering)
+    {
+        // 级别、谱仪都不匹配的块整块跳过
+        qint64 seq = mFirstSeq;
+        while (seq < mNextSeq)
+        {
+            qint64 blockEnd = qMin(mNextSeq, (seq / BlockLines + 1) * BlockLines);
+            if (blockAccepts(block(seq)))
+            {
+                for (; seq < blockEnd; ++seq)
+                {
+                    if (accepts(entry(seq)))
+                        mFiltered.append(seq);
+                }
+            }
+            seq = blockEnd;
+        }
+    }
+    endResetModel();
+}
+
+int LogModel::find(const QString &text, int fromRow, bool forward) const
+{
+    int rows = rowCount();
+    if (text.isEmpty() || rows == 0)
+        return -1;
+
+    // 查找内容的全部三字组都在块的布隆过滤器中时，块内才可能有匹配行
+    QVarLengthArray<ushort, 256> folded;
+    foldText(text, folded);
+    QVarLengthArray<int, 64> bits;
+    for (int j = 0; j + 2 < folded.size(); ++j)
+        bits.append(trigramBit(folded[j], folded[j+1], folded[j+2]));
+
+    int step = forward ? 1 : -1;
+    int row = fromRow < 0 ? (forward ? 0 : rows - 1) : fromRow + step;
+    qint64 checkedBlock = -1;
+    bool blockMatch = false;
+    for (; row >= 0 && row < rows; row += step)
+    {
+        qint64 seq = rowToSeq(row);
+        qint64 blockIndex = seq / BlockLines;
+        if (blockIndex != checkedBlock)
+        {
+            checkedBlock = blockIndex;
+            const Block& currentBlock = block(seq);
+            blockMatch = true;
+            for (int bit : bits)
+            {
+                if (!(currentBlock.bloom[bit >> 6] & (1ull << (bit & 63))))
+                {
+                    blockMatch = false;
+                    break;
+                }
+            }
+        }
+
+        if (!blockMatch)
+        {
+            // 未过滤时行与序号连续，直接跳到块边界
+            if (!mFiltering)
+                row = int((forward ? (blockIndex + 1) * BlockLines - 1 : blockIndex * BlockLines) - mFirstSeq);
+            continue;
+        }
+
+        if (entry(seq).text.contains(text, Qt::CaseInsensitive))
+            return row;
+    }
+    return -1;
+}
+
+void LogModel::setDarkTheme(bool isDarkTheme)
+{
+    mIsDarkTheme = isDarkTheme;
+    int rows = rowCount();
+    if (rows > 0)
+        emit dataChanged(index(0), index(rows - 1), {Qt::ForegroundRole});
+}
+
+QVariant LogModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= rowCount())
+        return QVariant();
+
+    const Entry& logEntry = entry(rowToSeq(index.row()));
+    switch (role) {
+    case Qt::DisplayRole:
+        return QDateTime::fromMSecsSinceEpoch(logEntry.time).toString("yyyy-MM-dd hh:mm:ss.zzz >> ") + logEntry.text;
+    case Qt::ToolTipRole:
+        return logEntry.text;
+    case Qt::ForegroundRole:
+        // 与原日志窗口的颜色一致
+        if (logEntry.severity >= logSeverity(QtCriticalMsg))
+            return QColor(0xFF, 0x00, 0x00);
+        else if (logEntry.severity == logSeverity(QtWarningMsg))
+            return QColor(0x00, 0x00, 0xF0);
+        return mIsDarkTheme ? QColor(Qt::white) : QColor(Qt::black);
+    default:
+        return QVariant();
+    }
+}
+
+/**
+ * @brief 绘制日志行，并为匹配的文字加上高亮背景
+ */
+class LogItemDelegate : public QStyledItemDelegate
+{
+public:
+    using QStyledItemDelegate::QStyledItemDelegate;
+
+    void setHighlightText(const QString& text) { mHighlightText = text; }
+
+    void paint(QPainter* painter, const QStyleOptionViewItem& option, const QModelIndex& index) const override
+    {
+        QStyleOptionViewItem opt = option;
+        initStyleOption(&opt, index);
+        QString text = opt.text;
+        opt.text.clear();
+
+        const QWidget* widget = opt.widget;
+        QStyle* style = widget ? widget->style() : QApplication::style();
+        style->drawControl(QStyle::CE_ItemViewItem, &opt, painter, widget);
+
+        QRect textRect = style->subElementRect(QStyle::SE_ItemViewItemText, &opt, widget);
+        painter->save();
+        painter->setClipRect(textRect);
+
+        if (!mHighlightText.isEmpty())
+        {
+            QColor highlightColor(255, 255, 0, 100);  // 黄色半透明背景
+            int pos = 0;
+            while ((pos = text.indexOf(mHighlightText, pos, Qt::CaseInsensitive)) >= 0)
+            {
+                int x = opt.fontMetrics.horizontalAdvance(text.left(pos));
+                int width = opt.fontMetrics.horizontalAdvance(text.mid(pos, mHighlightText.size()));
+                painter->fillRect(QRect(textRect.left() + x, textRect.top(), width, textRect.height()), highlightColor);
+                pos += mHighlightText.size();
+            }
+        }
+
+        if (opt.state & QStyle::State_Selected)
+            painter->setPen(opt.palette.color(QPalette::HighlightedText));
+        else
+            painter->setPen(index.data(Qt::ForegroundRole).value<QColor>());
+        painter->drawText(textRect, Qt::AlignLeft | Qt::AlignVCenter | Qt::TextSingleLine, text);
+        painter->restore();
+    }
+
+private:
+    QString mHighlightText;
+};
+
+LogView::LogView(QWidget *parent)
+    : QListView(parent)
+{
+    // 最多保留的日志行数
+    GlobalSettings settings(CONFIG_FILENAME);
+    int capacity = qBound(10000, settings.value("mainWindow/LogCapacity", 1000000).toInt(), 10000000);
+
+    mModel = new LogModel(capacity, this);
+    mDelegate = new LogItemDelegate(this);
+    setModel(mModel);
+    setItemDelegate(mDelegate);
+
+    // 行高一致，视图按行号直接定位，不逐行计算尺寸
+    setUniformItemSizes(true);
+    setSelectionMode(QAbstractItemView::ExtendedSelection);
+    setEditTriggers(QAbstractItemView::NoEditTriggers);
+    setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+}
+
+void LogView::appendMessages(const QVector<LogMessage> &messages)
+{
+    QScrollBar* scrollBar = verticalScrollBar();
+    bool atBottom = scrollBar->value() >= scrollBar->maximum();
+    mModel->append(messages);
+    if (atBottom)
+        scrollToBottom();
+}
+
+void LogView::clear()
+{
+    mModel->clear();
+}
+
+void LogView::setHighlightText(const QString &text)
+{
+    mDelegate->setHighlightText(text);
+    viewport()->update();
+}
+
+bool LogView::findNext(const QString &text, bool forward, bool restart, bool wrap, bool *wrapped)
+{
+    if (wrapped)
+        *wrapped = false;
+
+    int fromRow = restart || !currentIndex().isValid() ? -1 : currentIndex().row();
+    int row = mModel->find(text, fromRow, forward);
+    if (row < 0 && fromRow >= 0 && wrap)
+    {
+        // 循环到开头/末尾继续查找
+        row = mModel->find(text, -1, forward);
+        if (row >= 0 && wrapped)
+            *wrapped = true;
+    }
+    if (row < 0)
+        return false;
+
+    QModelIndex index = mModel->index(row);
+    setCurrentIndex(index);
+    scrollTo(index, QAbstractItemView::PositionAtCenter);
+    return true;
+}
+
+void LogView::keyPressEvent(QKeyEvent *event)
+{
+    // 复制选中的行
+    if (event->matches(QKeySequence::Copy))
+    {
+        QModelIndexList indexes = selectionModel()->selectedRows();
+        std::sort(indexes.begin(), indexes.end());
+        QStringList lines;
+        for (const QModelIndex& index : qAsConst(indexes))
+            lines << index.data(Qt::DisplayRole).toString();
+        QApplication::clipboard()->setText(lines.join('\n'));
+        return;
+    }
+
+    QListView::keyPressEvent(event);
+}
@@ -0,0 +1,126 @@
+/*
+ * @Author: MrPan
+ * @Date: 2026-02-08 16:20:37
+ * @LastEditors: Maoxiaoqing
+ * @LastEditTime: 2026-02-08 16:20:37
+ * @Description: 运行日志视图。日志存放在定长环形缓冲区中，列表只绘制可见行；每16行建立一个块索引
+ *               （三字组布隆过滤器、级别掩码、谱仪掩码），查找和过滤时整块跳过不可能匹配的行，
+ *               日志达到百万行时查找、高亮仍然流畅。
+ */
+#ifndef LOGVIEW_H
+#define LOGVIEW_H
+
+#include <QAbstractListModel>
+#include <QListView>
+#include <QStyledItemDelegate>
+#include "asynclogger.h"
+
+class LogModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    /**
+     * @param capacity 最多保留的日志行数，超出后丢弃最早的日志
+     */
+    explicit LogModel(int capacity = 1000000, QObject* parent = nullptr);
+
+    // 追加一批日志，必要时移除最早的行
+    void append(const QVector<LogMessage>& messages);
+    void clear();
+
+    /**
+     * @brief setFilter 只显示满足条件的日志
+     * @param minSeverity 最低严重程度，见logSeverity，0为全部
+     * @param detectorId 谱仪编号，0为全部
+     */
+    void setFilter(int minSeverity, int detectorId);
+
+    /**
+     * @brief find 查找下一个包含text（不区分大小写）的行
+     * @param fromRow 起始行（不含），-1表示从头（向前查找）或从尾（向后查找）开始
+     * @param forward true为向下查找
+     * @return 行号，未找到返回-1
+     */
+    int find(const QString& text, int fromRow, bool forward) const;
+
+    // 主题切换时改变文字颜色
+    void setDarkTheme(bool isDarkTheme);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+private:
+    struct Entry {
+        qint64 time = 0;
+        QString text;
+        quint8 severity = 0;
+        quint8 detector = 0; // 0表示与谱仪无关
+    };
+
+    // 每16行一个块，布隆过滤器2048位
+    enum { BlockLines = 16, BloomWords = 32 };
+    struct Block {
+        quint64 bloom[BloomWords];
+        quint32 severityMask;
+        quint32 detectorMask;
+    };
+
+    const Entry& entry(qint64 seq) const { return mEntries.at(seq % mCapacity); }
+    Block& block(qint64 seq) { return mBlocks[(seq / BlockLines) % mBlocks.size()]; }
+    const Block& block(qint64 seq) const { return mBlocks.at((seq / BlockLines) % mBlocks.size()); }
+    qint64 rowToSeq(int row) const;
+    bool accepts(const Entry& entry) const;
+    bool blockAccepts(const Block& block) const;
+
+    int mCapacity;
+    QVector<Entry> mEntries;
+    QVector<Block> mBlocks;
+    qint64 mFirstSeq = 0; // 最早一行的序号
+    qint64 mNextSeq = 0;  // 下一行的序号
+
+    // 过滤后的行，按序号递增，mFilteredHead之前的已被移除
+    bool mFiltering = false;
+    int mMinSeverity = 0;
+    int mDetectorId = 0;
+    QVector<qint64> mFiltered;
+    int mFilteredHead = 0;
+
+    bool mIsDarkTheme = true;
+};
+
+/**
+ * @brief 日志列表，只绘制可见行，高亮全部匹配项时只处理可见行
+ */
+class LogView : public QListView
+{
+    Q_OBJECT
+public:
+    explicit LogView(QWidget* parent = nullptr);
+
+    LogModel* logModel() const { return mModel; }
+
+    // 追加日志，原来在末尾时保持滚动到末尾
+    void appendMessages(const QVector<LogMessage>& messages);
+    void clear();
+
+    // 高亮全部匹配项，空字符串为取消高亮
+    void setHighlightText(const QString& text);
+
+    /**
+     * @brief findNext 从当前行开始查找并选中下一个匹配行
+     * @param restart true时从头/尾开始查找
+     * @param wrap 查找到末尾/开头仍未找到时，是否循环到开头/末尾继续查找
+     * @param wrapped 返回是否循环到了开头/末尾，可为nullptr
+     * @return 是否找到
+     */
+    bool findNext(const QString& text, bool forward, bool restart, bool wrap, bool* wrapped = nullptr);
+
+protected:
+    void keyPressEvent(QKeyEvent* event) override;
+
+private:
+    LogModel* mModel;
+    class LogItemDelegate* mDelegate;
+};
+
+#endif // LOGVIEW_H
@@ -6,6 +6,7 @@
 #include "lightstyle.h"
 #include "darkstyle.h"
 #include "customcolorstyle.h"
+#include "asynclogger.h"
 
 #include <QApplication>
 #include <QStyleFactory>
@@ -28,27 +29,18 @@
 #include <log4qt/fileappender.h>
 
 QMainWindow *mMainWindow = nullptr;
-QMutex mutexMsg;
 QtMessageHandler system_default_message_handler = NULL;// 用来保存系统默认的输出接口
 void AppMessageHandler(QtMsgType type, const QMessageLogContext& context, const QString &msg)
 {
-    QMutexLocker locker(&mutexMsg);
     if (type == QtWarningMsg && context.file == nullptr && context.function == nullptr)
         return;// 主要用于过滤系统的警告信息
 
-    if (mMainWindow && type != QtDebugMsg){
-        //emit mw->sigWriteLog(msg, type);
-        QMetaObject::invokeMethod(mMainWindow, "sigWriteLog", Qt::QueuedConnection, Q_ARG(QString, msg), Q_ARG(QtMsgType, type));
-    }
-
     if (type == QtFatalMsg){
         return ;
     }
 
-    //这里必须调用，否则消息被拦截，log4qt无法捕获系统日志
-    if (system_default_message_handler){
-        system_default_message_handler(type, context, msg);
-    }
+    //只写入日志队列，由后台线程写入log4qt（原处理函数）并批量转发到界面，调用线程不加锁、不等待
+    AsyncLogger::instance()->post(type, context, msg);
 }
 
 bool gMatlabInited = false;
@@ -165,6 +157,8 @@ int main(int argc, char *argv[])
     qRegisterMetaType<QtMsgType>("QtMsgType");
     qRegisterMetaType<FullSpectrum>("FullSpectrum");
     system_default_message_handler = qInstallMessageHandler(AppMessageHandler);
+    //这里必须把原处理函数交给日志线程，否则消息被拦截，log4qt无法捕获系统日志
+    AsyncLogger::instance()->start(system_default_message_handler);
 
     QString darkTheme = "true";
     settingsGlobal.beginGroup("Global/Startup");
@@ -211,6 +205,9 @@ int main(int argc, char *argv[])
 
     int ret = a.exec();
 
+    //写出日志队列中剩余的消息，之后的日志直接同步写入log4qt
+    AsyncLogger::instance()->stop();
+
     //运行运行到这里，此时主窗体析构函数还没触发，所以shutdownRootLogger需要在主窗体销毁以后再做处理
     QObject::connect(&w, &QObject::destroyed, []{
         auto logger = Log4Qt::Logger::rootLogger();
@@ -4,8 +4,12 @@
 #include "globalsettings.h"
 #include "switchbutton.h"
 #include <QTimer>
+#include <QSet>
 #include "energycalibration.h"
 #include "qcustomplothelper.h"
+#include "spectrumkernels.h"
+#include "spectrumlod.h"
+#include "tracezone.h"
 
 MainWindow::MainWindow(bool isDarkTheme, QWidget *parent)
     : QMainWindow(parent)
@@ -47,6 +51,16 @@ MainWindow::MainWindow(bool isDarkTheme, QWidget *parent)
     mMeasureCountdownTimer->setInterval(1000); // 每秒触发一次
     connect(mMeasureCountdownTimer, &QTimer::timeout, this, &MainWindow::onMeasureCountdownTimeout);
     
+    // 初始化渲染定时器，刷新频率默认5Hz
+    {
+        GlobalSettings settings(CONFIG_FILENAME);
+        int renderRate = qBound(1, settings.value("mainWindow/RenderRate", 5).toInt(), 30);
+        mRenderTimer = new QTimer(this);
+        mRenderTimer->setInterval(1000 / renderRate);
+        connect(mRenderTimer, &QTimer::timeout, this, &MainWindow::onRenderTick);
+        mRenderTimer->start();
+    }
+
     // 初始化连接按钮禁用定时器
     mConnectButtonDisableTimer = new QTimer(this);
     mConnectButtonDisableTimer->setSingleShot(true);
@@ -66,6 +80,7 @@ MainWindow::MainWindow(bool isDarkTheme, QWidget *parent)
     applyColorTheme();
 
     connect(this, SIGNAL(sigWriteLog(const QString&,QtMsgType)), this, SLOT(slotWriteLog(const QString&,QtMsgType)));
+    connect(AsyncLogger::instance(), &AsyncLogger::messagesReady, this, &MainWindow::slotWriteLogBatch);
 
     ui->action_startServer->setEnabled(true);
     ui->action_stopServer->setEnabled(false);
@@ -85,6 +100,16 @@ MainWindow::MainWindow(bool isDarkTheme, QWidget *parent)
     connect(ui->lineEdit_search, &QLineEdit::returnPressed, this, &MainWindow::on_lineEdit_search_returnPressed);
     connect(ui->lineEdit_search, &QLineEdit::textChanged, this, &MainWindow::on_lineEdit_search_textChanged);
 
+    // 日志过滤，级别值为logSeverity
+    ui->comboBox_logLevel->addItem(tr("全部级别"), 0);
+    ui->comboBox_logLevel->addItem(tr("警告及以上"), logSeverity(QtWarningMsg));
+    ui->comboBox_logLevel->addItem(tr("错误"), logSeverity(QtCriticalMsg));
+    ui->comboBox_logDetector->addItem(tr("全部谱仪"), 0);
+    for (int i = 1; i <= 24; ++i)
+        ui->comboBox_logDetector->addItem(tr("谱仪#%1").arg(i), i);
+    connect(ui->comboBox_logLevel, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &MainWindow::applyLogFilter);
+    connect(ui->comboBox_logDetector, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &MainWindow::applyLogFilter);
+
     // 继电器
     connect(commHelper, &CommHelper::switcherConnected, this, [=](QString ip){
         mSwitcherConnected = true;
@@ -661,8 +686,26 @@ void MainWindow::initUi()
     for (int i=1; i<=2; ++i){
         QCustomPlot *spectroMeter_top = this->findChild<QCustomPlot*>(QString("spectroMeter%1_top").arg(i));
         initCustomPlot(i, spectroMeter_top, tr(""), tr("时间/s 计数率/cps"), tr("计数曲线"), 12);
+
+        // 909keV ROI净计数率趋势，虚线画在右侧y轴，曲线下标12~23与计数率曲线一一对应
+        disconnect(spectroMeter_top->yAxis, SIGNAL(rangeChanged(const QCPRange &)), spectroMeter_top->yAxis2, SLOT(setRange(const QCPRange &)));
+        spectroMeter_top->yAxis2->setVisible(true);
+        spectroMeter_top->yAxis2->setTicks(true);
+        spectroMeter_top->yAxis2->setTickLabels(true);
+        spectroMeter_top->yAxis2->setLabel(tr("909keV净计数率/cps"));
+        for (int j=0; j<12; ++j){
+            QCPGraph * graph = spectroMeter_top->addGraph(spectroMeter_top->xAxis, spectroMeter_top->yAxis2);
+            graph->setAntialiased(false);
+            graph->setPen(QPen(mGraphisColor.at(j), 1, Qt::DashLine));
+            graph->setLineStyle(QCPGraph::lsLine);
+            graph->setSelectable(QCP::SelectionType::stNone);
+        }
         QCustomPlot *spectroMeter_bottom = this->findChild<QCustomPlot*>(QString("spectroMeter%1_bottom").arg(i));
         initCustomPlot(i, spectroMeter_bottom, tr(""), tr("道址 计数"), tr("累积能谱"), 12);
+
+        // 累积能谱按像素宽度抽稀显示
+        for (int j=0; j<12; ++j)
+            mSpectrumLod[(i-1)*12 + j] = new SpectrumLodGraph(spectroMeter_bottom->graph(j));
     }
 
     QCustomPlot *spectroMeter_left = this->findChild<QCustomPlot*>(QString("spectroMeter_left"));
@@ -703,8 +746,14 @@ void MainWindow::initUi()
                 graph = getGraph(index % 12, false);
                 if (graph){
                     graph->setVisible(Qt::CheckState::Checked == state ? true : false);
-                    getCustomPlot(index % 12, false)->replot();
                 }
+
+                // 909keV ROI净计数率
+                graph = getRoi909Graph(index % 12);
+                if (graph){
+                    graph->setVisible(Qt::CheckState::Checked == state ? true : false);
+                }
+                getCustomPlot(index % 12, false)->replot();
             });
 
             if (index<=12)
@@ -758,21 +807,24 @@ void MainWindow::initUi()
             return;
         }
 
+        TRACE_ZONE_DET("GUI accumulate", index);
         DetectorData &data = m_detectorData[index];
 
         // 累积能谱
-        quint32 currentCount = 0;
-        for (int i = 0; i < 8192; ++i) {
-            currentCount += fullSpectrum.spectrum[i];
-            data.spectrum[i] += fullSpectrum.spectrum[i];
-        }
+        quint64 currentCount = SpectrumKernels::totalCount(fullSpectrum.spectrum, 8192);
+        SpectrumKernels::accumulate(fullSpectrum.spectrum, 8192, data.spectrum);
+
+        // 909keV ROI净面积，只累加峰区和本底区
+        if (!data.roi909.isConfigured())
+            configureRoi909(index, data.roi909);
+        data.roi909.addSpectrum(fullSpectrum.spectrum, 8192, fullSpectrum.sequence, fullSpectrum.measureTime, fullSpectrum.deathTime);
 
         //记录累积计数率
         data.lastAccumulateCount += currentCount;
 
-        // 更新能谱显示
-        updateSpectrumDisplay(index, data.spectrum);
-        qDebug()<<"Det index="<<index<<", sequenceID="<<fullSpectrum.sequence;
+        // 能谱显示由渲染定时器刷新
+        data.spectrumDirty = true;
+        qCDebug(lcSpectrum)<<"Det index="<<index<<", sequenceID="<<fullSpectrum.sequence;
         //最快每秒更新一次计数率,这里不考虑丢包带来的计数率修复
         quint32 accuTime = (fullSpectrum.sequence - data.lastSpectrumID) * fullSpectrum.measureTime;//单位ms
         double currenTime = 1.0 * fullSpectrum.sequence * fullSpectrum.measureTime / 1000; //单位s，这里最大数对应2^32/24/3600=49days
@@ -780,9 +832,12 @@ void MainWindow::initUi()
             double countRate = 1000.0*data.lastAccumulateCount * 1.0 / accuTime; //cps
             data.lastSpectrumID = fullSpectrum.sequence;
             data.lastAccumulateCount = 0;
-            data.countRateHistory.append(countRate);
-            // 更新计数率显示
-            updateCountRateDisplay(index, currenTime, countRate);
+            // 计数率显示由渲染定时器刷新
+            data.countRateHistory.append(currenTime, countRate);
+
+            Roi909Estimator::Sample roiSample;
+            if (data.roi909.takeSample(roiSample))
+                data.roi909History.append(currenTime, roiSample.netRate);
         }
     });
     
@@ -1057,43 +1112,17 @@ bool MainWindow::eventFilter(QObject *watched, QEvent *event){
 
 void MainWindow::slotWriteLog(const QString &msg, QtMsgType msgType)
 {
-    // 创建一个 QTextCursor
-    QTextCursor cursor = ui->textEdit_log->textCursor();
-    // 将光标移动到文本末尾
-    cursor.movePosition(QTextCursor::End);
-
-    // 先插入时间
-    QString color = "black";
-    if (mIsDarkTheme)
-        color = "white";
-    cursor.insertHtml(QString("<span style='color:%1;'>%2</span>").arg(color, QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss.zzz >> ")));
-    // 再插入文本
-    if (msgType == QtDebugMsg || msgType == QtInfoMsg)
-        cursor.insertHtml(QString("<span style='color:%1;'>%2</span>").arg(color, msg));
-    else if (msgType == QtCriticalMsg || msgType == QtFatalMsg)
-        cursor.insertHtml(QString("<span style='color:#FF0000;'>%1</span>").arg(msg));
-    else
-        cursor.insertHtml(QString("<span style='color:#0000F0;'>%1</span>").arg(msg));
-
-    // 最后插入换行符
-    cursor.insertHtml("<br>");
-
-    // 确保 QTextEdit 显示了光标的新位置
-    ui->textEdit_log->setTextCursor(cursor);
-
-    //限制行数
-    QTextDocument *document = ui->textEdit_log->document(); // 获取文档对象，想象成打开了一个TXT文件
-    int rowCount = document->blockCount(); // 获取输出区的行数
-    int maxRowNumber = 2000;//设定最大行
-    if(rowCount > maxRowNumber){//超过最大行则开始删除
-        QTextCursor cursor = QTextCursor(document); // 创建光标对象
-        cursor.movePosition(QTextCursor::Start); //移动到开头，就是TXT文件开头
+    LogMessage message;
+    message.type = msgType;
+    message.text = msg;
+    message.time = QDateTime::currentMSecsSinceEpoch();
+    slotWriteLogBatch({message});
+}
 
-        for (int var = 0; var < rowCount - maxRowNumber; ++var) {
-            cursor.movePosition(QTextCursor::Down, QTextCursor::KeepAnchor); // 向下移动并选中当前行
-        }
-        cursor.removeSelectedText();//删除选择的文本
-    }
+void MainWindow::slotWriteLogBatch(const QVector<LogMessage> &messages)
+{
+    // 日志存放在环形缓冲区中，超出容量后丢弃最早的日志，列表只绘制可见行
+    ui->listView_log->appendMessages(messages);
 }
 
 
@@ -1222,9 +1251,12 @@ void MainWindow::on_action_startMeasure_triggered()
         for (int j=0; j<spectroMeter_top->graphCount(); ++j)
             spectroMeter_top->graph(j)->data()->clear();
 
+        // 累积能谱连同抽稀数据一起清空，否则缩放、拖动时会重新显示上次测量的能谱
         QCustomPlot *spectroMeter_bottom = this->findChild<QCustomPlot*>(QString("spectroMeter%1_bottom").arg(i));
-        for (int j=0; j<spectroMeter_bottom->graphCount(); ++j)
-            spectroMeter_bottom->graph(j)->data()->clear();
+        for (int j=0; j<12; ++j){
+            if (mSpectrumLod[(i-1)*12 + j])
+                mSpectrumLod[(i-1)*12 + j]->clear();
+        }
 
         spectroMeter_top->replot();
         spectroMeter_bottom->replot();
@@ -1250,9 +1282,12 @@ void MainWindow::on_pushButton_startMeasure_clicked()
         for (int j=0; j<spectroMeter_top->graphCount(); ++j)
             spectroMeter_top->graph(j)->data()->clear();
 
+        // 累积能谱连同抽稀数据一起清空，否则缩放、拖动时会重新显示上次测量的能谱
         QCustomPlot *spectroMeter_bottom = this->findChild<QCustomPlot*>(QString("spectroMeter%1_bottom").arg(i));
-        for (int j=0; j<spectroMeter_bottom->graphCount(); ++j)
-            spectroMeter_bottom->graph(j)->data()->clear();
+        for (int j=0; j<12; ++j){
+            if (mSpectrumLod[(i-1)*12 + j])
+                mSpectrumLod[(i-1)*12 + j]->clear();
+        }
 
         spectroMeter_top->replot();
         spectroMeter_bottom->replot();
@@ -1597,6 +1632,9 @@ void MainWindow::on_action_colorTheme_triggered()
 
 void MainWindow::applyColorTheme()
 {
+    // 日志颜色随主题切换，只重绘可见行
+    ui->listView_log->logModel()->setDarkTheme(mIsDarkTheme);
+
     QList<QCustomPlot*> customPlots = this->findChildren<QCustomPlot*>();
     for (auto customPlot : customPlots){
         QPalette palette = customPlot->palette();
@@ -1612,13 +1650,6 @@ void MainWindow::applyColorTheme()
                 DarkStyle darkStyle;
                 darkStyle.polish(palette);
             }
-
-            // 创建一个 QTextCursor
-            QTextCursor cursor = ui->textEdit_log->textCursor();
-            QTextDocument *document = cursor.document();
-            QString html = document->toHtml();
-            html = html.replace("color:#000000", "color:#ffffff");
-            document->setHtml(html);
         }
         else
         {
@@ -1632,12 +1663,6 @@ void MainWindow::applyColorTheme()
                 LightStyle lightStyle;
                 lightStyle.polish(palette);
             }
-
-            QTextCursor cursor = ui->textEdit_log->textCursor();
-            QTextDocument *document = cursor.document();
-            QString html = document->toHtml();
-            html = html.replace("color:#ffffff", "color:#000000");
-            document->setHtml(html);
         }
         //日志窗体
         QString styleSheet = mIsDarkTheme ?
@@ -1723,6 +1748,10 @@ void MainWindow::restoreSettings()
             QGoodWindow::setAppCustomTheme(mIsDarkTheme,this->mThemeColor); // Must be >96
         });
     }
+
+    // 性能跟踪，默认关闭
+    GlobalSettings settings(CONFIG_FILENAME);
+    ui->action_traceEnabled->setChecked(settings.value("Trace/Enabled", false).toBool());
 }
 
 // 重置能谱
@@ -1740,9 +1769,13 @@ void MainWindow::resetDetectorSpectrum(int detectorId) {
     // 清空上次测量累积时间的计数率
     it->lastAccumulateCount = 0;
     
-    // 清空计数率历史并释放内存
-    QVector<double>().swap(it->countRateHistory);
-    // 如果是 QList<double>，同样写法：QList<double>().swap(it->countRateHistory);
+    // 清空计数率历史并释放归档内存，下次同步时重建曲线
+    it->countRateHistory.clear();
+    it->roi909History.clear();
+    it->spectrumDirty = false;
+
+    // 重新按能量刻度设置ROI，收到第一个能谱时配置
+    it->roi909 = Roi909Estimator();
 
     qInfo() << "Detector" << detectorId << "spectrum and countRateHistory reset";
 }
@@ -1763,41 +1796,42 @@ QList<int> MainWindow::getOnlineDetectors() const {
 }
 
 // 更新能谱、计数率显示
-void MainWindow::updateSpectrumDisplay(int detectorId, const quint32 spectrum[]) {
+void MainWindow::updateSpectrumDisplay(int detectorId, const quint64 spectrum[]) {
+    TRACE_ZONE_DET("spectrum display", detectorId);
     // 计算在页面中的索引
     QCustomPlot *customPlot = getCustomPlot(detectorId, true);
     if (!customPlot)
         return;
 
-    QVector<double> x, y;
+    SpectrumPlotSettings &plotSettings = m_spectrumPlotSettings[detectorId-1];
+    int multiCh = qMin(plotSettings.multiChannel, 8192);
+    SpectrumLodGraph *spectrumLod = mSpectrumLod.value(detectorId-1);
+    if (!spectrumLod)
+        return;
 
-    // 转换数据格式
-    if(mEnScale)
+    // x坐标不变时只更新计数并按当前范围重新抽稀，不申请内存
+    if (!plotSettings.xAxisValid || !spectrumLod->setValues(spectrum, multiCh))
     {
-        for (int i = 0; i < m_spectrumPlotSettings[detectorId-1].multiChannel; ++i) {
-            double tempX;
-            if (m_spectrumPlotSettings[detectorId-1].fitType == 1){
-                tempX = m_spectrumPlotSettings[detectorId-1].c0*i + m_spectrumPlotSettings[detectorId-1].c1;
-            } else if (m_spectrumPlotSettings[detectorId-1].fitType == 2){
-                //拟合参数赋值
-                tempX = m_spectrumPlotSettings[detectorId-1].c0*i*i + m_spectrumPlotSettings[detectorId-1].c1*i + m_spectrumPlotSettings[detectorId-1].c2;
+        // 刻度或道数变化后重建，非单调的刻度不抽稀，每次都重建
+        QVector<double> keys(multiCh), values(multiCh);
+        for (int i = 0; i < multiCh; ++i) {
+            double x = i;
+            if (mEnScale)
+            {
+                if (plotSettings.fitType == 1){
+                    x = plotSettings.c0*i + plotSettings.c1;
+                } else if (plotSettings.fitType == 2){
+                    x = plotSettings.c0*i*i + plotSettings.c1*i + plotSettings.c2;
+                }
             }
 
-            x << tempX;
-            y << spectrum[i];
+            keys[i] = x;
+            values[i] = spectrum[i];
         }
-    }
-    else
-    {
-        for (int i = 0; i < m_spectrumPlotSettings[detectorId-1].multiChannel; ++i) {
-            x << i;
-            y << spectrum[i];
-        }
-    }
 
-    // 更新图表
-    getGraph(detectorId, true)->setData(x, y);
-    // customPlot->xAxis->setRange(0, m_spectrumPlotSettings[detectorId-1].multiChannel);
+        spectrumLod->setData(keys, values);
+        plotSettings.xAxisValid = true;
+    }
 
     //customPlot->xAxis->rescale(true);
     customPlot->yAxis->rescale(false);
@@ -1805,46 +1839,115 @@ void MainWindow::updateSpectrumDisplay(int detectorId, const quint32 spectrum[])
     double y_max = customPlot->yAxis->range().upper;
     y_max = y_min + (y_max - y_min) * 1.1;
     customPlot->yAxis->setRange(y_min - 1, y_max);
-
-    customPlot->replot(QCustomPlot::rpQueuedReplot);
 }
 
-// 添加计数率显示更新函数
-void MainWindow::updateCountRateDisplay(int detectorId, double fpgaTime, double countRate) {
+// 添加计数率显示更新函数，只更新图像数据，由渲染定时器统一重绘
+void MainWindow::updateCountRateDisplay(int detectorId) {
     // 计算在页面中的索引
     QCustomPlot *customPlot = getCustomPlot(detectorId, false);
-    if (!customPlot)
+    QCPGraph *graph = getGraph(detectorId, false);
+    if (!customPlot || !graph)
         return;
 
-    DetectorData &data = m_detectorData[detectorId];
-
-    // 获取当前时间（使用相对时间或绝对时间）
-    static QElapsedTimer timer;
-    if (!timer.isValid()) {
-        timer.start();
-    }
-    // double currentTime = timer.elapsed() / 1000.0; // 转换为秒
-
-    // int currentTime = data.countRateHistory.size();
-    // 添加新的数据点
-    // int elapsedSeconds = mTotalCountdown - mRemainingCountdown;
-    // qDebug().nospace()<<"detID="<<detectorId<<", elapsedTime = "<<elapsedSeconds<<", fpgaTime = "<<fpgaTime;
-    getGraph(detectorId, false)->addData(fpgaTime, countRate);
+    // 曲线只追加新点，移出窗口的点替换为归档点，开销与测量时长无关
+    RollingSeries &history = m_detectorData[detectorId].countRateHistory;
+    history.syncGraph(graph);
+    if (history.isEmpty())
+        return;
 
-    // 显示最近300秒
+    // 显示最近300秒，窗口点数与RollingSeries默认窗口一致
     const int WINDOW = 300;
-    customPlot->xAxis->setRange(qMax(0.0, fpgaTime*1.0 - WINDOW), fpgaTime + 1);
-    
+    double fpgaTime = history.last().x();
+    customPlot->xAxis->setRange(qMax(0.0, fpgaTime - WINDOW), fpgaTime + 1);
+
     // y轴范围只由最近300秒的y决定
-    auto range = calcRecentYRange(data.countRateHistory, WINDOW);
+    auto range = history.windowRange();
     double y_min = range.first;
     double y_max = range.second;
 
     // 稍微留点头部空间
     double pad = (y_max - y_min) * 0.1;
     customPlot->yAxis->setRange(y_min - pad, y_max + pad);
+}
+
+void MainWindow::updateRoi909Display(int detectorId) {
+    QCustomPlot *customPlot = getCustomPlot(detectorId, false);
+    QCPGraph *graph = getRoi909Graph(detectorId);
+    if (!customPlot || !graph)
+        return;
+
+    RollingSeries &history = m_detectorData[detectorId].roi909History;
+    history.syncGraph(graph);
+    if (history.isEmpty())
+        return;
+
+    // 与计数率相同，y轴范围只由最近300秒决定
+    auto range = history.windowRange();
+    double pad = (range.second - range.first) * 0.1;
+    customPlot->yAxis2->setRange(range.first - pad, range.second + pad);
+}
+
+void MainWindow::onRenderTick()
+{
+    TRACE_ZONE("render tick");
+    // 窗口最小化时不刷新，数据保留到下次可见时再画
+    if (isMinimized())
+        return;
+
+    // 不在当前页面的图像跳过，保持脏标记
+    auto isShown = [](QCustomPlot* customPlot) {
+        return customPlot && customPlot->isVisible() && !customPlot->visibleRegion().isEmpty();
+    };
+
+    QSet<QCustomPlot*> dirtyPlots;
+    for (auto it = m_detectorData.begin(); it != m_detectorData.end(); ++it)
+    {
+        int detectorId = it.key();
+        DetectorData &data = it.value();
+
+        if (data.spectrumDirty)
+        {
+            QCustomPlot *customPlot = getCustomPlot(detectorId, true);
+            if (isShown(customPlot))
+            {
+                updateSpectrumDisplay(detectorId, data.spectrum);
+                data.spectrumDirty = false;
+                dirtyPlots.insert(customPlot);
+            }
+        }
+
+        if (data.countRateHistory.hasPendingSync() || data.roi909History.hasPendingSync())
+        {
+            QCustomPlot *customPlot = getCustomPlot(detectorId, false);
+            if (isShown(customPlot))
+            {
+                updateCountRateDisplay(detectorId);
+                updateRoi909Display(detectorId);
+                dirtyPlots.insert(customPlot);
+            }
+        }
+    }
+
+    // 每个图像每次最多重绘一次
+    for (QCustomPlot* customPlot : qAsConst(dirtyPlots))
+        customPlot->replot(QCustomPlot::rpQueuedReplot);
+}
+
+void MainWindow::configureRoi909(int detectorId, Roi909Estimator& estimator)
+{
+    // 有线性能量刻度时按刻度计算道址，否则采用默认刻度
+    double k = 0.0, b = 0.0;
+    GlobalSettings settings(CONFIG_FILENAME);
+    settings.beginGroup(QString("EnCalibration/Detector%1").arg(detectorId));
+    if (settings.value("type", 0).toInt() == 1)
+    {
+        k = settings.value("c0", 0.0).toDouble();
+        b = settings.value("c1", 0.0).toDouble();
+    }
+    settings.endGroup();
 
-    customPlot->replot(QCustomPlot::rpQueuedReplot);
+    estimator.setEnergyScale(k, b);
+    qInfo().nospace() << "谱仪[#" << detectorId << "]909keV ROI道址：" << estimator.peakRegion().first << "-" << estimator.peakRegion().last;
 }
 
 #include "localsettingwindow.h"
@@ -1922,10 +2025,8 @@ void MainWindow::updateConnectButtonState(bool connected)
 // 清除日志
 void MainWindow::on_bt_clearLog_clicked()
 {
-    ui->textEdit_log->clear();
-    clearHighlights();
+    ui->listView_log->clear();
     mLastSearchText.clear();
-    mCurrentSearchPosition = 0;
 }
 
 // 查找功能实现
@@ -1980,82 +2081,22 @@ void MainWindow::performSearch(bool forward, bool wrap)
         return;
     }
 
-    QTextEdit *textEdit = ui->textEdit_log;
-    QTextDocument *document = textEdit->document();
-    QTextCursor cursor = textEdit->textCursor();
+    // 如果搜索文本改变，从开头/末尾开始，否则从当前选中行继续查找
+    bool restart = searchText != mLastSearchText;
+    mLastSearchText = searchText;
 
-    // 如果搜索文本改变，重置位置
-    if (searchText != mLastSearchText) {
-        mLastSearchText = searchText;
-        if (forward) {
-            cursor.setPosition(0);  // 从开头开始
-        } else {
-            cursor.setPosition(document->characterCount());  // 从末尾开始
-        }
-        textEdit->setTextCursor(cursor);
-    } else {
-        // 如果搜索文本未改变，从当前位置继续查找
-        // 对于向前查找，需要移动到下一个位置；对于向后查找，需要移动到上一个位置
-        if (forward) {
-            // 向前查找：从当前位置的下一个字符开始
-            int pos = cursor.position();
-            if (pos < document->characterCount()) {
-                cursor.setPosition(pos + 1);
-            } else if (wrap) {
-                cursor.setPosition(0);  // 循环到开头
-            }
-        } else {
-            // 向后查找：从当前位置的上一个字符开始
-            int pos = cursor.position();
-            if (pos > 0) {
-                cursor.setPosition(pos - 1);
-            } else if (wrap) {
-                cursor.setPosition(document->characterCount());  // 循环到末尾
-            }
-        }
-    }
-
-    // 设置查找选项
-    QTextDocument::FindFlags flags;
-    if (!forward) {
-        flags |= QTextDocument::FindBackward;
-    }
-
-    // 执行查找
-    QTextCursor found = document->find(searchText, cursor, flags);
+    // 按块索引跳过不可能匹配的行，只在候选行中比较文本
+    bool wrapped = false;
+    bool found = ui->listView_log->findNext(searchText, forward, restart, wrap, &wrapped);
 
     QLabel* label_Query = this->findChild<QLabel*>("label_Query");
-    if (found.isNull()) {
-        // 未找到，如果支持循环，从头/尾继续查找
-        if (wrap) {
-            QTextCursor newCursor(document);
-            if (forward) {
-                newCursor.setPosition(0);
-            } else {
-                newCursor.setPosition(document->characterCount());
-            }
-            found = document->find(searchText, newCursor, flags);
-            
-            if (!found.isNull()) {
-                textEdit->setTextCursor(found);
-                textEdit->ensureCursorVisible();
-                // 显示提示信息
-                // ui->statusbar->showMessage(tr("已循环到%1").arg(forward ? tr("开头") : tr("末尾")), 2000);
-                label_Query->setText(tr("已循环到%1").arg(forward ? tr("开头") : tr("末尾")));
-            } else {
-                // ui->statusbar->showMessage(tr("未找到：%1").arg(searchText), 2000);
-                label_Query->setText(tr("未找到：%1").arg(searchText));
-            }
-        } else {
-            // ui->statusbar->showMessage(tr("未找到：%1").arg(searchText), 2000);
-            label_Query->setText(tr("未找到：%1").arg(searchText));
-        }
+    if (!found) {
+        // ui->statusbar->showMessage(tr("未找到：%1").arg(searchText), 2000);
+        label_Query->setText(tr("未找到：%1").arg(searchText));
+    } else if (wrapped) {
+        // ui->statusbar->showMessage(tr("已循环到%1").arg(forward ? tr("开头") : tr("末尾")), 2000);
+        label_Query->setText(tr("已循环到%1").arg(forward ? tr("开头") : tr("末尾")));
     } else {
-        // 找到匹配项
-        textEdit->setTextCursor(found);
-        textEdit->ensureCursorVisible();
-        mCurrentSearchPosition = found.position();
-
         label_Query->setText(tr("找到：%1").arg(searchText));
     }
 }
@@ -2067,44 +2108,19 @@ void MainWindow::highlightAllMatches(const QString &searchText)
         return;
     }
 
-    QTextEdit *textEdit = ui->textEdit_log;
-    QTextDocument *document = textEdit->document();
-    
-    // 清除之前的高亮
-    clearHighlights();
-
-    // 设置高亮格式
-    QTextCharFormat highlightFormat;
-    highlightFormat.setBackground(QBrush(QColor(255, 255, 0, 100)));  // 黄色半透明背景
-    if (mIsDarkTheme) {
-        highlightFormat.setForeground(QBrush(QColor(255, 255, 0)));  // 黄色文字
-    }
-
-    // 从文档开头开始查找所有匹配项
-    QTextCursor cursor(document);
-    cursor.setPosition(0);
-
-    mExtraSelections.clear();
-    while (true) {
-        cursor = document->find(searchText, cursor, QTextDocument::FindFlags());
-        if (cursor.isNull()) {
-            break;
-        }
-
-        QTextEdit::ExtraSelection extra;
-        extra.cursor = cursor;
-        extra.format = highlightFormat;
-        mExtraSelections.append(extra);
-    }
-
-    // 应用高亮
-    textEdit->setExtraSelections(mExtraSelections);
+    // 只在绘制可见行时高亮，与日志行数无关
+    ui->listView_log->setHighlightText(searchText);
 }
 
 void MainWindow::clearHighlights()
 {
-    mExtraSelections.clear();
-    ui->textEdit_log->setExtraSelections(mExtraSelections);
+    ui->listView_log->setHighlightText(QString());
+}
+
+void MainWindow::applyLogFilter()
+{
+    ui->listView_log->logModel()->setFilter(ui->comboBox_logLevel->currentData().toInt(), ui->comboBox_logDetector->currentData().toInt());
+    ui->listView_log->scrollToBottom();
 }
 
 // 能量刻度
@@ -2132,6 +2148,36 @@ void MainWindow::on_action_yieldCalibration_triggered()
     w->show();
 }
 
+void MainWindow::on_action_traceEnabled_toggled(bool checked)
+{
+    TraceRecorder::setEnabled(checked);
+
+    GlobalSettings settings(CONFIG_FILENAME);
+    settings.setValue("Trace/Enabled", checked);
+}
+
+void MainWindow::on_action_traceExport_triggered()
+{
+    if (!TraceRecorder::isEnabled()) {
+        QMessageBox::information(this, tr("提示"), tr("请先勾选“记录性能跟踪”，运行一段时间后再导出。"));
+        return;
+    }
+
+    GlobalSettings settings(CONFIG_FILENAME);
+    double seconds = qBound(1.0, settings.value("Trace/DumpSeconds", 30.0).toDouble(), 3600.0);
+    QString defaultName = QString("trace_%1.json").arg(QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss"));
+    QString filePath = QFileDialog::getSaveFileName(this, tr("导出性能跟踪"), defaultName, tr("Chrome Trace (*.json)"));
+    if (filePath.isEmpty())
+        return;
+
+    // 可在chrome://tracing或ui.perfetto.dev中打开
+    int count = TraceRecorder::exportChromeTrace(filePath, seconds);
+    if (count < 0)
+        qWarning().noquote() << tr("导出性能跟踪失败：%1").arg(filePath);
+    else
+        qInfo().noquote() << tr("已导出最近%1秒的性能跟踪，共%2条记录：%3").arg(seconds).arg(count).arg(filePath);
+}
+
 void MainWindow::startMeasure()
 {
     /*设置发次信息*/
@@ -2246,6 +2292,15 @@ QCPGraph* MainWindow::getGraph(int detectorId, bool isSpectrum)
     return  customPlot->graph((detectorId-1) % 12);
 }
 
+QCPGraph* MainWindow::getRoi909Graph(int detectorId)
+{
+    QCustomPlot *customPlot = getCustomPlot(detectorId, false);
+    if (!customPlot || customPlot->graphCount() < 24)
+        return nullptr;
+
+    return customPlot->graph(12 + (detectorId-1) % 12);
+}
+
 void MainWindow::on_checkBox_continueMeasure_toggled(bool toggled)
 {
     ui->spinBox_measureTime->setEnabled(!toggled);
@@ -2306,6 +2361,11 @@ void MainWindow::updateSpectrumPlotSettings(int detectorId)
     int multiCh = detParameter.spectrumLength;
     m_spectrumPlotSettings[detectorId-1].multiChannel = multiCh;
 
+    // 刻度可能变化，下次刷新时重建x坐标
+    m_spectrumPlotSettings[detectorId-1].xAxisValid = false;
+    if (m_detectorData.contains(detectorId))
+        m_detectorData[detectorId].spectrumDirty = true;
+
     double xMin = 0.0;
     double xMax = multiCh*1.0;
 
@@ -6,6 +6,9 @@
 #include "clientpeerswindow.h"
 #include "detsettingwindow.h"
 #include "QGoodWindowHelper"
+#include "roi909estimator.h"
+#include "rollingseries.h"
+#include "asynclogger.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -16,18 +19,21 @@ QT_END_NAMESPACE
 class QCustomPlot;
 class QCPGraph;
 class QTimer;
+class SpectrumLodGraph;
 
 // 探测器数据结构
 struct DetectorData {
     // double countRate;                 // 当前计数率
-    QVector<double> countRateHistory;    // 计数率历史，cps，每秒钟更新一次
-    quint32 spectrum[8192];              // 累积能谱 (固定长度8192)
+    RollingSeries countRateHistory;      // 计数率历史（时间s，cps），每秒钟更新一次，最近300秒保留原始数据
+    quint64 spectrum[8192];              // 累积能谱 (固定长度8192)，64位防止长时间累积溢出
     quint32 lastSpectrumID;              // 上次测量累积时间的能谱序号
-    quint32 lastAccumulateCount;         // 上次测量累积时间的计数率,暂时不考虑丢包带来的计数率修复
+    quint64 lastAccumulateCount;         // 上次测量累积时间的计数率,暂时不考虑丢包带来的计数率修复
+    Roi909Estimator roi909;              // 909keV ROI净面积流式估计
+    RollingSeries roi909History;         // 909keV ROI净计数率历史（时间s，cps），与计数率同步更新
+    bool spectrumDirty = false;          // 累积能谱已更新，等待渲染定时器刷新显示
     // QDateTime lastUpdate;
 
     DetectorData() : lastSpectrumID(0), lastAccumulateCount(0) {
-        countRateHistory.clear();
         for(int i=0; i<8192; i++) spectrum[i] = 0;// 初始化能谱为全0
     }
 };
@@ -55,44 +61,24 @@ public:
     bool isDetectorOnline(int detectorId) const;
     QList<int> getOnlineDetectors() const;
 
-    // 更新能谱显示
-    void updateSpectrumDisplay(int detectorId, const quint32 spectrum[]);
+    // 更新能谱显示，只更新图像数据，由渲染定时器统一重绘
+    void updateSpectrumDisplay(int detectorId, const quint64 spectrum[]);
 
     /**
-     * @brief 计数率显示，最快更新时间间隔不小于1000ms
+     * @brief 计数率显示，将计数率历史中新增的点同步到曲线，显示最近300秒
      * @param detectorId 探测器编号
-     * @param FPGATime FPGA内部时钟，当前的计数率对应的FPGA时钟，单位s，能谱数据中单位是ms，这里采用向下取整
-     * @param countRate 计数率，单位cps
      */
-    void updateCountRateDisplay(int detectorId, double FPGATime, double countRate);
+    void updateCountRateDisplay(int detectorId);
+
+    /**
+     * @brief 909keV ROI净计数率趋势显示，画在计数率图像的右侧y轴，与计数率同步更新
+     * @param detectorId 探测器编号
+     */
+    void updateRoi909Display(int detectorId);
 
     // 将秒数转换为 天/时分秒 格式字符串
     QString formatTimeString(int totalSeconds);
 
-private:
-    //最近窗口的 min/max
-    static inline QPair<double,double> calcRecentYRange(const QVector<double>& history, int windowPoints)
-    {
-        if (history.isEmpty())
-            return {0.0, 1.0};
-
-        int n = history.size();
-        int start = qMax(0, n - windowPoints);
-
-        double ymin = history[start];
-        double ymax = history[start];
-        for (int i = start + 1; i < n; ++i) {
-            double v = history[i];
-            if (v < ymin) ymin = v;
-            if (v > ymax) ymax = v;
-        }
-        if (qFuzzyCompare(ymin, ymax)) {
-            ymax = ymin + 1.0; // 防止上下界相等导致范围为0
-        }
-        return {ymin, ymax};
-    }
-
-public:
     virtual void closeEvent(QCloseEvent *event) override;
     virtual bool eventFilter(QObject *watched, QEvent *event) override;
 
@@ -100,6 +86,7 @@ public:
 
 public slots:
     void slotWriteLog(const QString &msg, QtMsgType msgType = QtDebugMsg);//操作日志
+    void slotWriteLogBatch(const QVector<LogMessage> &messages);//日志线程批量转发的日志，一次插入
 
 signals:
     void sigUpdateBootInfo(const QString &msg);
@@ -147,6 +134,8 @@ private slots:
 
     // 测量倒计时结束处理
     void onMeasureCountdownTimeout();
+    // 渲染定时器，刷新有新数据且当前可见的能谱、计数率图像
+    void onRenderTick();
     // 清理日志
     void on_bt_clearLog_clicked();
 
@@ -162,6 +151,9 @@ private slots:
     void on_lineEdit_search_textChanged(const QString &text);
     void on_action_energycalibration_triggered();
     void on_action_yieldCalibration_triggered();
+    // 性能跟踪
+    void on_action_traceEnabled_toggled(bool checked);
+    void on_action_traceExport_triggered();
     void on_checkBox_continueMeasure_toggled(bool toggled);
     void on_cbb_measureMode_activated(int index);
     void on_cbb_energyCalibration_toggled(bool checked);
@@ -175,6 +167,9 @@ private:
     QString increaseShotNumSuffix(QString shotNumStr);
     QCustomPlot* getCustomPlot(int detectorId, bool isSpectrum = true);
     QCPGraph* getGraph(int detectorId, bool isSpectrum = true);
+    QCPGraph* getRoi909Graph(int detectorId);
+    // 按能量刻度设置909keV ROI道址区间
+    void configureRoi909(int detectorId, Roi909Estimator& estimator);
 
 private:
     Ui::MainWindow *ui;
@@ -198,6 +193,9 @@ private:
     QHash<int, DetectorData> m_detectorData;  // 只存储联网探测器的数据
     CommHelper *commHelper = nullptr;
     
+    // 渲染定时器，收到的数据只更新DetectorData，图像按固定频率刷新
+    QTimer *mRenderTimer = nullptr;
+
     // 测量倒计时定时器
     QTimer *mMeasureCountdownTimer = nullptr;
     int mRemainingCountdown = 0;  // 剩余倒计时（秒）
@@ -230,19 +228,23 @@ private:
         double c0 = 0.0;
         double c1 = 0.0;
         double c2 = 0.0;
+
+        // 图像中的x坐标（道址或能量）是否与当前刻度一致，刻度或道数变化时置为false，下次刷新时重建
+        bool xAxisValid = false;
     };
     
     // 能谱图像属性
     std::atomic<bool> mEnScale = false;// 是否勾选能量刻度
     QVector<SpectrumPlotSettings> m_spectrumPlotSettings = QVector<SpectrumPlotSettings>(24);
+    // 24个通道累积能谱的抽稀显示，下标为探测器编号-1
+    QVector<SpectrumLodGraph*> mSpectrumLod = QVector<SpectrumLodGraph*>(24, nullptr);
 
     // 日志内容查找功能相关
     QString mLastSearchText;  // 上次查找的文本
-    int mCurrentSearchPosition = 0;  // 当前查找位置
-    QList<QTextEdit::ExtraSelection> mExtraSelections;  // 高亮选择列表
     void performSearch(bool forward = true, bool wrap = true);  // 执行查找
     void highlightAllMatches(const QString &searchText);  // 高亮所有匹配项
     void clearHighlights();  // 清除高亮
+    void applyLogFilter();  // 按级别、谱仪过滤日志
 
     QPixmap roundPixmap(QSize sz, QColor clrOut = Qt::gray);//单圆
     QPixmap dblroundPixmap(QSize sz, QColor clrIn, QColor clrOut = Qt::gray);//双圆
@@ -8,6 +8,9 @@
 #include "neutronyieldstatisticswindow.h"
 #include "ui_neutronyieldstatisticswindow.h"
 #include "globalsettings.h"
+#include "neutronyieldcalibration.h"
+#include "analysisjob.h"
+#include "analysiscache.h"
 
 #include <QButtonGroup>
 #include <QFileDialog>
@@ -18,6 +21,9 @@
 #include <QJsonObject>
 #include <QJsonDocument>
 #include <QMessageBox>
+#include <QThreadPool>
+#include <QProgressBar>
+#include <QtNumeric>
 #include <math.h>
 
 NeutronYieldStatisticsWindow::NeutronYieldStatisticsWindow(bool isDarkTheme, QWidget *parent)
@@ -37,6 +43,38 @@ NeutronYieldStatisticsWindow::NeutronYieldStatisticsWindow(bool isDarkTheme, QWi
     connect(this, SIGNAL(sigStart()), this, SLOT(slotStart()));
     connect(this, SIGNAL(sigFail()), this, SLOT(slotFail()));//, Qt::QueuedConnection);
     connect(this, SIGNAL(sigSuccess()), this, SLOT(slotSuccess()));//, Qt::QueuedConnection);
+    qRegisterMetaType<NeutronYieldResult>("NeutronYieldResult");
+
+    // 后台解析任务
+    mAnalysisJob = new AnalysisJob(&mInterrupted, this);
+    connect(mAnalysisJob, &AnalysisJob::progress, this, [=](qint64 done, qint64 total, const QString& stage){
+        QProgressBar* progressBar = this->findChild<QProgressBar*>("progressBar_job");
+        progressBar->setMaximum(1000);
+        progressBar->setValue(total > 0 ? done * 1000 / total : 0);
+        progressBar->setFormat(QString("%1 %2/%3").arg(stage).arg(done).arg(total));
+        progressBar->show();
+    });
+    connect(mAnalysisJob, &AnalysisJob::partialResult, this, [=](const QVariant& data){
+        // 批量解析：单个谱仪完成
+        if (data.userType() == qMetaTypeId<NeutronYieldResult>())
+        {
+            slotBatchResult(data.value<NeutronYieldResult>());
+            return;
+        }
+
+        // 单谱仪解析：最新一段分时能谱的909keV剥谱结果，先行刷新曲线
+        QVector<specStripData> strip = data.value<QVector<specStripData>>();
+        QVector<double> channel, count, fitcount, residual;
+        for (auto point : strip)
+        {
+            channel << point.x;
+            count << point.y;
+            fitcount << point.fit_y;
+            residual << point.residual_rate;
+        }
+        slotUpdateSpec_909keV(channel, count, fitcount, residual);
+    });
+    connect(mAnalysisJob, &AnalysisJob::finished, this, &NeutronYieldStatisticsWindow::slotAnalysisFinished);
 
     QTimer::singleShot(0, this, [&](){
         qGoodStateHolder->setCurrentThemeDark(mIsDarkTheme);
@@ -53,6 +91,11 @@ NeutronYieldStatisticsWindow::NeutronYieldStatisticsWindow(bool isDarkTheme, QWi
 
 NeutronYieldStatisticsWindow::~NeutronYieldStatisticsWindow()
 {
+    // 先结束后台任务再释放界面
+    delete mAnalysisJob;
+    mAnalysisJob = nullptr;
+    delete dealFile;
+    dealFile = nullptr;
     delete ui;
 }
 
@@ -70,6 +113,14 @@ void NeutronYieldStatisticsWindow::initUi()
         ui->statusbar->setContentsMargins(5, 0, 5, 0);
         ui->statusbar->addWidget(new QLabel(ui->statusbar), 1);
         ui->statusbar->addWidget(nullptr, 1);
+
+        // 解析进度
+        QProgressBar *progressBar_job = new QProgressBar(ui->statusbar);
+        progressBar_job->setObjectName("progressBar_job");
+        progressBar_job->setFixedWidth(300);
+        progressBar_job->setTextVisible(true);
+        progressBar_job->hide();
+        ui->statusbar->addPermanentWidget(progressBar_job);
         ui->statusbar->addPermanentWidget(label_systemtime);
 
         QTimer* systemClockTimer = new QTimer(this);
@@ -744,32 +795,17 @@ void NeutronYieldStatisticsWindow::initCountCustomPlot()
         double eps = 0.00001; // 单位min
 
         //索引给出该点属于第几个点，下标从0开始
-        QVector<specStripData> count909 = dealFile->GetCount909Data();
-        for(auto data:count909)
+        if (!mCurrentSnapshot)
+            return;
+        for(auto x:mCurrentSnapshot->count909_time)
         {
-            if(abs(key - data.x)<eps) {
+            if(abs(key - x)<eps) {
                 break;
             }
             index++;
         }
 
-        QVector<specStripData> allSpec = dealFile->GetStripData(index);
-
-        std::vector<double> energy; //能量
-        std::vector<double> specCount; // 能谱计数
-        std::vector<double> fitSpecCount; // 拟合曲线
-        std::vector<double> residual;// 残差
-        int num = energy.size();
-        energy.reserve(num);
-        for(auto data:allSpec)
-        {
-            energy.push_back(data.x);
-            specCount.push_back(data.y);
-            fitSpecCount.push_back(data.fit_y);
-            residual.push_back(data.residual_rate);
-        }
-
-        slotUpdateSpec_909keV(energy, specCount, fitSpecCount, residual);
+        showStripResult(index);
     });
 }
 
@@ -782,7 +818,6 @@ void NeutronYieldStatisticsWindow::initPolorCustomPlot()
     customPlot->replot();
 }
 
-#include "H5Cpp.h"
 void NeutronYieldStatisticsWindow::on_action_open_triggered()
 {
     // 打开历史测量数据文件...
@@ -811,62 +846,18 @@ void NeutronYieldStatisticsWindow::on_action_open_triggered()
     settings.setValue("mainWindow/LastFilePath", filePath);
     ui->textBrowser_filepath->setText(filePath);
 
-    // 解析文件，获取能谱范围时长
-    {
-        // 1. 打开文件
-        H5::H5File file(filePath.toStdString(), H5F_ACC_RDONLY);
-
-        // 2. 打开分组核数据集
-        H5::Group group = file.openGroup("Detector#1");
-        H5::DataSet dataset = group.openDataSet("Spectrum");
-
-        // 3. 确认数据类型匹配（可选，用于错误检查）
-        H5::CompType fileType = dataset.getCompType();
-        if (fileType != H5::PredType::NATIVE_UINT) {
-            file.close();
-            return;
-        }
-
-        // 4. 初始文件空间
-        H5::DataSpace file_space = dataset.getSpace();
-        hsize_t current_dims[2];
-        file_space.getSimpleExtentDims(current_dims, NULL);
-        hsize_t rows = current_dims[0];
-        hsize_t cols = current_dims[1];
-        if (rows<=0){
-            group.close();
-            dataset.close();
-            file_space.close();
-            file.close();
-            return;
-        }
-
-        // 5. 内存空间：只读取一行
-        hsize_t mem_dims[2] = {1, cols};
-        H5::DataSpace mem_space(2, mem_dims);
-        uint32_t* row_data = new uint32_t[cols];
-
-        // 6. 指定数据读取位置
-        hsize_t start[2] = {0, 0};
-        hsize_t count[2] = {1, cols};
-        file_space.selectHyperslab(H5S_SELECT_SET, count, start);
-
-        // 7. 读取数据
-        dataset.read(row_data, H5::PredType::NATIVE_UINT, mem_space, file_space);
-        FullSpectrum* data = reinterpret_cast<FullSpectrum*>(row_data);
-
-        quint32 measureTimelength = rows * data->measureTime / 1000;        
-        ui->spinBox_timeEnd->setMaximum(measureTimelength / 60);
-
-        emit reporWriteLog(tr("测量时长/s：%1").arg(measureTimelength));
+    // 解析文件，获取能谱范围时长。经HDF5Settings串行读取（HDF5库不是线程安全的），只读各行表头
+    QVector<quint32> headers;
+    if (!HDF5Settings::readH5SpectrumHeaders(filePath.toStdString(), 1, headers) || headers.isEmpty())
+        return;
 
-        delete[] row_data;
-        row_data = nullptr;
+    // 表头每行3个数：序号、测量时间、死时间
+    quint64 rows = headers.size() / 3;
+    quint32 measureTime = headers.at(1);
+    quint32 measureTimelength = rows * measureTime / 1000;
+    ui->spinBox_timeEnd->setMaximum(measureTimelength / 60);
 
-        group.close();
-        dataset.close();
-        file_space.close();
-    }
+    emit reporWriteLog(tr("测量时长/s：%1").arg(measureTimelength));
 }
 
 
@@ -878,6 +869,12 @@ void NeutronYieldStatisticsWindow::on_action_exit_triggered()
 
 void NeutronYieldStatisticsWindow::on_action_startMeasure_triggered()
 {
+    if (mAnalysisJob->isRunning())
+    {
+        QMessageBox::information(this, tr("提示"), tr("解析正在进行中，请等待或先停止解析。"));
+        return;
+    }
+
     // 获取测量的起始时刻，以打靶时刻为零时刻
     // 获取两个时间的时间戳（秒）
     qint64 seconds1 = ui->messureDateTime->dateTime().toSecsSinceEpoch();
@@ -912,36 +909,312 @@ void NeutronYieldStatisticsWindow::on_action_startMeasure_triggered()
 
     emit reporWriteLog(tr("开始解析..."));
 
-    if(!dealFile) delete dealFile;
+    delete dealFile;
     dealFile = new ParseData();
-
-    quint32 specCount = 0;
     dealFile->setStartTime(measureTime);
+    dealFile->setInterruptFlag(&mInterrupted);
+
+    QString filePath = ui->textBrowser_filepath->toPlainText();
+    int index = 1; //默认读取探测器1的数据
+    if (ui->tableWidget->selectedItems().count() > 0)
+        index = ui->tableWidget->selectedItems()[0]->row() + 1;
+
+    ui->action_startMeasure->setEnabled(false);
+    ui->action_batchMeasure->setEnabled(false);
+    ParseData* parseData = dealFile;
+    AnalysisCache::Parameters parameters;
+    parameters.measureTime = measureTime;
+    parameters.timeStep = timeStep;
+    parameters.startTime = startTime;
+    parameters.endTime = endTime;
+    mAnalysisJob->start([=](AnalysisJob::Context& context) -> bool {
+        // 文件和解析参数均未变化时直接读取缓存
+        QString cacheKey = AnalysisCache::key(filePath, index, parameters);
+        ParseResultSnapshotPtr cached = AnalysisCache::load(cacheKey);
+        if (cached)
+        {
+            emit reporWriteLog(tr("解析参数未变化，读取缓存的解析结果"));
+            context.setResult(QVariant::fromValue(cached));
+            return true;
+        }
+
+        // 每拟合完一段分时能谱，上报进度并推送该段剥谱结果（剥谱失败的能谱段没有剥谱结果）
+        int postedStrips = 0;
+        parseData->setProgressCallback([&context, &postedStrips, parseData, this](int done, int total){
+            context.setProgress(done, total, tr("拟合能谱"));
+            if (parseData->GetStripCount() > postedStrips)
+                context.postPartial(QVariant::fromValue(parseData->GetStripData(postedStrips++)));
+        });
+
+        context.setProgress(0, 1, tr("读取能谱"));
+        quint32 specCount = 0;
+        if (QFileInfo(filePath).suffix() == "H5")
+            specCount = parseData->parseH5File(filePath, index);
+        else//处理网口原始数据，暂时搁置，后续有空再处理
+            specCount = parseData->parseDatFile(filePath);
+
+        bool success = false;
+        if (specCount <= 0)
+            qInfo().nospace() << tr("文件中未找到完整能谱数据。");
+        else if (!context.isCanceled())
+            success = parseData->getResult_offline(timeStep, startTime, endTime);
+
+        parseData->setProgressCallback(nullptr);
+        if (success && !context.isCanceled())
+        {
+            ParseResultSnapshotPtr snapshot = parseData->snapshot();
+            AnalysisCache::save(cacheKey, snapshot);
+            context.setResult(QVariant::fromValue(snapshot));
+        }
+        return success;
+    });
+}
+
+
+/**
+ * @brief 批量解析，使用线程池并行分析文件中全部谱仪(Detector#1~24)的数据
+ */
+void NeutronYieldStatisticsWindow::on_action_batchMeasure_triggered()
+{
+    if (mAnalysisJob->isRunning()){
+        QMessageBox::information(this, tr("提示"), tr("解析正在进行中，请等待或先停止解析。"));
+        return;
+    }
+
     QString filePath = ui->textBrowser_filepath->toPlainText();
-    if (QFileInfo(filePath).suffix() == "H5")
+    if (QFileInfo(filePath).suffix() != "H5" || !QFileInfo::exists(filePath))
     {
-        int index = 1; //默认读取探测器1的数据
-        if (ui->tableWidget->selectedItems().count() > 0)
-            index = ui->tableWidget->selectedItems()[0]->row() + 1;
-        specCount = dealFile->parseH5File(filePath, index);
+        QMessageBox::information(this, tr("提示"), tr("批量解析仅支持H5测量文件，请先打开文件。"));
+        return;
     }
-    else//处理网口原始数据，暂时搁置，后续有空再处理
-        specCount = dealFile->parseDatFile(filePath);
 
-    if (specCount <= 0)
+    // 获取测量的起始时刻，以打靶时刻为零时刻
+    qint64 seconds1 = ui->messureDateTime->dateTime().toSecsSinceEpoch();
+    qint64 seconds2 = ui->fusionDateTime->dateTime().toSecsSinceEpoch();
+    qint64 measureTime = seconds1 - seconds2;
+
+    // 设定待分析的时间区间以及步长
+    int startTime = ui->spinBox_timeStart->value() * 60; //单位：s
+    int endTime = ui->spinBox_timeEnd->value() * 60; //单位：s
+    int timeStep = ui->spinBox_step->value() * 60;//单位：s
+
+    if(startTime >= endTime)
     {
-        qInfo().nospace() << tr("文件中未找到完整能谱数据。");
+        qInfo().nospace() << tr("退出解析！输入的解析时间起点>=解析时间终点。");
+        return;
     }
-    else {
-        if (dealFile->getResult_offline(timeStep, startTime, endTime))
-            emit sigSuccess();
-        else
-            emit sigFail();
+
+    QString msgTip = QString("将并行解析全部%1个谱仪的数据"
+                             "\n起点时间：%2分钟"
+                             "\n结束时间：%3分钟"
+                             "\n时间步长：%4分钟"
+                             "\n\n点击[确认]开始解析"
+                             "\n点击[否]返回重新修改").arg(DET_NUM)
+                         .arg(ui->spinBox_timeStart->value())
+                         .arg(ui->spinBox_timeEnd->value())
+                         .arg(ui->spinBox_step->value());
+    if (QMessageBox::question(this, tr("提示"), msgTip, QMessageBox::Yes, QMessageBox::No)!=QMessageBox::Yes)
+        return;
+
+    // 清空上一次结果
+    mBatchSnapshots.clear();
+    mBatchResults.clear();
+    for (int row=0; row<ui->tableWidget->rowCount(); ++row)
+    {
+        for (int column=1; column<ui->tableWidget->columnCount(); ++column)
+            ui->tableWidget->item(row, column)->setText("");
+    }
+
+    mBatchRunning = true;
+    ui->action_startMeasure->setEnabled(false);
+    ui->action_batchMeasure->setEnabled(false);
+    emit reporWriteLog(tr("开始批量解析，共%1个谱仪...").arg(DET_NUM));
+
+    AnalysisCache::Parameters parameters;
+    parameters.measureTime = measureTime;
+    parameters.timeStep = timeStep;
+    parameters.startTime = startTime;
+    parameters.endTime = endTime;
+    mAnalysisJob->start([=](AnalysisJob::Context& context) -> bool {
+        QThreadPool pool;
+        pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount()));
+
+        std::atomic<int> finishedCount = 0;
+        context.setProgress(0, DET_NUM, tr("解析谱仪"));
+        for (quint8 detId = 1; detId <= DET_NUM; ++detId)
+        {
+            pool.start([=, &finishedCount, &context](){
+                NeutronYieldResult result;
+                result.detectorId = detId;
+                if (!context.isCanceled())
+                {
+                    QString cacheKey = AnalysisCache::key(filePath, detId, parameters);
+                    ParseResultSnapshotPtr snapshot = AnalysisCache::load(cacheKey);
+                    if (snapshot)
+                    {
+                        result.success = true;
+                        result.specCount = snapshot->mergeSpec.size();
+                    }
+                    else
+                    {
+                        // 只保留解析结果快照，原始能谱随parseData一起释放
+                        QSharedPointer<ParseData> parseData(new ParseData());
+                        parseData->setStartTime(measureTime);
+                        parseData->setInterruptFlag(&mInterrupted);
+
+                        result.specCount = parseData->parseH5File(filePath, detId);
+                        if (result.specCount > 0 && !context.isCanceled())
+                        {
+                            result.success = parseData->getResult_offline(timeStep, startTime, endTime);
+                            snapshot = parseData->snapshot();
+                            if (result.success && !context.isCanceled())
+                                AnalysisCache::save(cacheKey, snapshot);
+                        }
+                    }
+
+                    if (result.success && snapshot)
+                    {
+                        // 未参与衰减拟合的点残差率为NaN，不计入均方根
+                        double sumSquare = 0.0;
+                        int residualCount = 0;
+                        for (int i=0; i<snapshot->count909_count.size(); ++i)
+                        {
+                            result.count909 += snapshot->count909_count.at(i);
+                            if (i < snapshot->count909_residual.size() && qIsFinite(snapshot->count909_residual.at(i)))
+                            {
+                                sumSquare += snapshot->count909_residual.at(i) * snapshot->count909_residual.at(i);
+                                residualCount++;
+                            }
+                        }
+                        if (residualCount > 0)
+                            result.residualRms = sqrt(sumSquare / residualCount);
+                        result.decayFitC0 = snapshot->decayFitC0;
+                        if (!snapshot->count909_fitcount.isEmpty()) //衰减拟合成功
+                            result.initialRate = exp(snapshot->decayFitC0) / timeStep;
+                        result.snapshot = snapshot;
+                    }
+                }
+
+                int count = ++finishedCount;
+                emit reporWriteLog(tr("谱仪#%1解析%2（%3/%4）").arg(detId)
+                                   .arg(result.success ? tr("完成") : tr("失败"))
+                                   .arg(count).arg(DET_NUM));
+                context.postPartial(QVariant::fromValue(result));
+                context.setProgress(count, DET_NUM, tr("解析谱仪"));
+            });
+        }
+
+        pool.waitForDone();
+        return true;
+    });
+}
+
+void NeutronYieldStatisticsWindow::slotBatchResult(NeutronYieldResult result)
+{
+    // 根据产额刻度（中子产额-初始活度）换算中子产额，初始活度为打靶时刻909keV计数率(cps)，
+    // 用计数率而不是每段计数换算，结果与时间步长无关
+    if (result.success)
+    {
+        QVector<QPair<double, double>> calibration = NeutronYieldCalibration::neutronYield();
+        QPair<double, double> pair = calibration.at(result.detectorId - 1);
+        if (pair.second > 0)
+            result.neutronYield = result.initialRate * pair.first / pair.second;
+    }
+    if (result.snapshot)
+        mBatchSnapshots[result.detectorId] = result.snapshot;
+    mBatchResults[result.detectorId] = result;
+
+    int row = result.detectorId - 1;
+    if (row >= ui->tableWidget->rowCount())
+        return;
+
+    if (!result.success)
+    {
+        ui->tableWidget->item(row, 1)->setText(tr("失败"));
+        return;
     }
 
+    ui->tableWidget->item(row, 1)->setText(result.neutronYield > 0 ? QString::number(result.neutronYield, 'E', 3) : tr("未刻度"));
+    ui->tableWidget->item(row, 2)->setText(QString::number(result.count909, 'f', 0));
+    ui->tableWidget->item(row, 3)->setText(QString::number(result.residualRms, 'f', 2));
+    ui->tableWidget->item(row, 4)->setText(QString::number(result.decayFitC0, 'f', 4));
+}
+
+void NeutronYieldStatisticsWindow::slotAnalysisFinished(bool success, bool canceled, const QVariant& result)
+{
+    ui->action_startMeasure->setEnabled(true);
+    ui->action_batchMeasure->setEnabled(true);
+    this->findChild<QProgressBar*>("progressBar_job")->hide();
+
+    if (mBatchRunning)
+    {
+        slotBatchFinished();
+        return;
+    }
+
+    if (canceled)
+    {
+        emit reporWriteLog(tr("解析已中断"), QtWarningMsg);
+        return;
+    }
+
+    if (success)
+    {
+        mCurrentSnapshot = result.value<ParseResultSnapshotPtr>();
+        emit sigSuccess();
+    }
+    else
+        emit sigFail();
     emit reporWriteLog(tr("解析结束"));
 }
 
+void NeutronYieldStatisticsWindow::slotBatchFinished()
+{
+    mBatchRunning = false;
+
+    if (mInterrupted)
+    {
+        emit reporWriteLog(tr("批量解析已中断"), QtWarningMsg);
+        return;
+    }
+
+    // 综合产额：已刻度谱仪产额的算术平均，并给出相对标准偏差
+    QVector<double> yields;
+    int successCount = 0;
+    for (auto result : mBatchResults)
+    {
+        if (!result.success)
+            continue;
+
+        successCount++;
+        if (result.neutronYield > 0)
+            yields.push_back(result.neutronYield);
+    }
+
+    emit reporWriteLog(tr("批量解析结束，成功%1个，失败%2个").arg(successCount).arg(DET_NUM - successCount));
+    if (yields.size() == 0)
+    {
+        QMessageBox::information(this, tr("提示"), tr("批量解析完成，无可用的产额刻度数据，无法给出综合中子产额。"));
+        return;
+    }
+
+    double mean = 0.0;
+    for (auto yield : yields)
+        mean += yield;
+    mean /= yields.size();
+
+    double variance = 0.0;
+    for (auto yield : yields)
+        variance += (yield - mean) * (yield - mean);
+    double rsd = yields.size() > 1 ? sqrt(variance / (yields.size() - 1)) / mean * 100.0 : 0.0;
+
+    QString msg = tr("综合中子产额：%1（%2个谱仪，相对标准偏差%3%）")
+                      .arg(QString::number(mean, 'E', 3))
+                      .arg(yields.size())
+                      .arg(QString::number(rsd, 'f', 2));
+    emit reporWriteLog(msg);
+    QMessageBox::information(this, tr("提示"), msg);
+}
 
 void NeutronYieldStatisticsWindow::on_action_stopMeasure_triggered()
 {
@@ -952,6 +1225,13 @@ void NeutronYieldStatisticsWindow::on_action_stopMeasure_triggered()
 
 void NeutronYieldStatisticsWindow::on_tableWidget_cellClicked(int row, int column)
 {
+    // 批量解析结果，显示对应谱仪的拟合曲线
+    if (mBatchSnapshots.contains(row + 1))
+    {
+        showParseResult(mBatchSnapshots[row + 1]);
+        return;
+    }
+
     if (row <= 1 || column != 0)
         return;
 
@@ -982,65 +1262,47 @@ void NeutronYieldStatisticsWindow::slotFail()
 void NeutronYieldStatisticsWindow::slotSuccess()
 {
     //SplashWidget::instance()->setInfo(tr("开始数据分析，请等待..."));
+    showParseResult(mCurrentSnapshot);
+
+    // QTimer::singleShot(1, this, [=](){
+    //     SplashWidget::instance()->hide();
+    // });
+
+    QMessageBox::information(this, tr("提示"), tr("文件解析已顺利完成！"));
+}
+
+void NeutronYieldStatisticsWindow::showParseResult(ParseResultSnapshotPtr snapshot)
+{
+    if (!snapshot)
+        return;
+
+    mCurrentSnapshot = snapshot;
 
     //显示计数衰减曲线、显示计数率和残差%
-    std::vector<double> time;// x
-    std::vector<double> count;// y
-    std::vector<double> fitCount; // fity 拟合曲线
-    std::vector<double> residual; // 残差
-
-    QVector<specStripData> count909_picture = dealFile->GetCount909Data();
-    specStripData tempData;
-    for(int i=0; i<count909_picture.size(); i++)
-    {
-        time.push_back(count909_picture.at(i).x);
-        count.push_back(count909_picture.at(i).y);
-        fitCount.push_back(count909_picture.at(i).fit_y);
-        residual.push_back(count909_picture.at(i).residual_rate);
-    }
-    slotUpdate_Count909_time(time, count, fitCount, residual);
+    slotUpdate_Count909_time(snapshot->count909_time, snapshot->count909_count,
+                             snapshot->count909_fitcount, snapshot->count909_residual);
 
     // 先默认绘制第一幅图
-    {
-        QVector<specStripData> allSpec = dealFile->GetStripData(0);
-        std::vector<double> energy; //能量
-        std::vector<double> specCount; // 能谱计数
-        std::vector<double> fitSpecCount; // 拟合曲线
-        std::vector<double> residual;// 残差
-        int num = energy.size();
-        energy.reserve(num);
-        for(auto data:allSpec)
-        {
-            energy.push_back(data.x);
-            specCount.push_back(data.y);
-            fitSpecCount.push_back(data.fit_y);
-            residual.push_back(data.residual_rate);
-        }
-
-        slotUpdateSpec_909keV(energy, specCount, fitSpecCount, residual);
-    }
+    showStripResult(0);
 
     // 绘制多段能谱
-    {
-        QVector<ParseData::mergeSpecData> allSpec = dealFile->GetMergeSpec();
-        std::vector<ParseData::mergeSpecData> allSpec_vec;
-        for(auto data:allSpec)
-        {
-            allSpec_vec.push_back(data);
-        }
-
-        slotUpdateMultiSegmentPlotDatas(allSpec_vec);
-    }
+    slotUpdateMultiSegmentPlotDatas(snapshot->mergeSpec);
+}
 
-    // QTimer::singleShot(1, this, [=](){
-    //     SplashWidget::instance()->hide();
-    // });
+void NeutronYieldStatisticsWindow::showStripResult(int specID)
+{
+    int first = 0, length = 0;
+    if (!mCurrentSnapshot || !mCurrentSnapshot->stripRange(specID, first, length))
+        return;
 
-    QMessageBox::information(this, tr("提示"), tr("文件解析已顺利完成！"));
+    slotUpdateSpec_909keV(mCurrentSnapshot->strip_x.mid(first, length),
+                          mCurrentSnapshot->strip_y.mid(first, length),
+                          mCurrentSnapshot->strip_fity.mid(first, length),
+                          mCurrentSnapshot->strip_residualRate.mid(first, length));
 }
 
 //更新多段能谱数据
-void NeutronYieldStatisticsWindow::slotUpdateMultiSegmentPlotDatas(std::vector<ParseData::mergeSpecData> allSpectrum)
+void NeutronYieldStatisticsWindow::slotUpdateMultiSegmentPlotDatas(const ParseData::MergeSpecList& allSpectrum)
 {
     QCustomPlot *customPlot = ui->spectorMeter_Spectrum;
     customPlot->clearGraphs();
@@ -1068,7 +1330,7 @@ void NeutronYieldStatisticsWindow::slotUpdateMultiSegmentPlotDatas(std::vector<P
     checkBoxAll->setFixedWidth(80);
     checkBoxAll->setChecked(true);
     flowLayout->addWidget(checkBoxAll);
-    for (size_t i=0; i<allSpectrum.size(); ++i){
+    for (int i=0; i<allSpectrum.size(); ++i){
         //用横向布局包裹起来
         QWidget* w = new QWidget(flowLayoutContainer);
         w->setContentsMargins(0,0,0,0);
@@ -1125,7 +1387,7 @@ void NeutronYieldStatisticsWindow::slotUpdateMultiSegmentPlotDatas(std::vector<P
 
     //能谱
     {
-        for (size_t i=0; i<allSpectrum.size(); ++i){
+        for (int i=0; i<allSpectrum.size(); ++i){
             //QCPGraph *graph = customPlot->addGraph(customPlot->xAxis, customPlot->yAxis);
             QCPGraph *graph = customPlot->addGraph();
 
@@ -1152,8 +1414,8 @@ void NeutronYieldStatisticsWindow::slotUpdateMultiSegmentPlotDatas(std::vector<P
     customPlot->replot();
 }
 
-void NeutronYieldStatisticsWindow::slotUpdate_Count909_time(std::vector<double> time/*时刻*/, std::vector<double> count/*散点*/,
-                              std::vector<double> fitcount/*拟合曲线*/, std::vector<double> residual/*残差*/)
+void NeutronYieldStatisticsWindow::slotUpdate_Count909_time(const QVector<double>& time/*时刻*/, const QVector<double>& count/*散点*/,
+                              const QVector<double>& fitcount/*拟合曲线*/, const QVector<double>& residual/*残差*/)
 {
     QCustomPlot *customPlot = ui->spectorMeter_Count;
 
@@ -1267,7 +1529,7 @@ void NeutronYieldStatisticsWindow::slotUpdate_Count909_time(std::vector<double>
     customPlot->replot();
 }
 
-void NeutronYieldStatisticsWindow::slotUpdateSpec_909keV(std::vector<double> channel, std::vector<double> count, std::vector<double> fitcount, std::vector<double>residual)
+void NeutronYieldStatisticsWindow::slotUpdateSpec_909keV(const QVector<double>& channel, const QVector<double>& count, const QVector<double>& fitcount, const QVector<double>& residual)
 {
     QCustomPlot *customPlot = ui->spectorMeter_Count;
 
@@ -9,10 +9,25 @@
 #define NEUTRONYIELDSTATISTICSWINDOW_H
 
 #include <QWidget>
+#include <QSharedPointer>
 #include "QGoodWindowHelper"
 #include "qcustomplothelper.h"
 #include "parsedata.h"
 
+// 单个谱仪的批量解析结果
+struct NeutronYieldResult{
+    quint8 detectorId = 0;      // 谱仪编号1-24
+    bool success = false;       // 解析是否成功
+    int specCount = 0;          // 分时能谱个数
+    double count909 = 0.0;      // 909keV全能峰总计数（死时间修正后）
+    double residualRms = 0.0;   // 衰减拟合残差率均方根，单位%
+    double decayFitC0 = 0.0;    // 衰减拟合参数c0，ln(N0)，N0为打靶时刻一个时间步长内的909keV计数
+    double initialRate = 0.0;   // 打靶时刻909keV计数率 N0/时间步长，单位cps，与时间步长无关
+    double neutronYield = 0.0;  // 中子产额 = 初始计数率 * 产额刻度系数
+    ParseResultSnapshotPtr snapshot; // 解析结果快照，用于点击表格时显示曲线
+};
+Q_DECLARE_METATYPE(NeutronYieldResult)
+
 namespace Ui {
 class NeutronYieldStatisticsWindow;
 }
@@ -49,12 +64,19 @@ public slots:
     void slotFail();
     void slotSuccess();
 
+    // 批量解析，单个谱仪完成
+    void slotBatchResult(NeutronYieldResult result);
+    // 批量解析，全部谱仪完成，给出综合产额
+    void slotBatchFinished();
+    // 后台解析任务结束（单谱仪解析/批量解析）
+    void slotAnalysisFinished(bool success, bool canceled, const QVariant& result);
+
     //更新多段能谱数据
-    void slotUpdateMultiSegmentPlotDatas(std::vector<ParseData::mergeSpecData>); //分时能谱
+    void slotUpdateMultiSegmentPlotDatas(const ParseData::MergeSpecList& allSpectrum); //分时能谱
 
-    void slotUpdate_Count909_time(std::vector<double> time/*时刻*/, std::vector<double> count/*散点*/,
-                                  std::vector<double> fitcount/*拟合曲线*/, std::vector<double> residual/*残差*/);//计数衰减曲线
-    void slotUpdateSpec_909keV(std::vector<double> channel, std::vector<double> count, std::vector<double> fitcount, std::vector<double>residual);//909峰位段能谱曲线
+    void slotUpdate_Count909_time(const QVector<double>& time/*时刻*/, const QVector<double>& count/*散点*/,
+                                  const QVector<double>& fitcount/*拟合曲线*/, const QVector<double>& residual/*残差*/);//计数衰减曲线
+    void slotUpdateSpec_909keV(const QVector<double>& channel, const QVector<double>& count, const QVector<double>& fitcount, const QVector<double>& residual);//909峰位段能谱曲线
 
 private slots:
     void on_action_lightTheme_triggered();
@@ -67,11 +89,18 @@ private slots:
 
     void on_action_startMeasure_triggered();
 
+    void on_action_batchMeasure_triggered();
+
     void on_action_stopMeasure_triggered();
 
     void on_tableWidget_cellClicked(int row, int column);
 
 private:
+    // 显示某一谱仪的解析结果曲线
+    void showParseResult(ParseResultSnapshotPtr snapshot);
+    // 显示当前结果中第specID段能谱的剥谱曲线
+    void showStripResult(int specID);
+
     Ui::NeutronYieldStatisticsWindow *ui;
     bool mIsDarkTheme = true;
     bool mThemeColorEnable = true;
@@ -96,6 +125,14 @@ private:
     unsigned int endTimeUI = 0;
 
     ParseData* dealFile = nullptr;
+    ParseResultSnapshotPtr mCurrentSnapshot; //当前显示的解析结果
+
+    // 批量解析
+    QMap<quint8, ParseResultSnapshotPtr> mBatchSnapshots; //各谱仪解析结果
+    QMap<quint8, NeutronYieldResult> mBatchResults;
+    bool mBatchRunning = false;
+
+    class AnalysisJob* mAnalysisJob = nullptr; //后台解析任务
 };
 
 #endif // NEUTRONYIELDSTATISTICSWINDOW_H
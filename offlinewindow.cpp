@@ -8,11 +8,15 @@
 #include "offlinewindow.h"
 #include "ui_offlinewindow.h"
 #include "globalsettings.h"
+#include "spectrumquery.h"
+#include "analysisjob.h"
 
 #include <QButtonGroup>
 #include <QFileDialog>
 #include <QAction>
 #include <QToolButton>
+#include <QProgressBar>
+#include <QElapsedTimer>
 
 #include <QJsonArray>
 #include <QJsonObject>
@@ -33,6 +37,27 @@ OfflineWindow::OfflineWindow(bool isDarkTheme, QWidget *parent)
     applyColorTheme();
     connect(this, SIGNAL(reporWriteLog(const QString&,QtMsgType)), this, SLOT(replyWriteLog(const QString&,QtMsgType)));
 
+    // 后台分析任务
+    mAnalysisJob = new AnalysisJob(&mInterrupted, this);
+    connect(mAnalysisJob, &AnalysisJob::progress, this, [=](qint64 done, qint64 total, const QString& stage){
+        QProgressBar* progressBar = this->findChild<QProgressBar*>("progressBar_job");
+        progressBar->setMaximum(1000);
+        progressBar->setValue(total > 0 ? done * 1000 / total : 0);
+        progressBar->setFormat(QString("%1 %2/%3").arg(stage).arg(done).arg(total));
+        progressBar->show();
+    });
+    connect(mAnalysisJob, &AnalysisJob::partialResult, this, [=](const QVariant& data){
+        QVariantMap partial = data.toMap();
+        QVector<double> keys;
+        for (int j=0; j<8192; ++j)
+            keys << j;
+        ui->spectorMeter->graph(0)->setData(keys, partial["spectrum"].value<QVector<double>>());
+        ui->spectorMeter->graph(1)->setData(keys, partial["spectrumAdjust"].value<QVector<double>>());
+        ui->spectorMeter->rescaleAxes(true);
+        ui->spectorMeter->replot(QCustomPlot::rpQueuedReplot);
+    });
+    connect(mAnalysisJob, &AnalysisJob::finished, this, &OfflineWindow::slotAnalysisFinished);
+
     QTimer::singleShot(0, this, [&](){
         qGoodStateHolder->setCurrentThemeDark(mIsDarkTheme);
         QGoodWindow::setAppCustomTheme(mIsDarkTheme,this->mThemeColor); // Must be >96
@@ -48,6 +73,9 @@ OfflineWindow::OfflineWindow(bool isDarkTheme, QWidget *parent)
 
 OfflineWindow::~OfflineWindow()
 {
+    // 先结束后台任务再释放界面
+    delete mAnalysisJob;
+    mAnalysisJob = nullptr;
     delete ui;
 }
 
@@ -63,6 +91,14 @@ void OfflineWindow::initUi()
         ui->statusbar->setContentsMargins(5, 0, 5, 0);
         ui->statusbar->addWidget(new QLabel(ui->statusbar), 1);
         ui->statusbar->addWidget(nullptr, 1);
+
+        // 解析进度
+        QProgressBar *progressBar_job = new QProgressBar(ui->statusbar);
+        progressBar_job->setObjectName("progressBar_job");
+        progressBar_job->setFixedWidth(300);
+        progressBar_job->setTextVisible(true);
+        progressBar_job->hide();
+        ui->statusbar->addPermanentWidget(progressBar_job);
         ui->statusbar->addPermanentWidget(label_systemtime);
 
         QTimer* systemClockTimer = new QTimer(this);
@@ -547,7 +583,6 @@ void OfflineWindow::initCustomPlot(QCustomPlot* customPlot, QString axisXLabel,
     connect(customPlot, SIGNAL(mouseRelease(QMouseEvent*)), this, SLOT(slotRestorePlot(QMouseEvent*)));
 }
 
-#include "H5Cpp.h"
 void OfflineWindow::on_action_open_triggered()
 {
     // 打开历史测量数据文件...
@@ -564,62 +599,16 @@ void OfflineWindow::on_action_open_triggered()
     settings.setValue("mainWindow/LastFilePath", filePath);
     ui->textBrowser_filepath->setText(filePath);
 
-    // 解析文件，获取能谱范围时长
-    {
-        QString filePath = ui->textBrowser_filepath->toPlainText();
-
-        // 1. 打开文件
-        H5::H5File file(filePath.toStdString(), H5F_ACC_RDONLY);
-
-        // 2. 打开分组核数据集
-        H5::Group group = file.openGroup("Detector#1");
-        H5::DataSet dataset = group.openDataSet("Spectrum");
-
-        // 3. 确认数据类型匹配（可选，用于错误检查）
-        H5::CompType fileType = dataset.getCompType();
-        if (fileType != H5::PredType::NATIVE_UINT) {
-            file.close();
-            return;
-        }
-
-        // 4. 初始文件空间
-        H5::DataSpace file_space = dataset.getSpace();
-        hsize_t current_dims[2];
-        file_space.getSimpleExtentDims(current_dims, NULL);
-        hsize_t rows = current_dims[0];
-        hsize_t cols = current_dims[1];
-        if (rows<=0){
-            group.close();
-            dataset.close();
-            file_space.close();
-            file.close();
-            return;
-        }
-
-        // 5. 内存空间：只读取一行
-        hsize_t mem_dims[2] = {1, cols};
-        H5::DataSpace mem_space(2, mem_dims);
-        uint32_t* row_data = new uint32_t[cols];
-
-        // 6. 指定数据读取位置
-        hsize_t start[2] = {0, 0};
-        hsize_t count[2] = {1, cols};
-        file_space.selectHyperslab(H5S_SELECT_SET, count, start);
-
-        // 7. 读取数据
-        dataset.read(row_data, H5::PredType::NATIVE_UINT, mem_space, file_space);
-        FullSpectrum* data = reinterpret_cast<FullSpectrum*>(row_data);
-
-        ui->line_measure_endT->setText(QString::number(rows * data->measureTime / 1000));
-        emit reporWriteLog(tr("测量时长/s：%1").arg(ui->line_measure_endT->text()));
-
-        delete[] row_data;
-        row_data = nullptr;
+    // 解析文件，获取能谱范围时长。经HDF5Settings串行读取（HDF5库不是线程安全的），只读各行表头
+    QVector<quint32> headers;
+    if (!HDF5Settings::readH5SpectrumHeaders(filePath.toStdString(), 1, headers) || headers.isEmpty())
+        return;
 
-        group.close();
-        dataset.close();
-        file_space.close();
-    }
+    // 表头每行3个数：序号、测量时间、死时间
+    quint64 rows = headers.size() / 3;
+    quint32 measureTime = headers.at(1);
+    ui->line_measure_endT->setText(QString::number(rows * measureTime / 1000));
+    emit reporWriteLog(tr("测量时长/s：%1").arg(ui->line_measure_endT->text()));
 }
 
 
@@ -631,6 +620,12 @@ void OfflineWindow::on_action_exit_triggered()
 
 void OfflineWindow::on_action_startMeasure_triggered()
 {
+    if (mAnalysisJob->isRunning())
+    {
+        emit reporWriteLog(tr("上一次解析尚未结束，请等待或先停止解析。"), QtWarningMsg);
+        return;
+    }
+
     emit reporWriteLog(tr("开始解析..."));
 
     ui->spectorMeter->graph(0)->data()->clear();
@@ -658,47 +653,20 @@ void OfflineWindow::on_action_startMeasure_triggered()
         return;
     }
 
-    qApp->setOverrideCursor(QCursor(Qt::WaitCursor));
     quint32 tmStart = ui->spinBox_timeStart->value();
     quint32 tmEnd = ui->spinBox_timeEnd->value();
     QString filePath = ui->textBrowser_filepath->toPlainText();
 
-    // 1. 打开文件
-    H5::H5File file(filePath.toStdString(), H5F_ACC_RDONLY);
-
-
-    //for (int index = 1; index <= DET_NUM; ++index)
-    {
-        // 2. 打开分组核数据集
-        H5::Group group = file.openGroup(QString("Detector#%1").arg(index).toStdString().c_str());
-        H5::DataSet dataset = group.openDataSet("Spectrum");
+    ui->action_startMeasure->setEnabled(false);
+    mAnalysisJob->start([=](AnalysisJob::Context& context) -> bool {
+        // 经SpectrumQuery按秒（测量时间累计满1000ms）汇总，不足一秒的尾部数据舍弃；每秒按这一秒的死时间修正
+        SpectrumQueryRequest request;
+        request.filePath = filePath;
+        request.detectors << quint8(index);
+        request.sequenceBegin = tmStart;
+        request.sequenceEnd = tmEnd;
+        request.timeBin = 1000;
 
-        // 3. 确认数据类型匹配（可选，用于错误检查）
-        H5::CompType fileType = dataset.getCompType();
-        if (fileType != H5::PredType::NATIVE_UINT)
-        {
-            file.close();
-            qApp->restoreOverrideCursor();
-            return;
-        }
-
-        // 4. 初始文件空间
-        H5::DataSpace file_space = dataset.getSpace();
-        hsize_t current_dims[2];
-        file_space.getSimpleExtentDims(current_dims, NULL);
-        hsize_t rows = current_dims[0];
-        hsize_t cols = current_dims[1];
-        if (rows<=0)
-        {
-            file.close();
-            qApp->restoreOverrideCursor();
-            return;
-        }
-
-        // 5. 内存空间：每次读取一行
-        hsize_t mem_dims[2] = {1, cols};
-        H5::DataSpace mem_space(2, mem_dims);
-        uint32_t* row_data = new uint32_t[cols];
         quint64 minV = quint32(-1);
         quint64 maxV = 0;
         double minVAdjust = quint32(-1);
@@ -708,117 +676,127 @@ void OfflineWindow::on_action_startMeasure_triggered()
         quint32 ref = 0;
         quint64 total = 0;
         double totalDeathTime = 0;
-        quint32 measureTime = 0;
         double totalAdjust = 0;// 修正后
         QVector<double> spectrumTotal(8192, 0); // 8192道完整数据
         QVector<double> spectrumTotalAdjust(8192, 0); // 8192道完整数据
 
-        for (hsize_t i = 0; i < rows;/* ++i*/) {
-            if (mInterrupted)
+        // 只查询一个谱仪，回调都在同一个线程中
+        QElapsedTimer partialTimer;
+        partialTimer.start();
+        int count = SpectrumQuery::run(request, [&](quint8, const SpectrumQueryBin& bin) {
+            if (!bin.complete)
+                return;
+
+            double realTime = (double)bin.measureTime * 10e6;
+            double factor = realTime / (realTime - (double)bin.deathTime * 10);
+            quint64 totalTemp = 0;//计数
+            for (int j=0; j<8192; ++j)
             {
-                emit reporWriteLog(tr("解析被中断！"));
-                break;
+                totalTemp += bin.spectrum[j];
+                spectrumTotal[j] += bin.spectrum[j];
+                spectrumTotalAdjust[j] += (double)bin.spectrum[j] * factor;
             }
 
-            // 6. 指定数据读取位置
-            hsize_t start[2] = {i, 0};
-            hsize_t count[2] = {1, cols};
-            file_space.selectHyperslab(H5S_SELECT_SET, count, start);
-
-            // 7. 读取数据
-            dataset.read(row_data, H5::PredType::NATIVE_UINT, mem_space, file_space);
-            FullSpectrum* data = reinterpret_cast<FullSpectrum*>(row_data);
-            if (data->sequence >= tmStart && data->sequence <= tmEnd)
-            {
-                // 8. 对数据按秒进行重新分类
-                quint64 totalTemp = 0;//计数
-                double totalTempDeathT = 0;//死时间
-                quint8 step = 1000 / data->measureTime;
-                QVector<quint32> spectrum(8192, 0);// 能谱/s
-                quint32 deathTime = 0;// 死时间/s
-                for (int t = 0; t < step; ++t)
-                {
-                    for (int j=0; j<8192; ++j)
-                    {
-                        spectrum[j] += data->spectrum[j];
-
-                    }
-
-                    deathTime += data->deathTime;
-                }
-                i += step;
-
-                // 9. 能谱统计
-                for (int j=0; j<8192; ++j)
-                {
-                    // 9. 对数据进行累加，计数计数率
-                    totalTemp += spectrum[j];
-                    spectrumTotal[j] += spectrum[j];
-                    spectrumTotalAdjust[j] += (double)spectrum[j] * data->measureTime * 10e6 / (data->measureTime*10e6 - data->deathTime*10);
-                }
+            // 死时间率统计
+            double totalTempDeathT = (double)bin.deathTime * 10 / realTime;
+            minVDeathTime = qMin(minVDeathTime, totalTempDeathT);
+            maxVDeathTime = qMax(maxVDeathTime, totalTempDeathT);
+            totalDeathTime += totalTempDeathT;
 
-                // 死时间率统计
-                totalTempDeathT = (double)deathTime*10 / (data->measureTime*10e6);
-                minVDeathTime = qMin(minVDeathTime, (double)totalTempDeathT);
-                maxVDeathTime = qMax(maxVDeathTime, (double)totalTempDeathT);
-                totalDeathTime += totalTempDeathT;
+            // 修正后10e6
+            double totalSAdjust = (double)totalTemp * factor;
 
-                // 9. 修正后10e6
-                double totalSAdjust = 0;
-                totalSAdjust = (double)totalTemp * data->measureTime * 10e6 / (data->measureTime*10e6 - data->deathTime*10);
+            ++ref;
+            minV = qMin(minV, totalTemp);
+            maxV = qMax(maxV, totalTemp);
+            total += totalTemp;
 
-                ++ref;
-                minV = qMin(minV, (quint64)totalTemp);
-                maxV = qMax(maxV, (quint64)totalTemp);
-                total += (quint64)totalTemp;
+            minVAdjust = qMin(minVAdjust, totalSAdjust);
+            maxVAdjust = qMax(maxVAdjust, totalSAdjust);
+            totalAdjust += totalSAdjust;
 
-                minVAdjust = qMin((double)minVAdjust, (double)totalSAdjust);
-                maxVAdjust = qMax((double)maxVAdjust, (double)totalSAdjust);
-                totalAdjust += totalSAdjust;
-            }
-            else{
-                ++i;
+            // 定时推送当前累计能谱，界面先行刷新
+            if (partialTimer.elapsed() >= 500)
+            {
+                partialTimer.restart();
+                QVariantMap partial;
+                partial["spectrum"] = QVariant::fromValue(spectrumTotal);
+                partial["spectrumAdjust"] = QVariant::fromValue(spectrumTotalAdjust);
+                context.postPartial(partial);
             }
+        }, [&](qint64 done, qint64 totalRows) {
+            context.setProgress(done, totalRows, tr("读取能谱"));
+        }, &mInterrupted);
+
+        if (count <= 0 || ref == 0)
+            return false;
+
+        QVariantMap result;
+        result["index"] = index;
+        result["minV"] = minV;
+        result["minVAdjust"] = minVAdjust;
+        result["maxV"] = maxV;
+        result["maxVAdjust"] = maxVAdjust;
+        result["meanV"] = (quint64)(total / ref);
+        result["meanVAdjust"] = totalAdjust / ref;
+        result["minVDeathTime"] = minVDeathTime;
+        result["maxVDeathTime"] = maxVDeathTime;
+        result["meanVDeathTime"] = totalDeathTime * 100 / ref;
+        result["spectrum"] = QVariant::fromValue(spectrumTotal);
+        result["spectrumAdjust"] = QVariant::fromValue(spectrumTotalAdjust);
+        context.setResult(result);
+        return true;
+    });
+}
 
-            measureTime = data->measureTime;
 
-            // 释放文件空间
-            file_space.selectNone();
-        }
+void OfflineWindow::slotAnalysisFinished(bool success, bool canceled, const QVariant& data)
+{
+    ui->action_startMeasure->setEnabled(true);
+    this->findChild<QProgressBar*>("progressBar_job")->hide();
 
-        QVector<double> keys;
-        for (int j=0; j<8192; ++j)
-            keys << j;
+    if (canceled)
+    {
+        emit reporWriteLog(tr("解析被中断！"));
+        return;
+    }
 
-        ui->spectorMeter->graph(0)->setData(keys, spectrumTotal);
-        ui->spectorMeter->graph(1)->setData(keys, spectrumTotalAdjust);
-        ui->tableWidget->item(index + 1, 1)->setText(QString::number(minV));
-        ui->tableWidget->item(index + 1, 2)->setText(QString::number(minVAdjust));
-        ui->tableWidget->item(index + 1, 3)->setText(QString::number(maxV));
-        ui->tableWidget->item(index + 1, 4)->setText(QString::number(maxVAdjust));
-        ui->tableWidget->item(index + 1, 5)->setText(QString::number(total / ref));
-        ui->tableWidget->item(index + 1, 6)->setText(QString::number(totalAdjust / ref));
-
-        ui->tableWidget->item(index + 1, 7)->setText(QString::number(minVDeathTime, 'e', 2));
-        ui->tableWidget->item(index + 1, 8)->setText(QString::number(maxVDeathTime, 'e', 2));
-        ui->tableWidget->item(index + 1, 9)->setText(QString::number(totalDeathTime * 100 / ref, 'e', 2));
-
-        mMapSpectrum[index] = spectrumTotal;
-        mMapSpectrumAdjust[index] = spectrumTotalAdjust;
-        delete[] row_data;
-        dataset.close();
-        group.close();
+    if (!success)
+    {
+        emit reporWriteLog(tr("解析失败！"), QtCriticalMsg);
+        return;
     }
 
-    file.close();
+    QVariantMap result = data.toMap();
+    int index = result["index"].toInt();
+    QVector<double> spectrumTotal = result["spectrum"].value<QVector<double>>();
+    QVector<double> spectrumTotalAdjust = result["spectrumAdjust"].value<QVector<double>>();
+    QVector<double> keys;
+    for (int j=0; j<8192; ++j)
+        keys << j;
+
+    ui->spectorMeter->graph(0)->setData(keys, spectrumTotal);
+    ui->spectorMeter->graph(1)->setData(keys, spectrumTotalAdjust);
+    ui->tableWidget->item(index + 1, 1)->setText(QString::number(result["minV"].toULongLong()));
+    ui->tableWidget->item(index + 1, 2)->setText(QString::number(result["minVAdjust"].toDouble()));
+    ui->tableWidget->item(index + 1, 3)->setText(QString::number(result["maxV"].toULongLong()));
+    ui->tableWidget->item(index + 1, 4)->setText(QString::number(result["maxVAdjust"].toDouble()));
+    ui->tableWidget->item(index + 1, 5)->setText(QString::number(result["meanV"].toULongLong()));
+    ui->tableWidget->item(index + 1, 6)->setText(QString::number(result["meanVAdjust"].toDouble()));
+
+    ui->tableWidget->item(index + 1, 7)->setText(QString::number(result["minVDeathTime"].toDouble(), 'e', 2));
+    ui->tableWidget->item(index + 1, 8)->setText(QString::number(result["maxVDeathTime"].toDouble(), 'e', 2));
+    ui->tableWidget->item(index + 1, 9)->setText(QString::number(result["meanVDeathTime"].toDouble(), 'e', 2));
+
+    mMapSpectrum[index] = spectrumTotal;
+    mMapSpectrumAdjust[index] = spectrumTotalAdjust;
+
     ui->spectorMeter->rescaleAxes(true);
     ui->spectorMeter->replot(QCustomPlot::rpQueuedReplot);
-    qApp->restoreOverrideCursor();
 
     emit reporWriteLog(tr("解析结束"));
 }
 
-
 void OfflineWindow::on_action_stopMeasure_triggered()
 {
     emit reporWriteLog(tr("中断解析"));
@@ -41,6 +41,9 @@ private slots:
 
     void on_tableWidget_cellClicked(int row, int column);
 
+    // 后台解析完成
+    void slotAnalysisFinished(bool success, bool canceled, const QVariant& data);
+
 private:
     Ui::OfflineWindow *ui;
     bool mIsDarkTheme = true;
@@ -50,6 +53,7 @@ private:
 
     // 中断解析
     std::atomic<bool> mInterrupted = false;
+    class AnalysisJob* mAnalysisJob = nullptr;
 
     QMap<quint8, QVector<double>> mMapSpectrum;
     QMap<quint8, QVector<double>> mMapSpectrumAdjust;
@@ -3,11 +3,18 @@
 #include <QDataStream>
 #include <QDebug>
 #include <QElapsedTimer>
+#include <QtNumeric>
 #include <cmath>
 #include <cstring> // 需要包含memcpy
+#include <algorithm>
 #include "sysutils.h"
+#include "spectrumkernels.h"
+#include "asynclogger.h"
+#include "tracezone.h"
 
 #include "curveFit.h"
+#include "lmsolver.h"
+#include <QVarLengthArray>
 #include "gram_savitzky_golay/gram_savitzky_golay.h"
 
 std::vector<double> sgolayfilt_matlab_like(
@@ -56,6 +63,137 @@ std::vector<double> sgolayfilt_matlab_like(
 }
 
 const double diffstep = 1.4901e-08;
+
+// 909keV计数衰减拟合的残差率，计数不为正的点不参与拟合，残差率记为NaN
+static void decayResidualRate(const double* count, const double* fit, int n, double* rate)
+{
+    CurveFit::residual_rate(count, fit, n, rate);
+    for (int i=0; i<n; ++i)
+    {
+        if (!(count[i] > 0))
+            rate[i] = qQNaN();
+    }
+}
+
+/**
+ * @brief 候选峰快速筛选。峰位、sigma固定时，func = A*exp(-0.5*((x-peak)/sigma)^2) + k*x + b 对A/k/b是线性的，
+ * 可直接解正规方程，不需要对每个候选峰位做非线性拟合。窗口关于候选峰位对称，以u=x-peak为自变量时
+ * Σu=0、Σg*u=0，斜率与(A,b)解耦；Σy、Σu*y由前缀和得到，Σg*y对每个候选峰位需要一次窗口求和。
+ * 按卡方从小到大依次对候选峰做非线性拟合（峰位固定，sigma可变），取第一个sigma合理（0.5~1.5倍估值）的结果，
+ * 通常第一个候选峰即满足要求；全部候选峰都不满足时认为没有找到峰。
+ * @param spectrum 平滑后的能谱，道址x从1开始，spectrum[x-1]
+ * @param channels 能谱道数
+ * @param leftCH 候选峰位起点
+ * @param rightCH 候选峰位终点（包含）
+ * @param halfWidth 拟合窗口半宽，窗口为[peak-halfWidth, peak+halfWidth]
+ * @param sigma sigma估值
+ * @param result 最优候选峰的拟合结果，c1为峰位，c3/c4为线性本底的斜率、截距
+ * @return 是否找到有效的峰
+ */
+static bool findPeakCandidate(const double* spectrum, int channels, int leftCH, int rightCH, int halfWidth, double sigma, fit_result& result)
+{
+    int first = leftCH - halfWidth;
+    int last = rightCH + halfWidth;
+    if (halfWidth < 1 || sigma <= 0.0 || first < 1 || last > channels || leftCH > rightCH)
+        return false;
+
+    // 前缀和：sumY[i] = Σy，sumXY[i] = Σx*y，x∈[first, first+i)
+    int len = last - first + 1;
+    QVector<double> sumY(len + 1, 0.0), sumXY(len + 1, 0.0);
+    for (int i=0; i<len; ++i)
+    {
+        double x = first + i;
+        double y = spectrum[first + i - 1];
+        sumY[i+1] = sumY[i] + y;
+        sumXY[i+1] = sumXY[i] + x * y;
+    }
+
+    // 高斯核只与u=x-peak有关，各候选峰位共用
+    int n = 2 * halfWidth + 1;
+    QVector<double> kernel(n);
+    double sumG = 0.0, sumGG = 0.0, sumUU = 0.0;
+    for (int i=0; i<n; ++i)
+    {
+        double u = i - halfWidth;
+        kernel[i] = exp(-0.5 * u * u / (sigma * sigma));
+        sumG += kernel[i];
+        sumGG += kernel[i] * kernel[i];
+        sumUU += u * u;
+    }
+    double det = sumGG * n - sumG * sumG;
+    if (fabs(det) < 1e-12)
+        return false;
+
+    QVector<fit_result> candidates;
+    for (int peak = leftCH; peak <= rightCH; ++peak)
+    {
+        int start = peak - halfWidth - first;
+        const double* y = spectrum + (peak - halfWidth - 1);
+        double Sy = sumY[start + n] - sumY[start];
+        double Suy = (sumXY[start + n] - sumXY[start]) - peak * Sy;
+        double Sgy = 0.0;
+        for (int i=0; i<n; ++i)
+            Sgy += kernel[i] * y[i];
+
+        double A = (Sgy * n - sumG * Sy) / det;
+        double b0 = (sumGG * Sy - sumG * Sgy) / det;
+        double k = Suy / sumUU;
+        if (A <= 0.0)
+            continue;
+
+        // 与CurveFit::fit_gauss_linear一致的卡方统计量
+        double chi_square = 0.0;
+        for (int i=0; i<n; ++i)
+        {
+            double fit = A * kernel[i] + k * (i - halfWidth) + b0;
+            double residual = y[i] - fit;
+            if (fit > 0.0)
+                chi_square += residual * residual / fit;
+        }
+
+        candidates.push_back(fit_result{A, peak * 1.0, sigma, k, b0 - k * peak, chi_square});
+    }
+    std::stable_sort(candidates.begin(), candidates.end(), [](const fit_result& a, const fit_result& b) {
+        return a.chi_square < b.chi_square;
+    });
+
+    // 按卡方从小到大对候选峰做非线性拟合，sigma可变
+    QVarLengthArray<double, 256> fitx(n);
+    for (const fit_result& candidate : qAsConst(candidates))
+    {
+        int peak = candidate.c1;
+        for (int i=0; i<n; ++i)
+            fitx[i] = peak - halfWidth + i;
+        const double* fity = spectrum + (peak - halfWidth - 1);
+
+        CurveFit::LM::GaussLinear model;
+        model.peak = candidate.c1;
+        CurveFit::LM::Params<4> p(candidate.c0, sigma, candidate.c3, candidate.c4);
+        if (!CurveFit::LM::fit(model, fitx.constData(), fity, n, p) ||
+            !(p[0] > 0 && p[1] <= 1.5*sigma && p[1] >= 0.5*sigma))
+            continue;
+
+        // 峰位固定的高斯+线性即c1=peak的GaussLinear2
+        const double c[5] = {p[0], model.peak, p[1], p[2], p[3]};
+        QVarLengthArray<double, 256> fitCurve(n);
+        CurveFit::evaluate_gauss_linear2(c, fitx.constData(), n, fitCurve.data());
+
+        double chi_square = 0.0;
+        for (int i=0; i<n; ++i)
+        {
+            double fit = fitCurve[i];
+            if (fit > 0.0)
+                chi_square += (fity[i] - fit) * (fity[i] - fit) / fit;
+        }
+
+        result = fit_result{p[0], candidate.c1, p[1], p[2], p[3], chi_square};
+        return true;
+    }
+
+    // 全部候选峰的sigma都不合理，不沿用固定sigma的筛选结果
+    return false;
+}
+
 ParseData::ParseData() {
 
 }
@@ -64,28 +202,16 @@ ParseData::~ParseData() {}
 
 void ParseData::mergeSpecTime_online(const H5Spectrum& specPack)
 {
-    // -------- 0. 先做道址压缩：8192 道 -> 2048 道，每 4 道求和 --------
-    quint32 compressedSpec[mCHANNEL2048];
-    for (int ch = 0; ch < mCHANNEL2048; ++ch) {
-        const int base = ch * 4;
-        // 简单相加，和你后面 m_mergeSpec 的累加一样，本身就可能溢出，所以这里不额外做饱和判断
-        compressedSpec[ch] =
-            specPack.spectrum[base]
-            + specPack.spectrum[base + 1]
-            + specPack.spectrum[base + 2]
-            + specPack.spectrum[base + 3];
-    }
+    TRACE_ZONE("mergeSpecTime_online");
+    m_parasemode = onlineMode;
 
-    // -------- 1. 统计计数率：用压缩后的谱 --------
-    int sumCount = 0;
-    for (int i = 0; i < mCHANNEL2048; ++i) {
-        sumCount += compressedSpec[i];
-    }
+    // -------- 统计计数率 --------
+    quint64 sumCount = SpectrumKernels::totalCount(specPack.spectrum, mCHANNEL8192);
 
     allSpecTime.push_back(specPack.sequence * specPack.measureTime);
     allSpecCount.push_back(sumCount);
 
-    // 记录打靶时刻
+    // 记录打靶时刻。离线分析不做该判断（打靶时刻由界面输入），以后若需要可从H5文件的能谱摘要中查找
     if (shotTime < 0 && sumCount > 1000) {
         shotTime = specPack.sequence * specPack.measureTime;
         spectDeltaT = specPack.measureTime; // 单个能谱测量时长
@@ -109,31 +235,26 @@ void ParseData::mergeSpecTime_online(const H5Spectrum& specPack)
         if (m_mergeSpec.size() < mergeID) {
             // 新的分时能谱
             if (m_mergeSpec.size() > 0) {
-                QVector<mergeSpecData> mergeSpec_temp = m_mergeSpec;
-                // 处理前面已完整的分时能谱，进行拟合
-                bool flag = getResult(mergeSpec_temp);
-                Q_UNUSED(flag);
+                // 只对前面新完成的分时能谱进行拟合
+                fitCompletedBins_online(m_mergeSpec.size());
             }
 
             mergeSpecData tempMerge;
             tempMerge.currentTime = currentTime;
+            tempMerge.specTime    = timeBin_online * 1000;
             tempMerge.deathTime   = lossTime;
 
-            // ★ 这里用压缩后的 2048 道
-            for (int i = 0; i < mCHANNEL2048; ++i) {
-                tempMerge.spectrum[i] += compressedSpec[i];
-            }
-            m_mergeSpec.push_back(tempMerge);
+            // 道址压缩：8192 道 -> 2048 道，每 4 道求和
+            SpectrumKernels::rebinAccumulate(specPack.spectrum, mCHANNEL8192, 4, tempMerge.spectrum);
+            m_mergeSpec.append(tempMerge);
 
             qDebug() << "合并一个分时能谱，mergeID = " << mergeID;
-        } else {
-            // 往已有分时能谱里继续累加
+        } else if (mergeID - 1 >= m_onlineFittedBins) {
+            // 往已有分时能谱里继续累加，已拟合、已发布的分时能谱不再修改
             m_mergeSpec[mergeID - 1].currentTime = currentTime;
             m_mergeSpec[mergeID - 1].deathTime  += lossTime;
 
-            for (int i = 0; i < mCHANNEL2048; ++i) {
-                m_mergeSpec[mergeID - 1].spectrum[i] += compressedSpec[i];
-            }
+            SpectrumKernels::rebinAccumulate(specPack.spectrum, mCHANNEL8192, 4, m_mergeSpec[mergeID - 1].spectrum);
         }
     }
 
@@ -141,17 +262,111 @@ void ParseData::mergeSpecTime_online(const H5Spectrum& specPack)
 }
 
 
-bool ParseData::getResult(QVector<mergeSpecData> mergeSpec)
+bool ParseData::getResult(const MergeSpecList& mergeSpec)
 {
     clearFitResult();
-    //根据能量刻度进行首次寻峰，进一步拟合给出511,846,909的峰位和半高宽
+    if (mergeSpec.size() == 0)
+        return false;
+
+    //根据能量刻度进行首次寻峰，给出各峰拟合初值
     QVector<fit_result> fit_c_2;
+    QVector<double> fit_c;
+    initialFit(mergeSpec.at(0), fit_c_2, fit_c);
+
+    for(int i=0; i<mergeSpec.size(); i++)
+    {
+        const mergeSpecData& spec = mergeSpec.at(i);
+        if (m_interrupted && m_interrupted->load()) {
+            qDebug()<<"解析被中断";
+            return false;
+        }
+
+        if(!fitMergeSpec(spec, fit_c_2, fit_c))
+            return false;
+
+        if (m_progressCallback)
+            m_progressCallback(i + 1, mergeSpec.size());
+    }
+
+    //对909全能峰计数取对数做线性拟合
+    if(count909_count.size()>1 && fit909data())
+    {
+        //调试用,打印909相关结果
+        for(int i=0; i<count909_count.size(); i++)
+        {
+            qDebug() << QString("数据点[%1]: 时间=%2 min, 计数=%3, 拟合值=%4, 残差率=%5%").arg(i)
+                        .arg(count909_time.at(i), 0, 'f', 3)
+                        .arg(count909_count.at(i), 0, 'f', 2)
+                        .arg(count909_fitcount.at(i), 0, 'f', 2)
+                        .arg(count909_residual.at(i), 0, 'f', 3);
+        }
+        qDebug() << "================================================";
+    }
+
+    publishSnapshot();
+    return true;
+}
+
+/**
+ * @brief publishSnapshot 将当前解析结果打包为只读快照发布，分时能谱、剥谱曲线只复制块指针，其余容器隐式共享，不做深拷贝
+ */
+void ParseData::publishSnapshot()
+{
+    TRACE_ZONE("publishSnapshot");
+    QSharedPointer<ParseResultSnapshot> result(new ParseResultSnapshot());
+    result->count909_time = count909_time;
+    result->count909_count = count909_count;
+    result->decayFitC0 = m_decayFitC0;
+    if (m_parasemode == onlineMode)
+    {
+        // 在线模式最后一段能谱仍在累加，只发布已拟合的部分；衰减拟合只维护参数，发布时计算拟合曲线和残差
+        result->mergeSpec = m_mergeSpec.prefix(m_onlineFittedBins);
+        int count = count909_time.size();
+        result->count909_fitcount.resize(count);
+        result->count909_residual.resize(count);
+        double* fity = result->count909_fitcount.data();
+        CurveFit::evaluate_log(&m_decayFitC0, count909_time.constData(), count, fity);
+        SpectrumKernels::exp(fity, count, fity);
+        decayResidualRate(count909_count.constData(), fity, count, result->count909_residual.data());
+    }
+    else
+    {
+        result->mergeSpec = m_mergeSpec;
+        result->count909_fitcount = count909_fitcount;
+        result->count909_residual = count909_residual;
+    }
+    result->strip_x = specStripData_x;
+    result->strip_y = specStripData_y;
+    result->strip_fity = specStripData_fity;
+    result->strip_residualRate = specStripData_residualRate;
+    result->strip_rightCH = specStrip_rightCH;
+
+    QMutexLocker locker(&m_snapshotMutex);
+    m_snapshot = result;
+}
+
+ParseResultSnapshotPtr ParseData::snapshot() const
+{
+    QMutexLocker locker(&m_snapshotMutex);
+    return m_snapshot;
+}
+
+/**
+ * @brief initialFit 对第一段能谱做能量刻度和首次寻峰，给出后续逐段拟合的初值
+ * @param spec 第一段分时能谱
+ * @param fit_c_2 输出，511/909keV寻峰拟合参数
+ * @param fit_c 输出，剥谱拟合参数初值
+ */
+void ParseData::initialFit(const mergeSpecData& spec, QVector<fit_result>& fit_c_2, QVector<double>& fit_c)
+{
+    //根据能量刻度进行首次寻峰，进一步拟合给出511,846,909的峰位和半高宽
+    fit_c_2.clear();
     bool fitflag[3]={false,false,false}; //寻峰是否成功的标志
     {
         double* singleSpectrum = new double[mCHANNEL2048];
         for(int i=0; i<mCHANNEL2048; i++)
         {
-            singleSpectrum[i] = mergeSpec.at(0).spectrum[i]*1.0;
+            singleSpectrum[i] = spec.spectrum[i]*1.0;
         }
 
         // 先对能谱进行能量刻度拟合
@@ -170,82 +385,102 @@ bool ParseData::getResult(QVector<mergeSpecData> mergeSpec)
     // 单高斯拟合 fit_type1 = @(p, x) p(1).*exp(-1/2*((x-p(2))./p(3)).^2) + p(4).*x.^4 + p(5).*x.^3 + p(6).*x.^2 + p(7).*x + p(8);
     // 双高斯拟合 fit_type2 = @(p, x) p(1).*exp(-1/2*((x-p(2))./p(3)).^2) + p(4).*exp(-1/2*((x-p(5))./p(6)).^2)
     //                       + p(7).*x.^4 + p(8).*x.^3 + p(9).*x.^2 + p(10).*x + p(11);
-    QVector<double> fit_c = {fit_c_2[1].c0, 846, fit_c_2[1].c2, fit_c_2[2].c0, 909, fit_c_2[2].c2,
-                             10.0, 1.0e-3, 1.0e-2, 1.0, 0.5};
+    // 本底多项式系数在剥谱时由线性最小二乘给出，这里只占位
+    fit_c = {fit_c_2[1].c0, 846, fit_c_2[1].c2, fit_c_2[2].c0, 909, fit_c_2[2].c2,
+             0.0, 0.0, 0.0, 0.0, 0.0};
     // QVector<double> fit_c = {fit_c_2[1].c0, 846, fit_c_2[1].c2, fit_c_2[2].c0, 909, fit_c_2[2].c2,
     //                          0.0, 0.0, 0.0, 0.0, 0.0};
     fit_c_2.removeAt(1); //删除中间的846峰相关拟合参数
+}
 
-    int spec_id = 0;
-    for(auto spec:mergeSpec)
+/**
+ * @brief fitMergeSpec 对单个分时能谱寻峰、剥谱并计算909keV峰面积，结果追加到count909及剥谱数据中
+ * @param spec 分时能谱
+ * @param fit_c_2 寻峰参数，以上一段能谱的结果作为初值，拟合后更新
+ * @param fit_c 剥谱参数，以上一段能谱的结果作为初值，拟合后更新
+ * @return 寻峰失败（909keV峰计数太低）时返回false；剥谱失败时只跳过该段能谱的909keV计数点，仍返回true
+ */
+bool ParseData::fitMergeSpec(const mergeSpecData& spec, QVector<fit_result>& fit_c_2, QVector<double>& fit_c)
+{
+    TRACE_ZONE("fitMergeSpec");
+    qDebug()<<"specID: "<<count909_count.size();
+    double* singleSpectrum = new double[mCHANNEL2048];
+    for(int i=0; i<mCHANNEL2048; i++)
     {
-        //对初始拟合参数最后几位挑调整
-        fit_c[6] = 10.0;
-        fit_c[7] = 1.0;
-        fit_c[8] = 1.0;
-        fit_c[9] = 1.0;
-        fit_c[10] = 5.0;
-        qDebug()<<"specID: "<<spec_id;
-        qint64 nowtime = spec.currentTime;
-        double* singleSpectrum = new double[mCHANNEL2048];
-        for(int i=0; i<mCHANNEL2048; i++)
-        {
-            singleSpectrum[i] = spec.spectrum[i]*1.0;
-        }
+        singleSpectrum[i] = spec.spectrum[i]*1.0;
+    }
 
-        bool exitflag[2]={false,false}; //寻峰是否成功的标志
-        if(!PeakFind(singleSpectrum, fit_c_2, exitflag)) { //注意，这里的fit_c_2每次调用后发生了更新
-            qDebug()<<"PeakFind Failed!";
-            delete[] singleSpectrum;
-            return false;
-        }
+    bool exitflag[2]={false,false}; //寻峰是否成功的标志
+    if(!PeakFind(singleSpectrum, fit_c_2, exitflag)) { //注意，这里的fit_c_2每次调用后发生了更新
+        qDebug()<<"PeakFind Failed!";
+        delete[] singleSpectrum;
+        return false;
+    }
 
-        if(!exitflag[1]){
-            qDebug()<<"909keV全能峰计数太低无法拟合，已终止运行";
-            return false;
-        }
+    if(!exitflag[1]){
+        qDebug()<<"909keV全能峰计数太低无法拟合，已终止运行";
+        delete[] singleSpectrum;
+        return false;
+    }
 
-        //峰位漂移矫正 利用511keV 909keV做能量刻度
-        double new_energyScal[2] = {1.0,1.0};
-        double R2 = 0.0;
-        QVector<QPointF> enFitPoints;
-        enFitPoints.push_back(QPointF(fit_c_2[0].c1,m_energyCalibration[0])); //（ch1,En1）
-        enFitPoints.push_back(QPointF(fit_c_2[1].c1,m_energyCalibration[1])); // (ch2,En2)
-        CurveFit::fit_linear(enFitPoints, new_energyScal, &R2);
-
-        // 剥谱
-        double deathRatio = spec.deathTime / 1.0e6 /spec.specTime ; //注意统一单位
-        SpecStripping(singleSpectrum, new_energyScal, fit_c, exitflag);
-        count909_time.push_back(spec.currentTime*1.0/60000);//ms转化为min
-
-        // 计算909keV峰面积
-        // 高斯面积法
-        double pi = 3.141592654;
-        double peakCount = fit_c[3]*fit_c[5]*sqrt(2*pi)/(1-deathRatio);
-        count909_count.push_back(peakCount);
-
-        qDebug()<<"SpecStripping End, specID: "<<spec_id;
-        spec_id++;
+    //峰位漂移矫正 利用511keV 909keV做能量刻度
+    double new_energyScal[2] = {1.0,1.0};
+    double R2 = 0.0;
+    QVector<QPointF> enFitPoints;
+    enFitPoints.push_back(QPointF(fit_c_2[0].c1,m_energyCalibration[0])); //（ch1,En1）
+    enFitPoints.push_back(QPointF(fit_c_2[1].c1,m_energyCalibration[1])); // (ch2,En2)
+    CurveFit::fit_linear(enFitPoints, new_energyScal, &R2);
+
+    // 剥谱
+    double deathRatio = spec.deathTime / 1.0e6 /spec.specTime ; //注意统一单位
+    if(!SpecStripping(singleSpectrum, new_energyScal, fit_c, exitflag)) {
+        qWarning()<<"SpecStripping Failed, 跳过该段能谱, specTime(ms): "<<spec.currentTime;
         delete[] singleSpectrum;
+        return true;
     }
+    count909_time.push_back(spec.currentTime*1.0/60000);//ms转化为min
 
-    //对909全能峰计数取对数做线性拟合
-    if(count909_count.size()>1)
+    // 计算909keV峰面积
+    // 高斯面积法
+    double pi = 3.141592654;
+    double peakCount = fit_c[3]*fit_c[5]*sqrt(2*pi)/(1-deathRatio);
+    count909_count.push_back(peakCount);
+
+    qDebug()<<"SpecStripping End, specID: "<<count909_count.size()-1;
+    delete[] singleSpectrum;
+    return true;
+}
+
+/**
+ * @brief fitCompletedBins_online 在线模式下只对新完成的分时能谱做拟合，沿用上一段的拟合参数作为初值，
+ * 并增量更新909keV计数衰减拟合，每段能谱的处理耗时与已测量时长无关
+ */
+void ParseData::fitCompletedBins_online(int completedCount)
+{
+    TRACE_ZONE("fitCompletedBins_online");
+    while (m_onlineFittedBins < completedCount)
     {
-        fit909data();
-        //调试用,打印909相关结果
-        for(int i=0; i<count909_count.size(); i++)
+        const mergeSpecData& spec = m_mergeSpec.at(m_onlineFittedBins);
+        if (m_onlineFittedBins == 0)
+            initialFit(spec, m_onlinePeakC, m_onlineFitC);
+        m_onlineFittedBins++;
+
+        int pointCount = count909_count.size();
+        if (!fitMergeSpec(spec, m_onlinePeakC, m_onlineFitC) || count909_count.size() == pointCount)
+            continue; //寻峰或剥谱失败，该段能谱没有909keV计数点
+
+        // 衰减曲线斜率固定，c0的最小二乘解为 mean(ln(N)+λt)，逐点累加即可
+        double count = count909_count.last();
+        double time = count909_time.last();
+        if (count > 0)
         {
-            qDebug() << QString("数据点[%1]: 时间=%2 min, 计数=%3, 拟合值=%4, 残差率=%5%").arg(i)
-                        .arg(count909_time.at(i), 0, 'f', 3)
-                        .arg(count909_count.at(i), 0, 'f', 2)
-                        .arg(count909_fitcount.at(i), 0, 'f', 2)
-                        .arg(count909_residual.at(i), 0, 'f', 3);
+            m_decaySum += log(count) + CurveFit::lambda89Zr * time;
+            m_decayPoints++;
+            m_decayFitC0 = m_decaySum / m_decayPoints;
         }
-        qDebug() << "================================================";
     }
 
-    return true;
+    publishSnapshot();
 }
 
 /**
@@ -258,16 +493,17 @@ bool ParseData::getResult(QVector<mergeSpecData> mergeSpec)
  */
 bool ParseData::initial_PeakFind(double* spectrum, double energy_scale[], QVector<fit_result>& fit_c_2, bool* exitflag)
 {
+    TRACE_ZONE("initial_PeakFind");
     for(int e = 0; e<3; e++)
     {
         exitflag[e] = false;
     }
 
     //平滑两次能谱曲线
-    double* spectrum_smooth1 = new double[mCHANNEL2048];
-    double* spectrum_smooth2 = new double[mCHANNEL2048];
-    SysUtils::smooth(spectrum, spectrum_smooth1, mCHANNEL2048, 5);
-    SysUtils::smooth(spectrum_smooth1, spectrum_smooth2, mCHANNEL2048, 5);
+    m_smoothSpectrum.resize(mCHANNEL2048);
+    m_smoothScratch.resize(2*mCHANNEL2048 + 1);
+    double* spectrum_smooth2 = m_smoothSpectrum.data();
+    SysUtils::smoothTwice(spectrum, spectrum_smooth2, m_smoothScratch.data(), mCHANNEL2048, 5);
 
     //搜索峰的能量，keV
     double m_energyCalibration[3] = {511.0, 846.0, 909.0};
@@ -284,83 +520,22 @@ bool ParseData::initial_PeakFind(double* spectrum, double energy_scale[], QVecto
         leftCH = floor(init_peak) - floor(2.0 * sigma[e]);
         rightCH = floor(init_peak) + floor(2.0 * sigma[e]);
 
-        //先对峰位附近划定不同的道址范围进行拟合，每次拟合的高斯项不同
-        QVector<fit_result> fit_result_All; //拟合结果汇总
-        int numPeak = rightCH - leftCH + 1; //待拟合的数目
-
-        for(int peak = leftCH; peak<=rightCH; peak++)
-        {
-            //确定拟合道址范围
-            int start_ch = peak - 3*floor(sigma[e]);
-            int end_ch = peak + 3*floor(sigma[e]);
-
-            //提取拟合数据
-            QVector<QPointF> fitPoints;
-            double maxY = 0.0;
-            //这里需要注意，MATLAB和C++下标对齐问题。能量刻度y=ax+b时，x从1开始
-            for(int i = start_ch-1; i<end_ch; i++)
-            {
-                double xi = (i+1)*1.0;
-                double yi = spectrum_smooth2[i]*1.0;
-                fitPoints.push_back(QPointF(xi,yi));
-                maxY = (maxY > yi) ? maxY:yi;
-            }
+        //候选峰位逐道扫描，以卡方值确定最优高斯峰位
+        fit_result temp_result;
+        bool valid = findPeakCandidate(spectrum_smooth2, mCHANNEL2048, leftCH, rightCH, 3*floor(sigma[e]), sigma[e], temp_result);
 
-            //拟合参数的初值
-            double p[] = {maxY, sigma[e], 10.0, 10.0};
-            double chi_square = 0.0;
-
-            //拟合并给出结果,注意：这里是对未能量刻度前的道址区间进行拟合，或者说拟合结果峰位、sigma都不带能量刻度
-            CurveFit::fit_gauss_linear(fitPoints, p, peak*1.0, &chi_square);
-
-            //提取拟合结果并汇总
-            fit_result tempResult;
-            tempResult.c0 = p[0];
-            tempResult.c1 = peak*1.0;
-            tempResult.c2 = p[1];
-            tempResult.c3 = p[2];
-            tempResult.c4 = p[3];
-            tempResult.chi_square = chi_square;
-            fit_result_All.push_back(tempResult);
-        }
-
-        //根据拟合结果的卡方值来确定最优高斯峰位
-        //1、剔除不符合物理规律的拟合结果。
-        QVector<fit_result> valid_result;
-        QVector<double> valid_chi_square;
-        for(auto tempResult:fit_result_All)
-        {
-            if(tempResult.c0 >0 &&
-                tempResult.c2 <= 1.5*sigma[e] &&
-                tempResult.c2 >= 0.5*sigma[e])
-            {
-                valid_result.push_back(tempResult);
-                valid_chi_square.push_back(tempResult.chi_square);
-            }
-        }
-
-        //全部拟合结果都不满足要求，则退出
-        if(valid_result.size()<1) {
+        //全部候选峰都不满足要求，则退出
+        if(!valid) {
             exitflag[e] = false;
             fit_c_2.push_back(fit_result{0.0, 0.0, 0.0, 0.0, 0.0, 0.0});
             qDebug()<< QString("Failed to found peak. Found peak for the first merge Spectrum, peak psition:%1").arg(m_energyCalibration[e]);
         } else
         {
             exitflag[e] = true;
-            //2、取出卡方值最小组
-            int minIndex = -1;
-            // 获取最小值的迭代器
-            auto minIt = std::min_element(valid_chi_square.begin(), valid_chi_square.end());
-            if (minIt != valid_chi_square.end()) {
-                // double minValue = *minIt;                    // 最小值
-                minIndex = std::distance(valid_chi_square.begin(), minIt); // 下标
-                fit_result temp_result;
-                temp_result = valid_result.at(minIndex);
-                fit_c_2.push_back(temp_result);
-
-                qDebug()<< QString("Sucessful to found peak for the first merge Spectrum, peak position:%1, fit results, c:").arg(m_energyCalibration[e])
-                         <<temp_result.c0<<", "<<temp_result.c1<<", "<<temp_result.c2<<", "<<temp_result.c3<<", "<<temp_result.c4;
-            }
+            fit_c_2.push_back(temp_result);
+
+            qDebug()<< QString("Sucessful to found peak for the first merge Spectrum, peak position:%1, fit results, c:").arg(m_energyCalibration[e])
+                     <<temp_result.c0<<", "<<temp_result.c1<<", "<<temp_result.c2<<", "<<temp_result.c3<<", "<<temp_result.c4;
         }
     }
 
@@ -381,19 +556,18 @@ bool ParseData::initial_PeakFind(double* spectrum, double energy_scale[], QVecto
         int end_ch = temp_result.c1 + 2*temp_result.c2; //峰位+2sigma
 
         //提取拟合数据, 这里需要注意，MATLAB和C++下标对齐问题。能量刻度y=ax+b时，x从1开始
-        QVector<QPointF> fitPoints;
-        for(int i = start_ch-1; i<end_ch; i++)
-        {
-            double xi = (i+1)*1.0;
-            double yi = spectrum_smooth2[i]*1.0;
-            fitPoints.push_back(QPointF(xi,yi));
-        }
+        int num = qMax(0, end_ch - start_ch + 1);
+        QVarLengthArray<double, 256> fitx(num);
+        for(int i = 0; i<num; i++)
+            fitx[i] = (start_ch + i)*1.0;
+        const double* fity = spectrum_smooth2 + (start_ch-1);
 
         //选用上次的拟合结果作为拟合初值
-        double p[5] = {temp_result.c0, temp_result.c1, temp_result.c2, temp_result.c3, temp_result.c4};
+        CurveFit::LM::Params<5> p;
+        p << temp_result.c0, temp_result.c1, temp_result.c2, temp_result.c3, temp_result.c4;
 
         //拟合并给出结果
-        if(CurveFit::fit_gauss_linear2(fitPoints, p)){
+        if(CurveFit::LM::fit(CurveFit::LM::GaussLinear2(), fitx.constData(), fity, num, p)){
             //更新拟合结果
             fit_c_2[e].c0 = p[0];
             fit_c_2[e].c1 = p[1];
@@ -402,28 +576,27 @@ bool ParseData::initial_PeakFind(double* spectrum, double energy_scale[], QVecto
             fit_c_2[e].c4 = p[4];
         }
         else{
-            qDebug()<<"CurveFit::fit_gauss_linear2 failed";
+            qDebug()<<"CurveFit::LM::fit(GaussLinear2) failed";
         }
     }
 
-    delete[] spectrum_smooth1;
-    delete[] spectrum_smooth2;
     return true;
 }
 
 
 bool ParseData::PeakFind(double* spectrum, QVector<fit_result>& init_c, bool* exitflag)
 {
+    TRACE_ZONE("PeakFind");
     for(int e = 0; e<2; e++)
     {
         exitflag[e] = false;
     }
 
     //平滑滤波两次能谱曲线
-    double* spectrum_smooth1 = new double[mCHANNEL2048];
-    double* spectrum_smooth2 = new double[mCHANNEL2048];
-    SysUtils::smooth(spectrum, spectrum_smooth1, mCHANNEL2048, 5);
-    SysUtils::smooth(spectrum_smooth1, spectrum_smooth2, mCHANNEL2048, 5);
+    m_smoothSpectrum.resize(mCHANNEL2048);
+    m_smoothScratch.resize(2*mCHANNEL2048 + 1);
+    double* spectrum_smooth2 = m_smoothSpectrum.data();
+    SysUtils::smoothTwice(spectrum, spectrum_smooth2, m_smoothScratch.data(), mCHANNEL2048, 5);
 
     //峰位的sigma估值，该值根据能量分辨率可以初步估算得到。
     double Width = 15.0;
@@ -438,85 +611,22 @@ bool ParseData::PeakFind(double* spectrum, QVector<fit_result>& init_c, bool* ex
         leftCH = floor(ch_peak - Width);
         rightCH = floor(ch_peak + Width);
 
-        //先对峰位附近划定不同的道址范围进行拟合，每次拟合的高斯项不同
-        QVector<fit_result> fit_result_All; //拟合参数c汇总
-        QVector<double> chi_square_All; //拟合结果的卡方统计量汇总
-        int numPeak = rightCH - leftCH + 1; //待拟合的数目
-
-        for(int peak = leftCH; peak<=rightCH; peak++)
-        {
-            //确定拟合道址范围
-            int start_ch = peak - 2*floor(sigma);
-            int end_ch = peak + 2*floor(sigma);
-
-            //提取拟合数据
-            QVector<QPointF> fitPoints;
-            double maxY = 0.0;
-            //这里需要注意，MATLAB和C++下标对齐问题。能量刻度y=ax+b时，x从1开始
-            for(int i = start_ch-1; i<end_ch; i++)
-            {
-                double xi = (i+1) * 1.0;
-                double yi = spectrum_smooth2[i]*1.0;
-                fitPoints.push_back(QPointF(xi, yi));
-                maxY = (maxY > yi) ? maxY:yi;
-            }
-
-            //拟合参数的初值
-            double p[] = {maxY, sigma, 10.0, 10.0};
-            double chi_square = 0.0;
-
-            //拟合并给出结果
-            CurveFit::fit_gauss_linear(fitPoints, p, peak*1.0, &chi_square);
-
-            //提取拟合结果并汇总
-            fit_result temp_result;
-            temp_result.c0 = p[0];
-            temp_result.c1 = peak*1.0;
-            temp_result.c2 = p[1];
-            temp_result.c3 = p[2];
-            temp_result.c4 = p[3];
-            temp_result.chi_square = chi_square;
-            fit_result_All.push_back(temp_result);
-            chi_square_All.push_back(chi_square);
-        }
-
-        //根据拟合结果的卡方值来确定最优高斯峰位
-        //1、剔除不符合物理规律的拟合结果。
-        QVector<fit_result> valid_result;
-        QVector<double> valid_chi_square;
-        for(auto temp_result:fit_result_All)
-        {
-            if(temp_result.c0 >0 &&
-                temp_result.c2 <= 1.5*sigma &&
-                temp_result.c2 >= 0.5*sigma)
-            {
-                valid_result.push_back(temp_result);
-                valid_chi_square.push_back(temp_result.chi_square);
-            }
-        }
+        //候选峰位逐道扫描，以卡方值确定最优高斯峰位
+        fit_result temp_result;
+        bool valid = findPeakCandidate(spectrum_smooth2, mCHANNEL2048, leftCH, rightCH, 2*floor(sigma), sigma, temp_result);
 
-        //全部拟合结果都不满足要求，则退出
-        if(valid_result.size()<1) {
+        //全部候选峰都不满足要求，则退出
+        if(!valid) {
             exitflag[e] = false;
             fit_c_2.push_back(fit_result{0.0, 0.0, 0.0, 0.0, 0.0, 0.0});
             qDebug()<< QString("Peak position%1, Failed to found peak.").arg(m_energyCalibration[e]);
         }
         else{
             exitflag[e] = true;
-            //2、取出卡方值最小组
-            int minIndex = -1;
-            // 获取最小值的迭代器
-            auto minIt = std::min_element(valid_chi_square.begin(), valid_chi_square.end());
-            if (minIt != valid_chi_square.end()) {
-                // double minValue = *minIt;                    // 最小值
-                minIndex = std::distance(valid_chi_square.begin(), minIt); // 下标
-                fit_result temp_result;
-                temp_result = valid_result.at(minIndex);
-                fit_c_2.push_back(temp_result);
-
-                qDebug()<< QString("Peak position%1, Sucessfulll found peak, fit results c:").arg(m_energyCalibration[e])
-                         <<temp_result.c0<<", "<<temp_result.c1<<", "<<temp_result.c2<<", "<<temp_result.c3<<", "<<temp_result.c4;
-            }
+            fit_c_2.push_back(temp_result);
+
+            qDebug()<< QString("Peak position%1, Sucessfulll found peak, fit results c:").arg(m_energyCalibration[e])
+                     <<temp_result.c0<<", "<<temp_result.c1<<", "<<temp_result.c2<<", "<<temp_result.c3<<", "<<temp_result.c4;
         }
     }
 
@@ -536,21 +646,19 @@ bool ParseData::PeakFind(double* spectrum, QVector<fit_result>& init_c, bool* ex
         int start_ch = temp_result.c1 - 2*temp_result.c2; //峰位-2sigma
         int end_ch = temp_result.c1 + 2*temp_result.c2; //峰位+2sigma
 
-        //提取拟合数据
-        QVector<QPointF> fitPoints;
-        //这里需要注意，MATLAB和C++下标对齐问题。能量刻度y=ax+b时，x从1开始
-        for(int i = start_ch-1; i<end_ch; i++)
-        {
-            double xi = (i+1)*1.0;
-            double yi = spectrum_smooth2[i]*1.0;
-            fitPoints.push_back(QPointF(xi, yi));
-        }
+        //提取拟合数据, 这里需要注意，MATLAB和C++下标对齐问题。能量刻度y=ax+b时，x从1开始
+        int num = qMax(0, end_ch - start_ch + 1);
+        QVarLengthArray<double, 256> fitx(num);
+        for(int i = 0; i<num; i++)
+            fitx[i] = (start_ch + i)*1.0;
+        const double* fity = spectrum_smooth2 + (start_ch-1);
 
         //选用上次的拟合结果作为拟合初值
-        double p[5] = {temp_result.c0, temp_result.c1, temp_result.c2, temp_result.c3, temp_result.c4};
+        CurveFit::LM::Params<5> p;
+        p << temp_result.c0, temp_result.c1, temp_result.c2, temp_result.c3, temp_result.c4;
 
         //拟合并给出结果
-        if(CurveFit::fit_gauss_linear2(fitPoints, p)){
+        if(CurveFit::LM::fit(CurveFit::LM::GaussLinear2(), fitx.constData(), fity, num, p)){
             //更新拟合结果
             fit_c_2[e].c0 = p[0];
             fit_c_2[e].c1 = p[1];
@@ -559,15 +667,13 @@ bool ParseData::PeakFind(double* spectrum, QVector<fit_result>& init_c, bool* ex
             fit_c_2[e].c4 = p[4];
         }
         else{
-            qDebug()<<"CurveFit::fit_gauss_linear2 failed";
+            qDebug()<<"CurveFit::LM::fit(GaussLinear2) failed";
         }
     }
 
     //返回拟合结果
     init_c = fit_c_2;
 
-    delete[] spectrum_smooth1;
-    delete[] spectrum_smooth2;
     return true;
 }
 
@@ -581,25 +687,22 @@ bool ParseData::PeakFind(double* spectrum, QVector<fit_result>& init_c, bool* ex
  */
 bool ParseData::SpecStripping(double* spectrum, double energy_scale[], QVector<double>& init_c, bool* exitflag)
 {
-    std::vector<double> data;
-    for(int i=0; i<mCHANNEL2048; i++){
-        data.push_back(spectrum[i]);
-    }
-
-    // 四次Savitzky-Golay滤波器
-    std::vector<double> newdata = SysUtils::sgolayfilt_matlab_like(data, 3, 13);
-    newdata = SysUtils::sgolayfilt_matlab_like(newdata, 3, 13);
-    newdata = SysUtils::sgolayfilt_matlab_like(newdata, 3, 13);
-    newdata = SysUtils::sgolayfilt_matlab_like(newdata, 3, 13);
-
+    TRACE_ZONE("SpecStripping");
     int ch_count; //待分析的能谱道数
     int leftCH, rightCH;
     leftCH = int(floor((mStripEnRange[0] - energy_scale[1]) / energy_scale[0]));
     rightCH = int(floor((mStripEnRange[1] - energy_scale[1]) / energy_scale[0]));
     ch_count = rightCH - leftCH;
 
+    // 四次Savitzky-Golay滤波器，合成为一次滤波，只计算剥谱范围附近的道址
+    // 峰位确认时峰位±2sigma可能略超出剥谱范围，两侧各多算一段
+    const int margin = 32;
+    int filterFirst = qMax(0, leftCH - margin);
+    int filterLast = qMin(mCHANNEL2048 - 1, rightCH + margin);
+    std::vector<double> newdata(mCHANNEL2048, 0.0);
+    SysUtils::sgolayfilt_repeat(spectrum, mCHANNEL2048, 3, 13, 4, filterFirst, filterLast, newdata.data());
+
     //提取拟合数据
-    QVector<QPointF> fitPoints;
     QVector<double> fitx, fity;
     QVector<double> fity_curve;
     //这里需要注意，MATLAB和C++下标对齐问题。能量刻度y=ax+b时，x从1开始
@@ -607,78 +710,31 @@ bool ParseData::SpecStripping(double* spectrum, double energy_scale[], QVector<d
     {
         double xi = (i+1) * energy_scale[0] + energy_scale[1];
         double yi = newdata[i]*1.0;
-        fitPoints.push_back(QPointF(xi, yi));
         fitx.push_back(xi);
         fity.push_back(yi);
     }
 
-    //拟合并给出结果
-    alglib::real_1d_array c;
+    //拟合并给出结果，选用上次的拟合结果作为峰位、峰宽初值；拟合失败时init_c保持上次的结果
     QVector<double> residual_rate;
     if(exitflag[0]) //存在846峰，采用双高斯拟合
     {
-        //选用上次的拟合结果作为拟合初值
-        double p[11];
-        for(int i=0; i<11; i++)
-        {
-            p[i] = init_c[i];
-        }
-
-        CurveFit::fit_2gauss_ploy4(fitPoints, p, residual_rate);
-
-        //提取拟合结果
-        for(int i=0; i<11; i++)
-        {
-            init_c[i] = p[i];
-        }
-        c.setcontent(11, p);
-
-        //计算拟合曲线y值、残差
-        for(int i=0; i<ch_count; i++)
-        {
-            double x_temp = fitx.at(i);
-            alglib::real_1d_array xData;
-            xData.setlength(1);
-            xData[0] = x_temp;
-            double y;
-            CurveFit::function_2gauss_poly4(c, xData, y, NULL);
-            fity_curve.push_back(y);
-            double residual = fity.at(i) - y; //残差
-            residual = residual/y*100;
+        fity_curve.resize(ch_count);
+        if(!CurveFit::fit_strip(fitx.constData(), fity.constData(), ch_count, init_c.data(), true, mStripMinR2, fity_curve.data())){
+            qDebug()<<"SpecStripping: 双高斯拟合失败";
+            return false;
         }
     }else{
-        //选用上次的拟合结果作为拟合初值
-        double p[8];
-        for(int i=0; i<8; i++)
-        {
-            p[i] = init_c[i+3];
-        }
-
-        CurveFit::fit_gauss_ploy4(fitPoints, p, residual_rate);
-
-        //提取拟合结果
-        for(int i=0; i<8; i++)
-        {
-            init_c[i+3] = p[i];
-        }
-
-        c.setcontent(8, p);
-
-        //计算拟合曲线y值、残差
-        for(int i=0; i<ch_count; i++)
-        {
-            double x_temp = fitx.at(i);
-            alglib::real_1d_array xData;
-            xData.setlength(1);
-            xData[0] = x_temp;
-            double y;
-            CurveFit::function_gauss_poly4(c, xData, y, NULL);
-            fity_curve.push_back(y);
-            double residual = fity.at(i) - y; //残差
-            residual = residual/y*100;
+        fity_curve.resize(ch_count);
+        if(!CurveFit::fit_strip(fitx.constData(), fity.constData(), ch_count, init_c.data() + 3, false, mStripMinR2, fity_curve.data())){
+            qDebug()<<"SpecStripping: 单高斯拟合失败";
+            return false;
         }
     }
 
+    //计算残差
+    residual_rate.resize(ch_count);
+    CurveFit::residual_rate(fity.constData(), fity_curve.constData(), ch_count, residual_rate.data());
+
     //统一参数
     if(!exitflag[0]){
         for(int i=0; i<6; i++)
@@ -692,15 +748,15 @@ bool ParseData::SpecStripping(double* spectrum, double energy_scale[], QVector<d
         double bsl_L_846 = init_c[1] - 2*init_c[2];
         double bsl_R_846 = init_c[1] + 2*init_c[2];
         QVector<double> countRange;
-        for(int i = 0; i<mCHANNEL2048; i++)
+        for(int i = filterFirst; i<=filterLast; i++)
         {
             double energy = (i+1) * energy_scale[0] + energy_scale[1];
             if(energy>=bsl_L_846 && energy<=bsl_R_846){
                 countRange.push_back(newdata[i]*1.0);
             }
         }
-        double ave846 = (countRange.at(0) + countRange.back())*0.5;
-        if(init_c[0] <= sqrt(ave846) + 40)
+        double ave846 = countRange.size() > 0 ? (countRange.at(0) + countRange.back())*0.5 : 0.0;
+        if(countRange.size() == 0 || init_c[0] <= sqrt(ave846) + 40)
         {
             exitflag[0] = false;
             qDebug()<<"846峰值过低，固定参数拟合";
@@ -711,15 +767,15 @@ bool ParseData::SpecStripping(double* spectrum, double energy_scale[], QVector<d
         double bsl_L_909 = init_c[4] - 2*init_c[5];
         double bsl_R_909 = init_c[4] + 2*init_c[5];
         QVector<double> countRange;
-        for(int i = 0; i<mCHANNEL2048; i++)
+        for(int i = filterFirst; i<=filterLast; i++)
         {
             double energy = (i+1) * energy_scale[0] + energy_scale[1];
             if(energy>=bsl_L_909 && energy<=bsl_R_909){
                 countRange.push_back(newdata[i]*1.0);
             }
         }
-        double ave909 = (countRange.at(0) + countRange.back())*0.5;
-        if(init_c[3] <= sqrt(ave909) + 50)
+        double ave909 = countRange.size() > 0 ? (countRange.at(0) + countRange.back())*0.5 : 0.0;
+        if(countRange.size() == 0 || init_c[3] <= sqrt(ave909) + 50)
         {
             exitflag[1] = false;
             qDebug()<<"909峰值过低，固定参数拟合";
@@ -740,46 +796,46 @@ bool ParseData::SpecStripping(double* spectrum, double energy_scale[], QVector<d
 }
 
 /**
- * @brief fit909data 对909全能峰计数随时间的变化拟合出来
- * @return
+ * @brief fit909data 对909全能峰计数随时间的变化拟合出来，只使用计数为正的点（与在线模式的增量拟合一致）
+ * @return 可用的点不足或拟合失败时返回false
  */
 bool ParseData::fit909data()
 {
+    TRACE_ZONE("fit909data");
     count909_fitcount.clear();
     count909_residual.clear();
     int ch_count = count909_count.size();
 
-    //提取拟合数据
+    //提取拟合数据，计数不为正的点无法取对数，不参与拟合
     QVector<QPointF> fitPoints;
-    QVector<double> fitx, fity;
     for(int i=0; i<ch_count; i++)
     {
         double ti = count909_time.at(i);
         double yi = count909_count.at(i);
-        fitPoints.push_back(QPointF(ti, yi));
-        fitx.push_back(ti);
-        fity.push_back(yi);
+        if (yi > 0)
+            fitPoints.push_back(QPointF(ti, log(yi)));
+    }
+    if (fitPoints.size() < 2)
+    {
+        qWarning()<<"909keV计数为正的点不足，无法拟合衰减曲线";
+        return false;
     }
 
     //赋初值，并拟合
     double p = 10.0;
     QVector<double> residual_rate;
-    CurveFit::fit_log(fitPoints, &p, residual_rate);
+    if (!CurveFit::fit_log(fitPoints, &p, residual_rate))
+        return false;
+    m_decayFitC0 = p;
 
-    //计算拟合曲线y值、残差
-    alglib::real_1d_array c;
-    c.setcontent(1, &p);
-    QVector<double> fity_curve;
-    for(int i=0; i<ch_count; i++)
-    {
-        double x_temp = fitx.at(i);
-        alglib::real_1d_array xData;
-        xData.setlength(1);
-        xData[0] = x_temp;
-        double y;
-        CurveFit::function_log(c, xData, y, NULL);
-        fity_curve.push_back(exp(y));
-    }
+    //计算拟合曲线y值、残差，拟合在对数空间进行，曲线取指数；曲线与count909逐点对应
+    QVector<double> fity_curve(ch_count);
+    CurveFit::evaluate_log(&p, count909_time.constData(), ch_count, fity_curve.data());
+    SpectrumKernels::exp(fity_curve.constData(), ch_count, fity_curve.data());
+
+    // fit_log给出的是对数空间的残差，这里换算成计数的残差率，只计算参与拟合的点
+    residual_rate.resize(ch_count);
+    decayResidualRate(count909_count.constData(), fity_curve.constData(), ch_count, residual_rate.data());
 
     count909_fitcount.append(fity_curve);
     count909_residual.append(residual_rate);
@@ -815,6 +871,21 @@ QVector<specStripData> ParseData::GetCount909Data()
 {
     QVector<specStripData> pictureData;
     specStripData tempData;
+
+    // 在线模式只维护衰减拟合参数，拟合曲线和残差在取数据时计算
+    if (m_parasemode == onlineMode)
+    {
+        for(int i=0; i<count909_time.size() && i<count909_count.size(); i++)
+        {
+            tempData.x = count909_time.at(i);
+            tempData.y = count909_count.at(i);
+            tempData.fit_y = exp(m_decayFitC0 - CurveFit::lambda89Zr * tempData.x);
+            tempData.residual_rate = (tempData.y - tempData.fit_y) / tempData.fit_y * 100.0;
+            pictureData.push_back(tempData);
+        }
+        return pictureData;
+    }
+
     for(int i=0; i<count909_time.size() && i<count909_fitcount.size() && i<count909_residual.size(); i++)
     {
         tempData.x = count909_time.at(i);
@@ -835,11 +906,13 @@ void ParseData::clearFitResult()
     count909_count.clear(); //909keV计数，采用峰面积求得
     count909_fitcount.clear(); //909keV计数随时间变化的拟合曲线
     count909_residual.clear(); //残差
+    m_decayFitC0 = 0.0;
 
     specStripData_x.clear(); //拟合数据点x坐标
     specStripData_y.clear(); //拟合数据点y坐标
     specStripData_fity.clear(); //拟合曲线y
     specStripData_residualRate.clear(); //残差
+    specStrip_rightCH.clear();
 }
 
 int ParseData::parseH5File(const QString& filePath, const quint32 detectorId)
@@ -989,7 +1062,7 @@ bool ParseData::processSinglePacket(int headerPos, int nextHeaderPos, paraseMode
     if(!isSpecData(uncodedMsg)) return 0;
 
     totalPackets++;
-    qDebug() << "找到第" << totalPackets << "个数据包, 数据长度:" << uncodedMsg.size();
+    qCDebug(lcPacket) << "找到第" << totalPackets << "个数据包, 数据长度:" << uncodedMsg.size();
     // if (totalPackets % 1000 == 0) {
     // qDebug() << "找到第" << totalPackets << "个数据包, 数据长度:" << uncodedMsg.size();
 
@@ -1159,11 +1232,12 @@ void ParseData::mergeSpecTime_offline(quint64 timeBin, quint64 start_time, quint
     quint32 spectrumNum = (end_time - start_time+1)/timeBin; //整除，给出合并后的能谱个数，对于最后一段时间不满timeBin宽度的能谱直接丢弃。
     if(spectrumNum == 0) return;
 
-    //初始化合并能谱
+    //初始化合并能谱，之前发布的快照仍持有原来的数据块
+    m_mergeSpec.clear();
     m_mergeSpec.resize(spectrumNum);
-    for(auto it = m_mergeSpec.begin(); it!=m_mergeSpec.end(); ++it)
+    for(int i=0; i<m_mergeSpec.size(); i++)
     {
-        it->specTime = timeBin*1000;
+        m_mergeSpec[i].specTime = timeBin*1000;
     }
 
     quint64 spectDeltaT = m_allSpec.at(0).measureTime; //单个能量测量时间，单位ms. 室假设所有的能谱时间间隔都一样，如果不一样需要重新采取其他算法。
@@ -1201,12 +1275,7 @@ void ParseData::mergeSpecTime_offline(quint64 timeBin, quint64 start_time, quint
             //更新合并能谱的数值
             m_mergeSpec[mergeID].currentTime = currentTime;
             m_mergeSpec[mergeID].deathTime += lossTime;
-            for(int i=0; i<mCHANNEL2048; i++)
-            {
-                int ch = i*4;
-                int sum = spec.spectrum[ch] + spec.spectrum[ch+1] + spec.spectrum[ch+2] + spec.spectrum[ch+3];
-                m_mergeSpec[mergeID].spectrum[i] += sum;
-            }
+            SpectrumKernels::rebinAccumulate(spec.spectrum, mCHANNEL8192, 4, m_mergeSpec[mergeID].spectrum);
         }
         lastSpecID = spec.sequence;
     }
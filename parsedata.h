@@ -8,8 +8,14 @@
 #include <cstring>      // 用于内存初始化（如memset）
 #include <QVector>
 #include <QTextStream> // 添加文本流支持
+#include <QMetaType>
+#include <QSharedPointer>
+#include <QMutex>
+#include <atomic>
+#include <functional>
 
 #include "globalsettings.h"
+#include "chunkedvector.h"
 
 // 存放拟合参数值 fit_type = c0*exp(-0.5*pow((x-c1)/c2,2)) + c3*x + c4;
 struct fit_result{
@@ -27,6 +33,10 @@ struct specStripData{
     double fit_y; //拟合曲线y
     double residual_rate; //残差率
 };
+Q_DECLARE_METATYPE(QVector<specStripData>)
+
+struct ParseResultSnapshot;
+typedef QSharedPointer<const ParseResultSnapshot> ParseResultSnapshotPtr;
 
 enum paraseMode{
     offlineMode = 0,
@@ -42,7 +52,7 @@ public:
         qint64 currentTime; //能谱测量结束时刻，打靶时刻为零时刻，早于打靶为负数，单位ms
         quint64 specTime;   //能谱测量对应时长，单位ms
         quint64 deathTime;  //能谱测量死时间，单位ns
-        quint32 spectrum[2048];  // 能谱，将FPGA传输来的8192道压缩为2048道。
+        quint64 spectrum[2048];  // 能谱，将FPGA传输来的8192道压缩为2048道，64位累加防止溢出。
 
         // 1. 默认构造函数：初始化所有成员为默认值，确保spectrum前三道为0
         mergeSpecData()
@@ -57,17 +67,51 @@ public:
     };
     #pragma pack(pop) // 恢复默认对齐
 
+    // 分时能谱、剥谱曲线按块存放，发布快照时只复制块指针，之后的追加不会复制已发布的数据
+    typedef ChunkedVector<mergeSpecData, 16> MergeSpecList;
+    typedef ChunkedVector<double, 4096> StripSeries;
+
 public:
     ParseData();
     ~ParseData();
     
-    QVector<mergeSpecData> GetMergeSpec(){ return m_mergeSpec;}
+    const MergeSpecList& GetMergeSpec() const { return m_mergeSpec;}
+
+    /**
+     * @brief snapshot 获取最近一次发布的解析结果快照，可跨线程读取，快照内容只读
+     * @return 尚未完成解析时返回空指针
+     */
+    ParseResultSnapshotPtr snapshot() const;
 
     //获取剥谱图像数据,给出第i个能谱的剥谱数据，三条曲线数据
     QVector<specStripData> GetStripData(int specID);
 
+    // 已完成剥谱的能谱段数，剥谱失败的分时能谱不计入
+    int GetStripCount() const { return qMax(0, specStrip_rightCH.size() - 1); }
+
     QVector<specStripData> GetCount909Data();
 
+    // 909keV计数衰减拟合结果：ln(N) = c0 - λt，c0为外推至打靶时刻的对数计数
+    double GetDecayFitC0() const { return m_decayFitC0; }
+
+    /**
+     * @brief setInterruptFlag 设置外部中断标志，批量解析时用于在各分时能谱之间响应中断
+     * @param interrupted 中断标志，为true时终止解析
+     */
+    void setInterruptFlag(const std::atomic<bool>* interrupted) { m_interrupted = interrupted; }
+
+    /**
+     * @brief setProgressCallback 设置拟合进度回调，每完成一段分时能谱的拟合调用一次（在解析线程中调用）
+     * @param callback 参数依次为已拟合段数、总段数
+     */
+    void setProgressCallback(std::function<void(int, int)> callback) { m_progressCallback = callback; }
+
+    /**
+     * @brief setStripMinR2 设置剥谱拟合优度下限，拟合优度低于该值的分时能谱不计入909keV计数衰减拟合
+     * @param minR2 拟合优度下限，默认0，即只剔除比常数拟合还差的结果；峰幅度、峰宽、峰位不合理时总是判为失败
+     */
+    void setStripMinR2(double minR2) { mStripMinR2 = minR2; }
+
     /**
      * @brief mergeSpecTime 提取目标时间段能谱数据，根据时间道宽合并能谱，用于离线分析
      * @param timeBin 时间宽度,单位s
@@ -147,21 +191,36 @@ public:
     bool getResult_offline(quint64 timeBin, quint64 start_time, quint64 end_time);
 
 private:
-    bool getResult(QVector<mergeSpecData> mergeSpec);
+    bool getResult(const MergeSpecList& mergeSpec);
+
+    // 发布解析结果快照
+    void publishSnapshot();
+
+    // 对第一段能谱做能量刻度和首次寻峰，给出拟合初值
+    void initialFit(const mergeSpecData& spec, QVector<fit_result>& fit_c_2, QVector<double>& fit_c);
+
+    // 对单个分时能谱拟合，以上一段能谱的拟合参数作为初值
+    bool fitMergeSpec(const mergeSpecData& spec, QVector<fit_result>& fit_c_2, QVector<double>& fit_c);
+
+    // 在线模式：只拟合新完成的分时能谱，增量更新衰减拟合
+    void fitCompletedBins_online(int completedCount);
 
     void clearFitResult();
 
-    QVector<mergeSpecData> m_mergeSpec; //对原始数据汇总后的各时段能谱，对丢包带来的死时间做了相应记录
+    MergeSpecList m_mergeSpec; //对原始数据汇总后的各时段能谱，对丢包带来的死时间做了相应记录
     QVector<H5Spectrum> m_allSpec;// 从HDF5文件中读取到特定通道的所有能谱
 
     QVector<int> allSpecTime; //每一个计数点对应的时刻，考虑到可能丢包，所以时刻并不是连续的。
-    QVector<int> allSpecCount; //每秒能谱总计数随时间的变化
+    QVector<quint64> allSpecCount; //每秒能谱总计数随时间的变化
 
     const double m_energyCalibration[2] = {511.0, 909.0}; //用于能量刻度的特征峰
     const double mStripEnRange[2] = {800.0, 1100.0};//设定剥谱能量范围
+    double mStripMinR2 = 0.0;//剥谱拟合优度下限，低于该值时认为拟合失败，见setStripMinR2
 
     const int mCHANNEL8192 = 8192; //能谱的道数
     const int mCHANNEL2048 = 2048; //做能谱寻峰所用的道数
+    QVector<double> m_smoothSpectrum; //寻峰用的平滑能谱，各次寻峰复用
+    QVector<double> m_smoothScratch; //平滑滤波临时缓冲区
     const int specPackLen = 8237;//2050*4 + 9 +13 + 1 + 3*4+2 %完整数据包的长度（解码后长度），1是包头，9是时间信息以及空白，13是大包的帧内容
     qint32 T0_beforeShot = 0; //能谱开测时刻相对于打靶零时刻的时间（单位s，可正数可负数)T0_beforeShot = 开测时刻 - 打靶时刻
 
@@ -185,13 +244,18 @@ private:
     QVector<double> count909_count; //909keV计数，采用峰面积求得
     QVector<double> count909_fitcount; //909keV计数随时间变化的拟合曲线
     QVector<double> count909_residual; //残差
-
-    QVector<double> specStripData_x; //拟合数据点x坐标
-    QVector<double> specStripData_y; //拟合数据点y坐标
-    QVector<double> specStripData_fity;//拟合曲线y
-    QVector<double> specStripData_residualRate; //残差
-
-    paraseMode m_parasemode;
+    double m_decayFitC0 = 0.0; //909keV计数衰减拟合参数c0
+    ParseResultSnapshotPtr m_snapshot; //最近一次发布的解析结果
+    mutable QMutex m_snapshotMutex;
+    const std::atomic<bool>* m_interrupted = nullptr; //外部中断标志
+    std::function<void(int, int)> m_progressCallback; //拟合进度回调
+
+    StripSeries specStripData_x; //拟合数据点x坐标
+    StripSeries specStripData_y; //拟合数据点y坐标
+    StripSeries specStripData_fity;//拟合曲线y
+    StripSeries specStripData_residualRate; //残差
+
+    paraseMode m_parasemode = offlineMode;
     int shotTime = -1; //记录打靶起始时间，单位ms (FPGA内部时钟，仪器开始测量时为时钟为零)，必须在大靶前开始测量，这样才能找到计数率暴增点（打靶瞬间）
     int lastSpecID_online = 0; //上一个能谱的编号。用于在线处理
     quint64 spectDeltaT = 0; //单个能谱测量时长，单位ms
@@ -199,6 +263,52 @@ private:
     int timeBin_online = 300*60; //解析能谱的时间宽度，单位s.分时能谱的单个能谱测量时间
 
     QVector<int> specStrip_rightCH; //存放所有剥谱图形的右端点下标
+
+    // 在线增量拟合状态
+    int m_onlineFittedBins = 0; //已完成拟合的分时能谱个数
+    QVector<fit_result> m_onlinePeakC; //上一段能谱的寻峰参数
+    QVector<double> m_onlineFitC; //上一段能谱的剥谱参数
+    double m_decaySum = 0.0; //衰减拟合累加量 Σ(ln(N)+λt)
+    int m_decayPoints = 0; //参与衰减拟合的点数
+};
+
+/**
+ * @brief 解析结果快照，由ParseData在解析完成后发布，发布后不再修改。
+ * 各容器与ParseData内部数据共享，界面读取时不做深拷贝。分时能谱、剥谱曲线与ParseData共享数据块，
+ * 在线模式下ParseData只在已发布的元素之后追加、累加，快照只读取各自size()以内的元素。
+ */
+struct ParseResultSnapshot
+{
+    ParseData::MergeSpecList mergeSpec; //已拟合的分时能谱
+
+    // 909keV计数随时间变化
+    QVector<double> count909_time; //单位min
+    QVector<double> count909_count;
+    QVector<double> count909_fitcount;
+    QVector<double> count909_residual;
+    double decayFitC0 = 0.0;
+
+    // 剥谱曲线，各分时能谱依次存放，strip_rightCH给出每一段的右端点下标（首个元素为-1）
+    ParseData::StripSeries strip_x;
+    ParseData::StripSeries strip_y;
+    ParseData::StripSeries strip_fity;
+    ParseData::StripSeries strip_residualRate;
+    QVector<int> strip_rightCH;
+
+    // 剥谱段数
+    int stripCount() const { return strip_rightCH.size() > 0 ? strip_rightCH.size() - 1 : 0; }
+
+    // 第specID段剥谱数据在strip_*中的起始下标和长度
+    bool stripRange(int specID, int& first, int& length) const
+    {
+        if (specID < 0 || specID >= stripCount())
+            return false;
+
+        first = strip_rightCH.at(specID) + 1;
+        length = strip_rightCH.at(specID + 1) - first + 1;
+        return true;
+    }
 };
+Q_DECLARE_METATYPE(ParseResultSnapshotPtr)
 
 #endif // PARSEDATA_H
@@ -1,6 +1,11 @@
 ﻿#include "qhuaweiswitcherhelper.h"
 #include "globalsettings.h"
 #include "QTelnet.h"
+#include <QRegularExpression>
+
+// 批量上电/断电时一批端口（逐口操作时一个端口）的确认超时，以及发起登录到登录成功的超时，ms
+const int poeBatchTimeout = 5000;
+const int poeBatchLoginTimeout = 15000;
 
 QHuaWeiSwitcherHelper::QHuaWeiSwitcherHelper(QString ip, QObject *parent)
     : QObject{parent}
@@ -15,6 +20,15 @@ QHuaWeiSwitcherHelper::QHuaWeiSwitcherHelper(QString ip, QObject *parent)
     connect(mHeartbeatTimer, &QTimer::timeout, this, &QHuaWeiSwitcherHelper::performHeartbeatCheck);
     mWaitingHeartbeatResponse = false;
     mIsReconnecting = false;
+
+    // POE批量上电/断电
+    GlobalSettings settings(CONFIG_FILENAME);
+    mPoeBatchEnabled = settings.value("Switcher/PoeBatch", true).toBool();
+    mPoeBatchDepth = qBound(1, settings.value("Switcher/PipelineDepth", 8).toInt(), DET_NUM);
+    mPoeBatchTimer = new QTimer(this);
+    mPoeBatchTimer->setSingleShot(true);
+    mPoeBatchTimer->setInterval(poeBatchTimeout); // 一批端口5秒内没有全部确认视为失败
+    connect(mPoeBatchTimer, &QTimer::timeout, this, &QHuaWeiSwitcherHelper::onPoeBatchTimeout);
     
     connect(mTelnet, &QTelnet::socketReadyRead,this,[=](const char *data, int size){
         QByteArray rx_current(data, size);
@@ -128,9 +142,24 @@ QHuaWeiSwitcherHelper::QHuaWeiSwitcherHelper(QString ip, QObject *parent)
             startHeartbeatCheck();
 
             QTimer::singleShot(0, this, [=](){
-                mTelnet->sendData(mCurrentCommand.toStdString().c_str(), mCurrentCommand.size());
+                if (mPoeBatchAfterLogin)
+                {
+                    mPoeBatchAfterLogin = false;
+                    mPoeBatchTimer->stop();
+                    if (!startPoeBatch(true, true))
+                        reportPoeBatchFailure(true, "登录后无法开始");
+                }
+                else
+                {
+                    mTelnet->sendData(mCurrentCommand.toStdString().c_str(), mCurrentCommand.size());
+                }
             });
         }
+        // POE批量上电/断电，逐行确认端口结果
+        else if (mPoeBatch.active && mPoeBatch.pipelined && mSwitcherInSystemView)
+        {
+            parsePoeBatchResponse();
+        }
         // 检测心跳响应（只要在等待心跳响应且响应包含 HUAWEI 提示符就认为是心跳响应）
         else if (mWaitingHeartbeatResponse &&
                  (mRespondString.contains("[HUAWEI]") || mRespondString.contains("<HUAWEI>") || mRespondString.contains("display clock\r")))
@@ -214,6 +243,7 @@ QHuaWeiSwitcherHelper::QHuaWeiSwitcherHelper(QString ip, QObject *parent)
                 if (mRespondString.endsWith(switchCmd.toLatin1())){
                     QList<QByteArray> lines = mRespondString.split('\n');
                     mRespondString.clear();
+                    bool powerOk = lines.size() == 2 || (lines.size() == 3 && lines.at(1) == QString("Warning: This port is enabled already."));
                     if (lines.size() == 2){
                         //POE打开成功
                         qint8 index = this->indexOfPort(mCurrentQueryPort);
@@ -235,6 +265,7 @@ QHuaWeiSwitcherHelper::QHuaWeiSwitcherHelper(QString ip, QObject *parent)
 
                     if (mBatchOn){
                         //打开下一个开关
+                        recordLegacyPoeBatchPort(powerOk);
                         this->openNextSwitcherPOEPower();
                     }
                 }
@@ -243,6 +274,7 @@ QHuaWeiSwitcherHelper::QHuaWeiSwitcherHelper(QString ip, QObject *parent)
                 if (mRespondString.endsWith(switchCmd.toLatin1())){
                     QList<QByteArray> lines = mRespondString.split('\n');
                     mRespondString.clear();
+                    bool powerOk = lines.size() == 2 || (lines.size() == 3 && lines.at(1) == QString("Warning: This port is disabled already."));
                     if (lines.size() == 2){
                         //POE关闭成功
                         qint8 index = this->indexOfPort(mCurrentQueryPort);
@@ -264,6 +296,7 @@ QHuaWeiSwitcherHelper::QHuaWeiSwitcherHelper(QString ip, QObject *parent)
 
                     if (mBatchOff){
                         //关闭下一个开关
+                        recordLegacyPoeBatchPort(powerOk);
                         this->closeNextSwitcherPOEPower();
                     }
                 }
@@ -299,12 +332,21 @@ QHuaWeiSwitcherHelper::QHuaWeiSwitcherHelper(QString ip, QObject *parent)
         stopHeartbeatCheck();  // 停止心跳检测
         qDebug().noquote() << "交换机[" << mIp << "]连接错误，错误码：" << socketError;
         emit switcherDisconnected(mIp);
+
+        if (mPoeBatchAfterLogin)
+        {
+            mPoeBatchAfterLogin = false;
+            mPoeBatchTimer->stop();
+            reportPoeBatchFailure(true, "连接失败");
+        }
     });
     
     // 监听连接状态变化，在断开时停止心跳检测
     connect(mTelnet, &QTelnet::stateChanged, this, [=](QAbstractSocket::SocketState socketState){
         if (socketState == QAbstractSocket::UnconnectedState) {
             stopHeartbeatCheck();
+            if (mPoeBatch.active)
+                finishPoeBatch(true);
             qDebug().noquote() << "交换机[" << mIp << "]连接断开[QTelnet::stateChanged]";
             mSwitcherIsLoginOk = false;
             mSwitcherInSystemView = false;
@@ -372,6 +414,7 @@ void QHuaWeiSwitcherHelper::queryPowerStatus()
     mSingleOn = false;
     mBatchOff = false;
     mSingleOff = false;
+    mPoeBatchAfterLogin = false;
     quint8 fromPort = 1;
     quint8 toPort = DET_NUM;
 
@@ -380,7 +423,7 @@ void QHuaWeiSwitcherHelper::queryPowerStatus()
     mCurrentCommand = "display poe power-state interface GigabitEthernet0/0/1\r";
     mTelnet->disconnectFromHost();
     mTelnet->setType(QTelnet::TCP);
-    if (mTelnet->connectToHost(mIp, 23)){
+    if (mTelnet->connectToHost(mIp, mPort)){
         emit switcherConnected(mIp);
     }
     else
@@ -401,21 +444,28 @@ void QHuaWeiSwitcherHelper::forceOpenPower()
     //开机仅查询POE供电
     mCurrentQueryPort = 1;
     mCurrentCommand = QString("interface GigabitEthernet 0/0/%1").arg(mCurrentQueryPort) + "\r";
-    if (mTelnet->isConnected())
+    if (mTelnet->isConnected() && mSwitcherInSystemView)
     {
-        restartHeartbeatCheck();
-        mTelnet->sendData(mCurrentCommand.toStdString().c_str(), mCurrentCommand.size());
+        if (!startPoeBatch(true))
+            reportPoeBatchFailure(true, "正在进行其它批量操作");
     }
     else
     {
+        // 登录后开始批量上电，耗时从此刻算起；登录超时或连接失败时计为失败
+        mPoeBatchAfterLogin = true;
+        mPoeBatch.elapsed.start();
+        mPoeBatchTimer->start(poeBatchLoginTimeout);
         mTelnet->disconnectFromHost();
         mTelnet->setType(QTelnet::TCP);
-        if (mTelnet->connectToHost(mIp, 23)){
+        if (mTelnet->connectToHost(mIp, mPort)){
             emit switcherConnected(mIp);
         }
         else
         {
             //emit switcherDisconnected(mIp);
+            mPoeBatchAfterLogin = false;
+            mPoeBatchTimer->stop();
+            reportPoeBatchFailure(true, "连接失败");
         }
     }
 }
@@ -437,6 +487,9 @@ bool QHuaWeiSwitcherHelper::openSwitcherPOEPower(quint8 port/* = 0*/)
     mSingleOff = false;
     mDisconnect = false;
 
+    if (port == 0)
+        return startPoeBatch(true);
+
     restartHeartbeatCheck();
     mCurrentQueryPort = port==0 ? 1 : port;
     mCurrentCommand = QString("interface GigabitEthernet 0/0/%1").arg(mCurrentQueryPort) + "\r";
@@ -448,7 +501,13 @@ bool QHuaWeiSwitcherHelper::openSwitcherPOEPower(quint8 port/* = 0*/)
 void QHuaWeiSwitcherHelper::openNextSwitcherPOEPower()
 {
     if (mCurrentQueryPort >= DET_NUM)
+    {
+        // 逐口批量上电结束
+        if (mPoeBatch.active && !mPoeBatch.pipelined)
+            finishPoeBatch(false);
+
         return;
+    }
 
     restartHeartbeatCheck();
     mCurrentQueryPort++;
@@ -481,6 +540,9 @@ bool QHuaWeiSwitcherHelper::closeSwitcherPOEPower(quint8 port/* = 0*/, bool disc
     mBatchOff = port == 00 ? true : false;
     mSingleOff = port == 00 ? false : true;
 
+    if (port == 0)
+        return startPoeBatch(false);
+
     restartHeartbeatCheck();
     mCurrentQueryPort = port==0 ? 1 : port;
     mCurrentCommand = QString("interface GigabitEthernet 0/0/%1").arg(mCurrentQueryPort) + "\r";
@@ -493,18 +555,11 @@ void QHuaWeiSwitcherHelper::closeNextSwitcherPOEPower()
 {
     if (mCurrentQueryPort >= DET_NUM)
     {
-        // 已经关闭了所有POE供电口
-        if (mDisconnect)
-        {
-            mTelnet->disconnectFromHost();
-            mIsLoggingOut = false;
-            mLogoutStep = 0;
-            mSwitcherIsLoginOk = false;
-            mSwitcherInSystemView = false;
-            mSwitcherIsBusy = false;
-            mRespondString.clear();
-            emit switcherDisconnected(mIp);
-        }
+        // 已经关闭了所有POE供电口，逐口批量断电时由finishPoeBatch按需断开连接
+        if (mPoeBatch.active && !mPoeBatch.pipelined)
+            finishPoeBatch(false);
+        else if (mDisconnect)
+            disconnectAfterPowerOff();
 
         return;
     }
@@ -515,6 +570,281 @@ void QHuaWeiSwitcherHelper::closeNextSwitcherPOEPower()
     mTelnet->sendData(mCurrentCommand.toStdString().c_str(), mCurrentCommand.size());
 }
 
+void QHuaWeiSwitcherHelper::disconnectAfterPowerOff()
+{
+    mTelnet->disconnectFromHost();
+    mIsLoggingOut = false;
+    mLogoutStep = 0;
+    mSwitcherIsLoginOk = false;
+    mSwitcherInSystemView = false;
+    mSwitcherIsBusy = false;
+    mRespondString.clear();
+    emit switcherDisconnected(mIp);
+}
+
+/*
+ 开始批量上电/断电，配置为逐口操作时从1号端口开始逐口发送，结果同样计入mPoeBatch
+ 流水线方式下每个端口发送 interface GigabitEthernet 0/0/N、(undo) poe enable 两条指令，接口视图下可直接进入下一个接口，
+ 一次连续发送mPoeBatchDepth个端口，最后发一条quit回到系统视图，不等待每条指令的提示符
+*/
+bool QHuaWeiSwitcherHelper::startPoeBatch(bool on, bool afterLogin/* = false*/)
+{
+    if (mPoeBatch.active)
+        return false;
+    if (nullptr == mTelnet || !mTelnet->isConnected() || !mSwitcherInSystemView)
+        return false;
+
+    mPoeBatch.active = true;
+    mPoeBatch.pipelined = mPoeBatchEnabled;
+    mPoeBatch.on = on;
+    mPoeBatch.ports.clear();
+    for (quint8 port = 1; port <= DET_NUM; ++port)
+        mPoeBatch.ports.push_back(port);
+    mPoeBatch.sent = 0;
+    mPoeBatch.okCount = 0;
+    mPoeBatch.failCount = 0;
+    mPoeBatch.pendingPort = -1;
+    mPoeBatch.pendingError = false;
+    if (!afterLogin || !mPoeBatch.elapsed.isValid())
+        mPoeBatch.elapsed.start();
+
+    if (!mPoeBatch.pipelined)
+    {
+        // 逐口操作，由应答驱动下一个端口，每个端口的确认超时同样由mPoeBatchTimer计时
+        restartHeartbeatCheck();
+        mCurrentQueryPort = 1;
+        mCurrentCommand = QString("interface GigabitEthernet 0/0/%1").arg(mCurrentQueryPort) + "\r";
+        mTelnet->sendData(mCurrentCommand.toStdString().c_str(), mCurrentCommand.size());
+        mPoeBatchTimer->start(poeBatchTimeout);
+        return true;
+    }
+
+    // 批量操作期间暂停心跳命令，避免回显交错
+    mSwitcherIsBusy = true;
+    restartHeartbeatCheck();
+    mRespondString.clear();
+    mCurrentCommand.clear();
+    sendPoeBatchCommands();
+    return true;
+}
+
+void QHuaWeiSwitcherHelper::sendPoeBatchCommands()
+{
+    QString commands;
+    int count = qMin(mPoeBatchDepth, mPoeBatch.ports.size() - mPoeBatch.sent);
+    for (int i = 0; i < count; ++i)
+    {
+        quint8 port = mPoeBatch.ports.at(mPoeBatch.sent++);
+        commands += QString("interface GigabitEthernet 0/0/%1\r").arg(port);
+        commands += mPoeBatch.on ? "poe enable\r" : "undo poe enable\r";
+    }
+
+    if (!commands.isEmpty())
+    {
+        commands += "quit\r";
+        mPoeBatch.pendingPort = -1;
+        mPoeBatch.pendingError = false;
+        mTelnet->sendData(commands.toStdString().c_str(), commands.size());
+        mPoeBatchTimer->start(poeBatchTimeout);
+    }
+}
+
+/*
+ 逐行解析批量指令的回显：
+ [HUAWEI]interface GigabitEthernet 0/0/1
+ [HUAWEI-GigabitEthernet0/0/1]poe enable
+ Warning: This port is enabled already.
+ [HUAWEI-GigabitEthernet0/0/1]interface GigabitEthernet 0/0/2
+ [HUAWEI-GigabitEthernet0/0/2]poe enable
+ [HUAWEI-GigabitEthernet0/0/2]quit
+ 以 (undo) poe enable 的回显开始一个端口，到下一个提示符行结束，期间出现 Error 行则该端口失败；
+ 应答丢失、没有回显的端口在之后的端口回显或本批的quit回显到达时视为失败
+*/
+void QHuaWeiSwitcherHelper::parsePoeBatchResponse()
+{
+    // 只处理完整的行，最后一个换行之后的内容留到下次
+    int end = mRespondString.lastIndexOf('\n');
+    if (end < 0)
+        return;
+
+    QByteArray complete = mRespondString.left(end + 1);
+    mRespondString.remove(0, end + 1);
+
+    static const QRegularExpression poeLine("^\\[HUAWEI-GigabitEthernet0/0/(\\d+)\\](undo )?poe enable$");
+    static const QRegularExpression quitLine("^\\[HUAWEI[^\\]]*\\]quit$");
+    QList<QByteArray> lines = complete.split('\n');
+    for (QByteArray line : lines)
+    {
+        line = line.trimmed();
+        if (line.isEmpty())
+            continue;
+
+        QString text = QString::fromLatin1(line);
+        QRegularExpressionMatch match = poeLine.match(text);
+        if (match.hasMatch())
+        {
+            confirmPoeBatchPort();
+
+            // 只接受本批中尚未确认的端口，之前没有回显的端口视为失败
+            int resolved = mPoeBatch.okCount + mPoeBatch.failCount;
+            int position = mPoeBatch.ports.indexOf(quint8(match.captured(1).toInt()), resolved);
+            if (position >= 0 && position < mPoeBatch.sent)
+            {
+                failPoeBatchPorts(position);
+                mPoeBatch.pendingPort = qint8(mPoeBatch.ports.at(position));
+                mPoeBatch.pendingError = false;
+            }
+        }
+        else if (line.startsWith("Error"))
+        {
+            mPoeBatch.pendingError = true;
+        }
+        else if (quitLine.match(text).hasMatch())
+        {
+            confirmPoeBatchPort();
+            finishPoeBatchChunk(line.startsWith("[HUAWEI]"));
+        }
+        else if (line.startsWith("[HUAWEI"))
+        {
+            confirmPoeBatchPort();
+        }
+
+        if (!mPoeBatch.active)
+            return;
+    }
+}
+
+void QHuaWeiSwitcherHelper::confirmPoeBatchPort()
+{
+    if (mPoeBatch.pendingPort < 0)
+        return;
+
+    quint8 port = quint8(mPoeBatch.pendingPort);
+    mPoeBatch.pendingPort = -1;
+    if (mPoeBatch.pendingError)
+    {
+        mPoeBatch.failCount++;
+        qWarning().noquote() << "交换机[" << mIp << "]POE端口" << int(port) << (mPoeBatch.on ? "上电" : "断电") << "失败";
+    }
+    else
+    {
+        mPoeBatch.okCount++;
+        qint8 index = this->indexOfPort(port);
+        if (index > 0)
+            QMetaObject::invokeMethod(this, "reportPoePowerStatus", Qt::QueuedConnection, Q_ARG(quint8, index), Q_ARG(bool, mPoeBatch.on));
+    }
+}
+
+void QHuaWeiSwitcherHelper::failPoeBatchPorts(int end)
+{
+    for (int i = mPoeBatch.okCount + mPoeBatch.failCount; i < end; ++i)
+    {
+        mPoeBatch.failCount++;
+        qWarning().noquote() << "交换机[" << mIp << "]POE端口" << int(mPoeBatch.ports.at(i)) << (mPoeBatch.on ? "上电" : "断电") << "无应答";
+    }
+}
+
+void QHuaWeiSwitcherHelper::finishPoeBatchChunk(bool inUserView)
+{
+    // 本批的quit已执行，本批中仍未确认的端口视为失败，然后发送下一批
+    failPoeBatchPorts(mPoeBatch.sent);
+
+    // 本批没有进入任何接口视图时，quit从系统视图退回了<HUAWEI>，需要重新进入系统视图
+    if (inUserView)
+    {
+        QString cmd = "system-view\r";
+        mTelnet->sendData(cmd.toStdString().c_str(), cmd.size());
+    }
+    if (mPoeBatch.sent >= mPoeBatch.ports.size())
+        finishPoeBatch(false);
+    else
+        sendPoeBatchCommands();
+}
+
+void QHuaWeiSwitcherHelper::recordLegacyPoeBatchPort(bool ok)
+{
+    if (!mPoeBatch.active || mPoeBatch.pipelined)
+        return;
+
+    if (ok)
+    {
+        mPoeBatch.okCount++;
+    }
+    else
+    {
+        mPoeBatch.failCount++;
+        qWarning().noquote() << "交换机[" << mIp << "]POE端口" << int(mCurrentQueryPort) << (mPoeBatch.on ? "上电" : "断电") << "失败";
+    }
+    mPoeBatch.sent = mPoeBatch.okCount + mPoeBatch.failCount;
+    mPoeBatchTimer->start(poeBatchTimeout);
+}
+
+void QHuaWeiSwitcherHelper::reportPoeBatchFailure(bool on, const QString &reason)
+{
+    qint64 elapsedMs = mPoeBatch.elapsed.isValid() ? mPoeBatch.elapsed.elapsed() : 0;
+    mPoeBatch.elapsed.invalidate();
+    qWarning().noquote() << QString("交换机[%1]POE批量%2失败：%3").arg(mIp).arg(on ? "上电" : "断电").arg(reason);
+    emit poeBatchFinished(mIp, on, 0, DET_NUM, elapsedMs);
+}
+
+void QHuaWeiSwitcherHelper::onPoeBatchTimeout()
+{
+    if (mPoeBatchAfterLogin)
+    {
+        mPoeBatchAfterLogin = false;
+        reportPoeBatchFailure(true, "登录超时");
+        return;
+    }
+
+    if (!mPoeBatch.active)
+        return;
+
+    // 逐口操作时当前端口没有应答，后续端口由应答驱动，无法继续
+    if (!mPoeBatch.pipelined)
+    {
+        finishPoeBatch(true);
+        return;
+    }
+
+    // 本批超时，未确认的端口视为失败，剩余端口照常发送；最后一批超时则结束
+    qWarning().noquote() << "交换机[" << mIp << "]POE批量" << (mPoeBatch.on ? "上电" : "断电") << "本批应答超时";
+    mPoeBatch.pendingPort = -1;
+    failPoeBatchPorts(mPoeBatch.sent);
+    mRespondString.clear();
+    if (mPoeBatch.sent >= mPoeBatch.ports.size())
+        finishPoeBatch(true);
+    else
+        sendPoeBatchCommands();
+}
+
+void QHuaWeiSwitcherHelper::finishPoeBatch(bool timeout)
+{
+    if (!mPoeBatch.active)
+        return;
+
+    mPoeBatchTimer->stop();
+    mPoeBatch.active = false;
+    mSwitcherIsBusy = false;
+    mRespondString.clear();
+
+    // 超时未确认的端口视为失败
+    int unconfirmed = mPoeBatch.ports.size() - mPoeBatch.okCount - mPoeBatch.failCount;
+    if (timeout && unconfirmed > 0)
+    {
+        mPoeBatch.failCount += unconfirmed;
+        qWarning().noquote() << "交换机[" << mIp << "]POE批量" << (mPoeBatch.on ? "上电" : "断电") << "超时，" << unconfirmed << "个端口未确认";
+    }
+
+    qint64 elapsedMs = mPoeBatch.elapsed.isValid() ? mPoeBatch.elapsed.elapsed() : 0;
+    mPoeBatch.elapsed.invalidate();
+    qInfo().noquote() << QString("交换机[%1]POE批量%2完成，成功%3个，失败%4个，耗时%5ms")
+                         .arg(mIp).arg(mPoeBatch.on ? "上电" : "断电").arg(mPoeBatch.okCount).arg(mPoeBatch.failCount).arg(elapsedMs);
+    emit poeBatchFinished(mIp, mPoeBatch.on, mPoeBatch.okCount, mPoeBatch.failCount, elapsedMs);
+
+    if (!mPoeBatch.on && mDisconnect && mTelnet->isConnected())
+        disconnectAfterPowerOff();
+}
+
 //是否仍然处于登录状态
 void QHuaWeiSwitcherHelper::checkLoginAlive()
 {
@@ -619,7 +949,7 @@ void QHuaWeiSwitcherHelper::reconnectSwitcher()
     // 延迟一下再重连，避免立即重连失败
     QTimer::singleShot(2000, this, [=](){
         mTelnet->setType(QTelnet::TCP);
-        if (mTelnet->connectToHost(mIp, 23)) {
+        if (mTelnet->connectToHost(mIp, mPort)) {
             qInfo().noquote() << "交换机[" << mIp << "]重连请求已发送";
         } else {
             qWarning().noquote() << "交换机[" << mIp << "]重连失败，将在下次心跳检测时重试";
@@ -25,6 +25,11 @@ public:
         return mIp;
     }
 
+    //Telnet端口，默认23，连接本地交换机模拟器时使用其它端口
+    void setPort(quint16 port){
+        mPort = port;
+    }
+
     //判断谱仪编号是否存在
     bool contains(quint8 index);
 
@@ -75,6 +80,11 @@ public:
     Q_SIGNAL void switcherConnected(QString);//交换机连接
     Q_SIGNAL void switcherDisconnected(QString);//交换机断开
     Q_SIGNAL void reportPoePowerStatus(quint8, bool); //POE电源开关
+    /*
+     批量上电/断电结束
+     on 上电还是断电，okCount/failCount 确认成功/失败的端口数，elapsedMs 从发起（含登录）到全部端口确认的耗时
+    */
+    Q_SIGNAL void poeBatchFinished(QString ip, bool on, int okCount, int failCount, qint64 elapsedMs);
 
 signals:
 
@@ -84,6 +94,7 @@ private:
     // QTimer *mStatusRefreshTimer = nullptr;//状态定时刷新时钟
     QTimer *mHeartbeatTimer = nullptr;//心跳检测定时器
     QString mIp;
+    quint16 mPort = 23;
     QEventLoop mSwitcherEventLoop;
     quint8 mCurrentQueryPort = 0;
     bool mSwitcherIsBusy = false;
@@ -115,6 +126,44 @@ private:
     // 退出登录相关
     bool mIsLoggingOut = false;
     quint8 mLogoutStep = 0; // 0=未退出, 1=已发第一条 quit, 2=已发第二条 quit
+
+    // 全部断电后按需断开连接
+    void disconnectAfterPowerOff();
+
+    /*
+     POE批量上电/断电：不再逐口等待提示符，而是每次连续发送若干个端口的
+     interface/poe enable 指令（流水线，端口之间在接口视图下直接切换），每批最后发一条quit，
+     再从回显中逐口确认结果；配置项 Switcher/PoeBatch=false 时仍按原来的方式逐口操作，同样统计结果。
+     每次批量操作（包括登录失败、无法开始的情况）都以一次poeBatchFinished结束
+    */
+    struct PoeBatch {
+        bool active = false;
+        bool pipelined = true;      // false为逐口操作
+        bool on = true;
+        QVector<quint8> ports;      // 待操作的端口
+        int sent = 0;               // 已发送指令的端口数
+        int okCount = 0;            // 确认成功的端口数
+        int failCount = 0;          // 确认失败的端口数，端口按发送顺序确认，前okCount+failCount个已有结果
+        qint8 pendingPort = -1;     // 等待确认的端口
+        bool pendingError = false;  // 等待确认的端口是否返回了错误
+        QElapsedTimer elapsed;      // 从发起（含登录）开始计时
+    };
+    PoeBatch mPoeBatch;
+    bool mPoeBatchEnabled = true;
+    int mPoeBatchDepth = 8;         // 每次连续发送的端口数
+    bool mPoeBatchAfterLogin = false;// 登录后开始批量上电
+    QTimer *mPoeBatchTimer = nullptr;// 确认超时
+
+    bool startPoeBatch(bool on, bool afterLogin = false); // afterLogin 耗时从发起登录时算起；正在批量操作或未登录时返回false
+    void recordLegacyPoeBatchPort(bool ok);     // 逐口操作时记录一个端口的结果
+    void reportPoeBatchFailure(bool on, const QString& reason); // 批量操作无法开始，全部端口计为失败
+    void sendPoeBatchCommands();
+    void parsePoeBatchResponse();
+    void confirmPoeBatchPort();
+    void failPoeBatchPorts(int end);  // 发送顺序在end之前、仍未确认的端口视为失败
+    void finishPoeBatchChunk(bool inUserView); // 一批的quit回显到达，本批结束；inUserView为quit是否退回了用户视图
+    void onPoeBatchTimeout();
+    void finishPoeBatch(bool timeout);
 };
 
 #endif // QHUAWEISWITCHERHELPER_H
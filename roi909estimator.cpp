@@ -0,0 +1,137 @@
+#include "roi909estimator.h"
+#include "spectrumkernels.h"
+#include <QtMath>
+
+// 能量窗，单位keV。左侧本底区避开846keV峰的主体，峰区约为909keV峰的±2σ
+const double peakWindow[2] = {885.0, 935.0};
+const double leftWindow[2] = {865.0, 880.0};
+const double rightWindow[2] = {940.0, 955.0};
+
+// 能谱道数，道址区间按此裁剪
+const int spectrumChannels = 8192;
+
+// 默认能量刻度，与ParseData::initialFit中2048道的初始刻度（1.272keV/道，-26.87keV，道址从1开始）一致，换算到8192道
+const double defaultScaleK = 1.272 / 4;
+const double defaultScaleB = -26.87 + 1.272;
+
+Roi909Estimator::Roi909Estimator()
+{
+    mScaleK = defaultScaleK;
+    mScaleB = defaultScaleB;
+    mPeak = channelRegion(peakWindow[0], peakWindow[1]);
+    mLeft = channelRegion(leftWindow[0], leftWindow[1]);
+    mRight = channelRegion(rightWindow[0], rightWindow[1]);
+}
+
+void Roi909Estimator::setEnergyScale(double k, double b)
+{
+    if (k > 0)
+    {
+        mScaleK = k;
+        mScaleB = b;
+    }
+    else
+    {
+        mScaleK = defaultScaleK;
+        mScaleB = defaultScaleB;
+    }
+
+    mPeak = channelRegion(peakWindow[0], peakWindow[1]);
+    mLeft = channelRegion(leftWindow[0], leftWindow[1]);
+    mRight = channelRegion(rightWindow[0], rightWindow[1]);
+    mConfigured = true;
+    reset();
+}
+
+void Roi909Estimator::reset()
+{
+    mTotal = Sums();
+    mInterval = Sums();
+    mLastSequence = 0;
+    mHasLastSequence = false;
+}
+
+Roi909Estimator::Region Roi909Estimator::channelRegion(double energyLow, double energyHigh) const
+{
+    // 裁剪到能谱道址范围内，累加计数和估计本底都使用裁剪后的区间，完全超出时宽度为0
+    Region region;
+    region.first = qMax(0, qCeil((energyLow - mScaleB) / mScaleK));
+    region.last = qMin(spectrumChannels - 1, qFloor((energyHigh - mScaleB) / mScaleK));
+    if (region.last < region.first)
+        region.last = region.first - 1;
+    return region;
+}
+
+void Roi909Estimator::addSpectrum(const quint32* spectrum, int channels, quint32 sequence, quint32 measureTime, quint32 deathTime)
+{
+    if (channels < spectrumChannels)
+        return;
+
+    auto regionCount = [=](const Region& region) -> quint64 {
+        return region.width() > 0 ? SpectrumKernels::totalCount(spectrum + region.first, region.width()) : 0;
+    };
+
+    quint64 peak = regionCount(mPeak);
+    quint64 left = regionCount(mLeft);
+    quint64 right = regionCount(mRight);
+
+    // 与ParseData::mergeSpecTime_online一致，丢失的能谱计为死时间
+    quint64 lostSpectra = 0;
+    if (mHasLastSequence && sequence > mLastSequence)
+        lostSpectra = sequence - mLastSequence - 1;
+    mLastSequence = sequence;
+    mHasLastSequence = true;
+
+    quint64 realTime = (lostSpectra + 1) * measureTime;                          // ms
+    quint64 lossTime = lostSpectra * measureTime * 1000000 + deathTime * 10ull;  // ns
+
+    for (Sums* sums : {&mTotal, &mInterval})
+    {
+        sums->peak += peak;
+        sums->left += left;
+        sums->right += right;
+        sums->realTime += realTime;
+        sums->deathTime += lossTime;
+    }
+}
+
+bool Roi909Estimator::takeSample(Sample& sample)
+{
+    if (mInterval.realTime == 0)
+        return false;
+
+    sample = estimate(mInterval);
+    mInterval = Sums();
+    return true;
+}
+
+Roi909Estimator::Sample Roi909Estimator::estimate(const Sums& sums) const
+{
+    Sample sample;
+    if (sums.realTime == 0)
+        return sample;
+
+    // 线性本底：两侧本底区平均道计数的均值乘以峰区宽度
+    double background = 0.0;
+    int bands = 0;
+    if (mLeft.width() > 0)
+    {
+        background += sums.left * 1.0 / mLeft.width();
+        bands++;
+    }
+    if (mRight.width() > 0)
+    {
+        background += sums.right * 1.0 / mRight.width();
+        bands++;
+    }
+    if (bands > 0)
+        background = background / bands * mPeak.width();
+
+    // 死时间修正与ParseData::fitMergeSpec一致：peakCount/(1-deathRatio)
+    sample.realTime = sums.realTime / 1000.0;
+    sample.deathRatio = sums.deathTime / 1.0e6 / sums.realTime;
+    double liveRatio = 1.0 - sample.deathRatio;
+    sample.netCounts = liveRatio > 0.0 ? (sums.peak - background) / liveRatio : 0.0;
+    sample.netRate = sample.netCounts / sample.realTime;
+    return sample;
+}
@@ -0,0 +1,97 @@
+/*
+ * @Author: MrPan
+ * @Date: 2026-02-07 09:32:15
+ * @LastEditors: Maoxiaoqing
+ * @LastEditTime: 2026-02-07 09:32:15
+ * @Description: 909keV全能峰ROI净面积流式估计。每收到一个能谱只累加909keV峰区和左右本底区的计数，
+ *               本底取两侧本底区的平均道计数，死时间修正与ParseData::getResult一致，用于在线趋势显示。
+ *               准确的峰面积仍以分时能谱的剥谱拟合结果为准。
+ */
+#ifndef ROI909ESTIMATOR_H
+#define ROI909ESTIMATOR_H
+
+#include <QtGlobal>
+
+class Roi909Estimator
+{
+public:
+    // 道址区间[first, last]，8192道下标，已裁剪到能谱道址范围内
+    struct Region{
+        int first = 0;
+        int last = -1;
+        int width() const { return last - first + 1; }
+    };
+
+    // 一段时间内的净面积估计
+    struct Sample{
+        double netCounts = 0.0;  //净计数，已做死时间修正
+        double netRate = 0.0;    //净计数率，单位cps
+        double deathRatio = 0.0; //死时间比例（含丢包）
+        double realTime = 0.0;   //对应的测量时长，单位s
+    };
+
+    Roi909Estimator();
+
+    /**
+     * @brief setEnergyScale 设置能量刻度 E = k*ch + b，按能量窗计算峰区和本底区的道址
+     * @param k 能量刻度斜率，keV/道
+     * @param b 能量刻度截距，keV
+     */
+    void setEnergyScale(double k, double b);
+
+    // 是否已设置能量刻度
+    bool isConfigured() const { return mConfigured; }
+
+    // 清空累加量，道址区间不变
+    void reset();
+
+    /**
+     * @brief addSpectrum 累加一个能谱，耗时只与ROI宽度有关
+     * @param spectrum 能谱
+     * @param channels 能谱道数，不足8192道时忽略该能谱
+     * @param sequence 能谱序号，用于统计丢包
+     * @param measureTime 单个能谱测量时长，单位ms
+     * @param deathTime 死时间，单位*10ns
+     */
+    void addSpectrum(const quint32* spectrum, int channels, quint32 sequence, quint32 measureTime, quint32 deathTime);
+
+    /**
+     * @brief takeSample 给出上次取样以来的净面积估计，并开始新的取样区间
+     * @return 区间内没有数据时返回false
+     */
+    bool takeSample(Sample& sample);
+
+    // 测量开始以来的累积净面积，已做死时间修正
+    Sample total() const { return estimate(mTotal); }
+
+    const Region& peakRegion() const { return mPeak; }
+    const Region& leftRegion() const { return mLeft; }
+    const Region& rightRegion() const { return mRight; }
+
+private:
+    struct Sums{
+        quint64 peak = 0;      //峰区总计数
+        quint64 left = 0;      //左侧本底区总计数
+        quint64 right = 0;     //右侧本底区总计数
+        quint64 realTime = 0;  //测量时长，单位ms
+        quint64 deathTime = 0; //死时间（含丢包），单位ns
+    };
+
+    Sample estimate(const Sums& sums) const;
+    Region channelRegion(double energyLow, double energyHigh) const;
+
+    double mScaleK;
+    double mScaleB;
+    bool mConfigured = false;
+
+    Region mPeak;
+    Region mLeft;
+    Region mRight;
+
+    Sums mTotal;     //测量开始以来的累加量
+    Sums mInterval;  //当前取样区间的累加量
+    quint32 mLastSequence = 0;
+    bool mHasLastSequence = false;
+};
+
+#endif // ROI909ESTIMATOR_H
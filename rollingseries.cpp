@@ -0,0 +1,193 @@
+#include "rollingseries.h"
+#include "qcustomplot.h"
+
+RollingSeries::RollingSeries(int window, int archiveBlock, int archiveCapacity)
+    : mWindow(qMax(1, window))
+    , mArchiveBlock(qMax(1, archiveBlock))
+    , mArchiveCapacity(qMax(4, archiveCapacity))
+{
+    mRing.resize(mWindow);
+    mMinQueue.items.resize(mWindow);
+    mMaxQueue.items.resize(mWindow);
+    mBlock.reserve(mArchiveBlock);
+}
+
+void RollingSeries::clear()
+{
+    mSize = 0;
+    mAppended = 0;
+    mMinQueue.head = mMinQueue.count = 0;
+    mMaxQueue.head = mMaxQueue.count = 0;
+
+    // 释放长时间测量积累的归档数据
+    QVector<QPointF>().swap(mArchive);
+    mBlock.resize(0);
+
+    mUnsyncedPoints = 0;
+    mDroppedKeys.clear();
+    mArchivedPoints.clear();
+    mRebuildGraph = true;
+}
+
+void RollingSeries::append(double time, double value)
+{
+    // 窗口已满时最早的点移出窗口
+    if (mSize == mWindow)
+    {
+        archivePoint(at(0));
+        mSize--;
+    }
+
+    qint64 seq = mAppended++;
+    mRing[seq % mWindow] = QPointF(time, value);
+    mSize++;
+    mUnsyncedPoints++;
+
+    pushQueue(mMinQueue, seq, true);
+    pushQueue(mMaxQueue, seq, false);
+}
+
+void RollingSeries::pushQueue(MonotonicQueue& queue, qint64 seq, bool keepMin)
+{
+    const int capacity = queue.items.size();
+
+    // 先移除已出窗口的序号，其所在位置可能已被新点覆盖
+    while (queue.count > 0 && queue.items.at(queue.head) <= seq - mWindow)
+    {
+        queue.head = (queue.head + 1) % capacity;
+        queue.count--;
+    }
+
+    // 队尾不优于新点的序号不会再成为最值
+    double value = valueOf(seq);
+    while (queue.count > 0)
+    {
+        double back = valueOf(queue.items.at((queue.head + queue.count - 1) % capacity));
+        if (keepMin ? back < value : back > value)
+            break;
+        queue.count--;
+    }
+
+    queue.items[(queue.head + queue.count) % capacity] = seq;
+    queue.count++;
+}
+
+QPair<double, double> RollingSeries::windowRange() const
+{
+    if (mSize == 0)
+        return {0.0, 1.0};
+
+    double ymin = valueOf(mMinQueue.items.at(mMinQueue.head));
+    double ymax = valueOf(mMaxQueue.items.at(mMaxQueue.head));
+    if (qFuzzyCompare(ymin, ymax))
+        ymax = ymin + 1.0;
+    return {ymin, ymax};
+}
+
+void RollingSeries::archivePoint(const QPointF& point)
+{
+    mBlock.append(point);
+    if (mBlock.size() < mArchiveBlock)
+        return;
+
+    // 一块归档为最小值、最大值两点，按时间先后排列
+    int minIndex = 0, maxIndex = 0;
+    for (int i = 1; i < mBlock.size(); ++i)
+    {
+        if (mBlock.at(i).y() < mBlock.at(minIndex).y())
+            minIndex = i;
+        if (mBlock.at(i).y() > mBlock.at(maxIndex).y())
+            maxIndex = i;
+    }
+
+    int firstIndex = qMin(minIndex, maxIndex);
+    int secondIndex = qMax(minIndex, maxIndex);
+    mArchive.append(mBlock.at(firstIndex));
+    if (secondIndex != firstIndex)
+        mArchive.append(mBlock.at(secondIndex));
+
+    // 曲线隐藏时长时间不同步，下次同步整体重建，增量记录不再需要，避免随测量时长增长
+    if (rebuildPending())
+    {
+        mDroppedKeys.resize(0);
+        mArchivedPoints.resize(0);
+    }
+    else
+    {
+        mArchivedPoints.append(mBlock.at(firstIndex));
+        if (secondIndex != firstIndex)
+            mArchivedPoints.append(mBlock.at(secondIndex));
+        for (const QPointF& blockPoint : qAsConst(mBlock))
+            mDroppedKeys.append(blockPoint.x());
+    }
+    mBlock.resize(0);
+
+    if (mArchive.size() > mArchiveCapacity)
+        compactArchive();
+}
+
+void RollingSeries::compactArchive()
+{
+    // 每4个归档点（相邻两块）合并为最小值、最大值两点，块长度加倍
+    QVector<QPointF> compacted;
+    compacted.reserve(mArchive.size() / 2 + 2);
+    for (int start = 0; start < mArchive.size(); start += 4)
+    {
+        int end = qMin(start + 4, mArchive.size());
+        int minIndex = start, maxIndex = start;
+        for (int i = start + 1; i < end; ++i)
+        {
+            if (mArchive.at(i).y() < mArchive.at(minIndex).y())
+                minIndex = i;
+            if (mArchive.at(i).y() > mArchive.at(maxIndex).y())
+                maxIndex = i;
+        }
+
+        compacted.append(mArchive.at(qMin(minIndex, maxIndex)));
+        if (minIndex != maxIndex)
+            compacted.append(mArchive.at(qMax(minIndex, maxIndex)));
+    }
+
+    mArchive.swap(compacted);
+    mArchiveBlock *= 2;
+    mBlock.reserve(mArchiveBlock);
+    mRebuildGraph = true;
+    mDroppedKeys.resize(0);
+    mArchivedPoints.resize(0);
+}
+
+void RollingSeries::syncGraph(QCPGraph* graph)
+{
+    if (!graph)
+        return;
+
+    QSharedPointer<QCPGraphDataContainer> container = graph->data();
+
+    // 曲线长时间未同步（新点已移出窗口）或归档合并后整体重建
+    if (rebuildPending())
+    {
+        QVector<QCPGraphData> points;
+        points.reserve(mArchive.size() + mBlock.size() + mSize);
+        for (const QPointF& point : qAsConst(mArchive))
+            points.append(QCPGraphData(point.x(), point.y()));
+        for (const QPointF& point : qAsConst(mBlock))
+            points.append(QCPGraphData(point.x(), point.y()));
+        for (int i = 0; i < mSize; ++i)
+            points.append(QCPGraphData(at(i).x(), at(i).y()));
+        container->set(points, true);
+    }
+    else
+    {
+        for (double key : qAsConst(mDroppedKeys))
+            container->remove(key);
+        for (const QPointF& point : qAsConst(mArchivedPoints))
+            container->add(QCPGraphData(point.x(), point.y()));
+        for (int i = mSize - mUnsyncedPoints; i < mSize; ++i)
+            container->add(QCPGraphData(at(i).x(), at(i).y()));
+    }
+
+    mUnsyncedPoints = 0;
+    mDroppedKeys.resize(0);
+    mArchivedPoints.resize(0);
+    mRebuildGraph = false;
+}
@@ -0,0 +1,95 @@
+/*
+ * @Author: MrPan
+ * @Date: 2026-02-08 10:18:27
+ * @LastEditors: Maoxiaoqing
+ * @LastEditTime: 2026-02-08 10:18:27
+ * @Description: 定长滑动窗口的时间序列，用于长时间连续测量的计数率曲线。最近window个点存放在环形缓冲区中，
+ *               用单调队列维护窗口内的最小/最大值，追加一个点的开销为O(1)；移出窗口的点按块抽稀为
+ *               最小/最大值两点归档，归档超出容量时再两两合并，内存占用有上限。
+ */
+#ifndef ROLLINGSERIES_H
+#define ROLLINGSERIES_H
+
+#include <QVector>
+#include <QPointF>
+#include <QPair>
+
+class QCPGraph;
+
+class RollingSeries
+{
+public:
+    /**
+     * @param window 窗口内保留原始分辨率的点数
+     * @param archiveBlock 移出窗口的点每archiveBlock个归档为最小/最大值两点
+     * @param archiveCapacity 归档点数上限，超出后相邻块合并，分辨率减半
+     */
+    explicit RollingSeries(int window = 300, int archiveBlock = 10, int archiveCapacity = 20000);
+
+    void clear();
+
+    // 追加数据点，时间须递增
+    void append(double time, double value);
+
+    // 窗口内的点数
+    int size() const { return mSize; }
+    bool isEmpty() const { return mSize == 0; }
+
+    // 窗口内第i个点，0为最早的点
+    const QPointF& at(int i) const { return mRing.at((mAppended - mSize + i) % mWindow); }
+    const QPointF& last() const { return at(mSize - 1); }
+
+    // 窗口内的最小/最大值，O(1)；上下界相等时上界加1，防止坐标轴范围为0
+    QPair<double, double> windowRange() const;
+
+    // 抽稀后的归档数据，按时间递增
+    const QVector<QPointF>& archive() const { return mArchive; }
+
+    // 是否有尚未同步到曲线的数据
+    bool hasPendingSync() const { return mRebuildGraph || mUnsyncedPoints > 0; }
+
+    /**
+     * @brief syncGraph 将上次同步以来的变化写入曲线：追加新点，移出窗口的点替换为归档点。
+     * 曲线数据为 归档数据 + 窗口内原始数据，每次同步的开销与窗口点数有关，与测量时长无关
+     */
+    void syncGraph(QCPGraph* graph);
+
+private:
+    void archivePoint(const QPointF& point);
+    void compactArchive();
+
+    // 下次同步须整体重建曲线（归档已合并，或新点已移出窗口），此时无需记录增量变化
+    bool rebuildPending() const { return mRebuildGraph || mUnsyncedPoints > mSize; }
+
+    int mWindow;
+    int mArchiveBlock;
+    int mArchiveCapacity;
+
+    // 环形缓冲区，序号为seq的点存放在mRing[seq % mWindow]
+    QVector<QPointF> mRing;
+    int mSize = 0;
+    qint64 mAppended = 0; // 已追加的总点数，作为单调队列中的序号
+
+    // 单调队列，存放点的序号，队首为窗口内最小/最大值
+    struct MonotonicQueue{
+        QVector<qint64> items;
+        int head = 0;
+        int count = 0;
+    };
+    MonotonicQueue mMinQueue;
+    MonotonicQueue mMaxQueue;
+    void pushQueue(MonotonicQueue& queue, qint64 seq, bool keepMin);
+    double valueOf(qint64 seq) const { return mRing.at(seq % mWindow).y(); }
+
+    // 归档
+    QVector<QPointF> mArchive;
+    QVector<QPointF> mBlock; // 已移出窗口、尚未归档的点，归档前仍以原始分辨率显示
+
+    // 曲线同步状态
+    int mUnsyncedPoints = 0;          // 尚未加入曲线的新点个数
+    QVector<double> mDroppedKeys;     // 已归档、需从曲线删除的原始点
+    QVector<QPointF> mArchivedPoints; // 新产生、需加入曲线的归档点
+    bool mRebuildGraph = true;        // 需要整体重建曲线
+};
+
+#endif // ROLLINGSERIES_H
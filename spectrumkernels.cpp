@@ -0,0 +1,374 @@
+#include "spectrumkernels.h"
+
+#include <cstring>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SPECTRUM_KERNELS_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// GCC/Clang需要对单个函数开启AVX2指令集，MSVC可直接使用内建函数
+#if defined(SPECTRUM_KERNELS_X86) && (defined(__GNUC__) || defined(__clang__))
+#define AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define AVX2_TARGET
+#endif
+
+namespace SpectrumKernels
+{
+    static bool isValidFactor(int srcChannels, int factor)
+    {
+        if (factor != 2 && factor != 4 && factor != 8)
+            return false;
+
+        return srcChannels > 0 && srcChannels % factor == 0;
+    }
+
+    namespace Scalar
+    {
+        bool rebinAccumulate(const quint32* src, int srcChannels, int factor, quint64* dst)
+        {
+            if (!isValidFactor(srcChannels, factor))
+                return false;
+
+            int dstChannels = srcChannels / factor;
+            for (int i = 0; i < dstChannels; ++i)
+            {
+                quint64 sum = 0;
+                for (int j = 0; j < factor; ++j)
+                    sum += src[i * factor + j];
+                dst[i] += sum;
+            }
+            return true;
+        }
+
+        void accumulate(const quint32* src, int n, quint64* dst)
+        {
+            for (int i = 0; i < n; ++i)
+                dst[i] += src[i];
+        }
+
+        void accumulate(const quint32* src, int n, double* dst)
+        {
+            for (int i = 0; i < n; ++i)
+                dst[i] += src[i];
+        }
+
+        void accumulateWeighted(const quint32* src, int n, double weight, double* dst)
+        {
+            for (int i = 0; i < n; ++i)
+                dst[i] += src[i] * weight;
+        }
+
+        quint64 totalCount(const quint32* src, int n)
+        {
+            quint64 sum = 0;
+            for (int i = 0; i < n; ++i)
+                sum += src[i];
+            return sum;
+        }
+
+        void exp(const double* src, int n, double* dst)
+        {
+            for (int i = 0; i < n; ++i)
+                dst[i] = std::exp(src[i]);
+        }
+    }
+
+#ifdef SPECTRUM_KERNELS_X86
+    namespace AVX2
+    {
+        // 8个32位计数相邻两两求和，得到4个64位结果
+        AVX2_TARGET static inline __m256i pairSum(__m256i v)
+        {
+            const __m256i maskLow = _mm256_set1_epi64x(0xFFFFFFFFLL);
+            __m256i even = _mm256_and_si256(v, maskLow);
+            __m256i odd = _mm256_srli_epi64(v, 32);
+            return _mm256_add_epi64(even, odd);
+        }
+
+        // 两组64位结果分别相邻两两求和，a=[a0,a1,a2,a3],b=[b0,b1,b2,b3] -> [a0+a1,a2+a3,b0+b1,b2+b3]
+        AVX2_TARGET static inline __m256i pairSum(__m256i a, __m256i b)
+        {
+            __m256i lo = _mm256_unpacklo_epi64(a, b); // a0,b0,a2,b2
+            __m256i hi = _mm256_unpackhi_epi64(a, b); // a1,b1,a3,b3
+            __m256i sum = _mm256_add_epi64(lo, hi);   // a01,b01,a23,b23
+            return _mm256_permute4x64_epi64(sum, _MM_SHUFFLE(3, 1, 2, 0));
+        }
+
+        AVX2_TARGET static inline __m256i load8(const quint32* src)
+        {
+            return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+        }
+
+        // 4个无符号32位整数转double，拆成高低16位避免有符号转换出错
+        AVX2_TARGET static inline __m256d toDouble4(const quint32* src)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+            __m128i lo = _mm_and_si128(v, _mm_set1_epi32(0xFFFF));
+            __m128i hi = _mm_srli_epi32(v, 16);
+            __m256d dlo = _mm256_cvtepi32_pd(lo);
+            __m256d dhi = _mm256_cvtepi32_pd(hi);
+            return _mm256_add_pd(_mm256_mul_pd(dhi, _mm256_set1_pd(65536.0)), dlo);
+        }
+
+        AVX2_TARGET static void rebinAccumulate(const quint32* src, int srcChannels, int factor, quint64* dst)
+        {
+            // 每次处理32道原始数据
+            const int block = 32;
+            int blocks = srcChannels / block;
+            int outPerBlock = block / factor;
+            for (int b = 0; b < blocks; ++b)
+            {
+                const quint32* s = src + b * block;
+                quint64* d = dst + b * outPerBlock;
+                __m256i p0 = pairSum(load8(s));
+                __m256i p1 = pairSum(load8(s + 8));
+                __m256i p2 = pairSum(load8(s + 16));
+                __m256i p3 = pairSum(load8(s + 24));
+                if (factor == 2)
+                {
+                    __m256i* out = reinterpret_cast<__m256i*>(d);
+                    _mm256_storeu_si256(out, _mm256_add_epi64(_mm256_loadu_si256(out), p0));
+                    _mm256_storeu_si256(out + 1, _mm256_add_epi64(_mm256_loadu_si256(out + 1), p1));
+                    _mm256_storeu_si256(out + 2, _mm256_add_epi64(_mm256_loadu_si256(out + 2), p2));
+                    _mm256_storeu_si256(out + 3, _mm256_add_epi64(_mm256_loadu_si256(out + 3), p3));
+                    continue;
+                }
+
+                __m256i q0 = pairSum(p0, p1);
+                __m256i q1 = pairSum(p2, p3);
+                if (factor == 4)
+                {
+                    __m256i* out = reinterpret_cast<__m256i*>(d);
+                    _mm256_storeu_si256(out, _mm256_add_epi64(_mm256_loadu_si256(out), q0));
+                    _mm256_storeu_si256(out + 1, _mm256_add_epi64(_mm256_loadu_si256(out + 1), q1));
+                    continue;
+                }
+
+                __m256i r = pairSum(q0, q1);
+                __m256i* out = reinterpret_cast<__m256i*>(d);
+                _mm256_storeu_si256(out, _mm256_add_epi64(_mm256_loadu_si256(out), r));
+            }
+
+            // 剩余不足一个块的部分
+            int done = blocks * block;
+            if (done < srcChannels)
+                Scalar::rebinAccumulate(src + done, srcChannels - done, factor, dst + done / factor);
+        }
+
+        AVX2_TARGET static void accumulate(const quint32* src, int n, quint64* dst)
+        {
+            int i = 0;
+            for (; i + 4 <= n; i += 4)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+                __m256i w = _mm256_cvtepu32_epi64(v);
+                __m256i* out = reinterpret_cast<__m256i*>(dst + i);
+                _mm256_storeu_si256(out, _mm256_add_epi64(_mm256_loadu_si256(out), w));
+            }
+            for (; i < n; ++i)
+                dst[i] += src[i];
+        }
+
+        AVX2_TARGET static void accumulate(const quint32* src, int n, double* dst)
+        {
+            int i = 0;
+            for (; i + 4 <= n; i += 4)
+            {
+                __m256d v = toDouble4(src + i);
+                _mm256_storeu_pd(dst + i, _mm256_add_pd(_mm256_loadu_pd(dst + i), v));
+            }
+            for (; i < n; ++i)
+                dst[i] += src[i];
+        }
+
+        AVX2_TARGET static void accumulateWeighted(const quint32* src, int n, double weight, double* dst)
+        {
+            __m256d w = _mm256_set1_pd(weight);
+            int i = 0;
+            for (; i + 4 <= n; i += 4)
+            {
+                __m256d v = _mm256_mul_pd(toDouble4(src + i), w);
+                _mm256_storeu_pd(dst + i, _mm256_add_pd(_mm256_loadu_pd(dst + i), v));
+            }
+            for (; i < n; ++i)
+                dst[i] += src[i] * weight;
+        }
+
+        AVX2_TARGET static quint64 totalCount(const quint32* src, int n)
+        {
+            __m256i acc = _mm256_setzero_si256();
+            int i = 0;
+            for (; i + 8 <= n; i += 8)
+                acc = _mm256_add_epi64(acc, pairSum(load8(src + i)));
+
+            quint64 lanes[4];
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), acc);
+            quint64 sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+            for (; i < n; ++i)
+                sum += src[i];
+            return sum;
+        }
+
+        // exp(x) = 2^k * exp(r)，k = round(x/ln2)，|r| <= ln2/2，exp(r)用13阶泰勒多项式
+        // 有效范围与std::exp相同：x < -745.13时结果为0，[-745.13, -708.40)给出次正规数，x > 709.78时为inf
+        AVX2_TARGET static inline __m256d exp4(__m256d x)
+        {
+            const __m256d maxX = _mm256_set1_pd(710.0);
+            const __m256d minX = _mm256_set1_pd(-746.0);
+            const __m256d log2e = _mm256_set1_pd(1.4426950408889634);
+            const __m256d ln2Hi = _mm256_set1_pd(6.93147180369123816490e-01);
+            const __m256d ln2Lo = _mm256_set1_pd(1.90821492927058770002e-10);
+            const __m256d shifter = _mm256_set1_pd(6755399441055744.0); // 1.5*2^52，用于取整后转换为整数
+
+            __m256d underflow = _mm256_cmp_pd(x, minX, _CMP_LT_OQ);
+            x = _mm256_min_pd(maxX, _mm256_max_pd(minX, x)); // 操作数顺序保证NaN原样传递
+
+            __m256d k = _mm256_round_pd(_mm256_mul_pd(x, log2e), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+            __m256d r = _mm256_sub_pd(_mm256_sub_pd(x, _mm256_mul_pd(k, ln2Hi)), _mm256_mul_pd(k, ln2Lo));
+
+            // Horner: 1 + r + r^2/2! + ... + r^13/13!
+            __m256d p = _mm256_set1_pd(1.0 / 6227020800.0);
+            p = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(1.0 / 479001600.0));
+            p = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(1.0 / 39916800.0));
+            p = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(1.0 / 3628800.0));
+            p = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(1.0 / 362880.0));
+            p = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(1.0 / 40320.0));
+            p = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(1.0 / 5040.0));
+            p = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(1.0 / 720.0));
+            p = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(1.0 / 120.0));
+            p = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(1.0 / 24.0));
+            p = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(1.0 / 6.0));
+            p = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(0.5));
+            p = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(1.0));
+            p = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(1.0));
+
+            // 2^k = 2^k1 * 2^k2，k1 = floor(k/2)，k2 = k-k1，k在[-1076, 1024]内时k1、k2都是正规数的指数；
+            // p*2^k1不会舍入，最后乘2^k2只舍入一次，下溢时得到正确舍入的次正规数或0，上溢时得到inf
+            __m256d k1 = _mm256_round_pd(_mm256_mul_pd(k, _mm256_set1_pd(0.5)), _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+            __m256d k2 = _mm256_sub_pd(k, k1);
+            __m256i k1i = _mm256_sub_epi64(_mm256_castpd_si256(_mm256_add_pd(k1, shifter)), _mm256_castpd_si256(shifter));
+            __m256i k2i = _mm256_sub_epi64(_mm256_castpd_si256(_mm256_add_pd(k2, shifter)), _mm256_castpd_si256(shifter));
+            __m256d scale1 = _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_add_epi64(k1i, _mm256_set1_epi64x(1023)), 52));
+            __m256d scale2 = _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_add_epi64(k2i, _mm256_set1_epi64x(1023)), 52));
+            __m256d result = _mm256_mul_pd(_mm256_mul_pd(p, scale1), scale2);
+            return _mm256_andnot_pd(underflow, result);
+        }
+
+        AVX2_TARGET static void exp(const double* src, int n, double* dst)
+        {
+            int i = 0;
+            for (; i + 4 <= n; i += 4)
+                _mm256_storeu_pd(dst + i, exp4(_mm256_loadu_pd(src + i)));
+            for (; i < n; ++i)
+                dst[i] = std::exp(src[i]);
+        }
+    }
+#endif
+
+    static bool detectAVX2()
+    {
+#if defined(SPECTRUM_KERNELS_X86) && defined(_MSC_VER)
+        int info[4] = {0};
+        __cpuid(info, 0);
+        if (info[0] < 7)
+            return false;
+
+        // OSXSAVE + AVX，且操作系统已开启YMM寄存器保存
+        __cpuid(info, 1);
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx = (info[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx)
+            return false;
+        if ((_xgetbv(0) & 0x6) != 0x6)
+            return false;
+
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#elif defined(SPECTRUM_KERNELS_X86) && (defined(__GNUC__) || defined(__clang__))
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#else
+        return false;
+#endif
+    }
+
+    bool hasAVX2()
+    {
+        static const bool avx2 = detectAVX2();
+        return avx2;
+    }
+
+    bool rebin(const quint32* src, int srcChannels, int factor, quint64* dst)
+    {
+        if (!isValidFactor(srcChannels, factor))
+            return false;
+
+        memset(dst, 0, sizeof(quint64) * (srcChannels / factor));
+        return rebinAccumulate(src, srcChannels, factor, dst);
+    }
+
+    bool rebinAccumulate(const quint32* src, int srcChannels, int factor, quint64* dst)
+    {
+        if (!isValidFactor(srcChannels, factor))
+            return false;
+
+#ifdef SPECTRUM_KERNELS_X86
+        if (hasAVX2()) {
+            AVX2::rebinAccumulate(src, srcChannels, factor, dst);
+            return true;
+        }
+#endif
+        return Scalar::rebinAccumulate(src, srcChannels, factor, dst);
+    }
+
+    void accumulate(const quint32* src, int n, quint64* dst)
+    {
+#ifdef SPECTRUM_KERNELS_X86
+        if (hasAVX2())
+            return AVX2::accumulate(src, n, dst);
+#endif
+        Scalar::accumulate(src, n, dst);
+    }
+
+    void accumulate(const quint32* src, int n, double* dst)
+    {
+#ifdef SPECTRUM_KERNELS_X86
+        if (hasAVX2())
+            return AVX2::accumulate(src, n, dst);
+#endif
+        Scalar::accumulate(src, n, dst);
+    }
+
+    void accumulateWeighted(const quint32* src, int n, double weight, double* dst)
+    {
+#ifdef SPECTRUM_KERNELS_X86
+        if (hasAVX2())
+            return AVX2::accumulateWeighted(src, n, weight, dst);
+#endif
+        Scalar::accumulateWeighted(src, n, weight, dst);
+    }
+
+    quint64 totalCount(const quint32* src, int n)
+    {
+#ifdef SPECTRUM_KERNELS_X86
+        if (hasAVX2())
+            return AVX2::totalCount(src, n);
+#endif
+        return Scalar::totalCount(src, n);
+    }
+
+    void exp(const double* src, int n, double* dst)
+    {
+#ifdef SPECTRUM_KERNELS_X86
+        if (hasAVX2())
+            return AVX2::exp(src, n, dst);
+#endif
+        Scalar::exp(src, n, dst);
+    }
+}
@@ -0,0 +1,56 @@
+/*
+ * @Author: MrPan
+ * @Date: 2026-02-03 10:12:40
+ * @LastEditors: Maoxiaoqing
+ * @LastEditTime: 2026-02-03 10:12:40
+ * @Description: 能谱基础运算（道址合并、累加、死时间加权累加、总计数、批量指数），运行时按CPU支持情况选择AVX2实现
+ */
+#ifndef SPECTRUMKERNELS_H
+#define SPECTRUMKERNELS_H
+
+#include <QtGlobal>
+
+namespace SpectrumKernels
+{
+    // 当前CPU是否支持AVX2（只检测一次）
+    bool hasAVX2();
+
+    /**
+     * @brief rebin 道址合并，每factor道求和为1道，输出为64位，不会溢出
+     * @param src 原始能谱
+     * @param srcChannels 原始道数，必须是factor的整数倍
+     * @param factor 合并倍数，支持2/4/8
+     * @param dst 输出能谱，长度srcChannels/factor
+     * @return 参数不合法时返回false
+     */
+    bool rebin(const quint32* src, int srcChannels, int factor, quint64* dst);
+
+    // 道址合并后累加到dst，dst += rebin(src)
+    bool rebinAccumulate(const quint32* src, int srcChannels, int factor, quint64* dst);
+
+    // 能谱累加 dst[i] += src[i]
+    void accumulate(const quint32* src, int n, quint64* dst);
+    void accumulate(const quint32* src, int n, double* dst);
+
+    // 死时间加权累加 dst[i] += src[i] * weight，weight一般取 测量时间/(测量时间-死时间)
+    void accumulateWeighted(const quint32* src, int n, double weight, double* dst);
+
+    // 能谱总计数
+    quint64 totalCount(const quint32* src, int n);
+
+    // 批量指数运算 dst[i] = exp(src[i])，AVX2实现相对误差约1e-15，下溢范围与std::exp相同（给出次正规数，x < -745.13时为0）
+    void exp(const double* src, int n, double* dst);
+
+    // 标量实现，用于不支持AVX2的CPU以及结果比对
+    namespace Scalar
+    {
+        bool rebinAccumulate(const quint32* src, int srcChannels, int factor, quint64* dst);
+        void accumulate(const quint32* src, int n, quint64* dst);
+        void accumulate(const quint32* src, int n, double* dst);
+        void accumulateWeighted(const quint32* src, int n, double weight, double* dst);
+        quint64 totalCount(const quint32* src, int n);
+        void exp(const double* src, int n, double* dst);
+    }
+}
+
+#endif // SPECTRUMKERNELS_H
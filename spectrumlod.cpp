@@ -0,0 +1,236 @@
+#include "spectrumlod.h"
+#include <algorithm>
+
+bool SpectrumLod::setData(const QVector<double>& keys, const QVector<double>& values)
+{
+    int n = qMin(keys.size(), values.size());
+    for (int i = 1; i < n; ++i)
+    {
+        if (!(keys.at(i) > keys.at(i-1)))
+        {
+            clear();
+            return false;
+        }
+    }
+
+    mKeys = keys.mid(0, n);
+    mValues = values.mid(0, n);
+    buildPyramid();
+    return true;
+}
+
+void SpectrumLod::clear()
+{
+    mKeys.clear();
+    mValues.clear();
+    mMin.clear();
+    mMax.clear();
+}
+
+bool SpectrumLod::setValues(const quint64* values, int n)
+{
+    if (n != mValues.size())
+        return false;
+
+    double* dst = mValues.data();
+    for (int i = 0; i < n; ++i)
+        dst[i] = values[i];
+    buildPyramid();
+    return true;
+}
+
+bool SpectrumLod::setValues(const double* values, int n)
+{
+    if (n != mValues.size())
+        return false;
+
+    std::copy(values, values + n, mValues.data());
+    buildPyramid();
+    return true;
+}
+
+void SpectrumLod::buildPyramid()
+{
+    // 层数与道数有关，道数不变时各层只覆盖写入
+    int levels = 0;
+    for (int blocks = mValues.size(); blocks > 1; blocks = (blocks + 1) / 2)
+        levels++;
+    mMin.resize(levels);
+    mMax.resize(levels);
+
+    const double* srcMin = mValues.constData();
+    const double* srcMax = mValues.constData();
+    int srcCount = mValues.size();
+    for (int k = 0; k < levels; ++k)
+    {
+        int count = (srcCount + 1) / 2;
+        mMin[k].resize(count);
+        mMax[k].resize(count);
+        double* dstMin = mMin[k].data();
+        double* dstMax = mMax[k].data();
+        for (int i = 0; i < count; ++i)
+        {
+            int j = 2 * i;
+            if (j + 1 < srcCount)
+            {
+                dstMin[i] = qMin(srcMin[j], srcMin[j+1]);
+                dstMax[i] = qMax(srcMax[j], srcMax[j+1]);
+            }
+            else
+            {
+                dstMin[i] = srcMin[j];
+                dstMax[i] = srcMax[j];
+            }
+        }
+        srcMin = dstMin;
+        srcMax = dstMax;
+        srcCount = count;
+    }
+}
+
+void SpectrumLod::rangeMinMax(int first, int last, double& minValue, double& maxValue) const
+{
+    // 从左到右每次取起点对齐且不越界的最大块，共O(log n)块
+    minValue = mValues.at(first);
+    maxValue = minValue;
+    int a = first;
+    int b = last + 1;
+    while (a < b)
+    {
+        int k = 0;
+        while (k < mMin.size() && (a & ((2 << k) - 1)) == 0 && a + (2 << k) <= b)
+            ++k;
+
+        if (k == 0)
+        {
+            minValue = qMin(minValue, mValues.at(a));
+            maxValue = qMax(maxValue, mValues.at(a));
+            a += 1;
+        }
+        else
+        {
+            int index = a >> k;
+            minValue = qMin(minValue, mMin.at(k-1).at(index));
+            maxValue = qMax(maxValue, mMax.at(k-1).at(index));
+            a += 1 << k;
+        }
+    }
+}
+
+void SpectrumLod::envelope(double lower, double upper, int pixels, QVector<QCPGraphData>& points) const
+{
+    // resize(0)保留已申请的容量
+    points.resize(0);
+    int n = mKeys.size();
+    if (n == 0)
+        return;
+    pixels = qMax(1, pixels);
+
+    const double* keys = mKeys.constData();
+    const double* values = mValues.constData();
+    int first = std::lower_bound(keys, keys + n, lower) - keys;
+    int last = int(std::upper_bound(keys, keys + n, upper) - keys) - 1;
+    int from = qMax(0, first - 1);
+    int to = qMin(n - 1, last + 1);
+
+    // 数据点不多于像素数的两倍时不抽稀
+    if (last < first || last - first + 1 <= 2 * pixels)
+    {
+        for (int i = from; i <= to; ++i)
+            points.append(QCPGraphData(keys[i], values[i]));
+        return;
+    }
+
+    // 范围两侧各保留一个相邻点，曲线能画到坐标轴边缘
+    if (from < first)
+        points.append(QCPGraphData(keys[from], values[from]));
+
+    double step = (upper - lower) / pixels;
+    int a = first;
+    for (int p = 0; p < pixels && a <= last; ++p)
+    {
+        int b = last;
+        if (p < pixels - 1)
+            b = int(std::upper_bound(keys + a, keys + last + 1, lower + (p + 1) * step) - keys) - 1;
+        if (b < a)
+            continue;
+
+        if (a == b)
+        {
+            points.append(QCPGraphData(keys[a], values[a]));
+        }
+        else
+        {
+            double minValue, maxValue;
+            rangeMinMax(a, b, minValue, maxValue);
+            points.append(QCPGraphData(keys[a], minValue));
+            points.append(QCPGraphData(keys[a], maxValue));
+        }
+        a = b + 1;
+    }
+
+    if (to > last)
+        points.append(QCPGraphData(keys[to], values[to]));
+}
+
+SpectrumLodGraph::SpectrumLodGraph(QCPGraph* graph)
+    : QObject(graph->parentPlot())
+    , mGraph(graph)
+{
+    // 缩放、拖动时按新的范围重新抽稀，随后的重绘直接使用新数据
+    connect(graph->keyAxis(), QOverload<const QCPRange&>::of(&QCPAxis::rangeChanged), this, [=](){
+        refresh();
+    });
+}
+
+void SpectrumLodGraph::setData(const QVector<double>& keys, const QVector<double>& values)
+{
+    if (!mGraph)
+        return;
+
+    mEnabled = mLod.setData(keys, values);
+    if (mEnabled)
+        refresh();
+    else
+        mGraph->setData(keys, values);
+}
+
+bool SpectrumLodGraph::setValues(const quint64* values, int n)
+{
+    if (!mEnabled || !mLod.setValues(values, n))
+        return false;
+
+    refresh();
+    return true;
+}
+
+void SpectrumLodGraph::clear()
+{
+    mLod.clear();
+    mEnabled = false;
+    mPoints.clear();
+    if (mGraph)
+        mGraph->data()->clear();
+}
+
+void SpectrumLodGraph::refresh()
+{
+    if (!mGraph || !mEnabled)
+        return;
+
+    QCPAxis* keyAxis = mGraph->keyAxis();
+    mLod.envelope(keyAxis->range().lower, keyAxis->range().upper, keyAxis->axisRect()->width(), mPoints);
+
+    // 点数不变时原位覆盖，否则整体替换（mPoints已按x排序）
+    QSharedPointer<QCPGraphDataContainer> container = mGraph->data();
+    if (container->size() == mPoints.size())
+    {
+        QCPGraphDataContainer::iterator it = container->begin();
+        for (const QCPGraphData& point : qAsConst(mPoints))
+            *it++ = point;
+    }
+    else
+    {
+        container->set(mPoints, true);
+    }
+}
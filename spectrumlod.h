@@ -0,0 +1,87 @@
+/*
+ * @Author: MrPan
+ * @Date: 2026-02-07 15:46:02
+ * @LastEditors: Maoxiaoqing
+ * @LastEditTime: 2026-02-07 15:46:02
+ * @Description: 能谱曲线抽稀显示。对能谱建立多分辨率的最小/最大值金字塔，按当前x轴范围和像素宽度
+ *               每列像素只输出一对最小/最大值，峰不会因抽稀丢失，重绘耗时只与像素宽度有关。
+ */
+#ifndef SPECTRUMLOD_H
+#define SPECTRUMLOD_H
+
+#include <QObject>
+#include <QPointer>
+#include <QVector>
+#include "qcustomplot.h"
+
+class SpectrumLod
+{
+public:
+    /**
+     * @brief setData 设置能谱数据
+     * @param keys 各道的x坐标（道址或能量），必须严格递增
+     * @param values 各道计数
+     * @return keys不是严格递增时返回false，此时不能抽稀
+     */
+    bool setData(const QVector<double>& keys, const QVector<double>& values);
+
+    // x坐标不变，只更新计数，n必须与已有道数一致，不申请内存
+    bool setValues(const quint64* values, int n);
+    bool setValues(const double* values, int n);
+
+    int size() const { return mKeys.size(); }
+
+    // 清空数据和金字塔
+    void clear();
+
+    /**
+     * @brief envelope 计算[lower, upper]范围内每列像素的最小/最大值包络
+     * @param lower x轴下限
+     * @param upper x轴上限
+     * @param pixels 像素宽度
+     * @param points 输出的曲线数据点，按x递增排列，包含范围两侧各一个相邻点
+     */
+    void envelope(double lower, double upper, int pixels, QVector<QCPGraphData>& points) const;
+
+private:
+    void buildPyramid();
+    void rangeMinMax(int first, int last, double& minValue, double& maxValue) const;
+
+    QVector<double> mKeys;
+    QVector<double> mValues;
+    // 第k层（k从0开始）每个元素对应2^(k+1)道的最小/最大值
+    QVector<QVector<double>> mMin;
+    QVector<QVector<double>> mMax;
+};
+
+/**
+ * @brief 将SpectrumLod绑定到QCPGraph，数据或x轴范围变化时重新抽稀
+ */
+class SpectrumLodGraph : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SpectrumLodGraph(QCPGraph* graph);
+
+    // 设置能谱数据，keys不是严格递增时直接显示全部数据点
+    void setData(const QVector<double>& keys, const QVector<double>& values);
+
+    // x坐标不变，只更新计数并重新抽稀
+    bool setValues(const quint64* values, int n);
+
+    // 清空能谱和曲线数据，之后缩放、拖动不会再显示旧能谱，下次须调用setData
+    void clear();
+
+    int size() const { return mLod.size(); }
+
+    // 按当前x轴范围和像素宽度重新抽稀，写入曲线数据，不触发重绘
+    void refresh();
+
+private:
+    QPointer<QCPGraph> mGraph;
+    SpectrumLod mLod;
+    bool mEnabled = false;
+    QVector<QCPGraphData> mPoints; //抽稀结果，各次复用
+};
+
+#endif // SPECTRUMLOD_H
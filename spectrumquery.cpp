@@ -0,0 +1,280 @@
+#include "spectrumquery.h"
+#include "spectrumkernels.h"
+#include "globalsettings.h"
+#include <QMutex>
+#include <QThread>
+#include <QThreadPool>
+#include <QDebug>
+
+namespace {
+
+// H5Spectrum每行的表头列数：序号、测量时间、死时间
+const int headerColumns = 3;
+
+// 按时间合并宽度汇总一个谱仪的能谱行
+class BinAggregator
+{
+public:
+    BinAggregator(const SpectrumQueryRequest& request, quint8 detectorId, const SpectrumQuery::BinCallback& onBin)
+        : mRequest(request)
+        , mDetectorId(detectorId)
+        , mOnBin(onBin)
+    {
+        mBin.spectrum.resize(request.outputChannels());
+        mBin.spectrum.fill(0);
+    }
+
+    // channels为道址范围内的原始计数，channelEnd-channelBegin道
+    void add(quint32 sequence, quint32 measureTime, quint32 deathTime, const quint32* channels)
+    {
+        if (mBin.rows == 0)
+            mBin.firstSequence = sequence;
+        mBin.lastSequence = sequence;
+        mBin.rows++;
+        mBin.measureTime += measureTime;
+        mBin.deathTime += deathTime;
+
+        int channelCount = mRequest.channelEnd - mRequest.channelBegin;
+        if (mRequest.channelRebin > 1)
+            SpectrumKernels::rebinAccumulate(channels, channelCount, mRequest.channelRebin, mBin.spectrum.data());
+        else
+            SpectrumKernels::accumulate(channels, channelCount, mBin.spectrum.data());
+
+        if (mRequest.timeBin > 0 && mBin.measureTime >= quint64(mRequest.timeBin))
+            flush(true);
+    }
+
+    // 窗口结束，输出剩余的一条
+    void finish()
+    {
+        flush(mRequest.timeBin == 0);
+    }
+
+private:
+    void flush(bool complete)
+    {
+        if (mBin.rows == 0)
+            return;
+
+        mBin.complete = complete;
+        if (mOnBin)
+            mOnBin(mDetectorId, mBin);
+
+        mBin.rows = 0;
+        mBin.measureTime = 0;
+        mBin.deathTime = 0;
+        mBin.spectrum.fill(0);
+    }
+
+    const SpectrumQueryRequest& mRequest;
+    quint8 mDetectorId;
+    const SpectrumQuery::BinCallback& mOnBin;
+    SpectrumQueryBin mBin;
+};
+
+bool isInterrupted(const std::atomic<bool>* interrupted)
+{
+    return interrupted && interrupted->load();
+}
+
+/**
+ * @brief 查询一个谱仪
+ * @param datasetRows 数据集行数，用于进度
+ */
+bool queryDetector(const SpectrumQueryRequest& request, quint8 detectorId, quint64 datasetRows,
+                   const SpectrumQuery::BinCallback& onBin, const SpectrumQuery::ProgressCallback& onProgress,
+                   std::atomic<qint64>& doneRows, qint64 totalRows, const std::atomic<bool>* interrupted)
+{
+    std::string filePath = request.filePath.toStdString();
+
+    // 1. 只读表头，确定窗口对应的行范围
+    QVector<quint32> headers;
+    if (!HDF5Settings::readH5SpectrumHeaders(filePath, detectorId, headers))
+        return false;
+
+    quint64 rows = headers.size() / headerColumns;
+    quint64 firstRow = rows;
+    quint64 lastRow = 0;
+    for (quint64 i = 0; i < rows; ++i)
+    {
+        quint32 sequence = headers.at(int(i * headerColumns));
+        if (sequence >= request.sequenceBegin && sequence <= request.sequenceEnd)
+        {
+            firstRow = qMin(firstRow, i);
+            lastRow = i;
+        }
+    }
+
+    // 2. 只读道址范围内的数据，按块汇总
+    BinAggregator aggregator(request, detectorId, onBin);
+    int channelCount = request.channelEnd - request.channelBegin;
+    QVector<quint32> block;
+    quint64 reported = 0;
+    for (quint64 startRow = firstRow; startRow <= lastRow && firstRow < rows; startRow += request.blockRows)
+    {
+        if (isInterrupted(interrupted))
+            return false;
+
+        quint64 blockRows = qMin<quint64>(request.blockRows, lastRow + 1 - startRow);
+        if (!HDF5Settings::readH5SpectrumChannels(filePath, detectorId, startRow, blockRows,
+                                                  request.channelBegin, channelCount, block))
+            return false;
+
+        for (quint64 i = 0; i < blockRows; ++i)
+        {
+            const quint32* header = headers.constData() + (startRow + i) * headerColumns;
+            if (header[0] < request.sequenceBegin || header[0] > request.sequenceEnd || header[1] == 0)
+                continue;
+
+            aggregator.add(header[0], header[1], header[2], block.constData() + i * channelCount);
+        }
+
+        reported += blockRows;
+        if (onProgress)
+            onProgress(doneRows += blockRows, totalRows);
+    }
+    aggregator.finish();
+
+    // 窗口外的行视为已处理
+    if (onProgress && datasetRows > reported)
+        onProgress(doneRows += qint64(datasetRows - reported), totalRows);
+    return true;
+}
+
+}
+
+bool SpectrumQuery::validate(const SpectrumQueryRequest &request, QString *error)
+{
+    auto fail = [&](const QString& reason) {
+        if (error)
+            *error = reason;
+        return false;
+    };
+
+    if (request.filePath.isEmpty())
+        return fail(QObject::tr("未指定测量文件"));
+    for (quint8 detectorId : request.detectors)
+    {
+        if (detectorId < 1 || detectorId > DET_NUM)
+            return fail(QObject::tr("谱仪编号%1超出范围").arg(detectorId));
+    }
+    if (request.sequenceBegin > request.sequenceEnd)
+        return fail(QObject::tr("时间窗口起点大于终点"));
+    if (request.channelBegin < 0 || request.channelEnd > 8192 || request.channelBegin >= request.channelEnd)
+        return fail(QObject::tr("道址范围[%1, %2)不合法").arg(request.channelBegin).arg(request.channelEnd));
+    if (request.channelRebin != 1 && request.channelRebin != 2 && request.channelRebin != 4 && request.channelRebin != 8)
+        return fail(QObject::tr("道址合并倍数只支持1、2、4、8"));
+    if ((request.channelEnd - request.channelBegin) % request.channelRebin != 0)
+        return fail(QObject::tr("道址范围长度不是合并倍数的整数倍"));
+    if (request.timeBin < 0)
+        return fail(QObject::tr("时间合并宽度不能为负"));
+    if (request.blockRows <= 0)
+        return fail(QObject::tr("每次读取的行数必须大于0"));
+    return true;
+}
+
+int SpectrumQuery::run(const SpectrumQueryRequest &request, const BinCallback &onBin,
+                       const ProgressCallback &onProgress, const std::atomic<bool> *interrupted,
+                       const DetectorCallback &onDetectorFinished)
+{
+    QString error;
+    if (!validate(request, &error))
+    {
+        qWarning().noquote() << QObject::tr("能谱查询条件不合法：%1").arg(error);
+        return -1;
+    }
+
+    QVector<quint8> detectors = request.detectors;
+    if (detectors.isEmpty())
+    {
+        for (quint8 detectorId = 1; detectorId <= DET_NUM; ++detectorId)
+            detectors << detectorId;
+    }
+
+    // 先取各谱仪的行数，用于计算总进度，文件中没有的谱仪跳过
+    QMap<quint8, quint64> detectorRows;
+    qint64 totalRows = 0;
+    for (quint8 detectorId : qAsConst(detectors))
+    {
+        quint64 rows = 0, columns = 0;
+        if (HDF5Settings::readH5SpectrumDims(request.filePath.toStdString(), detectorId, rows, columns) && rows > 0)
+        {
+            detectorRows[detectorId] = rows;
+            totalRows += rows;
+        }
+    }
+
+    // 文件读取是串行的，线程池只让各谱仪的汇总计算与读取重叠，线程数不必多，同时也限制了块缓冲区占用的内存
+    QThreadPool pool;
+    pool.setMaxThreadCount(qBound(1, QThread::idealThreadCount(), 4));
+
+    std::atomic<qint64> doneRows(0);
+    std::atomic<int> successCount(0);
+    if (onProgress)
+        onProgress(0, totalRows);
+    for (auto iter = detectorRows.constBegin(); iter != detectorRows.constEnd(); ++iter)
+    {
+        quint8 detectorId = iter.key();
+        quint64 rows = iter.value();
+        pool.start([&, detectorId, rows](){
+            bool success = queryDetector(request, detectorId, rows, onBin, onProgress, doneRows, totalRows, interrupted);
+            if (success)
+                ++successCount;
+            if (onDetectorFinished)
+                onDetectorFinished(detectorId, success);
+        });
+    }
+    pool.waitForDone();
+
+    if (isInterrupted(interrupted))
+        return -1;
+    return successCount;
+}
+
+QMap<quint8, QVector<SpectrumQueryBin>> SpectrumQuery::collect(const SpectrumQueryRequest &request,
+        const ProgressCallback &onProgress, const std::atomic<bool> *interrupted)
+{
+    QMap<quint8, QVector<SpectrumQueryBin>> result;
+    QMutex mutex;
+    int count = run(request, [&](quint8 detectorId, const SpectrumQueryBin& bin) {
+        QMutexLocker locker(&mutex);
+        result[detectorId].append(bin);
+    }, onProgress, interrupted);
+
+    if (count < 0)
+        result.clear();
+    return result;
+}
+
+bool SpectrumQuery::summary(const QString &filePath, quint8 detectorId, QVector<H5SpectrumSummary> &rows,
+                            QVector<QPair<int, int>> *roiRanges, const std::atomic<bool> *interrupted)
+{
+    if (HDF5Settings::readH5SpectrumSummary(filePath.toStdString(), detectorId, rows, roiRanges))
+        return true;
+
+    // 没有摘要数据集，逐行汇总全谱
+    if (roiRanges)
+        roiRanges->clear();
+    rows.clear();
+
+    SpectrumQueryRequest request;
+    request.filePath = filePath;
+    request.detectors << detectorId;
+    request.timeBin = 1; // 每行单独成为一条
+    bool hasLast = false;
+    quint32 lastSequence = 0;
+    int count = run(request, [&](quint8, const SpectrumQueryBin& bin) {
+        H5SpectrumSummary row{};
+        row.sequence = bin.firstSequence;
+        row.measureTime = quint32(bin.measureTime);
+        row.deathTime = quint32(bin.deathTime);
+        if (hasLast && row.sequence > lastSequence + 1)
+            row.lostCount = row.sequence - lastSequence - 1;
+        hasLast = true;
+        lastSequence = row.sequence;
+        for (quint64 value : bin.spectrum)
+            row.totalCount += value;
+        rows.append(row);
+    }, nullptr, interrupted);
+    return count > 0;
+}
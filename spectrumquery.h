@@ -0,0 +1,89 @@
+/*
+ * @Author: MrPan
+ * @Date: 2026-02-09 09:40:26
+ * @LastEditors: Maoxiaoqing
+ * @LastEditTime: 2026-02-09 09:40:26
+ * @Description: 测量文件能谱查询。按 谱仪集合 × 能谱序号（时间）窗口 × 道址范围 × 时间/道址合并 汇总H5文件中的能谱：
+ *               先只读各行的序号、测量时间、死时间确定行范围，再只读所需道址范围内的数据，
+ *               查询2048道的感兴趣区时只读四分之一的数据量；累加、道址合并使用SpectrumKernels。
+ */
+#ifndef SPECTRUMQUERY_H
+#define SPECTRUMQUERY_H
+
+#include <QString>
+#include <QVector>
+#include <QMap>
+#include <atomic>
+#include <functional>
+
+struct H5SpectrumSummary;
+
+// 查询条件
+struct SpectrumQueryRequest {
+    QString filePath;
+    QVector<quint8> detectors;          // 谱仪编号，为空表示全部谱仪
+    quint32 sequenceBegin = 0;          // 能谱序号窗口[sequenceBegin, sequenceEnd]
+    quint32 sequenceEnd = 0xFFFFFFFF;
+    int channelBegin = 0;               // 道址范围[channelBegin, channelEnd)
+    int channelEnd = 8192;
+    int channelRebin = 1;               // 道址合并倍数：1、2、4、8，道址范围长度须为其整数倍
+    int timeBin = 0;                    // 时间合并宽度，ms，按各行测量时间累计；0表示窗口内全部合并为一条
+    int blockRows = 1024;               // 每次读取的行数
+
+    // 输出能谱的道数
+    int outputChannels() const { return (channelEnd - channelBegin) / qMax(1, channelRebin); }
+};
+
+// 一条汇总能谱
+struct SpectrumQueryBin {
+    quint32 firstSequence = 0;
+    quint32 lastSequence = 0;
+    int rows = 0;                       // 合并的行数
+    quint64 measureTime = 0;            // 测量时间合计，ms
+    quint64 deathTime = 0;              // 死时间合计，单位*10ns
+    bool complete = false;              // 测量时间是否达到timeBin，窗口末尾不足timeBin的一条为false
+    QVector<quint64> spectrum;          // outputChannels()道
+};
+
+namespace SpectrumQuery
+{
+    // 每得到一条汇总能谱调用一次；不同谱仪在线程池的不同线程中回调，同一谱仪按时间顺序回调
+    typedef std::function<void(quint8 detectorId, const SpectrumQueryBin& bin)> BinCallback;
+    // 进度回调，单位为行，可能在多个线程中调用
+    typedef std::function<void(qint64 done, qint64 total)> ProgressCallback;
+    // 一个谱仪查询结束（该谱仪的全部结果已回调），在该谱仪的汇总线程中调用
+    typedef std::function<void(quint8 detectorId, bool success)> DetectorCallback;
+
+    /**
+     * @brief validate 检查查询条件
+     * @param error 不合法时返回原因
+     */
+    bool validate(const SpectrumQueryRequest& request, QString* error = nullptr);
+
+    /**
+     * @brief run 执行查询，各谱仪在线程池中并行汇总（文件读取由HDF5Settings串行化）
+     * @param onBin 汇总结果回调，结果不在内部保留，适合按秒统计等结果条数很多的查询
+     * @param onProgress 进度回调，可为空
+     * @param interrupted 中断标志，可为空
+     * @param onDetectorFinished 各谱仪查询结束回调，可为空
+     * @return 成功查询的谱仪数，条件不合法、中断时返回-1
+     */
+    int run(const SpectrumQueryRequest& request, const BinCallback& onBin,
+            const ProgressCallback& onProgress = nullptr, const std::atomic<bool>* interrupted = nullptr,
+            const DetectorCallback& onDetectorFinished = nullptr);
+
+    /**
+     * @brief summary 读取谱仪每行能谱的摘要（序号、测量时间、死时间、丢失个数、总计数、感兴趣区计数），
+     * 优先读取文件中的摘要数据集；早期文件没有摘要时读取全部能谱计算，此时没有感兴趣区计数
+     * @param roiRanges 返回感兴趣区的道址区间，可为空
+     * @return 是否读取成功
+     */
+    bool summary(const QString& filePath, quint8 detectorId, QVector<H5SpectrumSummary>& rows,
+                 QVector<QPair<int, int>>* roiRanges = nullptr, const std::atomic<bool>* interrupted = nullptr);
+
+    // 执行查询并按谱仪收集全部结果，失败或中断时返回空
+    QMap<quint8, QVector<SpectrumQueryBin>> collect(const SpectrumQueryRequest& request,
+            const ProgressCallback& onProgress = nullptr, const std::atomic<bool>* interrupted = nullptr);
+}
+
+#endif // SPECTRUMQUERY_H
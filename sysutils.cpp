@@ -6,70 +6,110 @@
 #include <stdexcept>
 #include <cstddef>
 #include <Eigen/Dense>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <algorithm>
 
 SysUtils::SysUtils() {}
 
-// 滑动平均滤波函数
-void SysUtils::smooth(double *data, double *output, int data_size, int window_size) {
+// 滑动平均参数检查
+static bool checkSmoothWindow(int data_size, int window_size)
+{
     // 如果窗口大小大于数据长度，则不进行滤波
     if (window_size > data_size) {
         printf("窗口大小不能大于数据大小。\n");
-        return;
+        return false;
     }
 
     // 窗口宽度必须是奇数
     if ( window_size%2 == 0) {
         printf("smooth,窗口宽度只能是奇数，当前窗口宽度%d。\n", window_size);
-        return;
+        return false;
     }
+    return true;
+}
 
+// 前缀和实现的滑动平均，prefix长度不小于data_size+1
+// 第i点取以i为中心、半宽min(halfWindow, i, data_size-1-i)的对称窗口求平均
+static void smoothPrefix(const double *data, double *output, double *prefix, int data_size, int window_size)
+{
     int halfWindow = (window_size - 1) / 2;
 
-    // 计算每个点的滑动平均值
-    for (int i = 0; i < data_size; i++) {
-        double sum = 0.0;
-        int count = 0;
-        // 计算窗口内的平均值
-        for (int j = i - (window_size - 1) / 2; j <= i + (window_size - 1) / 2; j++) {
-            // 确保索引在有效范围内
-            if (j >= 0 && j < data_size) {
-                sum += data[j];
-                count++;
-            }
-        }
-        // 计算并存储当前位置的滑动平均值
-        output[i] = sum / count;
-    }
+    prefix[0] = 0.0;
+    for (int i = 0; i < data_size; i++)
+        prefix[i + 1] = prefix[i] + data[i];
 
-    // 重新处理左边界情况
-    for (int i = 0; i < halfWindow; i++) {
-        double sum = 0.0;
-        int count = 0;
-        //给出左侧端点个数
-        int leftPoint = i;
-        for (int j = 0; j <= i + i; j++) {
-            // printf("Left side, i = %d, data[%d]=%f\n", i, j, data[j]);
-            sum += data[j];
-            count++;
-        }
-        output[i] = sum / count;
+    // 中间部分窗口宽度固定，循环无分支，便于编译器向量化
+    const double* upper = prefix + window_size;
+    for (int i = halfWindow; i < data_size - halfWindow; i++)
+        output[i] = (upper[i - halfWindow] - prefix[i - halfWindow]) / window_size;
+
+    // 左边界，窗口[0, 2i]
+    for (int i = 0; i < halfWindow && i < data_size; i++)
+        output[i] = (prefix[2 * i + 1] - prefix[0]) / (2 * i + 1);
+
+    // 右边界，窗口[2i-data_size+1, data_size-1]
+    for (int i = std::max(data_size - halfWindow, halfWindow); i < data_size; i++) {
+        int count = 2 * (data_size - 1 - i) + 1;
+        output[i] = (prefix[data_size] - prefix[data_size - count]) / count;
     }
+}
+
+// 滑动平均滤波函数
+void SysUtils::smooth(double *data, double *output, int data_size, int window_size) {
+    if (!checkSmoothWindow(data_size, window_size))
+        return;
+
+    std::vector<double> prefix(data_size + 1);
+    smoothPrefix(data, output, prefix.data(), data_size, window_size);
+}
+
+void SysUtils::smoothTwice(const double *data, double *output, double *scratch, int data_size, int window_size)
+{
+    if (!checkSmoothWindow(data_size, window_size))
+        return;
+
+    // scratch前data_size个元素存放第一次平滑结果，其后为前缀和
+    double* smooth1 = scratch;
+    double* prefix = scratch + data_size;
+    smoothPrefix(data, smooth1, prefix, data_size, window_size);
+    smoothPrefix(smooth1, output, prefix, data_size, window_size);
+}
 
-    // 重新处理右边界情况
-    for (int i = data_size - halfWindow; i < data_size; i++) {
-        double sum = 0.0;
-        int count = 0;
-        //给出右侧端点个数
-        int leftPoint = data_size - i- 1;
-        for (int j = i - leftPoint; j < data_size; j++) {
-            // printf("Right side, i = %d, data[%d]=%f\n", i, j, data[j]);
-            sum += data[j];
-            count++;
+// 平滑投影矩阵P(f x f)，按(p, f)缓存。剥谱在线程池中并行调用，缓存需要加锁
+static const Eigen::MatrixXd& sgolayProjection(int p, int f)
+{
+    static std::mutex mutex;
+    static std::map<std::pair<int, int>, std::unique_ptr<Eigen::MatrixXd>> cache;
+
+    std::lock_guard<std::mutex> locker(mutex);
+    std::unique_ptr<Eigen::MatrixXd>& P = cache[std::make_pair(p, f)];
+    if (P)
+        return *P;
+
+    const int m = (f - 1) / 2; // half window
+
+    // 1) Build Vandermonde matrix A (f x (p+1)) with sample positions k = -m..m
+    // A(r, j) = k^j
+    Eigen::MatrixXd A(f, p + 1);
+    for (int r = 0; r < f; ++r) {
+        const double k = static_cast<double>(r - m);
+        double kj = 1.0;
+        for (int j = 0; j <= p; ++j) {
+            A(r, j) = kj;
+            kj *= k;
         }
-        output[i] = sum / count;
     }
-}
 
+    // 2) QR decomposition to obtain an orthonormal basis Q (f x (p+1))
+    // Projection matrix P = Q * Q^T (f x f)
+    Eigen::HouseholderQR<Eigen::MatrixXd> qr(A);
+    Eigen::MatrixXd Q = qr.householderQ() * Eigen::MatrixXd::Identity(f, p + 1);
+    P.reset(new Eigen::MatrixXd(Q * Q.transpose())); // smoothing (d=0) => fitted values = P * y_window
+    return *P;
+}
 
 // MATLAB-like sgolayfilt for 1D data, smoothing only (derivative order d = 0)
 // p: polynomial order, f: frame length (odd)
@@ -95,23 +135,8 @@ std::vector<double> SysUtils::sgolayfilt_matlab_like(
 
     const int m = (f - 1) / 2; // half window
 
-    // 1) Build Vandermonde matrix A (f x (p+1)) with sample positions k = -m..m
-    // A(r, j) = k^j
-    Eigen::MatrixXd A(f, p + 1);
-    for (int r = 0; r < f; ++r) {
-        const double k = static_cast<double>(r - m);
-        double kj = 1.0;
-        for (int j = 0; j <= p; ++j) {
-            A(r, j) = kj;
-            kj *= k;
-        }
-    }
-
-    // 2) QR decomposition to obtain an orthonormal basis Q (f x (p+1))
-    // Projection matrix P = Q * Q^T (f x f)
-    Eigen::HouseholderQR<Eigen::MatrixXd> qr(A);
-    Eigen::MatrixXd Q = qr.householderQ() * Eigen::MatrixXd::Identity(f, p + 1);
-    Eigen::MatrixXd P = Q * Q.transpose(); // smoothing (d=0) => fitted values = P * y_window
+    // 1)~2) 投影矩阵只与(p, f)有关，缓存后复用
+    const Eigen::MatrixXd& P = sgolayProjection(p, f);
 
     // 3) Apply with MATLAB-like boundary handling:
     //    - left edge: window is x[0..f-1], row = i
@@ -144,3 +169,103 @@ std::vector<double> SysUtils::sgolayfilt_matlab_like(
 
     return y;
 }
+
+// 多次滤波的合成系数
+struct SgolayComposite
+{
+    int halfWidth = 0;          // 合成中心核半宽 R = passes*m
+    int edgeCols = 0;           // 边界行的系数个数
+    std::vector<double> center; // 中心核，长度2R+1
+    std::vector<double> edge;   // 左边界R行，每行edgeCols个系数；右边界与左边界镜像对称
+};
+
+static std::shared_ptr<const SgolayComposite> sgolayComposite(int p, int f, int passes)
+{
+    static std::mutex mutex;
+    static std::map<std::tuple<int, int, int>, std::shared_ptr<const SgolayComposite>> cache;
+
+    {
+        std::lock_guard<std::mutex> locker(mutex);
+        auto it = cache.find(std::make_tuple(p, f, passes));
+        if (it != cache.end())
+            return it->second;
+    }
+
+    const Eigen::MatrixXd& P = sgolayProjection(p, f);
+    const int m = (f - 1) / 2;
+
+    std::shared_ptr<SgolayComposite> composite(new SgolayComposite);
+    composite->halfWidth = passes * m;
+
+    // 中心核：各次滤波中心行的卷积
+    composite->center.assign(1, 1.0);
+    for (int k = 0; k < passes; ++k) {
+        std::vector<double> next(composite->center.size() + f - 1, 0.0);
+        for (std::size_t i = 0; i < composite->center.size(); ++i)
+            for (int j = 0; j < f; ++j)
+                next[i + j] += composite->center[i] * P(m, j);
+        composite->center.swap(next);
+    }
+
+    // 边界行：对单位脉冲逐次滤波得到，左边界第i行只与x[0..edgeCols-1]有关
+    const int R = composite->halfWidth;
+    composite->edgeCols = 2 * R + f;
+    const int L = 2 * composite->edgeCols;
+    composite->edge.assign(static_cast<std::size_t>(R) * composite->edgeCols, 0.0);
+    for (int k = 0; k < composite->edgeCols; ++k) {
+        std::vector<double> impulse(L, 0.0);
+        impulse[k] = 1.0;
+        for (int pass = 0; pass < passes; ++pass)
+            impulse = SysUtils::sgolayfilt_matlab_like(impulse, p, f);
+        for (int i = 0; i < R; ++i)
+            composite->edge[static_cast<std::size_t>(i) * composite->edgeCols + k] = impulse[i];
+    }
+
+    std::lock_guard<std::mutex> locker(mutex);
+    cache[std::make_tuple(p, f, passes)] = composite;
+    return composite;
+}
+
+void SysUtils::sgolayfilt_repeat(const double* x, int N, int p, int f, int passes, int first, int last, double* y)
+{
+    if (passes <= 0 || N <= 0) {
+        throw std::invalid_argument("passes and N must be > 0.");
+    }
+    first = std::max(first, 0);
+    last = std::min(last, N - 1);
+    if (first > last)
+        return;
+
+    const int m = (f - 1) / 2;
+    const int minLength = 2 * (2 * passes * m + f);
+    if (N < minLength) {
+        // 数据太短，左右边界相互影响，直接逐次滤波
+        std::vector<double> data(x, x + N);
+        for (int pass = 0; pass < passes; ++pass)
+            data = sgolayfilt_matlab_like(data, p, f);
+        std::copy(data.begin() + first, data.begin() + last + 1, y + first);
+        return;
+    }
+
+    std::shared_ptr<const SgolayComposite> composite = sgolayComposite(p, f, passes);
+    const int R = composite->halfWidth;
+    const int C = composite->edgeCols;
+    const double* center = composite->center.data();
+    for (int i = first; i <= last; ++i) {
+        double acc = 0.0;
+        if (i < R) {
+            const double* row = composite->edge.data() + static_cast<std::size_t>(i) * C;
+            for (int k = 0; k < C; ++k)
+                acc += row[k] * x[k];
+        } else if (i > N - 1 - R) {
+            const double* row = composite->edge.data() + static_cast<std::size_t>(N - 1 - i) * C;
+            for (int k = 0; k < C; ++k)
+                acc += row[k] * x[N - 1 - k];
+        } else {
+            const double* window = x + (i - R);
+            for (int k = 0; k <= 2 * R; ++k)
+                acc += center[k] * window[k];
+        }
+        y[i] = acc;
+    }
+}
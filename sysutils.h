@@ -6,12 +6,20 @@ class SysUtils
 public:
     SysUtils();
 
-    // 滑动平均滤波函数
+    // 滑动平均滤波函数，边界处窗口对称收缩
     static void smooth(double *data, double *output, int data_size, int window_size);
 
+    // 连续两次滑动平均滤波，结果与调用两次smooth一致
+    // scratch为调用方提供的临时缓冲区，长度不小于2*data_size+1
+    static void smoothTwice(const double *data, double *output, double *scratch, int data_size, int window_size);
+
     // MATLAB-like sgolayfilt for 1D data, smoothing only (derivative order d = 0)
     // p: polynomial order, f: frame length (odd)
     static std::vector<double> sgolayfilt_matlab_like(const std::vector<double>& x,int p,int f);
+
+    // 连续passes次sgolayfilt_matlab_like的合成滤波，结果与逐次滤波一致（含边界行）
+    // 合成系数按(p, f, passes)缓存，只计算y[first..last]，其余元素不修改
+    static void sgolayfilt_repeat(const double* x, int N, int p, int f, int passes, int first, int last, double* y);
 };
 
 #endif // SYSUTILS_H
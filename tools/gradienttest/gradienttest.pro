@@ -0,0 +1,28 @@
+QT       += core
+QT       -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+# 拟合梯度方式对比测试：CurveFit::fit_*的AnalyticGradient与NumericGradient，独立于主程序构建
+SOURCES += \
+    ../../curveFit.cpp \
+    ../../spectrumkernels.cpp \
+    main.cpp
+
+HEADERS += \
+    ../../curveFit.h \
+    ../../spectrumkernels.h
+
+INCLUDEPATH += $$PWD/../..
+include($$PWD/../../../3rdParty/alglib-cpp/alglib.pri)
+INCLUDEPATH += $$PWD/../../../3rdParty/eigen-5.0.0
+
+DESTDIR = $$PWD/../../../build_Zr_ActivationPro/tools
+
+CONFIG -= debug_and_release
+CONFIG(debug, debug|release) {
+    TARGET = GradientTestd
+} else {
+    TARGET = GradientTest
+}
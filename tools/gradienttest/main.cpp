@@ -0,0 +1,287 @@
+/*
+ * @Author: MrPan
+ * @Date: 2026-02-09 17:03:46
+ * @LastEditors: Maoxiaoqing
+ * @LastEditTime: 2026-02-09 17:03:46
+ * @Description: 拟合梯度方式对比测试。在909keV窗口（剥谱窗口800~1100keV、909keV峰附近的窄窗口）和909keV计数衰减曲线上，
+ *               分别用AnalyticGradient与NumericGradient调用CurveFit::fit_2gauss_ploy4、fit_gauss_ploy4、
+ *               fit_gauss_linear2、fit_gauss_linear（峰位固定，寻峰时用的模型）、fit_log，
+ *               输出两种方式的参数差、909keV峰面积差、拟合优度和耗时。
+ *               两种方式都须拟合成功，解析梯度的拟合优度不低于有限差分，峰面积（fit_log为c0）的相对差不超过--tolerance。
+ *               例：GradientTest --seed 1 --repeat 5
+ */
+#include "curveFit.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <functional>
+#include <random>
+
+namespace {
+
+const double energyScale[2] = {1.272, -26.87};
+const double stripEnRange[2] = {800.0, 1100.0};
+const double sqrt2Pi = 2.5066282746310002;
+
+// 一种梯度方式的拟合结果
+struct Result {
+    bool ok = false;
+    double c[11] = {0};
+    double r2 = 0.0;
+    qint64 elapsed = 0; // us
+};
+
+// 一个拟合函数的统计
+struct Summary {
+    QString name;
+    int cases = 0;
+    int failed = 0;
+    double maxParamDelta = 0.0;  // 参数最大相对差
+    double maxAreaDelta = 0.0;   // 909keV峰面积（fit_log为c0）最大相对差
+    qint64 analyticTime = 0;     // us
+    qint64 numericTime = 0;      // us
+};
+
+// 一个测试窗口：数据点、初值和拟合函数
+struct Case {
+    QVector<QPointF> points;
+    double start[11] = {0};
+    int paramCount = 0;
+    int areaIndex = -1;          // 909keV峰幅度的下标；-1表示比较c0
+    int widthIndex = -1;         // 909keV峰宽的下标
+    std::function<bool(QVector<QPointF>, double*, CurveFit::GradientMode)> fit;
+    std::function<void(const double*, const double*, int, double*)> evaluate;
+};
+
+double rSquare(const QVector<QPointF>& points, const double* c, const Case& test)
+{
+    int n = points.size();
+    QVector<double> x(n), curve(n);
+    double mean = 0.0;
+    for (int i=0; i<n; ++i)
+    {
+        x[i] = points[i].x();
+        mean += points[i].y();
+    }
+    mean /= n;
+    test.evaluate(c, x.constData(), n, curve.data());
+
+    double rss = 0.0, tss = 0.0;
+    for (int i=0; i<n; ++i)
+    {
+        rss += (points[i].y() - curve[i]) * (points[i].y() - curve[i]);
+        tss += (points[i].y() - mean) * (points[i].y() - mean);
+    }
+    return tss > 0.0 ? 1.0 - rss / tss : 1.0;
+}
+
+Result runFit(const Case& test, CurveFit::GradientMode mode)
+{
+    Result result;
+    std::copy(test.start, test.start + test.paramCount, result.c);
+
+    QElapsedTimer timer;
+    timer.start();
+    result.ok = test.fit(test.points, result.c, mode);
+    result.elapsed = timer.nsecsElapsed() / 1000;
+    result.r2 = rSquare(test.points, result.c, test);
+    return result;
+}
+
+double area(const Result& result, const Case& test)
+{
+    if (test.areaIndex < 0)
+        return result.c[0];
+    return result.c[test.areaIndex] * fabs(result.c[test.widthIndex]) * sqrt2Pi;
+}
+
+double relativeDelta(double a, double b)
+{
+    double scale = qMax(fabs(a), fabs(b));
+    return scale > 0.0 ? fabs(a - b) / scale : 0.0;
+}
+
+// 909keV峰（可选846keV峰）+指数本底，计数为泊松抽样
+QVector<QPointF> makeWindow(double left, double right, double amplitude, bool twoPeaks, std::mt19937& rng)
+{
+    int leftCH = int(floor((left - energyScale[1]) / energyScale[0]));
+    int rightCH = int(floor((right - energyScale[1]) / energyScale[0]));
+    QVector<QPointF> points;
+    for (int i = leftCH; i < rightCH; ++i)
+    {
+        double e = (i+1) * energyScale[0] + energyScale[1];
+        double value = amplitude * (0.5 * exp(-(e - 800.0) / 250.0) + 0.05) + 20.0;
+        value += amplitude * exp(-0.5 * pow((e - 909.1) / 11.2, 2));
+        if (twoPeaks)
+            value += 0.4 * amplitude * exp(-0.5 * pow((e - 846.2) / 10.5, 2));
+        std::poisson_distribution<int> poisson(value);
+        points.push_back(QPointF(e, poisson(rng)));
+    }
+    return points;
+}
+
+// 与ParseData相同的初值给法：幅度、峰宽取自寻峰结果（这里在真值上加20%以内的偏差），峰位取标称值，本底系数为0
+QVector<Case> makeCases(double amplitude, std::mt19937& rng)
+{
+    std::uniform_real_distribution<double> bias(0.8, 1.2);
+    QVector<Case> cases(5);
+
+    Case& two = cases[0];
+    two.points = makeWindow(stripEnRange[0], stripEnRange[1], amplitude, true, rng);
+    double twoStart[11] = {0.4 * amplitude * bias(rng), 846, 10.5 / energyScale[0] * bias(rng),
+                           amplitude * bias(rng), 909, 11.2 / energyScale[0] * bias(rng), 0, 0, 0, 0, 0};
+    std::copy(twoStart, twoStart + 11, two.start);
+    two.paramCount = 11;
+    two.areaIndex = 3;
+    two.widthIndex = 5;
+    two.fit = [](QVector<QPointF> points, double* c, CurveFit::GradientMode mode) {
+        QVector<double> residual;
+        return CurveFit::fit_2gauss_ploy4(points, c, residual, mode);
+    };
+    two.evaluate = CurveFit::evaluate_2gauss_poly4;
+
+    Case& one = cases[1];
+    one.points = makeWindow(stripEnRange[0], stripEnRange[1], amplitude, false, rng);
+    double oneStart[8] = {amplitude * bias(rng), 909, 11.2 / energyScale[0] * bias(rng), 0, 0, 0, 0, 0};
+    std::copy(oneStart, oneStart + 8, one.start);
+    one.paramCount = 8;
+    one.areaIndex = 0;
+    one.widthIndex = 2;
+    one.fit = [](QVector<QPointF> points, double* c, CurveFit::GradientMode mode) {
+        QVector<double> residual;
+        return CurveFit::fit_gauss_ploy4(points, c, residual, mode);
+    };
+    one.evaluate = CurveFit::evaluate_gauss_poly4;
+
+    // 909keV峰±4σ，本底近似为直线
+    Case& linear = cases[2];
+    linear.points = makeWindow(909.1 - 45.0, 909.1 + 45.0, amplitude, false, rng);
+    double linearStart[5] = {amplitude * bias(rng), 909, 11.2 * bias(rng), 0, linear.points.first().y()};
+    std::copy(linearStart, linearStart + 5, linear.start);
+    linear.paramCount = 5;
+    linear.areaIndex = 0;
+    linear.widthIndex = 2;
+    linear.fit = [](QVector<QPointF> points, double* c, CurveFit::GradientMode mode) {
+        return CurveFit::fit_gauss_linear2(points, c, mode);
+    };
+    linear.evaluate = CurveFit::evaluate_gauss_linear2;
+
+    // 同一窗口，峰位固定为909keV，拟合{幅度, 峰宽, 斜率, 截距}
+    const double peak = 909.1;
+    Case& fixedPeak = cases[3];
+    fixedPeak.points = makeWindow(peak - 45.0, peak + 45.0, amplitude, false, rng);
+    double fixedStart[4] = {amplitude * bias(rng), 11.2 * bias(rng), 0, fixedPeak.points.first().y()};
+    std::copy(fixedStart, fixedStart + 4, fixedPeak.start);
+    fixedPeak.paramCount = 4;
+    fixedPeak.areaIndex = 0;
+    fixedPeak.widthIndex = 1;
+    fixedPeak.fit = [peak](QVector<QPointF> points, double* c, CurveFit::GradientMode mode) {
+        double chi_square = 0.0;
+        return CurveFit::fit_gauss_linear(points, c, peak, &chi_square, mode);
+    };
+    fixedPeak.evaluate = [peak](const double* c, const double* x, int n, double* func) {
+        const double c5[5] = {c[0], peak, c[1], c[2], c[3]};
+        CurveFit::evaluate_gauss_linear2(c5, x, n, func);
+    };
+
+    // 909keV计数衰减曲线，时间单位min，与ParseData相同在对数空间拟合，初值10
+    Case& decay = cases[4];
+    for (int t = 0; t < 3600; t += 10)
+    {
+        std::poisson_distribution<int> poisson(amplitude * exp(-CurveFit::lambda89Zr * t));
+        decay.points.push_back(QPointF(t, log(double(qMax(1, poisson(rng))))));
+    }
+    decay.start[0] = 10.0;
+    decay.paramCount = 1;
+    decay.fit = [](QVector<QPointF> points, double* c, CurveFit::GradientMode mode) {
+        QVector<double> residual;
+        return CurveFit::fit_log(points, c, residual, mode);
+    };
+    decay.evaluate = CurveFit::evaluate_log;
+    return cases;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("GradientTest");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("拟合梯度方式对比测试：AnalyticGradient与NumericGradient");
+    parser.addHelpOption();
+    QCommandLineOption seedOption("seed", "随机数种子", "seed", "1");
+    QCommandLineOption repeatOption("repeat", "每个幅度重复的次数", "count", "3");
+    QCommandLineOption toleranceOption("tolerance", "909keV峰面积（fit_log为c0）允许的相对差", "value", "1e-3");
+    parser.addOptions({seedOption, repeatOption, toleranceOption});
+    parser.process(app);
+
+    std::mt19937 rng(parser.value(seedOption).toUInt());
+    int repeat = qMax(1, parser.value(repeatOption).toInt());
+    double tolerance = parser.value(toleranceOption).toDouble();
+    QTextStream out(stdout);
+
+    QVector<Summary> summaries(5);
+    const char* names[] = {"fit_2gauss_ploy4", "fit_gauss_ploy4", "fit_gauss_linear2", "fit_gauss_linear", "fit_log"};
+    for (int i = 0; i < summaries.size(); ++i)
+        summaries[i].name = names[i];
+
+    for (double amplitude : {1e2, 1e3, 1e4, 1e5})
+    {
+        for (int r = 0; r < repeat; ++r)
+        {
+            QVector<Case> cases = makeCases(amplitude, rng);
+            for (int m = 0; m < cases.size(); ++m)
+            {
+                const Case& test = cases[m];
+                Summary& summary = summaries[m];
+                Result analytic = runFit(test, CurveFit::AnalyticGradient);
+                Result numeric = runFit(test, CurveFit::NumericGradient);
+
+                double paramDelta = 0.0;
+                int paramIndex = 0;
+                for (int i = 0; i < test.paramCount; ++i)
+                {
+                    double delta = relativeDelta(analytic.c[i], numeric.c[i]);
+                    if (delta > paramDelta)
+                    {
+                        paramDelta = delta;
+                        paramIndex = i;
+                    }
+                }
+                double areaDelta = relativeDelta(area(analytic, test), area(numeric, test));
+
+                bool pass = analytic.ok && numeric.ok && analytic.r2 >= numeric.r2 - 1e-4 && areaDelta <= tolerance;
+                summary.cases++;
+                summary.failed += pass ? 0 : 1;
+                summary.maxParamDelta = qMax(summary.maxParamDelta, paramDelta);
+                summary.maxAreaDelta = qMax(summary.maxAreaDelta, areaDelta);
+                summary.analyticTime += analytic.elapsed;
+                summary.numericTime += numeric.elapsed;
+
+                out << QString("%1 幅度%2 #%3 %4：解析%5 R2=%6 %7us，差分%8 R2=%9 %10us，")
+                       .arg(summary.name, -18).arg(amplitude, 0, 'g', 3).arg(r).arg(pass ? "PASS" : "FAIL")
+                       .arg(analytic.ok ? "成功" : "失败").arg(analytic.r2, 0, 'f', 6).arg(analytic.elapsed)
+                       .arg(numeric.ok ? "成功" : "失败").arg(numeric.r2, 0, 'f', 6).arg(numeric.elapsed)
+                    << QString("参数最大相对差%1(c%2)，面积相对差%3\n")
+                       .arg(paramDelta, 0, 'e', 2).arg(paramIndex).arg(areaDelta, 0, 'e', 2);
+            }
+        }
+    }
+
+    int failed = 0;
+    out << QString("==== 汇总 ====\n");
+    for (const Summary& summary : qAsConst(summaries))
+    {
+        double speedup = summary.analyticTime > 0 ? double(summary.numericTime) / summary.analyticTime : 0.0;
+        out << QString("%1 %2：%3组，失败%4组，参数最大相对差%5，面积最大相对差%6，解析%7us，差分%8us，加速%9倍\n")
+               .arg(summary.failed == 0 ? "PASS" : "FAIL").arg(summary.name, -18)
+               .arg(summary.cases).arg(summary.failed)
+               .arg(summary.maxParamDelta, 0, 'e', 2).arg(summary.maxAreaDelta, 0, 'e', 2)
+               .arg(summary.analyticTime).arg(summary.numericTime).arg(speedup, 0, 'f', 2);
+        failed += summary.failed;
+    }
+    return failed == 0 ? 0 : 1;
+}
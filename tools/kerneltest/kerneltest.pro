@@ -0,0 +1,24 @@
+QT       += core
+QT       -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+# 能谱基础运算测试：SpectrumKernels的AVX2实现与Scalar标量实现比对，独立于主程序构建
+SOURCES += \
+    ../../spectrumkernels.cpp \
+    main.cpp
+
+HEADERS += \
+    ../../spectrumkernels.h
+
+INCLUDEPATH += $$PWD/../..
+
+DESTDIR = $$PWD/../../../build_Zr_ActivationPro/tools
+
+CONFIG -= debug_and_release
+CONFIG(debug, debug|release) {
+    TARGET = KernelTestd
+} else {
+    TARGET = KernelTest
+}
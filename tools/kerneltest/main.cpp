@@ -0,0 +1,235 @@
+/*
+ * @Author: MrPan
+ * @Date: 2026-02-09 16:48:25
+ * @LastEditors: Maoxiaoqing
+ * @LastEditTime: 2026-02-09 16:48:25
+ * @Description: 能谱基础运算测试。用随机能谱（含接近UINT32_MAX的计数、不足一个SIMD块的尾部、非对齐地址）
+ *               比对SpectrumKernels各函数与Scalar标量实现的结果：整数运算要求完全一致，浮点运算按相对误差判断，
+ *               exp覆盖上溢、次正规数和NaN/inf。CPU不支持AVX2时两者走同一实现，测试仍可运行。
+ *               例：KernelTest --seed 1 --repeat 20
+ */
+#include "spectrumkernels.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QTextStream>
+#include <QVector>
+#include <cmath>
+#include <limits>
+#include <random>
+
+namespace {
+
+// 覆盖不足一个块、恰好整块、整块加尾部的长度
+const int lengths[] = {0, 1, 3, 4, 7, 8, 9, 31, 32, 33, 63, 100, 1023, 1024, 8192, 8195};
+
+// 一个函数的比对结果，只记录第一处不一致
+struct Check {
+    QString name;
+    int cases = 0;
+    int failures = 0;
+    QString firstFailure;
+
+    void verify(bool ok, const QString& what)
+    {
+        cases++;
+        if (ok)
+            return;
+        if (failures++ == 0)
+            firstFailure = what;
+    }
+};
+
+// 随机能谱：一半为一般计数，一半为接近UINT32_MAX的计数，用于检查64位累加不溢出
+QVector<quint32> randomSpectrum(int n, bool large, std::mt19937& rng)
+{
+    std::uniform_int_distribution<quint32> small(0, 5000);
+    std::uniform_int_distribution<quint32> big(std::numeric_limits<quint32>::max() - 1000, std::numeric_limits<quint32>::max());
+    QVector<quint32> spectrum(n);
+    for (quint32& value : spectrum)
+        value = large ? big(rng) : small(rng);
+    return spectrum;
+}
+
+template<typename T>
+QVector<T> randomBase(int n, std::mt19937& rng)
+{
+    std::uniform_int_distribution<quint32> base(0, 1u << 30);
+    QVector<T> result(n);
+    for (T& value : result)
+        value = T(base(rng));
+    return result;
+}
+
+bool closeTo(double value, double reference, double relative)
+{
+    if (std::isnan(reference))
+        return std::isnan(value);
+    if (std::isinf(reference))
+        return value == reference;
+    double tolerance = std::fmax(relative * std::fabs(reference), 2 * std::numeric_limits<double>::denorm_min());
+    return std::fabs(value - reference) <= tolerance;
+}
+
+void checkRebin(Check& rebin, Check& rebinAccumulate, std::mt19937& rng)
+{
+    for (int factor : {2, 4, 8})
+    {
+        for (int n : lengths)
+        {
+            int channels = (n + 1) * factor;
+            for (bool large : {false, true})
+            {
+                // 源数据从第1个元素开始，保证AVX2读取非对齐地址
+                QVector<quint32> src = randomSpectrum(channels + 1, large, rng);
+                QString what = QString("factor=%1 channels=%2 large=%3").arg(factor).arg(channels).arg(large);
+
+                QVector<quint64> dst(channels / factor, 0xDEADBEEF), reference(channels / factor, 0);
+                bool ok = SpectrumKernels::rebin(src.constData() + 1, channels, factor, dst.data());
+                SpectrumKernels::Scalar::rebinAccumulate(src.constData() + 1, channels, factor, reference.data());
+                rebin.verify(ok && dst == reference, what);
+
+                QVector<quint64> base = randomBase<quint64>(channels / factor, rng);
+                dst = base;
+                reference = base;
+                ok = SpectrumKernels::rebinAccumulate(src.constData() + 1, channels, factor, dst.data());
+                SpectrumKernels::Scalar::rebinAccumulate(src.constData() + 1, channels, factor, reference.data());
+                rebinAccumulate.verify(ok && dst == reference, what);
+            }
+        }
+    }
+
+    // 不合法的参数返回false，且不写输出
+    QVector<quint32> src = randomSpectrum(64, false, rng);
+    const int invalid[][2] = {{64, 3}, {64, 16}, {64, 0}, {0, 2}, {-8, 2}, {30, 4}, {63, 8}};
+    for (const auto& args : invalid)
+    {
+        QVector<quint64> dst(64, 7);
+        QString what = QString("非法参数 channels=%1 factor=%2").arg(args[0]).arg(args[1]);
+        bool ok = SpectrumKernels::rebin(src.constData(), args[0], args[1], dst.data());
+        rebin.verify(!ok && dst == QVector<quint64>(64, 7), what);
+        ok = SpectrumKernels::rebinAccumulate(src.constData(), args[0], args[1], dst.data());
+        rebinAccumulate.verify(!ok && dst == QVector<quint64>(64, 7), what);
+    }
+}
+
+void checkAccumulate(Check& accumulate64, Check& accumulateDouble, Check& weighted, Check& total, std::mt19937& rng)
+{
+    std::uniform_real_distribution<double> weights(1.0, 3.0);
+    for (int n : lengths)
+    {
+        for (bool large : {false, true})
+        {
+            QVector<quint32> src = randomSpectrum(n + 1, large, rng);
+            const quint32* s = src.constData() + 1;
+            QString what = QString("n=%1 large=%2").arg(n).arg(large);
+
+            QVector<quint64> dst64 = randomBase<quint64>(n, rng);
+            QVector<quint64> reference64 = dst64;
+            SpectrumKernels::accumulate(s, n, dst64.data());
+            SpectrumKernels::Scalar::accumulate(s, n, reference64.data());
+            accumulate64.verify(dst64 == reference64, what);
+
+            // 计数与底数都是小于2^53的整数，double累加结果是精确的
+            QVector<double> dst = randomBase<double>(n, rng);
+            QVector<double> reference = dst;
+            SpectrumKernels::accumulate(s, n, dst.data());
+            SpectrumKernels::Scalar::accumulate(s, n, reference.data());
+            accumulateDouble.verify(dst == reference, what);
+
+            double weight = weights(rng);
+            dst = randomBase<double>(n, rng);
+            reference = dst;
+            SpectrumKernels::accumulateWeighted(s, n, weight, dst.data());
+            SpectrumKernels::Scalar::accumulateWeighted(s, n, weight, reference.data());
+            bool ok = true;
+            for (int i = 0; i < n && ok; ++i)
+                ok = closeTo(dst[i], reference[i], 4 * std::numeric_limits<double>::epsilon());
+            weighted.verify(ok, what + QString(" weight=%1").arg(weight, 0, 'g', 17));
+
+            total.verify(SpectrumKernels::totalCount(s, n) == SpectrumKernels::Scalar::totalCount(s, n), what);
+        }
+    }
+}
+
+void checkExp(Check& check, std::mt19937& rng)
+{
+    // 全范围、多项式主区间、次正规数区间、上溢边界
+    const double ranges[][2] = {{-760.0, 720.0}, {-1.0, 1.0}, {-708.5, -708.0}, {-745.2, -744.0}, {709.0, 710.0}};
+    for (const auto& range : ranges)
+    {
+        std::uniform_real_distribution<double> values(range[0], range[1]);
+        for (int n : lengths)
+        {
+            QVector<double> src(n + 1);
+            for (double& value : src)
+                value = values(rng);
+
+            QVector<double> dst(n), reference(n);
+            SpectrumKernels::exp(src.constData() + 1, n, dst.data());
+            SpectrumKernels::Scalar::exp(src.constData() + 1, n, reference.data());
+            for (int i = 0; i < n; ++i)
+                check.verify(closeTo(dst[i], reference[i], 1e-14),
+                             QString("x=%1 exp=%2 std::exp=%3").arg(src[i + 1], 0, 'g', 17)
+                             .arg(dst[i], 0, 'g', 17).arg(reference[i], 0, 'g', 17));
+        }
+    }
+
+    // 特殊值，凑满两个SIMD块
+    const double inf = std::numeric_limits<double>::infinity();
+    const double special[] = {0.0, -0.0, 1.0, -1.0, inf, -inf, std::numeric_limits<double>::quiet_NaN(),
+                              709.78, 709.79, -708.39, -708.40, -745.13, -745.14, -746.0, -1e300, 1e300};
+    const int n = int(sizeof(special) / sizeof(special[0]));
+    double dst[n], reference[n];
+    SpectrumKernels::exp(special, n, dst);
+    SpectrumKernels::Scalar::exp(special, n, reference);
+    for (int i = 0; i < n; ++i)
+        check.verify(closeTo(dst[i], reference[i], 1e-14),
+                     QString("x=%1 exp=%2 std::exp=%3").arg(special[i], 0, 'g', 17)
+                     .arg(dst[i], 0, 'g', 17).arg(reference[i], 0, 'g', 17));
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("KernelTest");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("能谱基础运算测试：SpectrumKernels与Scalar标量实现比对");
+    parser.addHelpOption();
+    QCommandLineOption seedOption("seed", "随机数种子", "seed", "1");
+    QCommandLineOption repeatOption("repeat", "随机数据重复的轮数", "count", "5");
+    parser.addOptions({seedOption, repeatOption});
+    parser.process(app);
+
+    std::mt19937 rng(parser.value(seedOption).toUInt());
+    int repeat = qMax(1, parser.value(repeatOption).toInt());
+    QTextStream out(stdout);
+    out << QString("AVX2：%1\n").arg(SpectrumKernels::hasAVX2() ? QString("支持") : QString("不支持，仅比对标量实现"));
+
+    QVector<Check> checks(7);
+    const char* names[] = {"rebin", "rebinAccumulate", "accumulate(quint64)", "accumulate(double)",
+                           "accumulateWeighted", "totalCount", "exp"};
+    for (int i = 0; i < checks.size(); ++i)
+        checks[i].name = names[i];
+
+    for (int r = 0; r < repeat; ++r)
+    {
+        checkRebin(checks[0], checks[1], rng);
+        checkAccumulate(checks[2], checks[3], checks[4], checks[5], rng);
+        checkExp(checks[6], rng);
+    }
+
+    int failed = 0;
+    for (const Check& check : qAsConst(checks))
+    {
+        out << QString("%1 %2：%3组，不一致%4组").arg(check.failures == 0 ? "PASS" : "FAIL")
+               .arg(check.name, -20).arg(check.cases).arg(check.failures);
+        if (check.failures > 0)
+            out << QString("，首个：") << check.firstFailure;
+        out << "\n";
+        failed += check.failures > 0 ? 1 : 0;
+    }
+    return failed == 0 ? 0 : 1;
+}
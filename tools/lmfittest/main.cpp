@@ -0,0 +1,216 @@
+/*
+ * @Author: MrPan
+ * @Date: 2026-02-09 16:05:12
+ * @LastEditors: Maoxiaoqing
+ * @LastEditTime: 2026-02-09 16:05:12
+ * @Description: 剥谱拟合对比测试。按ParseData的剥谱窗口（800~1100keV，能量刻度1.272、-26.87）生成含846/909keV峰的
+ *               模拟能谱，以ParseData给出的初值（幅度、峰宽取自寻峰结果，峰位846/909，本底系数为0）分别用
+ *               alglib参考实现、未做换元的LM::fit、CurveFit::fit_strip拟合，比较参数、909keV峰面积和拟合优度。
+ *               例：LmFitTest --seed 1 --repeat 5
+ */
+#include "curveFit.h"
+#include "lmsolver.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <random>
+
+namespace {
+
+const double energyScale[2] = {1.272, -26.87};
+const double stripEnRange[2] = {800.0, 1100.0};
+const double stripMinR2 = 0.9;
+const double sqrt2Pi = 2.5066282746310002;
+
+// 模拟能谱的真值
+struct Truth {
+    double a846, mu846, sigma846;
+    double a909, mu909, sigma909;
+    double area909() const { return a909 * sigma909 * sqrt2Pi; }
+};
+
+// 一种拟合方法的结果
+struct Result {
+    bool ok = false;
+    double c[11] = {0};
+    double r2 = 0.0;
+    qint64 elapsed = 0; // us
+};
+
+double rSquare(const double* y, const double* curve, int n)
+{
+    double mean = 0.0;
+    for (int i=0; i<n; ++i)
+        mean += y[i];
+    mean /= n;
+    double rss = 0.0, tss = 0.0;
+    for (int i=0; i<n; ++i)
+    {
+        rss += (y[i] - curve[i]) * (y[i] - curve[i]);
+        tss += (y[i] - mean) * (y[i] - mean);
+    }
+    return tss > 0.0 ? 1.0 - rss / tss : 1.0;
+}
+
+// 与ParseData::SpecStripping相同的剥谱窗口，计数为泊松抽样（不做平滑）
+void makeWindow(const Truth& truth, bool twoPeaks, std::mt19937& rng, QVector<double>& x, QVector<double>& y)
+{
+    int leftCH = int(floor((stripEnRange[0] - energyScale[1]) / energyScale[0]));
+    int rightCH = int(floor((stripEnRange[1] - energyScale[1]) / energyScale[0]));
+    x.clear();
+    y.clear();
+    for (int i = leftCH; i < rightCH; ++i)
+    {
+        double e = (i+1) * energyScale[0] + energyScale[1];
+        double background = truth.a909 * (0.5 * exp(-(e - 800.0) / 250.0) + 0.05) + 20.0;
+        double value = background + truth.a909 * exp(-0.5 * pow((e - truth.mu909) / truth.sigma909, 2));
+        if (twoPeaks)
+            value += truth.a846 * exp(-0.5 * pow((e - truth.mu846) / truth.sigma846, 2));
+        std::poisson_distribution<int> poisson(value);
+        x.push_back(e);
+        y.push_back(poisson(rng));
+    }
+}
+
+// ParseData::initialFit给出的初值：幅度、峰宽（道）来自寻峰拟合，这里在真值上加20%以内的偏差模拟
+void makeStartValues(const Truth& truth, std::mt19937& rng, double* c)
+{
+    std::uniform_real_distribution<double> bias(0.8, 1.2);
+    double start[11] = {truth.a846 * bias(rng), 846, truth.sigma846 / energyScale[0] * bias(rng),
+                        truth.a909 * bias(rng), 909, truth.sigma909 / energyScale[0] * bias(rng),
+                        0.0, 0.0, 0.0, 0.0, 0.0};
+    std::copy(start, start + 11, c);
+}
+
+Result fitReference(const QVector<double>& x, const QVector<double>& y, const double* start, bool twoPeaks)
+{
+    Result result;
+    std::copy(start + (twoPeaks ? 0 : 3), start + 11, result.c);
+    QVector<QPointF> points(x.size());
+    for (int i=0; i<x.size(); ++i)
+        points[i] = QPointF(x[i], y[i]);
+    QVector<double> residual, curve(x.size());
+
+    QElapsedTimer timer;
+    timer.start();
+    result.ok = twoPeaks ? CurveFit::fit_2gauss_ploy4(points, result.c, residual)
+                         : CurveFit::fit_gauss_ploy4(points, result.c, residual);
+    result.elapsed = timer.nsecsElapsed() / 1000;
+
+    if (twoPeaks)
+        CurveFit::evaluate_2gauss_poly4(result.c, x.constData(), x.size(), curve.data());
+    else
+        CurveFit::evaluate_gauss_poly4(result.c, x.constData(), x.size(), curve.data());
+    result.r2 = rSquare(y.constData(), curve.constData(), x.size());
+    return result;
+}
+
+// 与修改前的SpecStripping相同：不换元，直接从初值做LM::fit
+template<typename Model, int N = Model::ParamCount>
+Result fitPlainLM(const QVector<double>& x, const QVector<double>& y, const double* start)
+{
+    Result result;
+    CurveFit::LM::Params<N> p;
+    for (int i=0; i<N; ++i)
+        p[i] = start[11 - N + i];
+
+    CurveFit::LM::Report report;
+    QElapsedTimer timer;
+    timer.start();
+    result.ok = CurveFit::LM::fit(Model(), x.constData(), y.constData(), x.size(), p, CurveFit::LM::Options(), &report);
+    result.elapsed = timer.nsecsElapsed() / 1000;
+    for (int i=0; i<N; ++i)
+        result.c[i] = p[i];
+    result.r2 = report.r2;
+    return result;
+}
+
+Result fitStrip(const QVector<double>& x, const QVector<double>& y, const double* start, bool twoPeaks, bool& usedReference)
+{
+    Result result;
+    std::copy(start + (twoPeaks ? 0 : 3), start + 11, result.c);
+    QVector<double> curve(x.size());
+
+    QElapsedTimer timer;
+    timer.start();
+    result.ok = CurveFit::fit_strip(x.constData(), y.constData(), x.size(), result.c, twoPeaks, stripMinR2, curve.data(), &usedReference);
+    result.elapsed = timer.nsecsElapsed() / 1000;
+    result.r2 = rSquare(y.constData(), curve.constData(), x.size());
+    return result;
+}
+
+QString describe(const Result& result, bool twoPeaks, const Truth& truth)
+{
+    // 909keV峰参数在单高斯时位于c[0..2]，双高斯时位于c[3..5]
+    const double* c909 = result.c + (twoPeaks ? 3 : 0);
+    double area = c909[0] * fabs(c909[2]) * sqrt2Pi;
+    return QString("%1 A909=%2 mu909=%3 sigma909=%4 area909误差=%5% R2=%6 耗时=%7us")
+        .arg(result.ok ? "成功" : "失败")
+        .arg(c909[0], 0, 'g', 6).arg(c909[1], 0, 'f', 3).arg(c909[2], 0, 'f', 3)
+        .arg((area - truth.area909()) / truth.area909() * 100.0, 0, 'f', 3)
+        .arg(result.r2, 0, 'f', 5).arg(result.elapsed);
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("LmFitTest");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("剥谱拟合对比测试：CurveFit::fit_strip、LM::fit与alglib参考实现");
+    parser.addHelpOption();
+    QCommandLineOption seedOption("seed", "随机数种子", "seed", "1");
+    QCommandLineOption repeatOption("repeat", "每个幅度重复的次数", "count", "3");
+    parser.addOptions({seedOption, repeatOption});
+    parser.process(app);
+
+    std::mt19937 rng(parser.value(seedOption).toUInt());
+    int repeat = qMax(1, parser.value(repeatOption).toInt());
+    QTextStream out(stdout);
+
+    int total = 0, failed = 0, fallback = 0, plainValid = 0;
+    for (bool twoPeaks : {true, false})
+    {
+        out << QString(twoPeaks ? "==== 双高斯（846+909keV）====" : "==== 单高斯（909keV）====") << "\n";
+        for (double amplitude : {1e2, 1e3, 1e4, 1e5})
+        {
+            for (int r = 0; r < repeat; ++r)
+            {
+                Truth truth = {0.4 * amplitude, 846.2, 10.5, amplitude, 909.1, 11.2};
+                QVector<double> x, y;
+                makeWindow(truth, twoPeaks, rng, x, y);
+                double start[11];
+                makeStartValues(truth, rng, start);
+
+                bool usedReference = false;
+                Result reference = fitReference(x, y, start, twoPeaks);
+                Result plain = twoPeaks ? fitPlainLM<CurveFit::LM::TwoGaussPoly4>(x, y, start)
+                                        : fitPlainLM<CurveFit::LM::GaussPoly4>(x, y, start);
+                Result strip = fitStrip(x, y, start, twoPeaks, usedReference);
+
+                // 未换元的LM::fit即使报告收敛，也可能停在本底发散的驻点上，这里按幅度、峰宽、拟合优度判断
+                const double* c909 = plain.c + (twoPeaks ? 3 : 0);
+                bool plainOk = plain.ok && c909[0] > 0.0 && c909[2] > 0.0 && plain.r2 >= stripMinR2;
+
+                // fit_strip必须给出有效结果，且不比alglib参考实现差
+                bool pass = strip.ok && (!reference.ok || strip.r2 >= reference.r2 - 1e-4);
+                total++;
+                failed += pass ? 0 : 1;
+                fallback += usedReference ? 1 : 0;
+                plainValid += plainOk ? 1 : 0;
+
+                out << QString("幅度%1 #%2 %3\n").arg(amplitude, 0, 'g', 3).arg(r).arg(pass ? "PASS" : "FAIL");
+                out << "  alglib    : " << describe(reference, twoPeaks, truth) << "\n";
+                out << QString("  LM(未换元): ") << describe(plain, twoPeaks, truth) << QString(plainOk ? "" : " 结果不合理") << "\n";
+                out << "  fit_strip : " << describe(strip, twoPeaks, truth) << QString(usedReference ? " 改用alglib" : "") << "\n";
+            }
+        }
+    }
+
+    out << QString("共%1组，fit_strip失败%2组，改用alglib%3组；未换元LM::fit结果合理%4组\n")
+           .arg(total).arg(failed).arg(fallback).arg(plainValid);
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,210 @@
+/*
+ * @Author: MrPan
+ * @Date: 2026-02-09 17:21:09
+ * @LastEditors: Maoxiaoqing
+ * @LastEditTime: 2026-02-09 17:21:09
+ * @Description: 滑动平均回归测试。用模拟能谱（511/846/909keV峰+指数本底，计数为泊松抽样）和长度、窗口的各种组合，
+ *               比对前缀和实现的SysUtils::smooth/smoothTwice与原O(n*w)实现：计数数据单次平滑须逐位一致，
+ *               两次平滑的误差按数据最大值归一化后不超过--tolerance；窗口为偶数或大于数据长度时输出不变。
+ *               同时给出2048道、窗口5时两种实现的耗时。例：SmoothTest --seed 1 --repeat 10
+ */
+#include "sysutils.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QVector>
+#include <cmath>
+#include <random>
+
+namespace {
+
+// 修改前的SysUtils::smooth：逐点对窗口求和，再重新处理左右边界
+void legacySmooth(const double *data, double *output, int data_size, int window_size)
+{
+    if (window_size > data_size)
+        return;
+    if (window_size%2 == 0)
+        return;
+
+    int halfWindow = (window_size - 1) / 2;
+
+    // 计算每个点的滑动平均值
+    for (int i = 0; i < data_size; i++) {
+        double sum = 0.0;
+        int count = 0;
+        for (int j = i - (window_size - 1) / 2; j <= i + (window_size - 1) / 2; j++) {
+            if (j >= 0 && j < data_size) {
+                sum += data[j];
+                count++;
+            }
+        }
+        output[i] = sum / count;
+    }
+
+    // 重新处理左边界情况
+    for (int i = 0; i < halfWindow; i++) {
+        double sum = 0.0;
+        int count = 0;
+        for (int j = 0; j <= i + i; j++) {
+            sum += data[j];
+            count++;
+        }
+        output[i] = sum / count;
+    }
+
+    // 重新处理右边界情况
+    for (int i = data_size - halfWindow; i < data_size; i++) {
+        double sum = 0.0;
+        int count = 0;
+        int leftPoint = data_size - i- 1;
+        for (int j = i - leftPoint; j < data_size; j++) {
+            sum += data[j];
+            count++;
+        }
+        output[i] = sum / count;
+    }
+}
+
+// 模拟能谱，能量刻度1.272keV/道，长度不是2048时按比例缩放峰位
+QVector<double> makeSpectrum(int n, double amplitude, std::mt19937& rng)
+{
+    const double peaks[][3] = {{511.0, 0.3, 9.0}, {846.2, 0.4, 10.5}, {909.1, 1.0, 11.2}};
+    double keVPerChannel = 1.272 * 2048.0 / qMax(n, 1);
+    QVector<double> spectrum(n);
+    for (int i = 0; i < n; ++i)
+    {
+        double e = (i + 1) * keVPerChannel;
+        double value = amplitude * 0.5 * exp(-e / 400.0) + 1.0;
+        for (const auto& peak : peaks)
+            value += amplitude * peak[1] * exp(-0.5 * pow((e - peak[0]) / peak[2], 2));
+        std::poisson_distribution<int> poisson(value);
+        spectrum[i] = poisson(rng);
+    }
+    return spectrum;
+}
+
+// 以数据最大值归一化的最大误差
+double scaledError(const QVector<double>& value, const QVector<double>& reference)
+{
+    double scale = 0.0, error = 0.0;
+    for (int i = 0; i < reference.size(); ++i)
+    {
+        scale = qMax(scale, fabs(reference[i]));
+        error = qMax(error, fabs(value[i] - reference[i]));
+    }
+    return scale > 0.0 ? error / scale : error;
+}
+
+struct Check {
+    int cases = 0;
+    int failures = 0;
+    double maxError = 0.0;
+    QString firstFailure;
+
+    void verify(bool ok, double error, const QString& what)
+    {
+        cases++;
+        maxError = qMax(maxError, error);
+        if (!ok && failures++ == 0)
+            firstFailure = what;
+    }
+};
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("SmoothTest");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("滑动平均回归测试：SysUtils::smooth/smoothTwice与原O(n*w)实现");
+    parser.addHelpOption();
+    QCommandLineOption seedOption("seed", "随机数种子", "seed", "1");
+    QCommandLineOption repeatOption("repeat", "随机能谱重复的轮数", "count", "5");
+    QCommandLineOption toleranceOption("tolerance", "两次平滑允许的误差（按数据最大值归一化）", "value", "1e-12");
+    parser.addOptions({seedOption, repeatOption, toleranceOption});
+    parser.process(app);
+
+    std::mt19937 rng(parser.value(seedOption).toUInt());
+    int repeat = qMax(1, parser.value(repeatOption).toInt());
+    double tolerance = parser.value(toleranceOption).toDouble();
+    QTextStream out(stdout);
+
+    const int sizes[] = {1, 2, 5, 7, 12, 33, 2048, 8192};
+    const int windows[] = {1, 2, 3, 5, 7, 9, 15, 31};
+    Check once, twice, invalid;
+    for (int r = 0; r < repeat; ++r)
+    {
+        for (int n : sizes)
+        {
+            for (double amplitude : {10.0, 1e3, 1e5})
+            {
+                QVector<double> spectrum = makeSpectrum(n, amplitude, rng);
+                for (int w : windows)
+                {
+                    QString what = QString("n=%1 window=%2 amplitude=%3").arg(n).arg(w).arg(amplitude, 0, 'g', 3);
+
+                    // 不合法的参数：不写输出
+                    if (w > n || w % 2 == 0)
+                    {
+                        QVector<double> output(n, -1.0), scratch(2 * n + 1);
+                        SysUtils::smooth(spectrum.data(), output.data(), n, w);
+                        bool ok = output == QVector<double>(n, -1.0);
+                        SysUtils::smoothTwice(spectrum.constData(), output.data(), scratch.data(), n, w);
+                        ok = ok && output == QVector<double>(n, -1.0);
+                        invalid.verify(ok, 0.0, what);
+                        continue;
+                    }
+
+                    // 计数为整数，前缀和与逐点求和都是精确的，单次平滑须逐位一致
+                    QVector<double> output(n), reference(n);
+                    SysUtils::smooth(spectrum.data(), output.data(), n, w);
+                    legacySmooth(spectrum.constData(), reference.data(), n, w);
+                    once.verify(output == reference, scaledError(output, reference), what);
+
+                    QVector<double> smooth1(n), scratch(2 * n + 1);
+                    SysUtils::smoothTwice(spectrum.constData(), output.data(), scratch.data(), n, w);
+                    legacySmooth(spectrum.constData(), smooth1.data(), n, w);
+                    legacySmooth(smooth1.constData(), reference.data(), n, w);
+                    double error = scaledError(output, reference);
+                    twice.verify(error <= tolerance, error, what + QString(" error=%1").arg(error, 0, 'e', 2));
+                }
+            }
+        }
+    }
+
+    // 寻峰时的用法：2048道，窗口5
+    const int timingRounds = 2000;
+    QVector<double> spectrum = makeSpectrum(2048, 1e4, rng);
+    QVector<double> smooth1(2048), output(2048), scratch(2 * 2048 + 1);
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < timingRounds; ++i)
+    {
+        legacySmooth(spectrum.constData(), smooth1.data(), 2048, 5);
+        legacySmooth(smooth1.constData(), output.data(), 2048, 5);
+    }
+    double legacyTime = timer.nsecsElapsed() / 1000.0 / timingRounds;
+    timer.restart();
+    for (int i = 0; i < timingRounds; ++i)
+        SysUtils::smoothTwice(spectrum.constData(), output.data(), scratch.data(), 2048, 5);
+    double currentTime = timer.nsecsElapsed() / 1000.0 / timingRounds;
+
+    out << QString("%1 smooth     ：%2组，不一致%3组，最大误差%4\n").arg(once.failures == 0 ? "PASS" : "FAIL")
+           .arg(once.cases).arg(once.failures).arg(once.maxError, 0, 'e', 2);
+    out << QString("%1 smoothTwice：%2组，超差%3组，最大误差%4\n").arg(twice.failures == 0 ? "PASS" : "FAIL")
+           .arg(twice.cases).arg(twice.failures).arg(twice.maxError, 0, 'e', 2);
+    out << QString("%1 非法参数   ：%2组，写入输出%3组\n").arg(invalid.failures == 0 ? "PASS" : "FAIL")
+           .arg(invalid.cases).arg(invalid.failures);
+    for (const Check* check : {&once, &twice, &invalid})
+    {
+        if (check->failures > 0)
+            out << QString("  首个失败：") << check->firstFailure << "\n";
+    }
+    out << QString("2048道两次平滑（窗口5）：原实现%1us，当前实现%2us\n")
+           .arg(legacyTime, 0, 'f', 2).arg(currentTime, 0, 'f', 2);
+
+    return once.failures + twice.failures + invalid.failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,25 @@
+QT       += core
+QT       -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+# 滑动平均回归测试：SysUtils::smooth/smoothTwice与原O(n*w)实现比对，独立于主程序构建
+SOURCES += \
+    ../../sysutils.cpp \
+    main.cpp
+
+HEADERS += \
+    ../../sysutils.h
+
+INCLUDEPATH += $$PWD/../..
+INCLUDEPATH += $$PWD/../../../3rdParty/eigen-5.0.0
+
+DESTDIR = $$PWD/../../../build_Zr_ActivationPro/tools
+
+CONFIG -= debug_and_release
+CONFIG(debug, debug|release) {
+    TARGET = SmoothTestd
+} else {
+    TARGET = SmoothTest
+}
@@ -0,0 +1,337 @@
+#include "huaweiswitchsimulator.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QLocale>
+#include <QRandomGenerator>
+#include <QRegularExpression>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+
+namespace {
+
+// Telnet命令字节
+const quint8 IAC = 255;
+const quint8 SB = 250;
+const quint8 WILL = 251;
+const quint8 DONT = 254;
+
+bool chance(double rate)
+{
+    return rate > 0.0 && QRandomGenerator::global()->generateDouble() < rate;
+}
+
+// 去掉客户端发来的Telnet选项协商，不完整的协商留在缓冲区等待后续数据
+QByteArray stripTelnetCommands(QByteArray& input)
+{
+    QByteArray text;
+    int i = 0;
+    while (i < input.size())
+    {
+        quint8 c = quint8(input.at(i));
+        if (c != IAC)
+        {
+            text.append(char(c));
+            i++;
+            continue;
+        }
+
+        if (i + 1 >= input.size())
+            break;
+        quint8 command = quint8(input.at(i + 1));
+        if (command == IAC)
+        {
+            text.append(char(IAC));
+            i += 2;
+        }
+        else if (command >= WILL && command <= DONT)
+        {
+            if (i + 2 >= input.size())
+                break;
+            i += 3;
+        }
+        else if (command == SB)
+        {
+            int end = input.indexOf(QByteArray("\xFF\xF0", 2), i + 2);
+            if (end < 0)
+                break;
+            i = end + 2;
+        }
+        else
+        {
+            i += 2;
+        }
+    }
+
+    input.remove(0, i);
+    return text;
+}
+
+}
+
+SwitchSession::SwitchSession(QTcpSocket *socket, SimulatedSwitch *owner)
+    : QObject(owner)
+    , mSocket(socket)
+    , mOwner(owner)
+{
+    mSocket->setParent(this);
+    mName = QString("%1 <- %2:%3").arg(owner->name()).arg(socket->peerAddress().toString()).arg(socket->peerPort());
+    mElapsed.start();
+    qInfo().noquote() << QString("[%1]连接").arg(mName);
+
+    connect(mSocket, &QTcpSocket::readyRead, this, &SwitchSession::onReadyRead);
+    connect(mSocket, &QTcpSocket::disconnected, this, [=](){
+        qInfo().noquote() << QString("[%1]断开，处理指令%2条，丢弃应答%3条，会话时长%4ms")
+                             .arg(mName).arg(mCommandCount).arg(mDroppedCount).arg(mElapsed.elapsed());
+        deleteLater();
+    });
+
+    // 登录提示同样按应答延迟发出
+    QTimer::singleShot(mOwner->options().latency, this, [=](){
+        QByteArray banner = "\r\n\r\nLogin authentication\r\n\r\n\r\nUsername:";
+        mSocket->write(banner);
+    });
+}
+
+void SwitchSession::onReadyRead()
+{
+    mInput.append(mSocket->readAll());
+    QByteArray text = stripTelnetCommands(mInput);
+
+    // 客户端以\r、\r\n或\r\0结束一行，\r之后的\n、\0不再作为空行
+    for (char c : text)
+    {
+        if ((c == '\n' || c == '\0') && mLastWasCR)
+        {
+            mLastWasCR = false;
+            continue;
+        }
+        mLastWasCR = (c == '\r');
+        if (c == '\r' || c == '\n')
+        {
+            mPending.enqueue(QString::fromLatin1(mLine));
+            mLine.clear();
+        }
+        else
+        {
+            mLine.append(c);
+        }
+    }
+
+    if (!mBusy)
+        processNext();
+}
+
+void SwitchSession::processNext()
+{
+    if (mPending.isEmpty() || mSocket->state() != QAbstractSocket::ConnectedState)
+    {
+        mBusy = false;
+        return;
+    }
+
+    mBusy = true;
+    QString line = mPending.dequeue();
+    mCommandCount++;
+
+    const SimulatorOptions& options = mOwner->options();
+    int delay = options.latency;
+    if (options.jitter > 0)
+        delay += QRandomGenerator::global()->bounded(options.jitter + 1);
+
+    QTimer::singleShot(delay, this, [=](){
+        const SimulatorOptions& options = mOwner->options();
+        if (mView != UsernameView && mView != PasswordView)
+        {
+            // 故障注入：断开连接、会话失效
+            if (chance(options.disconnectRate))
+            {
+                qInfo().noquote() << QString("[%1]故障注入：断开连接（指令\"%2\"）").arg(mName).arg(line);
+                mPending.clear();
+                mSocket->abort();
+                return;
+            }
+            if (chance(options.expireRate))
+            {
+                qInfo().noquote() << QString("[%1]故障注入：会话失效（指令\"%2\"）").arg(mName).arg(line);
+                mPending.clear();
+                mView = UsernameView;
+                mSocket->write("\r\n\r\nLogin authentication\r\n\r\n\r\nUsername:");
+                mBusy = false;
+                return;
+            }
+        }
+
+        bool close = false;
+        QByteArray response = execute(line, close);
+        if (chance(options.dropRate))
+        {
+            mDroppedCount++;
+            qInfo().noquote() << QString("[%1]故障注入：丢弃应答（指令\"%2\"）").arg(mName).arg(line);
+        }
+        else
+        {
+            mSocket->write(response);
+        }
+
+        if (close)
+        {
+            mPending.clear();
+            mSocket->disconnectFromHost();
+            return;
+        }
+        processNext();
+    });
+}
+
+QString SwitchSession::prompt() const
+{
+    switch (mView) {
+    case UsernameView:
+        return "Username:";
+    case PasswordView:
+        return "Password:";
+    case UserView:
+        return "<HUAWEI>";
+    case SystemView:
+        return "[HUAWEI]";
+    case InterfaceView:
+        return QString("[HUAWEI-GigabitEthernet0/0/%1]").arg(mInterfacePort);
+    }
+    return QString();
+}
+
+QByteArray SwitchSession::execute(const QString &line, bool &close)
+{
+    const SimulatorOptions& options = mOwner->options();
+    QString command = line.simplified();
+    QStringList output;
+
+    // 登录，用户名回显，密码不回显
+    if (mView == UsernameView)
+    {
+        mUsername = command;
+        mView = PasswordView;
+        return (line + "\r\n" + prompt()).toLatin1();
+    }
+    if (mView == PasswordView)
+    {
+        if (mUsername == options.username && command == options.password)
+        {
+            mView = UserView;
+            return ("\r\n" + prompt()).toLatin1();
+        }
+
+        mView = UsernameView;
+        return ("\r\nError: Local authentication is rejected.\r\n\r\n" + prompt()).toLatin1();
+    }
+
+    static const QRegularExpression interfacePattern("^interface GigabitEthernet ?0/0/(\\d+)$");
+    static const QRegularExpression statePattern("^display poe power-state interface GigabitEthernet ?0/0/(\\d+)$");
+    QRegularExpressionMatch match;
+
+    if (command.isEmpty())
+    {
+    }
+    else if (command == "quit")
+    {
+        if (mView == InterfaceView)
+            mView = SystemView;
+        else if (mView == SystemView)
+            mView = UserView;
+        else
+        {
+            close = true;
+            return (line + "\r\n").toLatin1();
+        }
+    }
+    else if (command == "system-view" && mView == UserView)
+    {
+        output << "Enter system view, return user view with Ctrl+Z.";
+        mView = SystemView;
+    }
+    else if (command == "display clock")
+    {
+        QDateTime now = QDateTime::currentDateTime();
+        output << now.toString("yyyy-MM-dd HH:mm:ss")
+               << QLocale(QLocale::English).dayName(now.date().dayOfWeek())
+               << "Time Zone(China-Standard-Time) : UTC+08:00";
+    }
+    else if ((match = interfacePattern.match(command)).hasMatch() && mView != UserView)
+    {
+        int port = match.captured(1).toInt();
+        if (mOwner->isPortValid(port))
+        {
+            mInterfacePort = port;
+            mView = InterfaceView;
+        }
+        else
+        {
+            output << "                                        ^"
+                   << "Error: Wrong parameter found at '^' position.";
+        }
+    }
+    else if ((command == "poe enable" || command == "undo poe enable") && mView == InterfaceView)
+    {
+        bool on = command == "poe enable";
+        if (options.failPorts.contains(mInterfacePort))
+            output << QString("Error: Failed to %1 PoE on the port.").arg(on ? "enable" : "disable");
+        else if (mOwner->isPowerOn(mInterfacePort) == on)
+            output << QString("Warning: This port is %1 already.").arg(on ? "enabled" : "disabled");
+        else
+            mOwner->setPowerOn(mInterfacePort, on);
+    }
+    else if ((match = statePattern.match(command)).hasMatch())
+    {
+        int port = match.captured(1).toInt();
+        if (mOwner->isPortValid(port))
+        {
+            bool on = mOwner->isPowerOn(port);
+            output << QString("Port power ON/OFF         : %1").arg(on ? "on" : "off")
+                   << QString("Port power status         : %1").arg(on ? "Powered" : "Disabled")
+                   << QString("Port PD detection status  : %1").arg(on ? "Delivering-power" : "Disabled")
+                   << QString("Power enable state        : %1").arg(on ? "enable" : "disable")
+                   << "Power priority            : Low";
+        }
+        else
+        {
+            output << "Error: Wrong parameter found at '^' position.";
+        }
+    }
+    else
+    {
+        output << "                    ^"
+               << "Error: Unrecognized command found at '^' position.";
+    }
+
+    QString response = line + "\r\n";
+    for (const QString& text : qAsConst(output))
+        response += text + "\r\n";
+    response += prompt();
+    return response.toLatin1();
+}
+
+SimulatedSwitch::SimulatedSwitch(const SimulatorOptions &options, QObject *parent)
+    : QObject(parent)
+    , mOptions(options)
+{
+    mPowerOn.fill(false, qMax(1, options.portCount));
+    mServer = new QTcpServer(this);
+    connect(mServer, &QTcpServer::newConnection, this, [=](){
+        while (QTcpSocket* socket = mServer->nextPendingConnection())
+            new SwitchSession(socket, this);
+    });
+}
+
+bool SimulatedSwitch::listen(const QHostAddress &address, quint16 port)
+{
+    mName = QString("%1:%2").arg(address.toString()).arg(port);
+    if (!mServer->listen(address, port))
+    {
+        qWarning().noquote() << QString("交换机模拟器[%1]监听失败：%2").arg(mName).arg(mServer->errorString());
+        return false;
+    }
+
+    qInfo().noquote() << QString("交换机模拟器[%1]已启动，POE端口%2个").arg(mName).arg(mPowerOn.size());
+    return true;
+}
@@ -0,0 +1,106 @@
+/*
+ * @Author: MrPan
+ * @Date: 2026-02-09 15:21:37
+ * @LastEditors: Maoxiaoqing
+ * @LastEditTime: 2026-02-09 15:21:37
+ * @Description: 华为交换机Telnet模拟器。模拟QHuaWeiSwitcherHelper用到的登录提示、system-view、
+ *               interface GigabitEthernet 0/0/N、(undo) poe enable、display poe power-state、display clock，
+ *               可设置应答延迟，并注入丢弃应答、断开连接、会话失效、端口上电失败等故障，
+ *               用于在没有交换机的情况下测试心跳/重连逻辑和测量POE上电耗时。
+ */
+#ifndef HUAWEISWITCHSIMULATOR_H
+#define HUAWEISWITCHSIMULATOR_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QQueue>
+#include <QSet>
+#include <QVector>
+
+class QTcpServer;
+class QTcpSocket;
+
+// 模拟参数
+struct SimulatorOptions {
+    QString username = "root";
+    QString password = "root@12345";
+    int portCount = 24;             // POE端口数
+    int latency = 20;               // 每条指令的应答延迟，ms
+    int jitter = 0;                 // 应答延迟随机增加[0, jitter]ms
+    double dropRate = 0.0;          // 丢弃应答（状态照常改变，但不回显、不回提示符）的概率
+    double disconnectRate = 0.0;    // 收到指令后直接断开连接的概率
+    double expireRate = 0.0;        // 收到指令后会话失效、回到Username:的概率
+    QSet<int> failPorts;            // (undo) poe enable 返回错误的端口
+};
+
+class SimulatedSwitch;
+
+/**
+ * @brief 一个Telnet会话，指令按收到的顺序逐条处理，每条指令延迟latency后应答
+ */
+class SwitchSession : public QObject
+{
+    Q_OBJECT
+public:
+    SwitchSession(QTcpSocket* socket, SimulatedSwitch* owner);
+
+private:
+    enum View {
+        UsernameView,
+        PasswordView,
+        UserView,       // <HUAWEI>
+        SystemView,     // [HUAWEI]
+        InterfaceView   // [HUAWEI-GigabitEthernet0/0/N]
+    };
+
+    void onReadyRead();
+    void processNext();
+
+    // 执行一条指令，返回回显、输出和新的提示符；close为true时应答后断开
+    QByteArray execute(const QString& line, bool& close);
+    QString prompt() const;
+
+    QTcpSocket* mSocket = nullptr;
+    SimulatedSwitch* mOwner = nullptr;
+    QString mName;
+    QByteArray mInput;
+    QByteArray mLine;           // 未结束的一行
+    bool mLastWasCR = false;
+    QQueue<QString> mPending;
+    bool mBusy = false;
+    View mView = UsernameView;
+    QString mUsername;
+    int mInterfacePort = 0;
+
+    // 会话统计
+    QElapsedTimer mElapsed;
+    int mCommandCount = 0;
+    int mDroppedCount = 0;
+};
+
+/**
+ * @brief 一台模拟交换机，监听一个端口，POE端口状态在各会话间共享
+ */
+class SimulatedSwitch : public QObject
+{
+    Q_OBJECT
+public:
+    SimulatedSwitch(const SimulatorOptions& options, QObject* parent = nullptr);
+
+    bool listen(const QHostAddress& address, quint16 port);
+    QString name() const { return mName; }
+    const SimulatorOptions& options() const { return mOptions; }
+
+    bool isPortValid(int port) const { return port >= 1 && port <= mPowerOn.size(); }
+    bool isPowerOn(int port) const { return mPowerOn.at(port - 1); }
+    void setPowerOn(int port, bool on) { mPowerOn[port - 1] = on; }
+
+private:
+    SimulatorOptions mOptions;
+    QTcpServer* mServer = nullptr;
+    QString mName;
+    QVector<bool> mPowerOn;
+};
+
+#endif // HUAWEISWITCHSIMULATOR_H
@@ -0,0 +1,71 @@
+/*
+ * @Author: MrPan
+ * @Date: 2026-02-09 15:21:37
+ * @LastEditors: Maoxiaoqing
+ * @LastEditTime: 2026-02-09 15:21:37
+ * @Description: 交换机模拟器入口。例：SwitchSimulator --count 3 --port 2323 --latency 30 --drop 0.01
+ *               启动3台模拟交换机，监听127.0.0.1:2323~2325；主程序配置文件中对应设置
+ *               Switcher/N/ip=127.0.0.1、Switcher/N/port=2323+N-1即可连接。
+ */
+#include "huaweiswitchsimulator.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("SwitchSimulator");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("华为交换机Telnet模拟器，用于测试交换机控制和测量POE上电耗时");
+    parser.addHelpOption();
+    QCommandLineOption listenOption("listen", "监听地址", "address", "127.0.0.1");
+    QCommandLineOption portOption("port", "第一台交换机的监听端口，之后的交换机依次加1", "port", "2323");
+    QCommandLineOption countOption("count", "模拟的交换机台数", "count", "1");
+    QCommandLineOption poePortsOption("poe-ports", "每台交换机的POE端口数", "count", "24");
+    QCommandLineOption latencyOption("latency", "每条指令的应答延迟，ms", "ms", "20");
+    QCommandLineOption jitterOption("jitter", "应答延迟的随机增量上限，ms", "ms", "0");
+    QCommandLineOption dropOption("drop", "丢弃应答的概率", "rate", "0");
+    QCommandLineOption disconnectOption("disconnect", "收到指令后断开连接的概率", "rate", "0");
+    QCommandLineOption expireOption("expire", "收到指令后会话失效、回到Username:的概率", "rate", "0");
+    QCommandLineOption failPortsOption("fail-ports", "(undo) poe enable返回错误的端口，逗号分隔", "ports");
+    QCommandLineOption usernameOption("username", "登录用户名", "name", "root");
+    QCommandLineOption passwordOption("password", "登录密码", "password", "root@12345");
+    parser.addOptions({listenOption, portOption, countOption, poePortsOption, latencyOption, jitterOption,
+                       dropOption, disconnectOption, expireOption, failPortsOption, usernameOption, passwordOption});
+    parser.process(app);
+
+    SimulatorOptions options;
+    options.username = parser.value(usernameOption);
+    options.password = parser.value(passwordOption);
+    options.portCount = qBound(1, parser.value(poePortsOption).toInt(), 52);
+    options.latency = qMax(0, parser.value(latencyOption).toInt());
+    options.jitter = qMax(0, parser.value(jitterOption).toInt());
+    options.dropRate = qBound(0.0, parser.value(dropOption).toDouble(), 1.0);
+    options.disconnectRate = qBound(0.0, parser.value(disconnectOption).toDouble(), 1.0);
+    options.expireRate = qBound(0.0, parser.value(expireOption).toDouble(), 1.0);
+    for (const QString& port : parser.value(failPortsOption).split(',', Qt::SkipEmptyParts))
+        options.failPorts.insert(port.trimmed().toInt());
+
+    QHostAddress address(parser.value(listenOption));
+    if (address.isNull())
+    {
+        qWarning().noquote() << QString("监听地址[%1]不合法").arg(parser.value(listenOption));
+        return 1;
+    }
+
+    quint16 firstPort = quint16(parser.value(portOption).toUInt());
+    int count = qMax(1, parser.value(countOption).toInt());
+    for (int i = 0; i < count; ++i)
+    {
+        SimulatedSwitch* simulatedSwitch = new SimulatedSwitch(options, &app);
+        if (!simulatedSwitch->listen(address, quint16(firstPort + i)))
+            return 1;
+    }
+
+    qInfo().noquote() << QString("应答延迟%1(+0~%2)ms，丢弃应答%3，断开连接%4，会话失效%5")
+                         .arg(options.latency).arg(options.jitter)
+                         .arg(options.dropRate).arg(options.disconnectRate).arg(options.expireRate);
+    return app.exec();
+}
@@ -0,0 +1,22 @@
+QT       += core network
+QT       -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+# 华为交换机Telnet模拟器，独立于主程序构建
+SOURCES += \
+    huaweiswitchsimulator.cpp \
+    main.cpp
+
+HEADERS += \
+    huaweiswitchsimulator.h
+
+DESTDIR = $$PWD/../../../build_Zr_ActivationPro/tools
+
+CONFIG -= debug_and_release
+CONFIG(debug, debug|release) {
+    TARGET = SwitchSimulatord
+} else {
+    TARGET = SwitchSimulator
+}
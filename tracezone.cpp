@@ -0,0 +1,214 @@
+#include "tracezone.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMap>
+#include <QMutex>
+#include <QSet>
+#include <QTextStream>
+#include <QThread>
+#include <QVector>
+#include <algorithm>
+
+std::atomic<bool> TraceRecorder::gEnabled(false);
+
+namespace {
+
+// 每个线程保留的事件数，写满后覆盖最早的事件
+const int bufferCapacity = 16384;
+
+struct TraceEvent {
+    const char* name;
+    qint64 begin;  // ns
+    qint64 end;    // ns
+    quint32 threadId;
+    quint16 detectorId;
+};
+
+struct ThreadBuffer {
+    QMutex mutex; // 只在导出时与写入线程争用
+    QVector<TraceEvent> events;
+    quint64 written = 0;
+    quint32 threadId = 0;
+    bool inUse = false;
+};
+
+struct Registry {
+    QMutex mutex;
+    QVector<ThreadBuffer*> buffers;
+    QMap<quint32, QString> threadNames;
+    quint32 nextThreadId = 1;
+    QElapsedTimer clock;
+
+    Registry() { clock.start(); }
+};
+
+Registry& registry()
+{
+    static Registry instance;
+    return instance;
+}
+
+// 线程退出时归还缓冲区，供之后创建的线程复用，已记录的事件保留到被覆盖为止
+struct ThreadBufferHolder {
+    ThreadBuffer* buffer = nullptr;
+    ~ThreadBufferHolder()
+    {
+        if (buffer)
+        {
+            QMutexLocker locker(&registry().mutex);
+            buffer->inUse = false;
+        }
+    }
+};
+thread_local ThreadBufferHolder threadBufferHolder;
+
+ThreadBuffer* currentThreadBuffer()
+{
+    if (threadBufferHolder.buffer)
+        return threadBufferHolder.buffer;
+
+    Registry& reg = registry();
+    QMutexLocker locker(&reg.mutex);
+    ThreadBuffer* buffer = nullptr;
+    for (ThreadBuffer* candidate : qAsConst(reg.buffers))
+    {
+        if (!candidate->inUse)
+        {
+            buffer = candidate;
+            break;
+        }
+    }
+    if (!buffer)
+    {
+        buffer = new ThreadBuffer;
+        buffer->events.resize(bufferCapacity);
+        reg.buffers.append(buffer);
+    }
+
+    quint32 threadId = reg.nextThreadId++;
+    QThread* thread = QThread::currentThread();
+    QString threadName = thread->objectName();
+    if (QCoreApplication::instance() && thread == QCoreApplication::instance()->thread())
+        threadName = "主线程";
+    else if (threadName.isEmpty())
+        threadName = QString("线程%1").arg(threadId);
+    reg.threadNames[threadId] = threadName;
+
+    {
+        QMutexLocker bufferLocker(&buffer->mutex);
+        buffer->inUse = true;
+        buffer->threadId = threadId;
+    }
+    threadBufferHolder.buffer = buffer;
+    return buffer;
+}
+
+QString jsonEscape(QString text)
+{
+    return text.replace('\\', "\\\\").replace('"', "\\\"");
+}
+
+}
+
+void TraceRecorder::setEnabled(bool enabled)
+{
+    gEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+qint64 TraceRecorder::now()
+{
+    return registry().clock.nsecsElapsed();
+}
+
+void TraceRecorder::record(const char *name, int detectorId, qint64 beginNs, qint64 endNs)
+{
+    ThreadBuffer* buffer = currentThreadBuffer();
+    QMutexLocker locker(&buffer->mutex);
+    TraceEvent& event = buffer->events[int(buffer->written % bufferCapacity)];
+    event.name = name;
+    event.begin = beginNs;
+    event.end = endNs;
+    event.threadId = buffer->threadId;
+    event.detectorId = quint16(qMax(0, detectorId));
+    buffer->written++;
+}
+
+int TraceRecorder::exportChromeTrace(const QString &filePath, double seconds)
+{
+    // 复制各线程中结束时刻在最近seconds秒内的事件
+    qint64 from = now() - qint64(seconds * 1.0e9);
+    QVector<TraceEvent> events;
+    QMap<quint32, QString> threadNames;
+    {
+        Registry& reg = registry();
+        QMutexLocker locker(&reg.mutex);
+        threadNames = reg.threadNames;
+        for (ThreadBuffer* buffer : qAsConst(reg.buffers))
+        {
+            QMutexLocker bufferLocker(&buffer->mutex);
+            quint64 count = qMin<quint64>(buffer->written, bufferCapacity);
+            for (quint64 i = buffer->written - count; i < buffer->written; ++i)
+            {
+                const TraceEvent& event = buffer->events.at(int(i % bufferCapacity));
+                if (event.end >= from)
+                    events.append(event);
+            }
+        }
+    }
+    std::sort(events.begin(), events.end(), [](const TraceEvent& a, const TraceEvent& b) {
+        return a.begin < b.begin;
+    });
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+        return -1;
+
+    QTextStream out(&file);
+    out.setCodec("UTF-8");
+    out << "{\"traceEvents\":[\n";
+
+    // 进程名（谱仪）、线程名
+    QSet<int> processes;
+    QSet<QPair<int, quint32>> threads;
+    for (const TraceEvent& event : qAsConst(events))
+    {
+        processes.insert(event.detectorId);
+        threads.insert(qMakePair(int(event.detectorId), event.threadId));
+    }
+    bool first = true;
+    auto separator = [&]() -> const char* {
+        if (first)
+        {
+            first = false;
+            return "";
+        }
+        return ",\n";
+    };
+    for (int pid : qAsConst(processes))
+    {
+        QString processName = pid == 0 ? QString("应用程序") : QString("谱仪#%1").arg(pid);
+        out << separator() << QString("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%1,\"args\":{\"name\":\"%2\"}}").arg(pid).arg(processName);
+        out << separator() << QString("{\"name\":\"process_sort_index\",\"ph\":\"M\",\"pid\":%1,\"args\":{\"sort_index\":%1}}").arg(pid);
+    }
+    for (const QPair<int, quint32>& thread : qAsConst(threads))
+    {
+        out << separator() << QString("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%1,\"tid\":%2,\"args\":{\"name\":\"%3\"}}")
+                              .arg(thread.first).arg(thread.second).arg(jsonEscape(threadNames.value(thread.second)));
+    }
+
+    // 完整事件，时间单位us
+    for (const TraceEvent& event : qAsConst(events))
+    {
+        out << separator() << QString("{\"name\":\"%1\",\"cat\":\"zr\",\"ph\":\"X\",\"pid\":%2,\"tid\":%3,\"ts\":%4,\"dur\":%5}")
+                              .arg(jsonEscape(QString::fromUtf8(event.name)))
+                              .arg(event.detectorId)
+                              .arg(event.threadId)
+                              .arg(event.begin / 1000.0, 0, 'f', 3)
+                              .arg((event.end - event.begin) / 1000.0, 0, 'f', 3);
+    }
+
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    out.flush();
+    return file.error() == QFile::NoError ? events.size() : -1;
+}
@@ -0,0 +1,82 @@
+/*
+ * @Author: MrPan
+ * @Date: 2026-02-08 19:12:09
+ * @LastEditors: Maoxiaoqing
+ * @LastEditTime: 2026-02-08 19:12:09
+ * @Description: 热点路径耗时跟踪。TRACE_ZONE在作用域结束时把一段耗时记录到本线程的环形缓冲区，
+ *               未开启跟踪时只读取一个原子标志；可导出最近若干秒的记录为Chrome Trace JSON文件，
+ *               在chrome://tracing或Perfetto中按谱仪、线程查看时间线。
+ */
+#ifndef TRACEZONE_H
+#define TRACEZONE_H
+
+#include <QString>
+#include <atomic>
+
+class TraceRecorder
+{
+public:
+    // 开启/关闭记录，关闭后已记录的数据保留
+    static void setEnabled(bool enabled);
+    static bool isEnabled() { return gEnabled.load(std::memory_order_relaxed); }
+
+    // 当前时刻，ns，各线程共用同一时间基准
+    static qint64 now();
+
+    /**
+     * @brief record 记录一段耗时，由TraceZone调用
+     * @param name 名称，必须是静态字符串
+     * @param detectorId 谱仪编号，0表示与谱仪无关
+     */
+    static void record(const char* name, int detectorId, qint64 beginNs, qint64 endNs);
+
+    /**
+     * @brief exportChromeTrace 导出最近seconds秒的记录为Chrome Trace JSON（“X”完整事件），
+     * 每个谱仪为一个进程，与谱仪无关的记录归入“应用程序”
+     * @return 导出的事件数，写文件失败返回-1
+     */
+    static int exportChromeTrace(const QString& filePath, double seconds);
+
+private:
+    static std::atomic<bool> gEnabled;
+};
+
+/**
+ * @brief 作用域耗时记录，构造时记下开始时刻，析构时写入本线程缓冲区
+ */
+class TraceZone
+{
+public:
+    explicit TraceZone(const char* name, int detectorId = 0)
+    {
+        if (TraceRecorder::isEnabled())
+        {
+            mName = name;
+            mDetectorId = detectorId;
+            mBegin = TraceRecorder::now();
+        }
+    }
+
+    ~TraceZone()
+    {
+        if (mName)
+            TraceRecorder::record(mName, mDetectorId, mBegin, TraceRecorder::now());
+    }
+
+    TraceZone(const TraceZone&) = delete;
+    TraceZone& operator=(const TraceZone&) = delete;
+
+private:
+    const char* mName = nullptr;
+    int mDetectorId = 0;
+    qint64 mBegin = 0;
+};
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+// 记录当前作用域的耗时
+#define TRACE_ZONE(name) TraceZone TRACE_CONCAT(traceZone_, __LINE__)(name)
+// 记录当前作用域的耗时，归入指定谱仪的时间线
+#define TRACE_ZONE_DET(name, detectorId) TraceZone TRACE_CONCAT(traceZone_, __LINE__)(name, detectorId)
+
+#endif // TRACEZONE_H